@@ -0,0 +1,273 @@
+// File: bdi/core/graph/BDIGraph.cpp
+ #include "BDIGraph.hpp"
+ #include "CompiledGraph.hpp"
+ #include "../serialization/GraphStream.hpp"
+ #include <algorithm>
+ #include <new>
+ #include <unordered_map>
+ #include <unordered_set>
+ namespace bdi::core::graph {
+ BDIGraph::NodePtr BDIGraph::createNode(NodeID node_id, BDIOperationType op) {
+    void* memory = arena_->allocate(sizeof(BDINode), alignof(BDINode));
+    return NodePtr(new (memory) BDINode(node_id, op, arena_.get()));
+ }
+ NodeID BDIGraph::addNode(std::unique_ptr<BDINode> node) {
+    if (!node) return 0;
+    // Keep a caller-chosen ID if it is free, otherwise assign the next one
+    NodeID id = node->id;
+    if (id == 0 || nodes_.count(id)) id = next_node_id_;
+    next_node_id_ = std::max(next_node_id_, id + 1);
+    // Move into an arena node; the edge lists are copied into the arena since the allocators differ
+    NodePtr stored = createNode(id, node->operation);
+    stored->data_inputs = std::move(node->data_inputs);
+    stored->data_outputs = std::move(node->data_outputs);
+    stored->control_inputs = std::move(node->control_inputs);
+    stored->control_outputs = std::move(node->control_outputs);
+    stored->payload = std::move(node->payload);
+    stored->metadata_handle = node->metadata_handle;
+    stored->region_id = node->region_id;
+    if (edit_depth_ == 0) {
+        for (size_t k = 0; k < stored->data_inputs.size(); ++k) {
+            const PortRef& ref = stored->data_inputs[k];
+            if (ref.node_id != 0) addUse(ref, PortRef{id, static_cast<PortIndex>(k)});
+        }
+    }
+    nodes_.emplace(id, std::move(stored));
+    return id;
+ }
+ NodeID BDIGraph::addNode(BDIOperationType op) {
+    NodeID id = next_node_id_++;
+    nodes_.emplace(id, createNode(id, op));
+    return id;
+ }
+ bool BDIGraph::removeNode(NodeID node_id) {
+    auto it = nodes_.find(node_id);
+    if (it == nodes_.end()) return false;
+    if (edit_depth_ != 0) {
+        // Edges may not match the index while editing; commitEdit() sweeps them
+        removed_in_edit_.push_back(node_id);
+        nodes_.erase(it);
+        return true;
+    }
+    const BDINode& node = *it->second;
+    for (size_t k = 0; k < node.data_inputs.size(); ++k) {
+        const PortRef& ref = node.data_inputs[k];
+        if (ref.node_id != 0) dropUse(ref, PortRef{node_id, static_cast<PortIndex>(k)});
+    }
+    // Control edges are stored on both ends
+    for (NodeID pred : node.control_inputs) {
+        if (BDINode* other = getNodeMutable(pred)) std::erase(other->control_outputs, node_id);
+    }
+    for (NodeID succ : node.control_outputs) {
+        if (BDINode* other = getNodeMutable(succ)) std::erase(other->control_inputs, node_id);
+    }
+    nodes_.erase(it);
+    // Readers of the removed node lose that input
+    if (auto uses = consumers_.find(node_id); uses != consumers_.end()) {
+        for (const DataUse& use : uses->second) {
+            BDINode* reader = getNodeMutable(use.consumer.node_id);
+            if (reader && use.consumer.port_index < reader->data_inputs.size() &&
+                reader->data_inputs[use.consumer.port_index].node_id == node_id) {
+                reader->data_inputs[use.consumer.port_index] = PortRef{};
+            }
+        }
+        consumers_.erase(uses);
+    }
+    return true;
+ }
+ size_t BDIGraph::removeNodes(std::span<const NodeID> node_ids) {
+    size_t removed = 0;
+    for (NodeID id : node_ids) removed += removeNode(id);
+    return removed;
+ }
+ bool BDIGraph::connectData(NodeID from_node_id, PortIndex from_port_idx, NodeID to_node_id, PortIndex to_input_idx) {
+    BDINode* from = getNodeMutable(from_node_id);
+    BDINode* to = getNodeMutable(to_node_id);
+    if (!from || !to) return false;
+    if (to->data_inputs.size() <= to_input_idx) {
+        to->data_inputs.resize(static_cast<size_t>(to_input_idx) + 1);
+    }
+    PortRef& input = to->data_inputs[to_input_idx];
+    const PortRef source{from_node_id, from_port_idx};
+    if (edit_depth_ == 0 && input != source) {
+        if (input.node_id != 0) dropUse(input, PortRef{to_node_id, to_input_idx});
+        addUse(source, PortRef{to_node_id, to_input_idx});
+    }
+    input = source;
+    return true;
+ }
+ bool BDIGraph::connectControl(NodeID from_node_id, NodeID to_node_id) {
+    BDINode* from = getNodeMutable(from_node_id);
+    BDINode* to = getNodeMutable(to_node_id);
+    if (!from || !to) return false;
+    from->control_outputs.push_back(to_node_id);
+    to->control_inputs.push_back(from_node_id);
+    return true;
+ }
+ bool BDIGraph::disconnectData(NodeID to_node_id, PortIndex to_input_idx) {
+    BDINode* to = getNodeMutable(to_node_id);
+    if (!to || to_input_idx >= to->data_inputs.size() || to->data_inputs[to_input_idx].node_id == 0) return false;
+    if (edit_depth_ == 0) dropUse(to->data_inputs[to_input_idx], PortRef{to_node_id, to_input_idx});
+    to->data_inputs[to_input_idx] = PortRef{};
+    return true;
+ }
+ bool BDIGraph::disconnectControl(NodeID from_node_id, NodeID to_node_id) {
+    BDINode* from = getNodeMutable(from_node_id);
+    BDINode* to = getNodeMutable(to_node_id);
+    if (!from || !to) return false;
+    auto out = std::find(from->control_outputs.begin(), from->control_outputs.end(), to_node_id);
+    auto in = std::find(to->control_inputs.begin(), to->control_inputs.end(), from_node_id);
+    if (out == from->control_outputs.end() || in == to->control_inputs.end()) return false;
+    from->control_outputs.erase(out);
+    to->control_inputs.erase(in);
+    return true;
+ }
+ void BDIGraph::commitEdit() {
+    if (edit_depth_ == 0 || --edit_depth_ != 0) return;
+    if (!removed_in_edit_.empty()) {
+        // One sweep drops every edge that referenced a node removed during the edit. A node added under
+        // a removed ID replaces it: data inputs reading the ID stay, and its own control lists decide
+        // which of the other ends' control edges to it stay.
+        std::unordered_set<NodeID> removed;
+        std::unordered_map<NodeID, std::unordered_map<NodeID, size_t>> preds, succs; // Per replacement
+        for (NodeID id : removed_in_edit_) {
+            auto it = nodes_.find(id);
+            if (it == nodes_.end()) {
+                removed.insert(id);
+            } else if (!preds.count(id)) {
+                auto& p = preds[id];
+                auto& q = succs[id];
+                for (NodeID pred : it->second->control_inputs) ++p[pred];
+                for (NodeID succ : it->second->control_outputs) ++q[succ];
+            }
+        }
+        auto gone = [&](NodeID id) { return removed.count(id) != 0; };
+        // Keeps as many 'other' -> 'id' entries as the replacement 'id' lists the other way round
+        auto unmirrored = [](std::unordered_map<NodeID, std::unordered_map<NodeID, size_t>>& mirrors, NodeID other) {
+            return [&mirrors, other](NodeID id) {
+                auto it = mirrors.find(id);
+                if (it == mirrors.end() || id == other) return false;
+                size_t& count = it->second[other];
+                if (count == 0) return true;
+                --count;
+                return false;
+            };
+        };
+        for (auto& [id, node] : nodes_) {
+            for (auto& input : node->data_inputs) {
+                if (gone(input.node_id)) input = PortRef{};
+            }
+            std::erase_if(node->control_inputs, gone);
+            std::erase_if(node->control_outputs, gone);
+            if (preds.empty()) continue;
+            std::erase_if(node->control_outputs, unmirrored(preds, id));
+            std::erase_if(node->control_inputs, unmirrored(succs, id));
+        }
+        removed_in_edit_.clear();
+    }
+    rebuildConsumerIndex();
+ }
+ void BDIGraph::addUse(const PortRef& source, const PortRef& consumer) {
+    consumers_[source.node_id].push_back(DataUse{source.port_index, consumer});
+ }
+ void BDIGraph::dropUse(const PortRef& source, const PortRef& consumer) {
+    auto it = consumers_.find(source.node_id);
+    if (it == consumers_.end()) return;
+    std::vector<DataUse>& uses = it->second;
+    for (size_t i = 0; i < uses.size(); ++i) {
+        if (uses[i].output != source.port_index || uses[i].consumer != consumer) continue;
+        uses[i] = uses.back();
+        uses.pop_back();
+        break;
+    }
+    if (uses.empty()) consumers_.erase(it);
+ }
+ void BDIGraph::rebuildConsumerIndex() {
+    consumers_.clear();
+    for (const auto& [id, node] : nodes_) {
+        for (size_t k = 0; k < node->data_inputs.size(); ++k) {
+            const PortRef& ref = node->data_inputs[k];
+            if (ref.node_id != 0) addUse(ref, PortRef{id, static_cast<PortIndex>(k)});
+        }
+    }
+ }
+ std::optional<std::reference_wrapper<BDINode>> BDIGraph::getNode(NodeID node_id) {
+    auto it = nodes_.find(node_id);
+    if (it == nodes_.end()) return std::nullopt;
+    return std::ref(*it->second);
+ }
+ std::optional<std::reference_wrapper<const BDINode>> BDIGraph::getNode(NodeID node_id) const {
+    auto it = nodes_.find(node_id);
+    if (it == nodes_.end()) return std::nullopt;
+    return std::cref(*it->second);
+ }
+ std::vector<PortRef> BDIGraph::getDataSourcesFor(NodeID node_id, PortIndex input_idx) const {
+    auto node = getNode(node_id);
+    if (!node || input_idx >= node->get().data_inputs.size()) return {};
+    const PortRef& ref = node->get().data_inputs[input_idx];
+    if (ref.node_id == 0) return {};
+    return {ref};
+ }
+ std::vector<PortRef> BDIGraph::getDataConsumersFor(NodeID node_id, PortIndex output_idx) const {
+    std::vector<PortRef> consumers;
+    if (edit_depth_ == 0) {
+        auto it = consumers_.find(node_id);
+        if (it == consumers_.end()) return consumers;
+        for (const DataUse& use : it->second) {
+            if (use.output == output_idx) consumers.push_back(use.consumer);
+        }
+        return consumers;
+    }
+    // The index is rebuilt at commitEdit(); until then scan the inputs
+    for (const auto& [id, node] : nodes_) {
+        for (size_t k = 0; k < node->data_inputs.size(); ++k) {
+            const PortRef& ref = node->data_inputs[k];
+            if (ref.node_id == node_id && ref.port_index == output_idx) {
+                consumers.push_back(PortRef{id, static_cast<PortIndex>(k)});
+            }
+        }
+    }
+    return consumers;
+ }
+ std::vector<NodeID> BDIGraph::getControlPredecessors(NodeID node_id) const {
+    auto node = getNode(node_id);
+    if (!node) return {};
+    return std::vector<NodeID>(node->get().control_inputs.begin(), node->get().control_inputs.end());
+ }
+ std::vector<NodeID> BDIGraph::getControlSuccessors(NodeID node_id) const {
+    auto node = getNode(node_id);
+    if (!node) return {};
+    return std::vector<NodeID>(node->get().control_outputs.begin(), node->get().control_outputs.end());
+ }
+ bool BDIGraph::validateGraph(std::vector<ValidationIssue>* issues) const {
+    // Validation walks the flat compiled view rather than chasing node pointers
+    return freeze()->validate(issues);
+ }
+ bool BDIGraph::serialize(std::ostream& os) const {
+    std::vector<const BDINode*> nodes;
+    nodes.reserve(nodes_.size());
+    for (const auto& [id, node] : nodes_) nodes.push_back(node.get());
+    std::sort(nodes.begin(), nodes.end(), [](const BDINode* a, const BDINode* b) { return a->id < b->id; });
+    serialization::GraphStreamWriter writer(os, name_);
+    for (const BDINode* node : nodes) {
+        if (!writer.writeNode(*node)) return false;
+    }
+    return writer.finish();
+ }
+ std::unique_ptr<BDIGraph> BDIGraph::deserialize(std::istream& is) {
+    serialization::GraphStreamReader reader(is);
+    if (!reader.isOpen()) return nullptr;
+    auto graph = std::make_unique<BDIGraph>(reader.getGraphName());
+    graph->beginEdit(); // Index the edges once, after the last node
+    while (auto node = reader.next()) {
+        NodeID id = node->id;
+        if (id == 0 || graph->addNode(std::move(node)) != id) return nullptr;
+    }
+    graph->commitEdit();
+    return reader.isComplete() ? std::move(graph) : nullptr;
+ }
+ BDINode* BDIGraph::getNodeMutable(NodeID node_id) {
+    auto it = nodes_.find(node_id);
+    return it == nodes_.end() ? nullptr : it->second.get();
+ }
+ } // namespace bdi::core::graph
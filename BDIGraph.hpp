@@ -2,43 +2,86 @@
  #ifndef BDI_CORE_GRAPH_BDIGRAPH_HPP
  #define BDI_CORE_GRAPH_BDIGRAPH_HPP
  #include "BDINode.hpp"
+ #include "GraphArena.hpp"
  #include <unordered_map>
  #include <vector>
  #include <optional>
  #include <string>
  #include <memory> // For std::unique_ptr
+ #include <iosfwd>
+ #include <span>
  namespace bdi::core::graph {
+ class CompiledGraph; // Immutable execution view, see CompiledGraph.hpp
+ // One problem found by validateGraph()
+ struct ValidationIssue {
+    NodeID node_id = 0; // 0: the graph as a whole
+    PortIndex port = 0; // Input, output or successor the problem is at, where it applies
+    ValidationError error = ValidationError::DANGLING_EDGE;
+ };
+ // Nodes, their edge lists and the node index are allocated from a per-graph GraphArena and released
+ // together when the graph is destroyed.
+ // Consumers of every node output are indexed, so consumer queries and edge cleanup on removal cost the
+ // node's degree rather than a scan of the graph. The index follows the editing methods below; data inputs
+ // changed directly through getNode() must be changed between beginEdit() and commitEdit().
  class BDIGraph {
  public:
     BDIGraph(std::string graph_name = "unnamed_bdi_graph")
-        : name_(std::move(graph_name)), next_node_id_(1) {} // Start IDs from 1 (0 reserved?)
+        : name_(std::move(graph_name)), arena_(std::make_unique<GraphArena>()),
+          nodes_(arena_.get()), next_node_id_(1) {} // Start IDs from 1 (0 reserved?)
+    // Movable (the arena moves with its nodes); not assignable
+    BDIGraph(BDIGraph&&) noexcept = default;
+    BDIGraph& operator=(BDIGraph&&) = delete;
     // --- Graph Modification --
-    // Add a new node, takes ownership if unique_ptr provided
+    // Add a new node, takes ownership if unique_ptr provided (its contents are moved into the arena)
     // Returns the assigned NodeID
     NodeID addNode(std::unique_ptr<BDINode> node);
     NodeID addNode(BDIOperationType op = BDIOperationType::META_NOP); // Creates node internally
-    // Remove a node (potentially complex due to edge cleanup)
+    // Remove a node and every edge that references it
     bool removeNode(NodeID node_id);
+    // Remove many nodes; returns how many were present
+    size_t removeNodes(std::span<const NodeID> node_ids);
     // Add data dependency edge: output 'from_port_idx' of 'from_node_id' -> input 'to_input_idx' of 'to_node_id'
+    // (replacing whatever the input was connected to)
     bool connectData(NodeID from_node_id, PortIndex from_port_idx, NodeID to_node_id, PortIndex to_input_idx);
     // Add control flow edge: from 'from_node_id' -> to 'to_node_id' (appends to output/input lists)
     bool connectControl(NodeID from_node_id, NodeID to_node_id);
-    // TODO: Add methods for conditional control flow, removing edges
+    // Leave input 'to_input_idx' of 'to_node_id' unconnected; false if it was not connected
+    bool disconnectData(NodeID to_node_id, PortIndex to_input_idx);
+    // Remove one control edge from -> to (the first, if there are several); false if there is none
+    bool disconnectControl(NodeID from_node_id, NodeID to_node_id);
+    // TODO: Add methods for conditional control flow
+    // --- Bulk Editing --
+    // Between beginEdit() and the matching commitEdit() (calls nest) edits skip index maintenance and
+    // node edges may be changed directly; removed nodes are only unlinked from the rest of the graph at
+    // commit. commitEdit() then sweeps the edges once and rebuilds the consumer index. A node added
+    // under the ID of one removed in the same edit replaces it: readers of the ID keep reading it.
+    // Consumer queries stay correct meanwhile, at the cost of a scan.
+    void beginEdit() { ++edit_depth_; }
+    void commitEdit();
+    bool isEditing() const { return edit_depth_ != 0; }
     // --- Graph Query --
     std::optional<std::reference_wrapper<BDINode>> getNode(NodeID node_id);
     std::optional<std::reference_wrapper<const BDINode>> getNode(NodeID node_id) const;
     size_t getNodeCount() const { return nodes_.size(); }
+    // Arena counters since construction (allocations served, heap chunks taken)
+    const GraphAllocationStats& getAllocationStats() const { return arena_->getStats(); }
     const std::string& getName() const { return name_; }
     // Get nodes providing data input to a specific input port of a node
     std::vector<PortRef> getDataSourcesFor(NodeID node_id, PortIndex input_idx) const;
-    // Get nodes consuming data output from a specific output port of a node
+    // Get nodes consuming data output from a specific output port of a node, as {consumer, input index}
     std::vector<PortRef> getDataConsumersFor(NodeID node_id, PortIndex output_idx) const;
     // Get control flow predecessors/successors
     std::vector<NodeID> getControlPredecessors(NodeID node_id) const;
     std::vector<NodeID> getControlSuccessors(NodeID node_id) const;
     // --- Validation --
-    // Perform comprehensive validation checks (types, connections, cycles if needed)
-    bool validateGraph() const;
+    // Edges, ports, operand and result types against the operation signatures, and data cycles.
+    // 'issues' (optional) receives every problem found; without it validation stops at the first.
+    bool validateGraph(std::vector<ValidationIssue>* issues = nullptr) const;
+    // --- Freezing --
+    // Build an immutable, contiguous view of the current graph for execution/validation.
+    // The view is a snapshot: later edits to this graph are not reflected in it.
+    // Defined in CompiledGraph.hpp
+    std::shared_ptr<const CompiledGraph> freeze() const;
     // --- Iteration --
     // Provide iterators to walk through nodes (const and non-const)
     auto begin() { return nodes_.begin(); }
@@ -48,27 +91,62 @@
     auto cbegin() const { return nodes_.cbegin(); }
     auto cend() const { return nodes_.cend(); }
     // --- Serialization --
-    // TODO: bool serialize(std::ostream& os) const;
-    // TODO: static std::unique_ptr<BDIGraph> deserialize(std::istream& is);
+    // Editable round trip through the record stream (GraphStream.hpp), nodes in NodeID order.
+    // For execution, save and mmap the frozen image instead (GraphImageFile.hpp).
+    bool serialize(std::ostream& os) const;
+    // nullptr on a truncated or corrupt stream or duplicate NodeIDs
+    static std::unique_ptr<BDIGraph> deserialize(std::istream& is);
  private:
+    // Runs the node destructor only; the memory belongs to the arena
+    struct ArenaNodeDeleter {
+        void operator()(BDINode* node) const { node->~BDINode(); }
+    };
+    using NodePtr = std::unique_ptr<BDINode, ArenaNodeDeleter>;
+    // One reader of a node output
+    struct DataUse {
+        PortIndex output;
+        PortRef consumer; // {consumer node, input index}
+    };
     std::string name_;
-    std::unordered_map<NodeID, std::unique_ptr<BDINode>> nodes_; // Using unique_ptr for ownership
+    std::unique_ptr<GraphArena> arena_; // Declared before nodes_: must outlive them
+    std::pmr::unordered_map<NodeID, NodePtr> nodes_;
     NodeID next_node_id_;
+    // Readers of each producer NodeID, in no particular order. On the heap rather than in the arena,
+    // since commitEdit() rebuilds it wholesale.
+    std::unordered_map<NodeID, std::vector<DataUse>> consumers_;
+    size_t edit_depth_ = 0;
+    std::vector<NodeID> removed_in_edit_;
     // Helper to get mutable node pointer
     BDINode* getNodeMutable(NodeID node_id);
+    NodePtr createNode(NodeID node_id, BDIOperationType op);
+    void addUse(const PortRef& source, const PortRef& consumer);
+    void dropUse(const PortRef& source, const PortRef& consumer);
+    void rebuildConsumerIndex();
  };
  // Implementation of BDINode::validatePorts needs BDIGraph definition
  inline bool BDINode::validatePorts(const BDIGraph& graph) const {
-    // Example validation: check if nodes referenced in data_inputs exist
     for (const auto& port_ref : data_inputs) {
-        if (!graph.getNode(port_ref.node_id)) {
-            return false; // Referenced node doesn't exist
-        }
-        // TODO: Check if the source node actually has the referenced output port
-        // TODO: Check type compatibility between source output and this input
+        if (port_ref.node_id == 0) continue; // Unconnected: the operand may come from the payload
+        auto source = graph.getNode(port_ref.node_id);
+        if (!source || port_ref.port_index >= source->get().data_outputs.size()) return false;
+    }
+    for (NodeID successor : control_outputs) {
+        if (!graph.getNode(successor)) return false;
+    }
+    for (NodeID predecessor : control_inputs) {
+        if (!graph.getNode(predecessor)) return false;
     }
-    // TODO: Add more checks for control flow etc.
-    return true;
+    auto input_type = [&](size_t k) -> std::optional<BDIType> {
+        const PortRef& ref = data_inputs[k];
+        if (ref.node_id == 0) return std::nullopt;
+        const BDINode& source = graph.getNode(ref.node_id)->get();
+        const BDIType declared = source.getOutputType(ref.port_index);
+        return ref.port_index == 0 ? getProducedType(source.operation, declared, source.payload.type) : declared;
+    };
+    bool valid = true;
+    checkOperation(operation, data_inputs.size(), input_type, payload.type, payload.data.size(), control_outputs.size(),
+                   getOutputType(0), [&valid](size_t, ValidationError) { return valid = false; });
+    return valid;
  }
  } // namespace bdi::core::graph
  #endif // BDI_CORE_GRAPH_BDIGRAPH_HPP
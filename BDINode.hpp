@@ -3,8 +3,10 @@
  #define BDI_CORE_GRAPH_BDINODE_HPP
  #include "../types/BDITypes.hpp"
  #include "../payload/TypedPayload.hpp"
- #include "OperationTypes.hpp"
+ #include "OperationSignatures.hpp"
+ #include "InternedName.hpp"
  #include <cstdint>
+ #include <memory_resource>
  #include <vector>
  #include <string>
  #include <map> // Or unordered_map if performance critical and hashing is fine
@@ -25,26 +27,28 @@
  // Describes an output port of a node
  struct PortInfo {
     BDIType type = BDIType::UNKNOWN;
-    std::string name = ""; // Optional symbolic name for debugging/introspection
-    PortInfo(BDIType t = BDIType::UNKNOWN, std::string n = "") : type(t), name(std::move(n)) {}
+    InternedName name; // Optional symbolic name for debugging/introspection
+    PortInfo(BDIType t = BDIType::UNKNOWN, InternedName n = {}) : type(t), name(n) {}
  };
  // The core structure representing a node in the BDI computation graph
+ // Edge lists are allocator-aware: nodes created by a BDIGraph keep them in the graph's arena,
+ // standalone nodes use the default heap.
  struct BDINode {
     NodeID id = 0;
     BDIOperationType operation = BDIOperationType::META_NOP;
     // Data Inputs: Specifies which node output ports provide data to this node
     // The index in this vector corresponds to the logical input number for the operation
-    std::vector<PortRef> data_inputs;
+    std::pmr::vector<PortRef> data_inputs;
     // Data Outputs: Describes the data produced by this node
     // Other nodes refer to these via {this->id, output_index}
-    std::vector<PortInfo> data_outputs;
+    std::pmr::vector<PortInfo> data_outputs;
     // Control Flow Inputs: Nodes that can transfer control *to* this node
     // Typically used for merge points, loop headers, function entries
-    std::vector<NodeID> control_inputs;
+    std::pmr::vector<NodeID> control_inputs;
     // Control Flow Outputs: Nodes where control can transfer *from* this node
     // Order might matter (e.g., for conditional branches: [true_target, false_target])
     // Could be map<ConditionValue, NodeID> for switch-like behavior
-    std::vector<NodeID> control_outputs;
+    std::pmr::vector<NodeID> control_outputs;
     // Immediate data or configuration used directly by the operation
     TypedPayload payload;
     // Handle to associated metadata (semantics, proofs, hints) in MetadataStore
@@ -52,13 +56,14 @@
     // Logical memory/compute region assignment
     RegionID region_id = 0;
     // --- Methods --
-    BDINode(NodeID node_id = 0, BDIOperationType op = BDIOperationType::META_NOP)
-        : id(node_id), operation(op) {}
-    // Helper to get expected input type (using a convention or op definition)
+    BDINode(NodeID node_id = 0, BDIOperationType op = BDIOperationType::META_NOP,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : id(node_id), operation(op),
+          data_inputs(resource), data_outputs(resource), control_inputs(resource), control_outputs(resource) {}
+    // Type input 'input_idx' should have according to the operation's signature (OperationSignatures.hpp)
+    // and the declared output type; UNKNOWN where the operation accepts a whole class of types
     BDIType getExpectedInputType(PortIndex input_idx) const {
-        // TODO: Implement logic based on 'operation' type
-        // This might require a separate definition table for operations
-        return BDIType::UNKNOWN; // Placeholder
+        return getExpectedOperandType(operation, input_idx, getOutputType(0));
     }
      // Helper to get output type
     BDIType getOutputType(PortIndex output_idx) const {
@@ -67,8 +72,8 @@
          }
          return BDIType::UNKNOWN;
     }
-    // Basic validation
-    bool validatePorts(const class BDIGraph& graph) const; // Declared here, defined later maybe in .cpp
+    // Sources and ports of the edges exist, and operands, result and successors match the signature
+    bool validatePorts(const class BDIGraph& graph) const; // Defined in BDIGraph.hpp
  };
  } // namespace bdi::core::graph
  #endif // BDI_CORE_GRAPH_BDINODE_HPP
@@ -0,0 +1,43 @@
+// File: bdi/core/types/BDITypes.hpp
+ #ifndef BDI_CORE_TYPES_BDITYPES_HPP
+ #define BDI_CORE_TYPES_BDITYPES_HPP
+ #include <cstddef>
+ #include <cstdint>
+ #include <vector>
+ namespace bdi::core::types {
+ // Scalar types carried by node ports and payloads. Stored as one byte in graph images and streams,
+ // so existing values must keep their numbers.
+ enum class BDIType : uint8_t {
+    UNKNOWN,
+    VOID,
+    BOOL,
+    INT8, UINT8,
+    INT16, UINT16,
+    INT32, UINT32,
+    INT64, UINT64,
+    FLOAT32, FLOAT64,
+    POINTER,  // Host address
+    MEM_REF,  // Address of a MemoryManager block
+    FUNC_PTR,
+    NODE_ID
+ };
+ // Raw bytes of a payload or serialized value
+ using BinaryData = std::vector<std::byte>;
+ // Size in bytes of one value of 'type'; 0 for UNKNOWN and VOID
+ inline constexpr size_t getBdiTypeSize(BDIType type) {
+    switch (type) {
+        case BDIType::BOOL: case BDIType::INT8: case BDIType::UINT8:
+            return 1;
+        case BDIType::INT16: case BDIType::UINT16:
+            return 2;
+        case BDIType::INT32: case BDIType::UINT32: case BDIType::FLOAT32:
+            return 4;
+        case BDIType::INT64: case BDIType::UINT64: case BDIType::FLOAT64:
+        case BDIType::POINTER: case BDIType::MEM_REF: case BDIType::FUNC_PTR: case BDIType::NODE_ID:
+            return 8;
+        default:
+            return 0;
+    }
+ }
+ } // namespace bdi::core::types
+ #endif // BDI_CORE_TYPES_BDITYPES_HPP
@@ -0,0 +1,759 @@
+// File: bdi/runtime/BDIVirtualMachine.cpp
+ #include "BDIVirtualMachine.hpp"
+ #include "IoPrint.hpp"
+ #include "OperationSemantics.hpp"
+ #include "kernels/VectorKernels.hpp"
+ #include "../meta/MetadataStore.hpp"
+ #include "memory/MemoryManager.hpp"
+ #include <algorithm>
+ #include <atomic>
+ #include <cstring>
+ namespace bdi::runtime {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::INVALID_NODE_INDEX;
+ using bdi::core::graph::INVALID_SLOT_INDEX;
+ namespace {
+ // Address, channel ID or other non-negative integer operand
+ bool toAddress(const RuntimeValue& value, uint64_t& out) {
+    if (value.type == BDIType::POINTER || value.type == BDIType::MEM_REF) {
+        out = value.bits;
+        return true;
+    }
+    if (!bdi::core::graph::isIntegerType(value.type)) return false;
+    const int64_t v = loadAs<int64_t>(value);
+    if (v < 0 && value.type != BDIType::UINT64) return false;
+    out = loadAs<uint64_t>(value);
+    return true;
+ }
+ template <typename T>
+ bool atomicFetchAdd(uint64_t address, const RuntimeValue& delta, BDIType type, RuntimeValue& previous) {
+    if (address % std::atomic_ref<T>::required_alignment != 0) return false;
+    std::atomic_ref<T> word(*reinterpret_cast<T*>(address));
+    previous = storeAs(type, word.fetch_add(loadAs<T>(delta)));
+    return true;
+ }
+ } // namespace
+ BDIVirtualMachine::BDIVirtualMachine()
+    : current_node_id_(0), current_index_(INVALID_NODE_INDEX) {}
+ bool BDIVirtualMachine::execute(BDIGraph& graph, NodeID entry_node_id) {
+    owned_graph_ = graph.freeze();
+    graph_ = nullptr; // A new snapshot, even if it lands at the address of the last one
+    return execute(*owned_graph_, entry_node_id);
+ }
+ bool BDIVirtualMachine::execute(const CompiledGraph& graph, NodeID entry_node_id) {
+    bool same_graph = false;
+    const NodeIndex entry = startRun(graph, entry_node_id, same_graph);
+    if (entry == INVALID_NODE_INDEX) return false;
+ #if BDI_TRACING
+    const uint64_t trace_begin = bindTrace(graph, !same_graph);
+ #endif
+    bool ok = true;
+    while (ok && !halted_) ok = fetchDecodeExecuteCycle(graph);
+ #if BDI_TRACING
+    if (trace_) trace_->recordRun(entry, trace_begin, trace::readCycleCounter());
+ #endif
+    return finishRun(ok);
+ }
+ concurrency::ExecutionTask BDIVirtualMachine::run(const CompiledGraph& graph, NodeID entry_node_id,
+                                                   concurrency::TaskScheduler& scheduler) {
+    scheduler_ = &scheduler;
+    bool same_graph = false;
+    const NodeIndex entry = startRun(graph, entry_node_id, same_graph);
+    if (entry == INVALID_NODE_INDEX) co_return false;
+ #if BDI_TRACING
+    const uint64_t trace_begin = bindTrace(graph, !same_graph);
+ #endif
+    bool ok = true;
+    for (;;) {
+        while (ok && !halted_) ok = fetchDecodeExecuteCycle(graph);
+        if (ok || wait_.kind == concurrency::WaitRequest::NONE) break;
+        // The worker goes back to the pool; the node is retried when (and wherever) the task resumes
+        co_await scheduler.wait(std::exchange(wait_, {}));
+        ok = true;
+ #if BDI_TRACING
+        if (trace_) bindTrace(graph, false);
+ #endif
+    }
+ #if BDI_TRACING
+    if (trace_) trace_->recordRun(entry, trace_begin, trace::readCycleCounter());
+ #endif
+    co_return finishRun(ok);
+ }
+ NodeIndex BDIVirtualMachine::startRun(const CompiledGraph& graph, NodeID entry_node_id, bool& same_graph) {
+    if (owned_graph_.get() != &graph) owned_graph_.reset();
+    same_graph = graph_ == &graph;
+    graph_ = &graph;
+    auto entry = graph.indexOf(entry_node_id);
+    if (!entry) {
+        reuse_valid_ = false;
+        return INVALID_NODE_INDEX;
+    }
+    current_index_ = *entry;
+    current_node_id_ = entry_node_id;
+    beginRun(*entry, same_graph);
+    return *entry;
+ }
+ bool BDIVirtualMachine::finishRun(bool ok) {
+    if (!ok) return false;
+    reuse_valid_ = incremental_;
+    return true;
+ }
+ uint64_t BDIVirtualMachine::bindTrace(const CompiledGraph& graph, bool new_snapshot) {
+    trace_ = nullptr;
+    if (!tracer_ || !tracer_->isEnabled()) return 0;
+    trace_ = &tracer_->threadTrace();
+    trace_->bindGraph(graph, new_snapshot);
+    return trace::readCycleCounter();
+ }
+ void BDIVirtualMachine::setNodePayload(NodeID node_id, const RuntimeValue& value) {
+    pending_payloads_.emplace_back(node_id, value);
+ }
+ void BDIVirtualMachine::clearPayloadOverrides() {
+    pending_payloads_.clear();
+    for (const auto& [node_id, value] : payload_overrides_) pending_payloads_.emplace_back(node_id, RuntimeValue{});
+ }
+ void BDIVirtualMachine::setIncremental(bool enabled) {
+    incremental_ = enabled;
+    reuse_valid_ = false;
+ }
+ void BDIVirtualMachine::setJitThreshold(uint32_t threshold) {
+    jit_threshold_ = jit::JitCompiler::isAvailable() ? threshold : 0;
+    resetJit();
+ }
+ void BDIVirtualMachine::invalidate(NodeID node_id) {
+    pending_invalidations_.push_back(node_id);
+ }
+ std::optional<RuntimeValue> BDIVirtualMachine::getOutputValue(NodeID node_id, PortIndex port_idx) const {
+    if (!graph_) return std::nullopt;
+    auto idx = graph_->indexOf(node_id);
+    if (!idx || port_idx >= graph_->outputCount(*idx)) return std::nullopt;
+    const SlotIndex slot = graph_->outputSlotBase(*idx) + port_idx;
+    const RuntimeValue& value = graph_->isFloating(*idx) ? value_slots_[slot] : readSlot(slot);
+    if (!value.isSet()) return std::nullopt;
+    return value;
+ }
+ void BDIVirtualMachine::beginRun(NodeIndex entry, bool same_graph) {
+    const CompiledGraph& g = *graph_;
+    const size_t node_count = g.getNodeCount();
+    if (!same_graph) resolvePayloadOverrides();
+    // Payload edits and invalidations since the last run seed the affected cone
+    std::vector<NodeIndex> dirty;
+    bool jit_stale = !same_graph;
+    for (const auto& [node_id, value] : pending_payloads_) {
+        auto it = payload_overrides_.find(node_id);
+        if (value.isSet()) {
+            if (it != payload_overrides_.end() && it->second == value) continue;
+            payload_overrides_[node_id] = value;
+        } else {
+            if (it == payload_overrides_.end()) continue;
+            payload_overrides_.erase(it);
+        }
+        if (auto idx = g.indexOf(node_id)) {
+            if (override_values_.empty()) override_values_.assign(node_count, RuntimeValue{});
+            override_values_[*idx] = value;
+            dirty.push_back(*idx);
+            // Native code reads floating constants from their slots; other payloads are compiled in
+            if (!(g.isFloating(*idx) && g.operation(*idx) == BDIOperationType::META_NOP)) jit_stale = true;
+        }
+    }
+    pending_payloads_.clear();
+    for (NodeID node_id : pending_invalidations_) {
+        if (auto idx = g.indexOf(node_id)) dirty.push_back(*idx);
+    }
+    pending_invalidations_.clear();
+    if (jit_stale) resetJit();
+    jit_resume_ = false;
+    native_steps_ = 0;
+    ++run_id_;
+    previous_return_ = return_value_;
+    previous_return_node_ = return_node_;
+    return_value_.reset();
+    return_node_ = INVALID_NODE_INDEX;
+    branch_taken_ = false;
+    halted_ = false;
+    wait_ = {};
+    lock_waiter_ = false;
+    step_count_ = 0;
+    reused_nodes_ = 0;
+    recomputed_nodes_ = 0;
+    aligned_ = incremental_ && reuse_valid_ && same_graph && entry == last_entry_;
+    reuse_valid_ = false; // Until this run completes
+    last_entry_ = entry;
+    if (aligned_) {
+        for (NodeIndex node : dirty) {
+            if (g.isFloating(node) && g.operation(node) == BDIOperationType::META_NOP) evaluateValueNode(node);
+        }
+        markAffectedCone(dirty);
+        return;
+    }
+    value_slots_.assign(g.getSlotCount(), RuntimeValue{});
+    floating_epoch_.assign(node_count, 0);
+    floating_expanded_.assign(node_count, 0);
+    if (incremental_) {
+        slot_run_.assign(g.getSlotCount(), 0);
+        exec_run_.assign(node_count, 0);
+        exec_count_.assign(node_count, 0);
+        cone_run_.assign(node_count, 0);
+        carried_run_.assign(node_count, 0);
+        branch_outcome_.assign(node_count, 0);
+        volatile_nodes_.clear();
+        for (NodeIndex i = 0; i < node_count; ++i) {
+            const BDIOperationType op = g.operation(i);
+            if (kernels::isKernelOperation(op) || op == BDIOperationType::LEARN_UPDATE_PARAM ||
+                bdi::core::graph::getOperationSignature(op).has(bdi::core::graph::OP_SYNCHRONIZES |
+                                                                bdi::core::graph::OP_READS_MEMORY |
+                                                                bdi::core::graph::OP_WRITES_MEMORY)) {
+                volatile_nodes_.push_back(i);
+            }
+        }
+    } else {
+        slot_run_.clear();
+    }
+    // Floating constants hold their payload for the whole run
+    for (NodeIndex i = 0; i < node_count; ++i) {
+        if (g.isFloating(i) && g.operation(i) == BDIOperationType::META_NOP) evaluateValueNode(i);
+    }
+ }
+ void BDIVirtualMachine::markAffectedCone(std::vector<NodeIndex>& roots) {
+    const CompiledGraph& g = *graph_;
+    std::vector<NodeIndex>& stack = roots;
+    stack.insert(stack.end(), volatile_nodes_.begin(), volatile_nodes_.end());
+    while (!stack.empty()) {
+        const NodeIndex node = stack.back();
+        stack.pop_back();
+        if (cone_run_[node] == run_id_) continue;
+        cone_run_[node] = run_id_;
+        for (NodeIndex consumer : g.dataConsumers(node)) {
+            if (cone_run_[consumer] != run_id_) stack.push_back(consumer);
+        }
+    }
+ }
+ void BDIVirtualMachine::resolvePayloadOverrides() {
+    override_values_.clear();
+    if (payload_overrides_.empty()) return;
+    override_values_.assign(graph_->getNodeCount(), RuntimeValue{});
+    for (const auto& [node_id, value] : payload_overrides_) {
+        if (auto idx = graph_->indexOf(node_id)) override_values_[*idx] = value;
+    }
+ }
+ RuntimeValue BDIVirtualMachine::payloadValue(NodeIndex node) const {
+    if (!override_values_.empty() && override_values_[node].isSet()) return override_values_[node];
+    return RuntimeValue::fromBytes(graph_->payloadType(node), graph_->payloadBytes(node));
+ }
+ const RuntimeValue& BDIVirtualMachine::readSlot(SlotIndex slot) const {
+    static const RuntimeValue unset;
+    if (!slot_run_.empty() && slot_run_[slot] != run_id_) return unset;
+    return value_slots_[slot];
+ }
+ void BDIVirtualMachine::writeSlot(SlotIndex slot, const RuntimeValue& value) {
+    value_slots_[slot] = value;
+    if (!slot_run_.empty()) slot_run_[slot] = run_id_;
+ }
+ bool BDIVirtualMachine::isReusable(NodeIndex node) const {
+    return aligned_ && cone_run_[node] != run_id_ && exec_run_[node] == run_id_ - 1 && exec_count_[node] == 1;
+ }
+ void BDIVirtualMachine::reusePrevious(NodeIndex node) {
+    const SlotIndex base = graph_->outputSlotBase(node);
+    for (size_t port = 0; port < graph_->outputCount(node); ++port) slot_run_[base + port] = run_id_;
+    carried_run_[node] = run_id_;
+    ++reused_nodes_;
+ }
+ void BDIVirtualMachine::noteExecuted(NodeIndex node) {
+    if (!incremental_) return;
+    if (exec_run_[node] != run_id_) {
+        exec_run_[node] = run_id_;
+        exec_count_[node] = 1;
+    } else {
+        ++exec_count_[node];
+    }
+ }
+ bool BDIVirtualMachine::fetchDecodeExecuteCycle(const CompiledGraph& graph) {
+    if (max_steps_ != 0 && step_count_ >= max_steps_) return false;
+    if (jit_threshold_ != 0 && !incremental_ && runNativeCode()) return true;
+    ++step_count_;
+    ++step_serial_;
+ #if BDI_TRACING
+    const uint64_t trace_begin = trace_ ? trace_->enterNode(current_index_) : 0;
+    const bool executed = executeNode(current_index_);
+    if (executed && trace_) trace_->leaveNode(current_index_, trace_begin);
+ #else
+    const bool executed = executeNode(current_index_);
+ #endif
+    if (!executed) {
+        if (wait_.kind != concurrency::WaitRequest::NONE) --step_count_; // Counted when it is retried
+        return false;
+    }
+    noteExecuted(current_index_);
+    NodeIndex next = determineNextNode(current_index_);
+    if (next == INVALID_NODE_INDEX) {
+        halted_ = true;
+    } else {
+        current_index_ = next;
+        current_node_id_ = graph.nodeIdAt(next);
+    }
+    return true;
+ }
+ bool BDIVirtualMachine::runNativeCode() {
+    if (jit_resume_) {
+        jit_resume_ = false;
+        return false;
+    }
+    const NodeIndex node = current_index_;
+    if (!jit_code_[node]) {
+        if (hotness_[node] == JIT_REJECTED || ++hotness_[node] < jit_threshold_) return false;
+        jit_code_[node] = jit::JitCompiler::compileRegion(*graph_, node, [this](NodeIndex n) { return payloadValue(n); });
+        if (!jit_code_[node]) {
+            hotness_[node] = JIT_REJECTED;
+            return false;
+        }
+        ++jit_regions_;
+    }
+    jit::JitFrame frame;
+    frame.slots = value_slots_.data();
+    frame.step_budget = max_steps_ != 0 ? max_steps_ - step_count_ : ~uint64_t{0};
+ #if BDI_TRACING
+    const uint64_t trace_begin = trace_ ? trace_->enterNative(node) : 0;
+    const NodeIndex next = jit_code_[node]->run(frame);
+    if (trace_) trace_->leaveNative(node, trace_begin, frame.steps);
+ #else
+    const NodeIndex next = jit_code_[node]->run(frame);
+ #endif
+    step_count_ += frame.steps;
+    step_serial_ += frame.steps;
+    native_steps_ += frame.steps;
+    if (next == INVALID_NODE_INDEX) {
+        halted_ = true;
+    } else {
+        current_index_ = next;
+        current_node_id_ = graph_->nodeIdAt(next);
+        jit_resume_ = true;
+    }
+    return true;
+ }
+ void BDIVirtualMachine::resetJit() {
+    const size_t node_count = graph_ && jit_threshold_ != 0 ? graph_->getNodeCount() : 0;
+    hotness_.assign(node_count, 0);
+    jit_code_.clear();
+    jit_code_.resize(node_count);
+    jit_regions_ = 0;
+ }
+ bool BDIVirtualMachine::executeNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    RuntimeValue operand;
+    switch (g.operation(node)) {
+        case BDIOperationType::META_START:
+        case BDIOperationType::META_COMMENT:
+        case BDIOperationType::CTRL_JUMP:
+        case BDIOperationType::CONCURRENCY_JOIN: // Spawned tasks have already completed when serial
+            return true;
+        case BDIOperationType::META_VERIFY_PROOF: {
+            const auto* proof = metadata_store_ ? metadata_store_->get<bdi::meta::ProofTag>(g.metadataHandle(node)) : nullptr;
+            return proof && proof_verifier_ && proof_verifier_(g.nodeIdAt(node), *proof);
+        }
+        case BDIOperationType::CONCURRENCY_SPAWN: {
+            // control_outputs = [continuation, task_entry...]; tasks run to completion in order
+            auto successors = g.controlSuccessors(node);
+            for (size_t k = 1; k < successors.size(); ++k) {
+                if (!runSpawnedTask(successors[k])) return false;
+            }
+            return true;
+        }
+        case BDIOperationType::META_END:
+        case BDIOperationType::CTRL_RETURN:
+            if (!g.inputSlots(node).empty()) {
+                if (node == previous_return_node_ && isReusable(node)) {
+                    return_value_ = previous_return_;
+                    ++reused_nodes_;
+                } else {
+                    if (!gatherOperands(node, &operand, 1)) return false;
+                    return_value_ = operand;
+                }
+                return_node_ = node;
+            }
+            return true;
+        case BDIOperationType::META_ASSERT:
+            if (isReusable(node)) {
+                ++reused_nodes_;
+                return true;
+            }
+            return gatherOperands(node, &operand, 1) && isTruthy(operand);
+        case BDIOperationType::CTRL_BRANCH_COND:
+            if (isReusable(node)) {
+                branch_taken_ = branch_outcome_[node] != 0;
+                ++reused_nodes_;
+                return true;
+            }
+            if (!gatherOperands(node, &operand, 1)) return false;
+            branch_taken_ = isTruthy(operand);
+            if (incremental_) {
+                // Outside the cone the outcome is the previous run's; inside it the path may diverge here
+                if (aligned_ && cone_run_[node] == run_id_ &&
+                    !(exec_run_[node] == run_id_ - 1 && exec_count_[node] == 1 && (branch_outcome_[node] != 0) == branch_taken_)) {
+                    aligned_ = false;
+                }
+                branch_outcome_[node] = branch_taken_;
+            }
+            return true;
+        case BDIOperationType::LEARN_UPDATE_PARAM:
+            return executeParamUpdate(node);
+        case BDIOperationType::COMM_CHANNEL_SEND:
+        case BDIOperationType::COMM_CHANNEL_RECV:
+            return executeChannelNode(node);
+        case BDIOperationType::SYNC_MUTEX_LOCK:
+        case BDIOperationType::SYNC_MUTEX_UNLOCK:
+        case BDIOperationType::SYNC_ATOMIC_RMW:
+            return executeSyncNode(node);
+        case BDIOperationType::MEM_ALLOC:
+        case BDIOperationType::MEM_FREE:
+        case BDIOperationType::MEM_LOAD:
+        case BDIOperationType::MEM_STORE:
+        case BDIOperationType::MEM_COPY:
+        case BDIOperationType::MEM_SET:
+            return executeMemoryNode(node);
+        case BDIOperationType::IO_PRINT:
+            if (!gatherOperands(node, &operand, 1)) return false;
+            printValue(g.nodeIdAt(node), operand);
+            return true;
+        default:
+            if (kernels::isKernelOperation(g.operation(node))) return executeKernelNode(node);
+            if (isReusable(node)) {
+                reusePrevious(node);
+                return true;
+            }
+            return evaluateValueNode(node);
+    }
+ }
+ bool BDIVirtualMachine::executeKernelNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    // Every operand is wired (the payload only names the element type); optional trailing ones may be left off
+    const kernels::KernelOperandCount arity = kernels::getKernelOperandCount(op);
+    auto slots = g.inputSlots(node);
+    const size_t count = slots.size();
+    if (count < arity.required || count > arity.max) return false;
+    for (SlotIndex slot : slots) {
+        if (slot == INVALID_SLOT_INDEX) return false;
+    }
+    RuntimeValue operands[kernels::MAX_KERNEL_OPERANDS];
+    if (!gatherOperands(node, operands, count)) return false;
+    bdi::meta::HardwareHints hints;
+    if (hint_resolver_) {
+        if (auto resolved = hint_resolver_(g.metadataHandle(node))) hints = *resolved;
+    } else if (metadata_store_) {
+        if (const auto* stored = metadata_store_->get<bdi::meta::HardwareHints>(g.metadataHandle(node))) hints = *stored;
+    }
+    const kernels::KernelBufferCheck buffers{&memory::MemoryManager::checkKernelBuffer, memory_};
+    if (!kernels::executeKernelOperation(op, g.payloadType(node), {operands, count}, buffers, hints)) return false;
+    // Output 0 (if any) passes the destination buffer on, so consumers can be data dependent on the result
+    if (g.outputCount(node)) writeSlot(g.outputSlotBase(node), operands[0]);
+    return true;
+ }
+ bool BDIVirtualMachine::executeChannelNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    const bool send = g.operation(node) == BDIOperationType::COMM_CHANNEL_SEND;
+    RuntimeValue operands[2];
+    uint64_t channel_id = 0;
+    if (!gatherOperands(node, operands, send ? 2 : 1) || !toAddress(operands[0], channel_id)) return false;
+    if (!scheduler_) {
+        if (send) return channel_endpoints_.send && channel_endpoints_.send(channel_id, operands[1].toPayload());
+        if (!channel_endpoints_.recv) return false;
+        const std::optional<TypedPayload> value = channel_endpoints_.recv(channel_id);
+        if (!value) return false;
+        const RuntimeValue received = RuntimeValue::fromPayload(*value);
+        if (!received.isSet()) return false;
+        if (g.outputCount(node)) writeSlot(g.outputSlotBase(node), received);
+        return true;
+    }
+    concurrency::Channel* channel = scheduler_->getChannel(channel_id);
+    if (!channel) return false;
+    if (send) {
+        TypedPayload value = operands[1].toPayload();
+        if (!channel->trySend(value)) return waitFor({concurrency::WaitRequest::CHANNEL_SEND, channel});
+        scheduler_->wakeReceiver(*channel);
+        return true;
+    }
+    TypedPayload value;
+    if (!channel->tryRecv(value)) return waitFor({concurrency::WaitRequest::CHANNEL_RECV, channel});
+    scheduler_->wakeSender(*channel);
+    const RuntimeValue received = RuntimeValue::fromPayload(value);
+    if (!received.isSet()) return false; // Wider than a value slot (sent by the host)
+    if (g.outputCount(node)) writeSlot(g.outputSlotBase(node), received);
+    return true;
+ }
+ bool BDIVirtualMachine::executeSyncNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    RuntimeValue operands[2];
+    uint64_t address = 0;
+    if (!gatherOperands(node, operands, op == BDIOperationType::SYNC_ATOMIC_RMW ? 2 : 1) ||
+        !toAddress(operands[0], address)) {
+        return false;
+    }
+    if (op == BDIOperationType::SYNC_ATOMIC_RMW) {
+        // Fetch-and-add in the width of the declared result, which receives the old value
+        const BDIType type = g.outputCount(node) ? g.slotType(g.outputSlotBase(node)) : operands[1].type;
+        const size_t size = getBdiTypeSize(type);
+        address = resolveAddress(address, 0, size);
+        RuntimeValue previous;
+        bool ok = false;
+        if (bdi::core::graph::isIntegerType(type) && address != 0) {
+            switch (size) {
+                case 1: ok = atomicFetchAdd<uint8_t>(address, operands[1], type, previous); break;
+                case 2: ok = atomicFetchAdd<uint16_t>(address, operands[1], type, previous); break;
+                case 4: ok = atomicFetchAdd<uint32_t>(address, operands[1], type, previous); break;
+                case 8: ok = atomicFetchAdd<uint64_t>(address, operands[1], type, previous); break;
+                default: break;
+            }
+        }
+        if (!ok) return false;
+        if (g.outputCount(node)) writeSlot(g.outputSlotBase(node), previous);
+        return true;
+    }
+    // Lock word: 0 free, 1 held, 2 held and tasks may be parked on it
+    address = resolveAddress(address, 0, sizeof(uint32_t));
+    if (address == 0 || address % std::atomic_ref<uint32_t>::required_alignment != 0) return false;
+    uint32_t* lock_word = reinterpret_cast<uint32_t*>(address);
+    std::atomic_ref<uint32_t> word(*lock_word);
+    if (op == BDIOperationType::SYNC_MUTEX_UNLOCK) {
+        uint32_t state = word.load();
+        do {
+            if (state == 0) return false; // Not held
+        } while (!word.compare_exchange_weak(state, 0));
+        if (state == 2 && scheduler_) scheduler_->wakeMutexWaiter(lock_word);
+        return true;
+    }
+    // A task that has waited takes the lock as contended, so that its unlock wakes the next waiter
+    uint32_t state = 0;
+    if (!lock_waiter_ && word.compare_exchange_strong(state, 1)) return true;
+    if (word.exchange(2) == 0) {
+        lock_waiter_ = false;
+        return true;
+    }
+    lock_waiter_ = true;
+    return waitFor({concurrency::WaitRequest::MUTEX, nullptr, lock_word});
+ }
+ uintptr_t BDIVirtualMachine::resolveAddress(uint64_t address, uint64_t offset, uint64_t size, std::optional<RegionID> region) const {
+    if (!memory_ || address == 0) return 0;
+    const auto block = memory_->findBlock(reinterpret_cast<const void*>(address));
+    if (!block || (region && block->region != *region)) return 0;
+    const uint64_t end = reinterpret_cast<uint64_t>(block->base) + block->bytes;
+    // Measured from 'address' (inside the block), so nothing can wrap
+    if (offset > end - address || size > end - address - offset) return 0;
+    return static_cast<uintptr_t>(address + offset);
+ }
+ bool BDIVirtualMachine::executeMemoryNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    // Trailing optional operands (alignment, offset) count only when wired
+    const auto& signature = bdi::core::graph::getOperationSignature(op);
+    const size_t count = std::max<size_t>(signature.min_inputs, std::min<size_t>(g.inputSlots(node).size(), signature.max_inputs));
+    RuntimeValue operands[3];
+    uint64_t address = 0;
+    if (!gatherOperands(node, operands, count) || !toAddress(operands[0], address)) return false;
+    const SlotIndex out_slot = g.outputCount(node) ? g.outputSlotBase(node) : INVALID_SLOT_INDEX;
+    switch (op) {
+        case BDIOperationType::MEM_ALLOC: {
+            // [size, (alignment)]; operand 0 is a size here, not an address
+            uint64_t alignment = memory::MemoryManager::MIN_ALIGNMENT;
+            if (!memory_ || (count > 1 && !toAddress(operands[1], alignment))) return false;
+            void* block = memory_->allocate(g.regionId(node), address, alignment);
+            if (!block) return false;
+            if (out_slot != INVALID_SLOT_INDEX) writeSlot(out_slot, RuntimeValue::make(BDIType::POINTER, reinterpret_cast<uint64_t>(block)));
+            return true;
+        }
+        case BDIOperationType::MEM_FREE:
+            return memory_ && memory_->free(reinterpret_cast<void*>(address));
+        case BDIOperationType::MEM_LOAD: {
+            // [address, (offset)]; reads the declared result type
+            uint64_t offset = 0;
+            if (out_slot == INVALID_SLOT_INDEX || (count > 1 && !toAddress(operands[1], offset))) return false;
+            const BDIType type = g.slotType(out_slot);
+            const size_t size = getBdiTypeSize(type);
+            if (size == 0 || size > sizeof(uint64_t)) return false;
+            const uintptr_t at = resolveAddress(address, offset, size, g.regionId(node));
+            if (at == 0) return false;
+            writeSlot(out_slot, RuntimeValue::fromBytes(type, {reinterpret_cast<const std::byte*>(at), size}));
+            return true;
+        }
+        case BDIOperationType::MEM_STORE: {
+            // [address, value, (offset)]; writes the value's own type
+            uint64_t offset = 0;
+            if (count > 2 && !toAddress(operands[2], offset)) return false;
+            const size_t size = getBdiTypeSize(operands[1].type);
+            if (size == 0 || size > sizeof(uint64_t)) return false;
+            const uintptr_t at = resolveAddress(address, offset, size, g.regionId(node));
+            if (at == 0) return false;
+            std::memcpy(reinterpret_cast<void*>(at), &operands[1].bits, size);
+            return true;
+        }
+        case BDIOperationType::MEM_COPY: {
+            // [dst, src, bytes]
+            uint64_t source = 0, bytes = 0;
+            if (!toAddress(operands[1], source) || !toAddress(operands[2], bytes)) return false;
+            const uintptr_t dst = resolveAddress(address, 0, bytes, g.regionId(node));
+            const uintptr_t src = resolveAddress(source, 0, bytes, g.regionId(node));
+            if (dst == 0 || src == 0) return false;
+            memory::MemoryManager::copy(reinterpret_cast<void*>(dst), reinterpret_cast<const void*>(src), bytes);
+            return true;
+        }
+        case BDIOperationType::MEM_SET: {
+            // [dst, value, count]: 'count' elements of the value's type
+            uint64_t elements = 0;
+            const size_t size = getBdiTypeSize(operands[1].type);
+            if (!toAddress(operands[2], elements) || (size != 0 && elements > UINT64_MAX / size)) return false;
+            const uintptr_t dst = resolveAddress(address, 0, elements * size, g.regionId(node));
+            return dst != 0 && memory::MemoryManager::fill(reinterpret_cast<void*>(dst), operands[1].bits, size, elements);
+        }
+        default:
+            return false;
+    }
+ }
+ bool BDIVirtualMachine::executeParamUpdate(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    // Input 0 is the parameter, a META_NOP holding its value as payload; input 1 (or the payload) the delta
+    auto slots = g.inputSlots(node);
+    if (slots.empty() || slots[0] == INVALID_SLOT_INDEX) return false;
+    const NodeIndex param = g.inputNodes(node)[0];
+    if (g.operation(param) != BDIOperationType::META_NOP) return false;
+    RuntimeValue operands[2];
+    RuntimeValue updated;
+    if (!gatherOperands(node, operands, 2)) return false;
+    if (!evaluateScalar(BDIOperationType::ARITH_ADD, operands[0].type, operands, updated)) return false;
+    // Later reads in this run still see the old value, as for any other payload edit
+    setNodePayload(g.nodeIdAt(param), updated);
+    if (g.outputCount(node)) writeSlot(g.outputSlotBase(node), updated);
+    return true;
+ }
+ NodeIndex BDIVirtualMachine::determineNextNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    auto successors = g.controlSuccessors(node);
+    switch (g.operation(node)) {
+        case BDIOperationType::META_END:
+        case BDIOperationType::CTRL_RETURN:
+            return INVALID_NODE_INDEX;
+        case BDIOperationType::CTRL_BRANCH_COND:
+            // control_outputs = [true_target, false_target]
+            if (successors.size() < 2) return INVALID_NODE_INDEX;
+            return branch_taken_ ? successors[0] : successors[1];
+        default:
+            return successors.empty() ? INVALID_NODE_INDEX : successors[0];
+    }
+ }
+ bool BDIVirtualMachine::runSpawnedTask(NodeIndex entry) {
+    NodeIndex node = entry;
+    while (node != INVALID_NODE_INDEX && graph_->operation(node) != BDIOperationType::CONCURRENCY_JOIN) {
+        if (max_steps_ != 0 && step_count_ >= max_steps_) return false;
+        ++step_count_;
+        ++step_serial_;
+ #if BDI_TRACING
+        const uint64_t trace_begin = trace_ ? trace_->enterNode(node) : 0;
+        const bool executed = executeNode(node);
+        if (executed && trace_) trace_->leaveNode(node, trace_begin);
+ #else
+        const bool executed = executeNode(node);
+ #endif
+        if (!executed) {
+            wait_ = {}; // A nested task cannot suspend: the wait fails the run
+            return false;
+        }
+        noteExecuted(node);
+        node = determineNextNode(node);
+    }
+    return true;
+ }
+ bool BDIVirtualMachine::gatherOperands(NodeIndex node, RuntimeValue* operands, size_t count) {
+    const CompiledGraph& g = *graph_;
+    auto slots = g.inputSlots(node);
+    auto sources = g.inputNodes(node);
+    for (size_t k = 0; k < count; ++k) {
+        if (k < slots.size() && slots[k] != INVALID_SLOT_INDEX) {
+            // Pure producers without control edges are evaluated when their value is needed,
+            // at most once per step
+            const NodeIndex src = sources[k];
+            if (g.isFloating(src) && !isFloatingCurrent(src) && !evaluateFloating(src)) return false;
+            operands[k] = readSlot(slots[k]);
+        } else {
+            // Operand not wired: take the immediate from the payload
+            operands[k] = payloadValue(node);
+        }
+        if (!operands[k].isSet()) return false; // Read of a value that was never produced
+    }
+    return true;
+ }
+ bool BDIVirtualMachine::evaluateFloating(NodeIndex root) {
+    const CompiledGraph& g = *graph_;
+    // Depth-first over the floating producers, on floating_stack_ rather than the native stack (chains
+    // can be millions of nodes deep). A node is expanded once: its pending producers go on top of it,
+    // and it is evaluated when it comes back to the top. Meeting an expanded, unevaluated node again
+    // means a cycle.
+    floating_stack_.clear();
+    floating_stack_.push_back(root);
+    while (!floating_stack_.empty()) {
+        const NodeIndex node = floating_stack_.back();
+        if (isFloatingCurrent(node)) { // Reached twice before it was evaluated
+            floating_stack_.pop_back();
+            continue;
+        }
+        if (floating_expanded_[node] != step_serial_) {
+            floating_expanded_[node] = step_serial_;
+            const BDIOperationType op = g.operation(node);
+            const size_t arity = isScalarOperation(op) ? getScalarOperationArity(op) : 0;
+            auto slots = g.inputSlots(node);
+            auto sources = g.inputNodes(node);
+            bool pending = false;
+            for (size_t k = 0; k < arity && k < slots.size(); ++k) {
+                const NodeIndex src = sources[k];
+                if (slots[k] == INVALID_SLOT_INDEX || !g.isFloating(src) || isFloatingCurrent(src)) continue;
+                if (floating_expanded_[src] == step_serial_) return false; // Cycle among floating nodes
+                floating_stack_.push_back(src);
+                pending = true;
+            }
+            if (pending) continue;
+        }
+        floating_stack_.pop_back();
+        if (canCarryFloating(node)) {
+            reusePrevious(node);
+            if (g.operation(node) == BDIOperationType::META_NOP) --reused_nodes_; // Constants are not counted
+            continue;
+        }
+        if (!evaluateValueNode(node)) return false;
+        floating_epoch_[node] = step_serial_;
+    }
+    return true;
+ }
+ bool BDIVirtualMachine::isFloatingCurrent(NodeIndex node) const {
+    return floating_epoch_[node] == step_serial_ || (aligned_ && carried_run_[node] == run_id_);
+ }
+ bool BDIVirtualMachine::canCarryFloating(NodeIndex node) const {
+    if (!aligned_ || cone_run_[node] == run_id_) return false;
+    const CompiledGraph& g = *graph_;
+    // The slot must hold the previous run's value...
+    if (g.outputCount(node) == 0 || slot_run_[g.outputSlotBase(node)] != run_id_ - 1) return false;
+    // ...computed from inputs that have not changed since: carried-over producers ran once in both runs
+    auto slots = g.inputSlots(node);
+    auto sources = g.inputNodes(node);
+    for (size_t k = 0; k < slots.size(); ++k) {
+        if (slots[k] != INVALID_SLOT_INDEX && carried_run_[sources[k]] != run_id_) return false;
+    }
+    return true;
+ }
+ bool BDIVirtualMachine::evaluateValueNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    BDIOperationType op = g.operation(node);
+    const SlotIndex out_slot = g.outputCount(node) ? g.outputSlotBase(node) : INVALID_SLOT_INDEX;
+    if (op == BDIOperationType::META_NOP) {
+        // Constant: payload (or its override) is published on output 0
+        if (out_slot != INVALID_SLOT_INDEX) writeSlot(out_slot, payloadValue(node));
+        return true;
+    }
+    if (!isScalarOperation(op)) return false; // Only constants and scalar operations float
+    RuntimeValue operands[3];
+    RuntimeValue result;
+    if (!gatherOperands(node, operands, getScalarOperationArity(op))) return false;
+    BDIType result_type = out_slot != INVALID_SLOT_INDEX ? g.slotType(out_slot) : BDIType::UNKNOWN;
+    if (!evaluateScalar(op, result_type, operands, result)) return false;
+    ++recomputed_nodes_;
+    if (out_slot != INVALID_SLOT_INDEX) writeSlot(out_slot, result);
+    return true;
+ }
+ } // namespace bdi::runtime
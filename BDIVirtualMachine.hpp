@@ -2,30 +2,237 @@
  #ifndef BDI_RUNTIME_BDIVIRTUALMACHINE_HPP
  #define BDI_RUNTIME_BDIVIRTUALMACHINE_HPP
  #include "../core/graph/BDIGraph.hpp"
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "RuntimeValue.hpp"
+ #include "jit/JitCompiler.hpp"
+ #include "trace/ExecutionTracer.hpp"
+ #include "concurrency/TaskScheduler.hpp"
+ #include "../meta/HardwareHints.hpp"
+ #include <functional>
  #include <memory> // For std::shared_ptr or unique_ptr if VM owns graph
+ #include <optional>
+ #include <unordered_map>
+ #include <utility>
+ #include <vector>
+ namespace bdi::meta {
+ class MetadataStore;
+ struct ProofTag;
+ }
+ namespace bdi::runtime::memory { class MemoryManager; }
  namespace bdi::runtime {
  using bdi::core::graph::BDIGraph;
+ using bdi::core::graph::BDINode;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::MetadataHandle;
  using bdi::core::graph::NodeID;
- // Basic Stub for the BDI Virtual Machine / Interpreter
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ using bdi::core::graph::RegionID;
+ using bdi::core::graph::SlotIndex;
+ // Reference interpreter: runs a CompiledGraph node by node along its control path, evaluating floating
+ // producers on demand. The other engines are checked against it.
  class BDIVirtualMachine {
  public:
-    BDIVirtualMachine(); // Constructor might take memory manager, scheduler etc.
+    BDIVirtualMachine();
     // Primary execution entry point
     // Takes graph by reference, doesn't assume ownership here.
+    // Freezes the graph into a CompiledGraph and runs that; prefer the overload below for repeated runs.
     // Returns success/failure or final state info.
     bool execute(BDIGraph& graph, NodeID entry_node_id);
-    // TODO: Add methods for stepping, debugging, state inspection, loading graphs
+    // Execute an already frozen graph. 'graph' must outlive any subsequent getOutputValue() calls.
+    bool execute(const CompiledGraph& graph, NodeID entry_node_id);
+    // Execute as a coroutine task of 'scheduler' (see TaskScheduler::spawn). Same as execute(), except that
+    // a COMM_CHANNEL_SEND to a full channel, a COMM_CHANNEL_RECV from an empty one and a contended
+    // SYNC_MUTEX_LOCK suspend the task until the channel or lock can let the node through, instead of
+    // failing the run. Blocking inside a CONCURRENCY_SPAWN task (run serially) still fails.
+    concurrency::ExecutionTask run(const CompiledGraph& graph, NodeID entry_node_id, concurrency::TaskScheduler& scheduler);
+    // Channels (and parked lock waiters) for COMM_CHANNEL_* / SYNC_MUTEX_* nodes run by execute(); set by run()
+    void setTaskScheduler(concurrency::TaskScheduler* scheduler) { scheduler_ = scheduler; }
+    // Channels served outside the VM (e.g. shared-memory rings to another process, see PartitionCoordinator),
+    // used by COMM_CHANNEL_* nodes when no TaskScheduler is set. Both calls may block; a false / nullopt
+    // result fails the node.
+    struct ChannelEndpoints {
+        std::function<bool(uint64_t channel, const TypedPayload& value)> send;
+        std::function<std::optional<TypedPayload>(uint64_t channel)> recv;
+    };
+    void setChannelEndpoints(ChannelEndpoints endpoints) { channel_endpoints_ = std::move(endpoints); }
+    // --- State Inspection --
+    // Value last produced on an output port during the most recent execute()
+    std::optional<RuntimeValue> getOutputValue(NodeID node_id, PortIndex port_idx) const;
+    // Value consumed by the META_END / CTRL_RETURN node that halted execution, if any
+    std::optional<RuntimeValue> getReturnValue() const { return return_value_; }
+    // Source of per-node HardwareHints (ISA choice, buffer alignment) for kernel-backed operations,
+    // looked up by metadata handle. Without a resolver kernels use the best ISA and probe alignment.
+    using HardwareHintResolver = std::function<std::optional<bdi::meta::HardwareHints>(MetadataHandle)>;
+    void setHardwareHintResolver(HardwareHintResolver resolver) { hint_resolver_ = std::move(resolver); }
+    // Read HardwareHints straight from a MetadataStore (lock-free; the store must outlive the VM's runs).
+    // A resolver, if set, takes precedence.
+    void setMetadataStore(const bdi::meta::MetadataStore* store) { metadata_store_ = store; }
+    // Checker behind META_VERIFY_PROOF. The node passes if its metadata handle names a ProofTag in the
+    // MetadataStore and the verifier accepts it; without a store, a tag or a verifier it fails.
+    using ProofVerifier = std::function<bool(NodeID node_id, const bdi::meta::ProofTag& proof)>;
+    void setProofVerifier(ProofVerifier verifier) { proof_verifier_ = std::move(verifier); }
+    // Pools behind MEM_* (allocations go to the node's region_id). MEM_LOAD / MEM_STORE / MEM_COPY / MEM_SET
+    // only touch live blocks of the node's region, within the block's bytes. Kernel buffers (VEC_*, LINALG_*,
+    // SIGNAL_*) must lie inside live blocks of any region. Without one MEM_* and kernel nodes fail.
+    void setMemoryManager(memory::MemoryManager* memory) { memory_ = memory; }
+    memory::MemoryManager* getMemoryManager() const { return memory_; }
+    // Guard against runaway control loops (0 = unlimited)
+    void setMaxSteps(uint64_t max_steps) { max_steps_ = max_steps; }
+    uint64_t getStepCount() const { return step_count_; }
+    // --- Payload Edits --
+    // Run node 'node_id' with scalar payload 'value' instead of the one compiled into the graph (the
+    // CompiledGraph itself is immutable). Takes effect from the next execute(); an unset value removes
+    // the override. LEARN_UPDATE_PARAM nodes edit payloads the same way.
+    void setNodePayload(NodeID node_id, const RuntimeValue& value);
+    void clearPayloadOverrides();
+    // --- Incremental Re-execution --
+    // Keep output values between runs of the same CompiledGraph from the same entry node and recompute only
+    // the downstream cone of edited payloads and invalidated nodes. Results match a full run; IO_PRINT,
+    // kernel and LEARN_UPDATE_PARAM nodes always run. A failed run, another graph or entry node, or
+    // execute(BDIGraph&) (which freezes a new snapshot) start from scratch.
+    void setIncremental(bool enabled);
+    // Recompute 'node_id' and everything reading it on the next run (e.g. after memory it reads changed)
+    void invalidate(NodeID node_id);
+    void invalidateAll() { reuse_valid_ = false; }
+    // Nodes of the last run whose previous result was kept / scalar operations that were evaluated
+    // (outputs of floating nodes are those of their last evaluation, which may be an earlier run's)
+    uint64_t getReusedNodeCount() const { return reused_nodes_; }
+    uint64_t getRecomputedNodeCount() const { return recomputed_nodes_; }
+    // --- Native Code --
+    // A control node interpreted 'threshold' times compiles the region around it to x86-64 code (see
+    // JitCompiler), which then runs in its place until control leaves the region or an operand needs the
+    // interpreter. 0 disables the JIT; it is also off in incremental mode and where native code is unavailable.
+    static constexpr uint32_t DEFAULT_JIT_THRESHOLD = 100;
+    void setJitThreshold(uint32_t threshold);
+    // Steps of the last run executed by native code (included in getStepCount())
+    uint64_t getNativeStepCount() const { return native_steps_; }
+    size_t getJitRegionCount() const { return jit_regions_; }
+    // --- Tracing --
+    // Count and sample every node this VM runs on 'tracer' (nullptr stops), see ExecutionTracer.
+    // The tracer must outlive the runs. Ignored when built with BDI_TRACING=0.
+    void setTracer(trace::ExecutionTracer* tracer) { tracer_ = tracer; }
  private:
     // --- Internal VM State --
     NodeID current_node_id_;
-    // TODO: Represent register file / execution context / stack
-    // TODO: Interface to MemoryManager
-    // TODO: Interface to RuntimeScheduler
-    // TODO: Interface to TraceGenerator
+    NodeIndex current_index_;
+    const CompiledGraph* graph_ = nullptr;
+    std::shared_ptr<const CompiledGraph> owned_graph_; // Set when execute() froze the graph itself
+    std::vector<RuntimeValue> value_slots_; // Register file: one slot per output port (SlotIndex)
+    std::vector<uint64_t> floating_epoch_; // Step in which a floating node was last evaluated (per NodeIndex)
+    std::vector<uint64_t> floating_expanded_; // Step in which evaluateFloating() pushed the node's producers
+    std::vector<NodeIndex> floating_stack_;
+    std::optional<RuntimeValue> return_value_;
+    bool branch_taken_ = false; // Outcome of the last CTRL_BRANCH_COND
+    bool halted_ = false;
+    uint64_t step_count_ = 0;
+    uint64_t max_steps_ = 0;
+    HardwareHintResolver hint_resolver_;
+    const bdi::meta::MetadataStore* metadata_store_ = nullptr;
+    ProofVerifier proof_verifier_;
+    uint64_t step_serial_ = 0; // Steps across all runs; floating_epoch_ holds values of it
+    // Payload overrides by NodeID, resolved per NodeIndex for graph_ (empty while there are none)
+    std::unordered_map<NodeID, RuntimeValue> payload_overrides_;
+    std::vector<RuntimeValue> override_values_;
+    std::vector<std::pair<NodeID, RuntimeValue>> pending_payloads_; // Applied when the next run starts
+    std::vector<NodeID> pending_invalidations_;
+    // Incremental state. Per-node/slot vectors hold the id of the run that last touched them, so carrying
+    // them into the next run needs no clearing. slot_run_ is empty while incremental_ is off.
+    bool incremental_ = false;
+    bool reuse_valid_ = false; // The previous run completed on graph_ from last_entry_
+    bool aligned_ = false;     // This run has taken the same control path as the previous one so far
+    NodeIndex last_entry_ = bdi::core::graph::INVALID_NODE_INDEX;
+    uint64_t run_id_ = 0;
+    std::vector<uint64_t> slot_run_;   // Run that last wrote the slot
+    std::vector<uint64_t> exec_run_;   // Run in which the node was last executed...
+    std::vector<uint32_t> exec_count_; // ...and how many times it was in that run
+    std::vector<uint64_t> cone_run_;   // Run whose affected cone contains the node
+    std::vector<uint64_t> carried_run_; // Run that took the node's outputs over from the previous one
+    std::vector<uint8_t> branch_outcome_;
+    std::vector<NodeIndex> volatile_nodes_; // Memory, kernel, sync and LEARN_UPDATE_PARAM nodes: outputs change every run
+    NodeIndex return_node_ = bdi::core::graph::INVALID_NODE_INDEX; // Node that set return_value_
+    NodeIndex previous_return_node_ = bdi::core::graph::INVALID_NODE_INDEX;
+    std::optional<RuntimeValue> previous_return_;
+    uint64_t reused_nodes_ = 0;
+    uint64_t recomputed_nodes_ = 0;
+    // JIT state for graph_. Regions bake payloads in: edits to anything but floating constants discard them.
+    static constexpr uint32_t JIT_REJECTED = ~0u;
+    uint32_t jit_threshold_ = jit::JitCompiler::isAvailable() ? DEFAULT_JIT_THRESHOLD : 0;
+    std::vector<uint32_t> hotness_; // Interpreted executions per node, JIT_REJECTED if it does not compile
+    std::vector<std::unique_ptr<jit::JitCode>> jit_code_; // Region entered at the node
+    size_t jit_regions_ = 0;
+    bool jit_resume_ = false; // Native code handed back: interpret the current node before re-entering
+    uint64_t native_steps_ = 0;
+    memory::MemoryManager* memory_ = nullptr;
+    trace::ExecutionTracer* tracer_ = nullptr;
+    trace::ThreadTrace* trace_ = nullptr; // The running thread's trace while tracer_ is enabled, else null
+    // Channels and locks. A node that would block sets wait_ and fails; run() suspends on it and retries.
+    concurrency::TaskScheduler* scheduler_ = nullptr;
+    ChannelEndpoints channel_endpoints_;
+    concurrency::WaitRequest wait_;
+    bool lock_waiter_ = false; // Retrying a SYNC_MUTEX_LOCK after waiting: keep the lock word marked contended
+    // --- Run Setup --
+    // Bind the graph and reset per-run state; INVALID_NODE_INDEX if the entry node does not exist
+    NodeIndex startRun(const CompiledGraph& graph, NodeID entry_node_id, bool& same_graph);
+    bool finishRun(bool ok);
+    // Point trace_ at the calling thread's trace (null unless tracer_ is enabled); returns the run's start time
+    uint64_t bindTrace(const CompiledGraph& graph, bool new_snapshot);
     // --- Execution Loop Helpers --
-    bool fetchDecodeExecuteCycle(BDIGraph& graph);
-    bool executeNode(BDINode& node); // Dispatch based on node.operation
-    NodeID determineNextNode(BDINode& node); // Follow control flow
+    bool fetchDecodeExecuteCycle(const CompiledGraph& graph);
+    // Run native code for the current node if there is (or, once hot, can be) a region for it.
+    // False if the interpreter should execute the node.
+    bool runNativeCode();
+    void resetJit();
+    bool executeNode(NodeIndex node); // Dispatch based on the node's operation
+    NodeIndex determineNextNode(NodeIndex node); // Follow control flow
+    // Gather operands (data inputs, then payload immediate) and evaluate floating producers on demand
+    bool gatherOperands(NodeIndex node, RuntimeValue* operands, size_t count);
+    // Evaluate the floating node 'root' for this step, after the floating producers it reads
+    bool evaluateFloating(NodeIndex root);
+    // Floating node whose output slot holds its value for this step (or, carried over, for the whole run)
+    bool isFloatingCurrent(NodeIndex node) const;
+    // Aligned run, outside the cone: a floating node reading only carried-over values keeps its last one
+    bool canCarryFloating(NodeIndex node) const;
+    // Constants (META_NOP with payload) and scalar operations, once their floating producers are evaluated
+    bool evaluateValueNode(NodeIndex node);
+    // VEC_*, LINALG_MATMUL, SIGNAL_FFT through the SIMD kernel library (see VectorKernels.hpp)
+    bool executeKernelNode(NodeIndex node);
+    // MEM_* on memory_ blocks; offsets are in bytes
+    bool executeMemoryNode(NodeIndex node);
+    // Serial semantics of CONCURRENCY_SPAWN: run a spawned task until it reaches a CONCURRENCY_JOIN or ends
+    bool runSpawnedTask(NodeIndex entry);
+    // COMM_CHANNEL_SEND (channel, value) / COMM_CHANNEL_RECV (channel) on scheduler_'s channels, or else
+    // through channel_endpoints_
+    bool executeChannelNode(NodeIndex node);
+    // SYNC_MUTEX_LOCK / SYNC_MUTEX_UNLOCK on a 32-bit lock word, SYNC_ATOMIC_RMW (fetch-and-add), both in
+    // MemoryManager blocks. Unlocking a free mutex fails.
+    bool executeSyncNode(NodeIndex node);
+    // Host address of 'size' bytes at 'address' + 'offset', all inside the live memory_ block 'address'
+    // points into (of 'region' if given); 0 without a MemoryManager, for foreign memory or on overflow
+    uintptr_t resolveAddress(uint64_t address, uint64_t offset, uint64_t size, std::optional<RegionID> region = std::nullopt) const;
+    bool waitFor(const concurrency::WaitRequest& request) {
+        wait_ = request;
+        return false;
+    }
+    // LEARN_UPDATE_PARAM: parameter + delta becomes the parameter's payload for the next run
+    bool executeParamUpdate(NodeIndex node);
+    // --- Slots and Payloads --
+    // Override if one is set, else the compiled payload (unset if there is none or it is not a scalar)
+    RuntimeValue payloadValue(NodeIndex node) const;
+    // In incremental mode slots keep earlier values; one not written during this run reads as unset
+    const RuntimeValue& readSlot(SlotIndex slot) const;
+    void writeSlot(SlotIndex slot, const RuntimeValue& value);
+    void resolvePayloadOverrides();
+    // --- Incremental Bookkeeping --
+    // Apply pending payload edits, then either carry the previous run's state over (marking the affected
+    // cone) or reset it
+    void beginRun(NodeIndex entry, bool same_graph);
+    void markAffectedCone(std::vector<NodeIndex>& roots); // Consumes 'roots' as its work list
+    // Outside the affected cone, on the previous run's path and executed exactly once by that run:
+    // the node would compute what it did then
+    bool isReusable(NodeIndex node) const;
+    void reusePrevious(NodeIndex node); // Keep the node's outputs from the previous run
+    void noteExecuted(NodeIndex node);
  };
  } // namespace bdi::runtime
  #endif // BDI_RUNTIME_BDIVIRTUALMACHINE_HPP
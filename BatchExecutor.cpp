@@ -0,0 +1,697 @@
+// File: bdi/runtime/BatchExecutor.cpp
+ #include "BatchExecutor.hpp"
+ #include "IoPrint.hpp"
+ #include "OperationSemantics.hpp"
+ #include "kernels/VectorKernels.hpp"
+ #include "memory/MemoryManager.hpp"
+ #include <algorithm>
+ #include <cmath>
+ #include <cstring>
+ #include <limits>
+ #include <map>
+ #include <type_traits>
+ namespace bdi::runtime {
+ using bdi::core::graph::INVALID_NODE_INDEX;
+ using bdi::core::graph::INVALID_SLOT_INDEX;
+ using bdi::core::graph::isFloatType;
+ using bdi::core::graph::isIntegerType;
+ namespace {
+ // Bytes per lane for values of 'type'; types without a scalar size keep all 64 bits of the value
+ size_t laneWidth(BDIType type) {
+    size_t size = getBdiTypeSize(type);
+    return size == 0 || size > sizeof(uint64_t) ? sizeof(uint64_t) : size;
+ }
+ // Run fn(lane) for every lane of a sorted group. Contiguous groups (the common, converged case)
+ // become a plain counted loop that the compiler vectorizes.
+ template <typename Fn>
+ inline void forLanes(const std::vector<uint32_t>& lanes, Fn&& fn) {
+    if (lanes.empty()) return;
+    const uint32_t first = lanes.front();
+    if (lanes.back() - first + 1 == lanes.size()) {
+        const uint32_t end = first + static_cast<uint32_t>(lanes.size());
+        for (uint32_t i = first; i < end; ++i) fn(i);
+    } else {
+        for (uint32_t i : lanes) fn(i);
+    }
+ }
+ // True if values of 'type' are stored as T
+ template <typename T>
+ bool hasStorage(BDIType type) {
+    bool same = false;
+    dispatchScalarType(type, [&](auto tag) { same = std::is_same_v<decltype(tag), T>; });
+    return same;
+ }
+ bool isComparison(BDIOperationType op) {
+    return op >= BDIOperationType::CMP_EQ && op <= BDIOperationType::CMP_GE;
+ }
+ // Column kernels; semantics mirror detail::applyArithmetic / applyComparison lane by lane.
+ // Ops without a vector form (division, rotates, bit counts) call the reference helper per lane.
+ template <typename T>
+ void arithmeticLanes(BDIOperationType op, const T* a, const T* b, const T* c, T* r,
+                      const std::vector<uint32_t>& lanes, uint8_t* failed) {
+    using Op = BDIOperationType;
+    if constexpr (std::is_floating_point_v<T>) {
+        switch (op) {
+            case Op::ARITH_ADD: forLanes(lanes, [&](uint32_t i) { r[i] = detail::orderedNan(a[i] + b[i], a[i], b[i]); }); return;
+            case Op::ARITH_SUB: forLanes(lanes, [&](uint32_t i) { r[i] = detail::orderedNan(a[i] - b[i], a[i], b[i]); }); return;
+            case Op::ARITH_MUL: forLanes(lanes, [&](uint32_t i) { r[i] = detail::orderedNan(a[i] * b[i], a[i], b[i]); }); return;
+            case Op::ARITH_DIV: forLanes(lanes, [&](uint32_t i) { r[i] = detail::orderedNan(a[i] / b[i], a[i], b[i]); }); return;
+            case Op::ARITH_NEG: forLanes(lanes, [&](uint32_t i) { r[i] = -a[i]; }); return;
+            case Op::ARITH_ABS: forLanes(lanes, [&](uint32_t i) { r[i] = std::fabs(a[i]); }); return;
+            case Op::ARITH_INC: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] + T(1); }); return;
+            case Op::ARITH_DEC: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] - T(1); }); return;
+            case Op::ARITH_FMA:
+                forLanes(lanes, [&](uint32_t i) { r[i] = detail::orderedNan(std::fma(a[i], b[i], c[i]), a[i], b[i], c[i]); });
+                return;
+            default: break;
+        }
+    } else {
+        using U = std::make_unsigned_t<T>;
+        using W = detail::WrapType<U>;
+        constexpr unsigned bits = std::numeric_limits<U>::digits;
+        switch (op) {
+            case Op::ARITH_ADD: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) + U(b[i]))); }); return;
+            case Op::ARITH_SUB: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) - U(b[i]))); }); return;
+            case Op::ARITH_MUL: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(W(U(a[i])) * W(U(b[i])))); }); return;
+            case Op::ARITH_NEG: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(0) - U(a[i]))); }); return;
+            case Op::ARITH_INC: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) + 1)); }); return;
+            case Op::ARITH_DEC: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) - 1)); }); return;
+            case Op::ARITH_FMA:
+                forLanes(lanes, [&](uint32_t i) { r[i] = T(U(W(U(a[i])) * W(U(b[i])) + W(U(c[i])))); });
+                return;
+            case Op::BIT_AND: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(a[i]) & U(b[i])); }); return;
+            case Op::BIT_OR:  forLanes(lanes, [&](uint32_t i) { r[i] = T(U(a[i]) | U(b[i])); }); return;
+            case Op::BIT_XOR: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(a[i]) ^ U(b[i])); }); return;
+            case Op::BIT_NOT: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(~U(a[i]))); }); return;
+            case Op::BIT_SHL: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) << (U(b[i]) % bits))); }); return;
+            case Op::BIT_SHR: forLanes(lanes, [&](uint32_t i) { r[i] = T(U(U(a[i]) >> (U(b[i]) % bits))); }); return;
+            case Op::BIT_ASHR: {
+                using S = std::make_signed_t<T>;
+                forLanes(lanes, [&](uint32_t i) { r[i] = T(S(S(a[i]) >> (U(b[i]) % bits))); });
+                return;
+            }
+            default: break;
+        }
+    }
+    forLanes(lanes, [&](uint32_t i) {
+        if (!detail::applyArithmetic<T>(op, a[i], b ? b[i] : T{}, c ? c[i] : T{}, r[i])) failed[i] = 1;
+    });
+ }
+ template <typename T>
+ void comparisonLanes(BDIOperationType op, const T* a, const T* b, uint8_t* r, const std::vector<uint32_t>& lanes) {
+    using Op = BDIOperationType;
+    switch (op) {
+        case Op::CMP_EQ: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] == b[i]; }); return;
+        case Op::CMP_NE: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] != b[i]; }); return;
+        case Op::CMP_LT: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] < b[i]; }); return;
+        case Op::CMP_LE: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] <= b[i]; }); return;
+        case Op::CMP_GT: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] > b[i]; }); return;
+        case Op::CMP_GE: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] >= b[i]; }); return;
+        default: return;
+    }
+ }
+ } // namespace
+ bool BatchExecutor::execute(const CompiledGraph& graph, NodeID entry_node_id, size_t batch_size,
+                             std::span<const BatchInput> inputs) {
+    graph_ = &graph;
+    batch_size_ = batch_size;
+    columns_.resize(graph.getSlotCount());
+    for (Column& column : columns_) {
+        column.type = BDIType::UNKNOWN;
+        column.width = 0;
+        column.written.assign(batch_size, 0);
+    }
+    return_values_.assign(batch_size, RuntimeValue{});
+    lane_steps_.assign(batch_size, 0);
+    lane_failed_.assign(batch_size, 0);
+    lane_flags_.assign(batch_size, 0);
+    for (auto& buffer : scratch_) buffer.resize(batch_size * sizeof(uint64_t));
+    floating_epoch_.assign(graph.getNodeCount(), 0);
+    floating_expanded_.assign(graph.getNodeCount(), 0);
+    dispatch_count_ = 0;
+    failed_lane_count_ = 0;
+    auto entry = graph.indexOf(entry_node_id);
+    if (!entry || batch_size > std::numeric_limits<uint32_t>::max() || !bindInputs(inputs)) {
+        lane_failed_.assign(batch_size, 1);
+        failed_lane_count_ = batch_size;
+        inputs_ = {};
+        return batch_size == 0 && entry.has_value();
+    }
+    LaneList lanes(batch_size);
+    for (uint32_t i = 0; i < batch_size; ++i) lanes[i] = i;
+    // Floating constants hold their (possibly per-lane) payload for the whole run
+    for (NodeIndex i = 0; i < graph.getNodeCount(); ++i) {
+        if (graph.isFloating(i) && graph.operation(i) == BDIOperationType::META_NOP) {
+            LaneList all = lanes;
+            evaluateValueNode(i, all);
+        }
+    }
+    rankControlNodes(*entry);
+    run(*entry, lanes, false);
+    inputs_ = {}; // Caller-owned; only valid during the run
+    return failed_lane_count_ == 0;
+ }
+ bool BatchExecutor::bindInputs(std::span<const BatchInput> inputs) {
+    const CompiledGraph& g = *graph_;
+    bound_input_.assign(g.getNodeCount(), -1);
+    inputs_ = inputs;
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        const BatchInput& input = inputs[k];
+        auto idx = g.indexOf(input.node_id);
+        if (!idx || g.operation(*idx) != BDIOperationType::META_NOP || bound_input_[*idx] >= 0) return false;
+        const size_t size = getBdiTypeSize(input.type);
+        if (size == 0 || size > sizeof(uint64_t) || input.values.size() != size * batch_size_) return false;
+        bound_input_[*idx] = static_cast<int32_t>(k);
+    }
+    return true;
+ }
+ void BatchExecutor::rankControlNodes(NodeIndex entry) {
+    const CompiledGraph& g = *graph_;
+    const size_t n = g.getNodeCount();
+    control_rank_.assign(n, std::numeric_limits<uint32_t>::max());
+    control_order_.clear();
+    // Iterative DFS over control edges; reverse post-order puts every node before its forward successors
+    std::vector<uint8_t> visited(n, 0);
+    std::vector<std::pair<NodeIndex, size_t>> stack;
+    stack.emplace_back(entry, 0);
+    visited[entry] = 1;
+    while (!stack.empty()) {
+        auto [node, next] = stack.back();
+        auto successors = g.controlSuccessors(node);
+        if (next < successors.size()) {
+            ++stack.back().second;
+            const NodeIndex succ = successors[next];
+            if (succ < n && !visited[succ]) {
+                visited[succ] = 1;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            control_order_.push_back(node);
+            stack.pop_back();
+        }
+    }
+    std::reverse(control_order_.begin(), control_order_.end());
+    for (uint32_t i = 0; i < control_order_.size(); ++i) control_rank_[control_order_[i]] = i;
+ }
+ void BatchExecutor::run(NodeIndex entry, const LaneList& lanes, bool task) {
+    const CompiledGraph& g = *graph_;
+    // Lanes waiting at each control node, by rank: the lowest rank runs first, which lets lanes that took
+    // different paths arrive at a join point (or leave a loop) before it executes
+    std::map<uint32_t, LaneList> pending;
+    auto arrive = [&](NodeIndex next, uint32_t lane) {
+        if (next == INVALID_NODE_INDEX) return; // Lane halts
+        pending[control_rank_[next]].push_back(lane);
+    };
+    for (uint32_t lane : lanes) arrive(entry, lane);
+    LaneList group;
+    while (!pending.empty()) {
+        auto it = pending.begin();
+        const NodeIndex node = control_order_[it->first];
+        group = std::move(it->second);
+        pending.erase(it);
+        const BDIOperationType op = g.operation(node);
+        if (task && op == BDIOperationType::CONCURRENCY_JOIN) continue; // The spawned task ends here
+        if (!std::is_sorted(group.begin(), group.end())) std::sort(group.begin(), group.end());
+        if (max_steps_ != 0) {
+            forLanes(group, [&](uint32_t i) { lane_flags_[i] = lane_steps_[i] >= max_steps_; });
+            failFlaggedLanes(group);
+            if (group.empty()) continue;
+        }
+        forLanes(group, [&](uint32_t i) { ++lane_steps_[i]; });
+        ++dispatch_count_;
+        executeNode(node, group);
+        if (group.empty()) continue;
+        auto successors = g.controlSuccessors(node);
+        switch (op) {
+            case BDIOperationType::META_END:
+            case BDIOperationType::CTRL_RETURN:
+                break;
+            case BDIOperationType::CTRL_BRANCH_COND:
+                // control_outputs = [true_target, false_target]; outcomes are in lane_flags_
+                if (successors.size() < 2) break;
+                for (uint32_t lane : group) {
+                    arrive(lane_flags_[lane] ? successors[0] : successors[1], lane);
+                    lane_flags_[lane] = 0;
+                }
+                break;
+            default:
+                if (successors.empty()) break;
+                for (uint32_t lane : group) arrive(successors[0], lane);
+                break;
+        }
+    }
+ }
+ void BatchExecutor::executeNode(NodeIndex node, LaneList& lanes) {
+    const CompiledGraph& g = *graph_;
+    Operand operand;
+    switch (g.operation(node)) {
+        case BDIOperationType::META_START:
+        case BDIOperationType::META_COMMENT:
+        case BDIOperationType::CTRL_JUMP:
+        case BDIOperationType::CONCURRENCY_JOIN: // Spawned tasks have already completed (serial semantics)
+            return;
+        case BDIOperationType::META_VERIFY_PROOF: // No proof verifier here: fails as in a VM without one
+            return failLanes(lanes);
+        case BDIOperationType::CONCURRENCY_SPAWN: {
+            // control_outputs = [continuation, task_entry...]; each task runs to completion for the group
+            auto successors = g.controlSuccessors(node);
+            for (size_t k = 1; k < successors.size() && !lanes.empty(); ++k) {
+                run(successors[k], lanes, true);
+                dropFailedLanes(lanes);
+            }
+            return;
+        }
+        case BDIOperationType::META_END:
+        case BDIOperationType::CTRL_RETURN:
+            if (!g.inputSlots(node).empty()) {
+                if (!gatherOperands(node, &operand, 1, lanes)) return;
+                forLanes(lanes, [&](uint32_t i) { return_values_[i] = laneValue(operand, i); });
+            }
+            return;
+        case BDIOperationType::META_ASSERT: {
+            if (!gatherOperands(node, &operand, 1, lanes)) return;
+            const uint8_t* truthy = truthyView(operand, lanes, 0);
+            forLanes(lanes, [&](uint32_t i) { lane_flags_[i] = !truthy[i]; });
+            failFlaggedLanes(lanes);
+            return;
+        }
+        case BDIOperationType::CTRL_BRANCH_COND: {
+            if (!gatherOperands(node, &operand, 1, lanes)) return;
+            const uint8_t* truthy = truthyView(operand, lanes, 0);
+            forLanes(lanes, [&](uint32_t i) { lane_flags_[i] = truthy[i]; });
+            return;
+        }
+        case BDIOperationType::IO_PRINT:
+            if (!gatherOperands(node, &operand, 1, lanes)) return;
+            for (uint32_t lane : lanes) printValue(g.nodeIdAt(node), lane, laneValue(operand, lane));
+            return;
+        default:
+            if (kernels::isKernelOperation(g.operation(node))) return executeKernelNode(node, lanes);
+            return evaluateValueNode(node, lanes);
+    }
+ }
+ void BatchExecutor::executeKernelNode(NodeIndex node, LaneList& lanes) {
+    // Same contract as BDIVirtualMachine::executeKernelNode, run lane by lane: buffers are per-lane pointers
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    const kernels::KernelOperandCount arity = kernels::getKernelOperandCount(op);
+    auto slots = g.inputSlots(node);
+    const size_t count = slots.size();
+    bool wired = count >= arity.required && count <= arity.max;
+    for (SlotIndex slot : slots) wired = wired && slot != INVALID_SLOT_INDEX;
+    if (!wired) return failLanes(lanes);
+    Operand operands[kernels::MAX_KERNEL_OPERANDS];
+    if (!gatherOperands(node, operands, count, lanes)) return;
+    Column* dest = g.outputCount(node) ? &columns_[g.outputSlotBase(node)] : nullptr;
+    const kernels::KernelBufferCheck buffers{&memory::MemoryManager::checkKernelBuffer, memory_};
+    for (uint32_t lane : lanes) {
+        RuntimeValue values[kernels::MAX_KERNEL_OPERANDS];
+        for (size_t k = 0; k < count; ++k) values[k] = laneValue(operands[k], lane);
+        if (!kernels::executeKernelOperation(op, g.payloadType(node), {values, count}, buffers)) lane_flags_[lane] = 1;
+        else if (dest && !storeValue(*dest, lane, values[0])) lane_flags_[lane] = 1;
+    }
+    failFlaggedLanes(lanes);
+ }
+ bool BatchExecutor::gatherOperands(NodeIndex node, Operand* operands, size_t count, LaneList& lanes) {
+    const CompiledGraph& g = *graph_;
+    auto slots = g.inputSlots(node);
+    auto sources = g.inputNodes(node);
+    for (size_t k = 0; k < count; ++k) {
+        if (k < slots.size() && slots[k] != INVALID_SLOT_INDEX) {
+            // Pure producers are evaluated for the group at most once per dispatch. Floating constants
+            // were published for every lane at the start of the run and never change.
+            const NodeIndex src = sources[k];
+            if (g.isFloating(src) && g.operation(src) != BDIOperationType::META_NOP &&
+                floating_epoch_[src] != dispatch_count_ && !evaluateFloating(src, lanes)) {
+                return false;
+            }
+            const Column& column = columns_[slots[k]];
+            if (column.type == BDIType::UNKNOWN) {
+                failLanes(lanes); // Read of a value that was never produced
+                return false;
+            }
+            operands[k] = Operand{&column, column.type, RuntimeValue{}};
+            forLanes(lanes, [&](uint32_t i) { lane_flags_[i] = !column.written[i]; });
+            failFlaggedLanes(lanes);
+            if (lanes.empty()) return false;
+        } else {
+            // Operand not wired: take the immediate from the payload
+            const RuntimeValue immediate = RuntimeValue::fromBytes(g.payloadType(node), g.payloadBytes(node));
+            if (!immediate.isSet()) {
+                failLanes(lanes);
+                return false;
+            }
+            operands[k] = Operand{nullptr, immediate.type, immediate};
+        }
+    }
+    return true;
+ }
+ bool BatchExecutor::evaluateFloating(NodeIndex root, LaneList& lanes) {
+    const CompiledGraph& g = *graph_;
+    // Same walk as BDIVirtualMachine::evaluateFloating, once per dispatch instead of once per step
+    floating_stack_.assign(1, root);
+    while (!floating_stack_.empty()) {
+        const NodeIndex node = floating_stack_.back();
+        if (floating_epoch_[node] == dispatch_count_) {
+            floating_stack_.pop_back();
+            continue;
+        }
+        if (floating_expanded_[node] != dispatch_count_) {
+            floating_expanded_[node] = dispatch_count_;
+            const BDIOperationType op = g.operation(node);
+            const size_t arity = isScalarOperation(op) ? getScalarOperationArity(op) : 0;
+            auto slots = g.inputSlots(node);
+            auto sources = g.inputNodes(node);
+            bool pending = false;
+            for (size_t k = 0; k < arity && k < slots.size(); ++k) {
+                const NodeIndex src = sources[k];
+                if (slots[k] == INVALID_SLOT_INDEX || !g.isFloating(src) || g.operation(src) == BDIOperationType::META_NOP ||
+                    floating_epoch_[src] == dispatch_count_) {
+                    continue;
+                }
+                if (floating_expanded_[src] == dispatch_count_) { // Cycle among floating nodes
+                    failLanes(lanes);
+                    return false;
+                }
+                floating_stack_.push_back(src);
+                pending = true;
+            }
+            if (pending) continue;
+        }
+        floating_stack_.pop_back();
+        evaluateValueNode(node, lanes);
+        if (lanes.empty()) return false;
+        floating_epoch_[node] = dispatch_count_;
+    }
+    return true;
+ }
+ void BatchExecutor::evaluateValueNode(NodeIndex node, LaneList& lanes) {
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    const SlotIndex out_slot = g.outputCount(node) ? g.outputSlotBase(node) : INVALID_SLOT_INDEX;
+    Column* dest = out_slot != INVALID_SLOT_INDEX ? &columns_[out_slot] : nullptr;
+    if (op == BDIOperationType::META_NOP) return publishConstant(node, lanes, dest);
+    if (!isScalarOperation(op)) return failLanes(lanes);
+    Operand operands[3];
+    const size_t arity = getScalarOperationArity(op);
+    if (!gatherOperands(node, operands, arity, lanes)) return;
+    const BDIType result_type = dest ? g.slotType(out_slot) : BDIType::UNKNOWN;
+    computeScalar(op, result_type, operands, arity, lanes, dest);
+ }
+ void BatchExecutor::publishConstant(NodeIndex node, LaneList& lanes, Column* dest) {
+    const CompiledGraph& g = *graph_;
+    if (!dest) return;
+    if (bound_input_[node] >= 0) {
+        const BatchInput& input = inputs_[bound_input_[node]];
+        if (!prepareColumn(*dest, input.type, lanes)) return;
+        const size_t width = dest->width;
+        std::byte* out = dest->storage.data();
+        if (lanes.back() - lanes.front() + 1 == lanes.size()) {
+            std::memcpy(out + lanes.front() * width, input.values.data() + lanes.front() * width, lanes.size() * width);
+        } else {
+            for (uint32_t i : lanes) std::memcpy(out + i * width, input.values.data() + i * width, width);
+        }
+        markWritten(*dest, lanes);
+        return;
+    }
+    // Constant: payload is published on output 0
+    if (g.flags(node) & CompiledGraph::FLAG_HAS_PAYLOAD) {
+        broadcast(*dest, RuntimeValue::fromBytes(g.payloadType(node), g.payloadBytes(node)), lanes);
+    }
+ }
+ void BatchExecutor::computeScalar(BDIOperationType op, BDIType result_type, const Operand* operands, size_t arity,
+                                   LaneList& lanes, Column* dest) {
+    // Typed column loops need scalar operand types; anything else (pointers, unset results) takes the
+    // per-lane reference path
+    bool typed = true;
+    for (size_t k = 0; k < arity; ++k) typed = typed && isScalarType(operands[k].type);
+    switch (op) {
+        case BDIOperationType::LOGIC_AND:
+        case BDIOperationType::LOGIC_OR:
+        case BDIOperationType::LOGIC_XOR:
+        case BDIOperationType::LOGIC_NOT:
+            return computeLogic(op, operands, lanes, dest);
+        case BDIOperationType::CONV_TRUNC:
+        case BDIOperationType::CONV_FLOAT_TO_INT:
+        case BDIOperationType::CONV_INT_TO_FLOAT:
+            if (typed && isScalarType(result_type)) return computeConversion(op, result_type, operands[0], lanes, dest);
+            break;
+        case BDIOperationType::CONV_BITCAST:
+            if (getBdiTypeSize(result_type) != 0 && getBdiTypeSize(result_type) == getBdiTypeSize(operands[0].type) &&
+                getBdiTypeSize(result_type) <= sizeof(uint64_t)) {
+                return computeBitcast(result_type, operands[0], lanes, dest);
+            }
+            break;
+        case BDIOperationType::CONV_EXTEND_SIGN:
+        case BDIOperationType::CONV_EXTEND_ZERO:
+            break;
+        default: {
+            // Float -> integer conversions of operands or result are range-checked per lane by the
+            // reference path
+            const BDIType store_type = result_type == BDIType::UNKNOWN ? operands[0].type : result_type;
+            const bool float_op = isFloatType(operands[0].type);
+            bool exact = isComparison(op) || !float_op || !isIntegerType(store_type);
+            for (size_t k = 1; k < arity; ++k) exact = exact && (float_op || !isFloatType(operands[k].type));
+            if (typed && exact && (isComparison(op) || isScalarType(store_type))) {
+                return computeArithmetic(op, result_type, operands, arity, lanes, dest);
+            }
+            break;
+        }
+    }
+    computeGeneric(op, result_type, operands, arity, lanes, dest);
+ }
+ void BatchExecutor::computeArithmetic(BDIOperationType op, BDIType result_type, const Operand* operands,
+                                       size_t arity, LaneList& lanes, Column* dest) {
+    dispatchScalarType(operands[0].type, [&](auto tag) {
+        using T = decltype(tag);
+        // Computed in the type of operand 0, like evaluateScalar
+        const T* a = operandView<T>(operands[0], lanes, 0);
+        const T* b = arity > 1 ? operandView<T>(operands[1], lanes, 1) : nullptr;
+        const T* c = arity > 2 ? operandView<T>(operands[2], lanes, 2) : nullptr;
+        if (isComparison(op)) {
+            if (dest && !prepareColumn(*dest, BDIType::BOOL, lanes)) return;
+            uint8_t* r = dest ? dest->data<uint8_t>() : scratch<uint8_t>(3);
+            comparisonLanes<T>(op, a, b, r, lanes);
+            if (dest) markWritten(*dest, lanes);
+            return;
+        }
+        const BDIType store_type = result_type == BDIType::UNKNOWN ? operands[0].type : result_type;
+        // Write straight into the output column unless the result needs a conversion
+        const bool direct = dest && store_type != BDIType::BOOL && hasStorage<T>(store_type);
+        if (direct && !prepareColumn(*dest, store_type, lanes)) return;
+        T* r = direct ? dest->data<T>() : scratch<T>(3);
+        arithmeticLanes<T>(op, a, b, c, r, lanes, lane_flags_.data());
+        failFlaggedLanes(lanes);
+        if (direct) markWritten(*dest, lanes);
+        else storeConverted<T>(dest, store_type, r, lanes);
+    });
+ }
+ void BatchExecutor::computeLogic(BDIOperationType op, const Operand* operands, LaneList& lanes, Column* dest) {
+    const uint8_t* a = truthyView(operands[0], lanes, 0);
+    const uint8_t* b = op != BDIOperationType::LOGIC_NOT ? truthyView(operands[1], lanes, 1) : nullptr;
+    if (dest && !prepareColumn(*dest, BDIType::BOOL, lanes)) return;
+    uint8_t* r = dest ? dest->data<uint8_t>() : scratch<uint8_t>(3);
+    switch (op) {
+        case BDIOperationType::LOGIC_AND: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] & b[i]; }); break;
+        case BDIOperationType::LOGIC_OR:  forLanes(lanes, [&](uint32_t i) { r[i] = a[i] | b[i]; }); break;
+        case BDIOperationType::LOGIC_XOR: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] ^ b[i]; }); break;
+        default: forLanes(lanes, [&](uint32_t i) { r[i] = a[i] ^ 1; }); break;
+    }
+    if (dest) markWritten(*dest, lanes);
+ }
+ void BatchExecutor::computeConversion(BDIOperationType op, BDIType result_type, const Operand& operand,
+                                       LaneList& lanes, Column* dest) {
+    dispatchScalarType(operand.type, [&](auto tag) {
+        using S = decltype(tag);
+        if constexpr (std::is_floating_point_v<S>) {
+            if (op == BDIOperationType::CONV_INT_TO_FLOAT) return failLanes(lanes);
+        } else if (op == BDIOperationType::CONV_FLOAT_TO_INT) {
+            return failLanes(lanes);
+        }
+        const S* v = operandView<S>(operand, lanes, 0);
+        if constexpr (std::is_floating_point_v<S>) {
+            // Undefined float -> int conversion: not finite, or out of the destination's range
+            dispatchScalarType(result_type, [&](auto to) {
+                using D = decltype(to);
+                const bool to_bool = result_type == BDIType::BOOL;
+                forLanes(lanes, [&](uint32_t i) {
+                    lane_flags_[i] = !std::isfinite(v[i]) || (!to_bool && !detail::fitsInteger<D>(v[i]));
+                });
+            });
+            failFlaggedLanes(lanes);
+        }
+        storeConverted<S>(dest, result_type, v, lanes);
+    });
+ }
+ void BatchExecutor::computeBitcast(BDIType result_type, const Operand& operand, LaneList& lanes, Column* dest) {
+    if (!dest) return;
+    if (!operand.column) {
+        RuntimeValue value = operand.immediate;
+        value.type = result_type;
+        return broadcast(*dest, value, lanes);
+    }
+    if (!prepareColumn(*dest, result_type, lanes)) return;
+    const size_t width = dest->width;
+    const std::byte* in = operand.column->storage.data();
+    std::byte* out = dest->storage.data();
+    if (in != out) {
+        forLanes(lanes, [&](uint32_t i) { std::memcpy(out + i * width, in + i * width, width); });
+    }
+    markWritten(*dest, lanes);
+ }
+ void BatchExecutor::computeGeneric(BDIOperationType op, BDIType result_type, const Operand* operands, size_t arity,
+                                    LaneList& lanes, Column* dest) {
+    forLanes(lanes, [&](uint32_t i) {
+        RuntimeValue values[3];
+        for (size_t k = 0; k < arity; ++k) values[k] = laneValue(operands[k], i);
+        RuntimeValue result;
+        if (!evaluateScalar(op, result_type, values, result) || (dest && !storeValue(*dest, i, result))) {
+            lane_flags_[i] = 1;
+        }
+    });
+    failFlaggedLanes(lanes);
+ }
+ bool BatchExecutor::prepareColumn(Column& column, BDIType type, LaneList& lanes) {
+    if (column.type == type) return true;
+    if (column.type != BDIType::UNKNOWN) {
+        // Slot types follow from operand types and do not change within a run; fail rather than reinterpret
+        failLanes(lanes);
+        return false;
+    }
+    column.type = type;
+    column.width = laneWidth(type);
+    column.storage.resize(batch_size_ * column.width);
+    return true;
+ }
+ void BatchExecutor::broadcast(Column& column, const RuntimeValue& value, LaneList& lanes) {
+    if (!value.isSet()) {
+        forLanes(lanes, [&](uint32_t i) { column.written[i] = 0; });
+        return;
+    }
+    if (!prepareColumn(column, value.type, lanes)) return;
+    std::byte* out = column.storage.data();
+    switch (column.width) {
+        case 1: forLanes(lanes, [&](uint32_t i) { std::memcpy(out + i, &value.bits, 1); }); break;
+        case 2: forLanes(lanes, [&](uint32_t i) { std::memcpy(out + i * 2, &value.bits, 2); }); break;
+        case 4: forLanes(lanes, [&](uint32_t i) { std::memcpy(out + i * 4, &value.bits, 4); }); break;
+        default: forLanes(lanes, [&](uint32_t i) { std::memcpy(out + i * column.width, &value.bits, column.width); }); break;
+    }
+    markWritten(column, lanes);
+ }
+ bool BatchExecutor::storeValue(Column& column, uint32_t lane, const RuntimeValue& value) {
+    if (!value.isSet()) {
+        column.written[lane] = 0;
+        return true;
+    }
+    if (column.type != value.type) {
+        if (column.type != BDIType::UNKNOWN) return false;
+        column.type = value.type;
+        column.width = laneWidth(value.type);
+        column.storage.resize(batch_size_ * column.width);
+    }
+    std::memcpy(column.storage.data() + lane * column.width, &value.bits, column.width);
+    column.written[lane] = 1;
+    return true;
+ }
+ template <typename T>
+ void BatchExecutor::storeConverted(Column* dest, BDIType type, const T* values, LaneList& lanes) {
+    // storeAs semantics: numeric conversion, BOOL normalized to 0/1
+    if (!dest || lanes.empty() || !prepareColumn(*dest, type, lanes)) return;
+    dispatchScalarType(type, [&](auto tag) {
+        using D = decltype(tag);
+        D* out = dest->data<D>();
+        if (type == BDIType::BOOL) forLanes(lanes, [&](uint32_t i) { out[i] = values[i] != T{} ? 1 : 0; });
+        else forLanes(lanes, [&](uint32_t i) { out[i] = static_cast<D>(values[i]); });
+    });
+    markWritten(*dest, lanes);
+ }
+ void BatchExecutor::markWritten(Column& column, const LaneList& lanes) {
+    uint8_t* written = column.written.data();
+    forLanes(lanes, [&](uint32_t i) { written[i] = 1; });
+ }
+ RuntimeValue BatchExecutor::laneValue(const Operand& operand, uint32_t lane) const {
+    if (!operand.column) return operand.immediate;
+    RuntimeValue value;
+    value.type = operand.type;
+    std::memcpy(&value.bits, operand.column->storage.data() + lane * operand.column->width, operand.column->width);
+    return value;
+ }
+ template <typename T>
+ const T* BatchExecutor::operandView(const Operand& operand, const LaneList& lanes, size_t index) {
+    if (operand.column && hasStorage<T>(operand.type)) return operand.column->data<T>();
+    T* out = scratch<T>(index);
+    if (!operand.column) {
+        const T value = loadAs<T>(operand.immediate);
+        forLanes(lanes, [&](uint32_t i) { out[i] = value; });
+        return out;
+    }
+    dispatchScalarType(operand.type, [&](auto tag) {
+        using S = decltype(tag);
+        const S* in = operand.column->data<S>();
+        forLanes(lanes, [&](uint32_t i) { out[i] = static_cast<T>(in[i]); });
+    });
+    return out;
+ }
+ const uint8_t* BatchExecutor::truthyView(const Operand& operand, const LaneList& lanes, size_t index) {
+    uint8_t* out = scratch<uint8_t>(index);
+    if (!operand.column) {
+        const uint8_t value = isTruthy(operand.immediate) ? 1 : 0;
+        forLanes(lanes, [&](uint32_t i) { out[i] = value; });
+        return out;
+    }
+    const bool typed = dispatchScalarType(operand.type, [&](auto tag) {
+        using T = decltype(tag);
+        const T* in = operand.column->data<T>();
+        forLanes(lanes, [&](uint32_t i) { out[i] = in[i] != T{}; });
+    });
+    if (!typed) forLanes(lanes, [&](uint32_t i) { out[i] = isTruthy(laneValue(operand, i)) ? 1 : 0; });
+    return out;
+ }
+ void BatchExecutor::failLanes(LaneList& lanes) {
+    for (uint32_t lane : lanes) {
+        if (!lane_failed_[lane]) ++failed_lane_count_;
+        lane_failed_[lane] = 1;
+    }
+    lanes.clear();
+ }
+ void BatchExecutor::failFlaggedLanes(LaneList& lanes) {
+    uint8_t any = 0;
+    forLanes(lanes, [&](uint32_t i) { any |= lane_flags_[i]; });
+    if (!any) return;
+    size_t kept = 0;
+    for (uint32_t lane : lanes) {
+        if (lane_flags_[lane]) {
+            lane_flags_[lane] = 0;
+            if (!lane_failed_[lane]) ++failed_lane_count_;
+            lane_failed_[lane] = 1;
+        } else {
+            lanes[kept++] = lane;
+        }
+    }
+    lanes.resize(kept);
+ }
+ void BatchExecutor::dropFailedLanes(LaneList& lanes) const {
+    std::erase_if(lanes, [&](uint32_t lane) { return lane_failed_[lane] != 0; });
+ }
+ std::optional<RuntimeValue> BatchExecutor::getOutputValue(size_t lane, NodeID node_id, PortIndex port_idx) const {
+    if (!graph_ || lane >= batch_size_) return std::nullopt;
+    auto idx = graph_->indexOf(node_id);
+    if (!idx || port_idx >= graph_->outputCount(*idx)) return std::nullopt;
+    const Column& column = columns_[graph_->outputSlotBase(*idx) + port_idx];
+    if (column.type == BDIType::UNKNOWN || !column.written[lane]) return std::nullopt;
+    return laneValue(Operand{&column, column.type, RuntimeValue{}}, static_cast<uint32_t>(lane));
+ }
+ std::optional<RuntimeValue> BatchExecutor::getReturnValue(size_t lane) const {
+    if (lane >= batch_size_ || !return_values_[lane].isSet()) return std::nullopt;
+    return return_values_[lane];
+ }
+ std::optional<BatchColumnView> BatchExecutor::getOutputColumn(NodeID node_id, PortIndex port_idx) const {
+    if (!graph_) return std::nullopt;
+    auto idx = graph_->indexOf(node_id);
+    if (!idx || port_idx >= graph_->outputCount(*idx)) return std::nullopt;
+    const Column& column = columns_[graph_->outputSlotBase(*idx) + port_idx];
+    if (column.type == BDIType::UNKNOWN) return std::nullopt;
+    return BatchColumnView{column.type, column.width, {column.storage.data(), batch_size_ * column.width},
+                           {column.written.data(), batch_size_}};
+ }
+ } // namespace bdi::runtime
@@ -0,0 +1,147 @@
+// File: bdi/runtime/BatchExecutor.hpp
+ #ifndef BDI_RUNTIME_BATCHEXECUTOR_HPP
+ #define BDI_RUNTIME_BATCHEXECUTOR_HPP
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "RuntimeValue.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <optional>
+ #include <span>
+ #include <vector>
+ namespace bdi::runtime::memory { class MemoryManager; }
+ namespace bdi::runtime {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ using bdi::core::graph::SlotIndex;
+ // Per-lane payload of one constant (META_NOP) node: lane i runs as if the node's payload were the
+ // i-th value. Values are packed, getBdiTypeSize(type) bytes each, and must outlive execute().
+ struct BatchInput {
+    NodeID node_id = 0;
+    BDIType type = BDIType::UNKNOWN;
+    std::span<const std::byte> values;
+ };
+ // One output port across the batch: lane i holds values[i * element_size], valid where written[i] != 0
+ struct BatchColumnView {
+    BDIType type = BDIType::UNKNOWN;
+    size_t element_size = 0;
+    std::span<const std::byte> values;
+    std::span<const uint8_t> written;
+ };
+ // Runs one CompiledGraph over many independent input records at once (SIMD across instances).
+ // Every output port is a column with one value per lane. Lanes that reach a control node together form
+ // a group; the node is dispatched once per group and scalar operations run as one loop over it.
+ // CTRL_BRANCH_COND splits a group by lane, groups waiting at the same node merge again, and the group
+ // earliest in reverse post-order runs first, so lanes that diverged reconverge at join points.
+ // Each lane behaves exactly like BDIVirtualMachine running the graph with its bound payloads (success,
+ // output values bit for bit, NaNs included, return value, step limit); lanes fail independently. IO_PRINT output of different
+ // lanes may interleave differently from one-record-at-a-time runs.
+ // Columns take batch_size bytes per value slot and lane: batches of a few thousand lanes keep the
+ // working set in cache; larger record sets are best fed in chunks.
+ class BatchExecutor {
+ public:
+    // Run 'batch_size' lanes from 'entry_node_id', with 'inputs' bound to constant nodes.
+    // Returns true if every lane succeeded. A missing entry node or malformed inputs (unknown or
+    // non-constant node, size mismatch, node bound twice) fail every lane without running any.
+    bool execute(const CompiledGraph& graph, NodeID entry_node_id, size_t batch_size,
+                 std::span<const BatchInput> inputs = {});
+    // --- State Inspection (per lane, same contract as BDIVirtualMachine) --
+    size_t getBatchSize() const { return batch_size_; }
+    bool laneSucceeded(size_t lane) const { return lane < batch_size_ && !lane_failed_[lane]; }
+    size_t getFailedLaneCount() const { return failed_lane_count_; }
+    std::optional<RuntimeValue> getOutputValue(size_t lane, NodeID node_id, PortIndex port_idx) const;
+    std::optional<RuntimeValue> getReturnValue(size_t lane) const;
+    // Whole column of an output port, e.g. the scores of all records; nullopt if it was never written
+    std::optional<BatchColumnView> getOutputColumn(NodeID node_id, PortIndex port_idx) const;
+    // Blocks kernel buffers must lie in, as on BDIVirtualMachine; without one kernel nodes fail
+    void setMemoryManager(memory::MemoryManager* memory) { memory_ = memory; }
+    // Step limit per lane (0 = unlimited)
+    void setMaxSteps(uint64_t max_steps) { max_steps_ = max_steps; }
+    uint64_t getStepCount(size_t lane) const { return lane < batch_size_ ? lane_steps_[lane] : 0; }
+    // Node dispatches of the last run; one-record engines need one per lane and step
+    uint64_t getDispatchCount() const { return dispatch_count_; }
+ private:
+    // Values of one output slot; the type is fixed by the first write of a run
+    struct Column {
+        BDIType type = BDIType::UNKNOWN;
+        size_t width = 0; // Bytes per lane
+        std::vector<std::byte> storage;
+        std::vector<uint8_t> written;
+        template <typename T> T* data() { return reinterpret_cast<T*>(storage.data()); }
+        template <typename T> const T* data() const { return reinterpret_cast<const T*>(storage.data()); }
+    };
+    // A gathered operand: a column, or the consuming node's payload immediate (same for every lane)
+    struct Operand {
+        const Column* column = nullptr;
+        BDIType type = BDIType::UNKNOWN;
+        RuntimeValue immediate;
+    };
+    using LaneList = std::vector<uint32_t>; // Sorted, unique
+    const CompiledGraph* graph_ = nullptr;
+    size_t batch_size_ = 0;
+    std::vector<Column> columns_;             // One per SlotIndex
+    std::vector<RuntimeValue> return_values_; // Per lane
+    std::vector<uint64_t> lane_steps_;
+    std::vector<uint8_t> lane_failed_;
+    size_t failed_lane_count_ = 0;
+    std::vector<uint8_t> lane_flags_;         // Per-lane scratch: kernel failures, branch outcomes
+    std::vector<std::byte> scratch_[4];       // Converted / broadcast operands and results
+    std::vector<uint32_t> control_rank_;      // Reverse post-order position of each control node
+    std::vector<NodeIndex> control_order_;
+    std::vector<int32_t> bound_input_;        // Per NodeIndex: index into inputs_, or -1
+    std::span<const BatchInput> inputs_;
+    std::vector<uint64_t> floating_epoch_;    // Dispatch in which a floating node was last evaluated
+    std::vector<uint64_t> floating_expanded_; // Dispatch in which evaluateFloating() pushed the node's producers
+    std::vector<NodeIndex> floating_stack_;
+    uint64_t dispatch_count_ = 0;
+    uint64_t max_steps_ = 0;
+    memory::MemoryManager* memory_ = nullptr;
+    bool bindInputs(std::span<const BatchInput> inputs);
+    void rankControlNodes(NodeIndex entry);
+    // Run 'lanes' from 'entry' until they halt; in a spawned task lanes also stop at CONCURRENCY_JOIN
+    void run(NodeIndex entry, const LaneList& lanes, bool task);
+    void executeNode(NodeIndex node, LaneList& lanes);
+    void executeKernelNode(NodeIndex node, LaneList& lanes);
+    // Evaluate the floating node 'root' for the group, after the floating producers it reads.
+    // Returns false when no lane is left.
+    bool evaluateFloating(NodeIndex root, LaneList& lanes);
+    void evaluateValueNode(NodeIndex node, LaneList& lanes);
+    // Gather operands for the group; lanes reading an unset value fail and leave 'lanes'.
+    // Returns false when no lane is left.
+    bool gatherOperands(NodeIndex node, Operand* operands, size_t count, LaneList& lanes);
+    void publishConstant(NodeIndex node, LaneList& lanes, Column* dest);
+    void computeScalar(BDIOperationType op, BDIType result_type, const Operand* operands, size_t arity,
+                       LaneList& lanes, Column* dest);
+    void computeArithmetic(BDIOperationType op, BDIType result_type, const Operand* operands, size_t arity,
+                           LaneList& lanes, Column* dest);
+    void computeLogic(BDIOperationType op, const Operand* operands, LaneList& lanes, Column* dest);
+    void computeConversion(BDIOperationType op, BDIType result_type, const Operand& operand, LaneList& lanes,
+                           Column* dest);
+    void computeBitcast(BDIType result_type, const Operand& operand, LaneList& lanes, Column* dest);
+    void computeGeneric(BDIOperationType op, BDIType result_type, const Operand* operands, size_t arity,
+                        LaneList& lanes, Column* dest);
+    // --- Column Helpers --
+    // Fix the column type on first write; a later write of another type fails the lanes
+    bool prepareColumn(Column& column, BDIType type, LaneList& lanes);
+    void broadcast(Column& column, const RuntimeValue& value, LaneList& lanes);
+    bool storeValue(Column& column, uint32_t lane, const RuntimeValue& value);
+    template <typename T>
+    void storeConverted(Column* dest, BDIType type, const T* values, LaneList& lanes);
+    void markWritten(Column& column, const LaneList& lanes);
+    RuntimeValue laneValue(const Operand& operand, uint32_t lane) const;
+    // Operand as a T array indexed by lane (numeric conversion like loadAs, immediates broadcast)
+    template <typename T>
+    const T* operandView(const Operand& operand, const LaneList& lanes, size_t scratch);
+    const uint8_t* truthyView(const Operand& operand, const LaneList& lanes, size_t scratch);
+    template <typename T>
+    T* scratch(size_t index) { return reinterpret_cast<T*>(scratch_[index].data()); }
+    // --- Lane Failure --
+    void failLanes(LaneList& lanes);
+    // Fail lanes whose lane_flags_ entry is set, and clear the flags
+    void failFlaggedLanes(LaneList& lanes);
+    void dropFailedLanes(LaneList& lanes) const;
+ };
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_BATCHEXECUTOR_HPP
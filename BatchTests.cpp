@@ -0,0 +1,140 @@
+// File: bdi/tests/BatchTests.cpp
+ // BatchExecutor lanes against BDIVirtualMachine runs of the same graph with the lane's payloads bound:
+ // random DAGs, loop CFGs whose lanes branch differently, and step limits
+ #include "TestSupport.hpp"
+ #include "../benchmarks/GraphGenerators.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/BatchExecutor.hpp"
+ #include <cmath>
+ #include <limits>
+ #include <random>
+ #include <vector>
+ using namespace bdi::tests;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ using bdi::runtime::BatchExecutor;
+ using bdi::runtime::BatchInput;
+ using bdi::runtime::BDIVirtualMachine;
+ namespace {
+ // Bit for bit, NaN sign and payload included
+ bool sameValue(const std::optional<RuntimeValue>& a, const std::optional<RuntimeValue>& b) {
+    if (!a || !b) return !a && !b;
+    return a->type == b->type && a->bits == b->bits;
+ }
+ // Small integers (so branches go both ways), and signed zeros, infinities and NaNs for floats
+ RuntimeValue randomValue(BDIType type, std::mt19937_64& rng) {
+    const int64_t small = static_cast<int64_t>(rng() % 72) - 8;
+    switch (type) {
+        case BDIType::FLOAT32:
+        case BDIType::FLOAT64: {
+            const double specials[] = {0.0, -0.0, std::numeric_limits<double>::infinity(),
+                                       -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()};
+            const double value = rng() % 4 == 0 ? specials[rng() % 5] : static_cast<double>(small) * 0.75;
+            return type == BDIType::FLOAT32 ? RuntimeValue::make(type, static_cast<float>(value)) : RuntimeValue::make(type, value);
+        }
+        case BDIType::INT16: return RuntimeValue::make(type, static_cast<int16_t>(small));
+        case BDIType::INT32: return RuntimeValue::make(type, static_cast<int32_t>(small));
+        default: return RuntimeValue::make(type, small);
+    }
+ }
+ struct Binding {
+    NodeID node = 0;
+    BDIType type = BDIType::UNKNOWN;
+    std::vector<RuntimeValue> lanes;
+    std::vector<std::byte> packed;
+ };
+ // Binds about half of the scalar constants of 'graph' to random per-lane values
+ std::vector<Binding> bindConstants(const BDIGraph& graph, size_t batch_size, std::mt19937_64& rng) {
+    std::vector<Binding> bindings;
+    for (const auto& [id, node] : graph) {
+        if (node->operation != BDIOperationType::META_NOP || node->data_outputs.empty() || rng() % 2) continue;
+        const BDIType type = node->payload.type;
+        const size_t size = getBdiTypeSize(type);
+        if (size == 0 || size > sizeof(uint64_t) || type == BDIType::POINTER) continue;
+        Binding binding{id, type, {}, {}};
+        for (size_t lane = 0; lane < batch_size; ++lane) {
+            const RuntimeValue value = randomValue(type, rng);
+            binding.lanes.push_back(value);
+            const auto* bytes = reinterpret_cast<const std::byte*>(&value.bits);
+            binding.packed.insert(binding.packed.end(), bytes, bytes + size);
+        }
+        bindings.push_back(std::move(binding));
+    }
+    return bindings;
+ }
+ // Runs the batch once and every lane on its own VM; same success, step count, return value and value
+ // on every output port
+ void checkLanes(BDIGraph& graph, NodeID entry, uint64_t max_steps, size_t batch_size, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    const std::vector<Binding> bindings = bindConstants(graph, batch_size, rng);
+    std::vector<BatchInput> inputs;
+    for (const Binding& binding : bindings) inputs.push_back({binding.node, binding.type, binding.packed});
+    auto compiled = graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BatchExecutor batch;
+    batch.setMaxSteps(max_steps);
+    batch.execute(*compiled, entry, batch_size, inputs);
+    for (size_t lane = 0; lane < batch_size; ++lane) {
+        for (const Binding& binding : bindings) graph.getNode(binding.node)->get().payload = binding.lanes[lane].toPayload();
+        auto single = graph.freeze();
+        BDI_CHECK(single != nullptr);
+        if (!single) return;
+        BDIVirtualMachine vm;
+        vm.setJitThreshold(0);
+        vm.setMaxSteps(max_steps);
+        const bool ok = vm.execute(*single, entry);
+        bool same = batch.laneSucceeded(lane) == ok && batch.getStepCount(lane) == vm.getStepCount() &&
+                    sameValue(batch.getReturnValue(lane), vm.getReturnValue());
+        for (NodeIndex i = 0; same && i < single->getNodeCount(); ++i) {
+            const NodeID id = single->nodeIdAt(i);
+            for (PortIndex port = 0; same && port < single->outputCount(i); ++port) {
+                same = sameValue(batch.getOutputValue(lane, id, port), vm.getOutputValue(id, port));
+            }
+        }
+        if (!BDI_CHECK(same)) {
+            std::fprintf(stderr, "  seed %llu lane %zu max_steps %llu\n", static_cast<unsigned long long>(seed), lane,
+                         static_cast<unsigned long long>(max_steps));
+            return;
+        }
+    }
+ }
+ void testRandomDags() {
+    for (uint64_t seed = 1; seed <= 12; ++seed) {
+        bdi::meta::MetadataStore store;
+        bdi::benchmarks::RandomDagOptions options;
+        options.nodes = 400;
+        options.seed = seed;
+        options.window = 8 + seed * 4;
+        options.floating_fraction = static_cast<double>(seed % 4) * 0.25;
+        const BDIType types[] = {BDIType::FLOAT64, BDIType::INT64, BDIType::INT16, BDIType::FLOAT32};
+        options.type = types[seed % 4];
+        auto generated = bdi::benchmarks::generateRandomDag(store, options);
+        checkLanes(*generated.graph, generated.entry, 0, 16, seed);
+        // Stopped part way through
+        checkLanes(*generated.graph, generated.entry, 50 + seed * 20, 16, seed + 100);
+    }
+ }
+ // Bound loop bounds and operands make lanes leave each block by different edges, and run into the
+ // step limit after different paths
+ void testLoopCfgs() {
+    for (uint64_t seed = 1; seed <= 8; ++seed) {
+        bdi::meta::MetadataStore store;
+        bdi::benchmarks::LoopCfgOptions options;
+        options.seed = seed;
+        options.blocks = 12;
+        options.block_size = 4;
+        options.type = seed % 2 ? BDIType::INT32 : BDIType::INT64;
+        auto generated = bdi::benchmarks::generateLoopCfg(store, options);
+        for (uint64_t max_steps : {uint64_t{1}, uint64_t{37}, 400 + seed * 13, uint64_t{3000}}) {
+            checkLanes(*generated.graph, generated.entry, max_steps, 24, seed * 1000 + max_steps);
+        }
+    }
+ }
+ } // namespace
+ int main() {
+    testRandomDags();
+    testLoopCfgs();
+    return bdi::tests::finish("BatchTests");
+ }
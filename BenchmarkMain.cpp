@@ -0,0 +1,326 @@
+// File: bdi/benchmarks/BenchmarkMain.cpp
+ // Benchmark driver: builds each synthetic workload (GraphGenerators.hpp) and times graph construction,
+ // validation, consumer queries, serialization, freezing and execution. Results are printed as JSON
+ // so that runs can be diffed for regressions. Graphs ThreadedInterpreter lowers completely are also
+ // run on it (compare execute_threaded with execute_interpreter), and graphs ParallelExecutor supports on
+ // 1, 2, 4, ... up to --threads workers (default: the hardware threads).
+ //
+ //   bdi_benchmarks [--nodes N] [--repeat R] [--filter SUBSTRING] [--seed S] [--threads T] [--output FILE]
+ #include "GraphGenerators.hpp"
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/ParallelExecutor.hpp"
+ #include "../runtime/ThreadedInterpreter.hpp"
+ #include "../runtime/trace/ExecutionTracer.hpp"
+ #include <algorithm>
+ #include <atomic>
+ #include <chrono>
+ #include <cstdlib>
+ #include <fstream>
+ #include <functional>
+ #include <iostream>
+ #include <memory>
+ #include <new>
+ #include <sstream>
+ #include <string>
+ #include <thread>
+ #include <vector>
+ #if defined(__unix__) || defined(__APPLE__)
+ #include <sys/resource.h>
+ #endif
+ // --- Allocation Counting --
+ // Every global operator new in the process goes through these, including the arena's upstream resource.
+ namespace {
+ std::atomic<uint64_t> g_allocations{0};
+ std::atomic<uint64_t> g_allocated_bytes{0};
+ void* countedAllocate(size_t size, size_t alignment) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    void* p = alignment <= alignof(std::max_align_t) ? std::malloc(size)
+                                                     : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+ }
+ } // namespace
+ void* operator new(size_t size) { return countedAllocate(size, 0); }
+ void* operator new[](size_t size) { return countedAllocate(size, 0); }
+ void* operator new(size_t size, std::align_val_t alignment) { return countedAllocate(size, static_cast<size_t>(alignment)); }
+ void* operator new[](size_t size, std::align_val_t alignment) { return countedAllocate(size, static_cast<size_t>(alignment)); }
+ void operator delete(void* p) noexcept { std::free(p); }
+ void operator delete[](void* p) noexcept { std::free(p); }
+ void operator delete(void* p, size_t) noexcept { std::free(p); }
+ void operator delete[](void* p, size_t) noexcept { std::free(p); }
+ void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+ void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+ void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+ void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+ namespace bdi::benchmarks {
+ namespace {
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::PortIndex;
+ using bdi::runtime::BDIVirtualMachine;
+ // High-water mark of the resident set in KiB (0 where unknown)
+ uint64_t peakRssKb() {
+ #if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+ #if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024; // Bytes on macOS
+ #else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+ #endif
+ #else
+    return 0;
+ #endif
+ }
+ struct Options {
+    size_t nodes = 100000;
+    size_t repeat = 5;
+    uint64_t seed = 1;
+    size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::string filter;
+    std::string output;
+ };
+ // One measured phase of one workload
+ struct Result {
+    std::string workload;
+    std::string phase;
+    size_t nodes = 0;       // Nodes in the graph
+    size_t items = 0;       // Units of work per repetition (nodes, queries or steps)
+    const char* item = "node";
+    uint64_t ns_median = 0; // Per repetition
+    uint64_t ns_min = 0;
+    uint64_t allocations = 0; // Per repetition (the last one)
+    uint64_t allocated_bytes = 0;
+    uint64_t peak_rss_kb = 0;
+    uint64_t output_bytes = 0; // Serialized size, where it applies
+ };
+ struct Workload {
+    std::string name;
+    std::function<GeneratedGraph(bdi::meta::MetadataStore&)> generate;
+ };
+ class Runner {
+ public:
+    explicit Runner(const Options& options) : options_(options) {}
+    // Time 'body' options_.repeat times; 'setup' runs before each repetition, untimed
+    Result measure(const std::string& workload, const std::string& phase, size_t nodes, size_t items,
+                   const std::function<void()>& body, const std::function<void()>& setup = {}) {
+        Result result;
+        result.workload = workload;
+        result.phase = phase;
+        result.nodes = nodes;
+        result.items = items;
+        std::vector<uint64_t> samples;
+        for (size_t r = 0; r < std::max<size_t>(options_.repeat, 1); ++r) {
+            if (setup) setup();
+            const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+            const uint64_t bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            result.allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+            result.allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed) - bytes;
+        }
+        std::sort(samples.begin(), samples.end());
+        result.ns_median = samples[samples.size() / 2];
+        result.ns_min = samples.front();
+        result.peak_rss_kb = peakRssKb();
+        return result;
+    }
+    void run(const Workload& workload) {
+        bdi::meta::MetadataStore store;
+        GeneratedGraph generated;
+        Result build = measure(workload.name, "build", 0, 0, [&] { generated = workload.generate(store); },
+                               [&] { generated = GeneratedGraph{}; });
+        BDIGraph& graph = *generated.graph;
+        const size_t nodes = graph.getNodeCount();
+        build.nodes = build.items = nodes;
+        results_.push_back(build);
+        bool valid = false;
+        results_.push_back(measure(workload.name, "validate", nodes, nodes, [&] { valid = graph.validateGraph(); }));
+        if (!valid) std::cerr << workload.name << ": validateGraph() failed\n";
+        // Consumers of every output port of every node
+        std::vector<std::pair<NodeID, PortIndex>> ports;
+        for (const auto& [id, node] : graph) {
+            for (PortIndex port = 0; port < node->data_outputs.size(); ++port) ports.emplace_back(id, port);
+        }
+        size_t consumers = 0;
+        Result query = measure(workload.name, "consumers", nodes, ports.size(), [&] {
+            consumers = 0;
+            for (const auto& [id, port] : ports) consumers += graph.getDataConsumersFor(id, port).size();
+        });
+        query.item = "query";
+        results_.push_back(query);
+        std::string bytes;
+        Result save = measure(workload.name, "serialize", nodes, nodes, [&] {
+            std::ostringstream os(std::ios::binary);
+            graph.serialize(os);
+            bytes = std::move(os).str();
+        });
+        save.output_bytes = bytes.size();
+        results_.push_back(save);
+        results_.push_back(measure(workload.name, "deserialize", nodes, nodes, [&] {
+            std::istringstream is(bytes, std::ios::binary);
+            if (!BDIGraph::deserialize(is)) std::cerr << workload.name << ": deserialize() failed\n";
+        }));
+        std::shared_ptr<const CompiledGraph> compiled;
+        results_.push_back(measure(workload.name, "freeze", nodes, nodes, [&] { compiled = graph.freeze(); }));
+        // Threshold 1: hot regions are compiled during the warm-up run rather than after 100 runs
+        runExecution(workload.name, "execute_jit", generated, *compiled, 1);
+        runExecution(workload.name, "execute_interpreter", generated, *compiled, 0);
+        // Same runs with the default tracer attached: compare with execute_interpreter for the overhead
+        bdi::runtime::trace::ExecutionTracer tracer;
+        runExecution(workload.name, "execute_traced", generated, *compiled, 0, &tracer);
+        runThreaded(workload.name, generated, *compiled);
+        runParallelSweep(workload.name, generated, *compiled);
+    }
+    void writeJson(std::ostream& os) const {
+        os << "{\n  \"nodes\": " << options_.nodes << ",\n  \"repeat\": " << options_.repeat
+           << ",\n  \"seed\": " << options_.seed << ",\n  \"peak_rss_kb\": " << peakRssKb() << ",\n  \"results\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            const double per_item = r.items ? static_cast<double>(r.ns_median) / static_cast<double>(r.items) : 0.0;
+            const double per_node = r.nodes ? static_cast<double>(r.ns_median) / static_cast<double>(r.nodes) : 0.0;
+            os << (i ? ",\n" : "\n") << "    {\"workload\": \"" << r.workload << "\", \"phase\": \"" << r.phase
+               << "\", \"nodes\": " << r.nodes << ", \"items\": " << r.items << ", \"item\": \"" << r.item
+               << "\", \"ns_median\": " << r.ns_median << ", \"ns_min\": " << r.ns_min
+               << ", \"ns_per_node\": " << per_node << ", \"ns_per_item\": " << per_item
+               << ", \"allocations\": " << r.allocations << ", \"allocated_bytes\": " << r.allocated_bytes
+               << ", \"allocations_per_node\": " << (r.nodes ? static_cast<double>(r.allocations) / static_cast<double>(r.nodes) : 0.0);
+            if (r.output_bytes) os << ", \"output_bytes\": " << r.output_bytes;
+            os << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+ private:
+    const Options& options_;
+    std::vector<Result> results_;
+    void runExecution(const std::string& workload, const char* phase, const GeneratedGraph& generated,
+                      const CompiledGraph& compiled, uint32_t jit_threshold,
+                      bdi::runtime::trace::ExecutionTracer* tracer = nullptr) {
+        BDIVirtualMachine vm;
+        vm.setJitThreshold(jit_threshold);
+        vm.setTracer(tracer);
+        vm.setMaxSteps(generated.max_steps);
+        vm.setMemoryManager(generated.memory.get());
+        bool ok = false;
+        // Warm-up run outside the measurement (slot allocation, JIT compilation of hot regions)
+        ok = vm.execute(compiled, generated.entry);
+        Result result = measure(workload, phase, compiled.getNodeCount(), 0, [&] {
+            ok = vm.execute(compiled, generated.entry);
+            if (tracer) tracer->drainEvents();
+        });
+        // Loop CFGs stop at the step limit, which execute() reports as a failure
+        if (!ok && vm.getStepCount() != generated.max_steps) std::cerr << workload << ": execute() failed\n";
+        result.items = vm.getStepCount();
+        result.item = "step";
+        results_.push_back(result);
+    }
+    // "lower_threaded" and "execute_threaded"; nothing for graphs that would run on the fallback VM
+    void runThreaded(const std::string& workload, const GeneratedGraph& generated, const CompiledGraph& compiled) {
+        std::unique_ptr<bdi::runtime::ThreadedProgram> program;
+        Result lower = measure(workload, "lower_threaded", compiled.getNodeCount(), compiled.getNodeCount(),
+                               [&] { program = bdi::runtime::ThreadedInterpreter::lower(compiled); });
+        if (program->requires_vm) return;
+        lower.items = program->code.size();
+        lower.item = "instruction";
+        results_.push_back(lower);
+        bdi::runtime::ThreadedInterpreter interpreter;
+        interpreter.setMaxSteps(generated.max_steps);
+        bool ok = interpreter.execute(*program, generated.entry);
+        Result result = measure(workload, "execute_threaded", compiled.getNodeCount(), 0,
+                                [&] { ok = interpreter.execute(*program, generated.entry); });
+        if (!ok && interpreter.getStepCount() != generated.max_steps) std::cerr << workload << ": threaded execute() failed\n";
+        result.items = interpreter.getStepCount();
+        result.item = "step";
+        results_.push_back(result);
+    }
+    // "execute_parallel_<T>" for T = 1, 2, 4, ... options_.threads; nothing for graphs that would run serially
+    void runParallelSweep(const std::string& workload, const GeneratedGraph& generated, const CompiledGraph& compiled) {
+        for (size_t threads = 1;; threads = std::min(threads * 2, options_.threads)) {
+            bdi::runtime::WorkStealingPool pool(threads);
+            bdi::runtime::ParallelExecutor executor(pool);
+            executor.getSerialMachine().setMaxSteps(generated.max_steps);
+            executor.getSerialMachine().setMemoryManager(generated.memory.get());
+            bool ok = executor.execute(compiled, generated.entry);
+            if (executor.ranSerially()) return;
+            const std::string phase = "execute_parallel_" + std::to_string(threads);
+            Result result = measure(workload, phase, compiled.getNodeCount(), executor.getLastTaskCount(),
+                                    [&] { ok = executor.execute(compiled, generated.entry); });
+            if (!ok) std::cerr << workload << ": parallel execute() failed\n";
+            result.item = "task";
+            results_.push_back(result);
+            if (threads >= options_.threads) return;
+        }
+    }
+ };
+ bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--nodes" && has_value) options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--repeat" && has_value) options.repeat = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && has_value) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && has_value) options.threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--filter" && has_value) options.filter = argv[++i];
+        else if (arg == "--output" && has_value) options.output = argv[++i];
+        else return false;
+    }
+    return options.nodes > 0 && options.threads > 0;
+ }
+ // Every workload sized to roughly options.nodes nodes
+ std::vector<Workload> makeWorkloads(const Options& options) {
+    const size_t n = options.nodes;
+    const uint64_t seed = options.seed;
+    std::vector<Workload> workloads;
+    workloads.push_back({"chain", [=](bdi::meta::MetadataStore& store) {
+        return generateChain(store, ChainOptions{n, BDIType::INT64});
+    }});
+    workloads.push_back({"wide_dag", [=](bdi::meta::MetadataStore& store) {
+        const size_t depth = 16;
+        return generateWideDag(store, WideDagOptions{std::max<size_t>(n / depth, 1), depth, BDIType::INT64, seed});
+    }});
+    workloads.push_back({"random_dag", [=](bdi::meta::MetadataStore& store) {
+        return generateRandomDag(store, RandomDagOptions{n, 3, 64, 0.25, BDIType::INT64, seed});
+    }});
+    workloads.push_back({"random_dag_f64", [=](bdi::meta::MetadataStore& store) {
+        return generateRandomDag(store, RandomDagOptions{n, 3, 64, 0.25, BDIType::FLOAT64, seed});
+    }});
+    workloads.push_back({"loop_cfg", [=](bdi::meta::MetadataStore& store) {
+        const size_t block_size = 8;
+        return generateLoopCfg(store, LoopCfgOptions{std::max<size_t>(n / (block_size + 4), 1), block_size, 10 * n, BDIType::INT32, seed});
+    }});
+    workloads.push_back({"vector_graph", [=](bdi::meta::MetadataStore& store) {
+        return generateVectorGraph(store, VectorGraphOptions{std::max<size_t>(n / 100, 1), 4096, 8, BDIType::FLOAT32, seed});
+    }});
+    return workloads;
+ }
+ } // namespace
+ } // namespace bdi::benchmarks
+ int main(int argc, char** argv) {
+    using namespace bdi::benchmarks;
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--nodes N] [--repeat R] [--filter SUBSTRING] [--seed S] [--threads T] [--output FILE]\n";
+        return 2;
+    }
+    Runner runner(options);
+    for (const Workload& workload : makeWorkloads(options)) {
+        if (!options.filter.empty() && workload.name.find(options.filter) == std::string::npos) continue;
+        std::cerr << "running " << workload.name << "...\n";
+        runner.run(workload);
+    }
+    if (options.output.empty()) {
+        runner.writeJson(std::cout);
+    } else {
+        std::ofstream file(options.output);
+        runner.writeJson(file);
+        if (!file) {
+            std::cerr << "cannot write " << options.output << "\n";
+            return 1;
+        }
+    }
+    return 0;
+ }
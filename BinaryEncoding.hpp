@@ -0,0 +1,31 @@
+// File: bdi/core/types/BinaryEncoding.hpp
+ #ifndef BDI_CORE_TYPES_BINARYENCODING_HPP
+ #define BDI_CORE_TYPES_BINARYENCODING_HPP
+ #include "BDITypes.hpp"
+ #include <bit>
+ #include <cstring>
+ #include <optional>
+ #include <span>
+ #include <type_traits>
+ namespace bdi::core::types {
+ // Little-endian encoding of trivially copyable scalars, the byte order of payloads and graph images
+ static_assert(std::endian::native == std::endian::little, "BDI payloads are stored in host order");
+ template <typename T>
+ void appendValue(BinaryData& out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+ }
+ // Value at 'offset', advancing it; nullopt if fewer than sizeof(T) bytes remain
+ template <typename T>
+ std::optional<T> readValue(std::span<const std::byte> bytes, size_t& offset) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (offset > bytes.size() || bytes.size() - offset < sizeof(T)) return std::nullopt;
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+ }
+ } // namespace bdi::core::types
+ #endif // BDI_CORE_TYPES_BINARYENCODING_HPP
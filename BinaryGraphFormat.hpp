@@ -0,0 +1,89 @@
+// File: bdi/core/serialization/BinaryGraphFormat.hpp
+ #ifndef BDI_CORE_SERIALIZATION_BINARYGRAPHFORMAT_HPP
+ #define BDI_CORE_SERIALIZATION_BINARYGRAPHFORMAT_HPP
+ #include "../types/BDITypes.hpp"
+ #include "../graph/OperationTypes.hpp"
+ #include <bit>
+ #include <cstddef>
+ #include <cstdint>
+ #include <cstring>
+ namespace bdi::core::serialization {
+ // On-disk layouts are little-endian. Images are used in place, so they are only loadable on
+ // little-endian hosts; the record stream is encoded byte by byte and is portable.
+ static_assert(std::endian::native == std::endian::little, "BDI graph images assume a little-endian host");
+ inline constexpr uint32_t GRAPH_FORMAT_VERSION = 1;
+ inline constexpr char GRAPH_IMAGE_MAGIC[8] = {'B', 'D', 'I', 'G', 'R', 'A', 'P', 'H'};
+ inline constexpr char GRAPH_STREAM_MAGIC[8] = {'B', 'D', 'I', 'S', 'T', 'R', 'M', '1'};
+ inline constexpr size_t GRAPH_SECTION_ALIGNMENT = 8;
+ // Sections of a CompiledGraph image, one per flat array (see CompiledGraph for their meaning)
+ enum class GraphSection : uint32_t {
+    NODE_IDS,
+    OPERATIONS,
+    FLAGS,
+    METADATA_HANDLES,
+    REGION_IDS,
+    PAYLOAD_TYPES,
+    PAYLOAD_OFFSETS,
+    PAYLOAD_BYTES,
+    INPUT_OFFSETS,
+    INPUT_SLOTS,
+    INPUT_NODES,
+    INPUT_PORTS,
+    OUTPUT_OFFSETS,
+    OUTPUT_TYPES,
+    SLOT_OWNERS,
+    OUTPUT_NAME_OFFSETS, // Per slot + 1, into STRINGS (after the graph name)
+    CONSUMER_OFFSETS,
+    CONSUMERS,
+    CTRL_SUCC_OFFSETS,
+    CTRL_SUCCS,
+    CTRL_PRED_OFFSETS,
+    CTRL_PREDS,
+    STRINGS,             // Graph name followed by all output port names, not NUL terminated
+    SECTION_COUNT // Sentinel value
+ };
+ struct GraphSectionEntry {
+    uint64_t offset = 0; // From the start of the image, GRAPH_SECTION_ALIGNMENT aligned
+    uint64_t size = 0;   // In bytes
+ };
+ // Fixed header at offset 0 of an image file. Followed by the sections.
+ struct GraphImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;        // sizeof(GraphImageHeader), guards against layout drift
+    uint64_t file_size;
+    uint64_t checksum;           // checksum64 over [header_size, file_size)
+    uint64_t node_count;
+    uint64_t slot_count;
+    uint64_t dangling_edges;
+    uint64_t first_id;
+    uint32_t ids_dense;
+    uint32_t name_length;        // Graph name occupies STRINGS[0, name_length)
+    uint16_t bdi_type_size;      // sizeof(BDIType) of the writer
+    uint16_t operation_type_size;
+    uint32_t reserved;
+    GraphSectionEntry sections[static_cast<size_t>(GraphSection::SECTION_COUNT)];
+ };
+ static_assert(sizeof(GraphImageHeader) % GRAPH_SECTION_ALIGNMENT == 0);
+ inline constexpr size_t alignSection(size_t offset) {
+    return (offset + GRAPH_SECTION_ALIGNMENT - 1) & ~(GRAPH_SECTION_ALIGNMENT - 1);
+ }
+ // Word-at-a-time 64-bit checksum (multiply-rotate mix). Detects corruption and truncation;
+ // not a cryptographic hash.
+ inline uint64_t checksum64(const std::byte* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull) {
+    constexpr uint64_t kMul = 0xFF51AFD7ED558CCDull;
+    uint64_t h = seed ^ (size * kMul);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h = std::rotl(h ^ (w * kMul), 29) * 0xC4CEB9FE1A85EC53ull;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = std::rotl(h ^ (tail * kMul), 29) * 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+ }
+ } // namespace bdi::core::serialization
+ #endif // BDI_CORE_SERIALIZATION_BINARYGRAPHFORMAT_HPP
@@ -0,0 +1,202 @@
+// File: bdi/runtime/concurrency/Channel.hpp
+ #ifndef BDI_RUNTIME_CONCURRENCY_CHANNEL_HPP
+ #define BDI_RUNTIME_CONCURRENCY_CHANNEL_HPP
+ #include "../../core/payload/TypedPayload.hpp"
+ #include <atomic>
+ #include <bit>
+ #include <coroutine>
+ #include <cstddef>
+ #include <cstdint>
+ #include <deque>
+ #include <memory>
+ #include <mutex>
+ #include <variant>
+ namespace bdi::runtime::concurrency {
+ using bdi::core::payload::TypedPayload;
+ // Channel identifier as carried by COMM_CHANNEL_SEND / COMM_CHANNEL_RECV operand 0 (0 = none)
+ using ChannelID = uint64_t;
+ // Bounded single-producer / single-consumer ring. Each side caches the other side's index, so a send or
+ // receive touches the shared line only when the ring looks full or empty.
+ template <typename T>
+ class SpscRing {
+ public:
+    explicit SpscRing(size_t capacity)
+        : mask_(std::bit_ceil(capacity ? capacity : 1) - 1), cells_(std::make_unique<T[]>(mask_ + 1)) {}
+    size_t capacity() const { return mask_ + 1; }
+    // 'value' is moved from on success; false if the ring is full
+    bool trySend(T& value) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        cells_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    // False if the ring is empty
+    bool tryRecv(T& out) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = std::move(cells_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // Snapshots for either side (may be stale by the time they return)
+    bool canSend() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) <= mask_; }
+    bool canRecv() const { return tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_acquire); }
+ private:
+    const uint64_t mask_;
+    const std::unique_ptr<T[]> cells_;
+    alignas(64) std::atomic<uint64_t> tail_{0}; // Producer
+    uint64_t head_cache_ = 0;
+    alignas(64) std::atomic<uint64_t> head_{0}; // Consumer
+    uint64_t tail_cache_ = 0;
+ };
+ // Bounded multi-producer / multi-consumer ring (Vyukov). Each cell carries a sequence number telling
+ // which lap of the ring it is ready for, so producers and consumers only contend on their own index.
+ template <typename T>
+ class MpmcRing {
+ public:
+    // At least two cells: with one, "written in this lap" and "free in the next" would be the same sequence
+    explicit MpmcRing(size_t capacity)
+        : mask_(std::bit_ceil(capacity > 2 ? capacity : 2) - 1), cells_(std::make_unique<Cell[]>(mask_ + 1)) {
+        for (uint64_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    size_t capacity() const { return mask_ + 1; }
+    bool trySend(T& value) {
+        uint64_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const int64_t lag = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire) - pos);
+            if (lag == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false; // The cell still holds the value from the previous lap
+            } else {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    bool tryRecv(T& out) {
+        uint64_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const int64_t lag = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (lag == 0) {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false; // Not written yet in this lap
+            } else {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    // True unless the next cell is certainly not ready (a stale index counts as ready: retrying resolves it)
+    bool canSend() const { return ready(enqueue_, 0); }
+    bool canRecv() const { return ready(dequeue_, 1); }
+ private:
+    struct Cell {
+        std::atomic<uint64_t> sequence{0};
+        T value{};
+    };
+    bool ready(const std::atomic<uint64_t>& index, uint64_t offset) const {
+        const uint64_t pos = index.load(std::memory_order_acquire);
+        return static_cast<int64_t>(cells_[pos & mask_].sequence.load(std::memory_order_acquire) - (pos + offset)) >= 0;
+    }
+    const uint64_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<uint64_t> enqueue_{0};
+    alignas(64) std::atomic<uint64_t> dequeue_{0};
+ };
+ enum class ChannelKind : uint8_t {
+    SPSC, // At most one task sends and one receives at a time
+    MPMC
+ };
+ // Bounded channel of TypedPayload values used by COMM_CHANNEL_SEND / COMM_CHANNEL_RECV.
+ // Sends and receives are lock-free. Tasks that find the channel full or empty park here (see
+ // TaskScheduler); only parking and waking a parked task take the channel's waiter lock.
+ // Capacity is rounded up to a power of two (at least 2 for MPMC).
+ class Channel {
+ public:
+    Channel(ChannelKind kind, size_t capacity) : kind_(kind), rings_(makeRings(kind, capacity)) {}
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+    ChannelKind getKind() const { return kind_; }
+    size_t getCapacity() const {
+        return kind_ == ChannelKind::SPSC ? std::get<0>(rings_).capacity() : std::get<1>(rings_).capacity();
+    }
+    // 'value' is moved from on success
+    bool trySend(TypedPayload& value) {
+        return kind_ == ChannelKind::SPSC ? std::get<0>(rings_).trySend(value) : std::get<1>(rings_).trySend(value);
+    }
+    bool tryRecv(TypedPayload& out) {
+        return kind_ == ChannelKind::SPSC ? std::get<0>(rings_).tryRecv(out) : std::get<1>(rings_).tryRecv(out);
+    }
+    bool canSend() const {
+        return kind_ == ChannelKind::SPSC ? std::get<0>(rings_).canSend() : std::get<1>(rings_).canSend();
+    }
+    bool canRecv() const {
+        return kind_ == ChannelKind::SPSC ? std::get<0>(rings_).canRecv() : std::get<1>(rings_).canRecv();
+    }
+    // --- Parked Tasks --
+    // Queue 'task' until a value arrives (receiver) or room frees up (sender). False, without queuing,
+    // if that has already happened: the caller retries instead of suspending.
+    bool parkReceiver(std::coroutine_handle<> task) { return park(receivers_, task, true); }
+    bool parkSender(std::coroutine_handle<> task) { return park(senders_, task, false); }
+    // After a successful send / receive: the longest parked receiver / sender to resume, or null.
+    // A resumed task retries its operation and may park again if another task got there first.
+    std::coroutine_handle<> takeReceiver() { return take(receivers_); }
+    std::coroutine_handle<> takeSender() { return take(senders_); }
+ private:
+    using Rings = std::variant<SpscRing<TypedPayload>, MpmcRing<TypedPayload>>;
+    struct Waiters {
+        std::atomic<uint32_t> count{0}; // Lets take() skip the lock while nobody is parked
+        std::mutex mutex;
+        std::deque<std::coroutine_handle<>> tasks;
+    };
+    static Rings makeRings(ChannelKind kind, size_t capacity) {
+        if (kind == ChannelKind::SPSC) return Rings(std::in_place_index<0>, capacity);
+        return Rings(std::in_place_index<1>, capacity);
+    }
+    // The parker announces itself before re-checking the ring, and take() checks for parkers after the ring
+    // changed; with a full fence on both sides at least one of them sees the other, so no wakeup is lost.
+    bool park(Waiters& waiters, std::coroutine_handle<> task, bool receiver) {
+        std::lock_guard lock(waiters.mutex);
+        waiters.count.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (receiver ? canRecv() : canSend()) {
+            waiters.count.fetch_sub(1);
+            return false;
+        }
+        waiters.tasks.push_back(task);
+        return true;
+    }
+    std::coroutine_handle<> take(Waiters& waiters) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.count.load(std::memory_order_relaxed) == 0) return {};
+        std::lock_guard lock(waiters.mutex);
+        if (waiters.tasks.empty()) return {};
+        const std::coroutine_handle<> task = waiters.tasks.front();
+        waiters.tasks.pop_front();
+        waiters.count.fetch_sub(1);
+        return task;
+    }
+    const ChannelKind kind_;
+    Rings rings_;
+    Waiters receivers_;
+    Waiters senders_;
+ };
+ } // namespace bdi::runtime::concurrency
+ #endif // BDI_RUNTIME_CONCURRENCY_CHANNEL_HPP
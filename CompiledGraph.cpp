@@ -0,0 +1,425 @@
+// File: bdi/core/graph/CompiledGraph.cpp
+ #include "CompiledGraph.hpp"
+ #include <algorithm>
+ #include <cstring>
+ #include <iterator>
+ #include <limits>
+ #include <optional>
+ #include <ostream>
+ #include <thread>
+ namespace bdi::core::graph {
+ using namespace bdi::core::serialization;
+ struct CompiledGraph::Columns {
+    std::string name;
+    std::vector<NodeID> node_ids;
+    std::vector<BDIOperationType> operations;
+    std::vector<uint8_t> flags;
+    std::vector<MetadataHandle> metadata_handles;
+    std::vector<RegionID> region_ids;
+    NodeID first_id = 0;
+    bool ids_dense = false;
+    std::vector<BDIType> payload_types;
+    std::vector<uint32_t> payload_offsets;
+    std::vector<std::byte> payload_bytes;
+    std::vector<uint32_t> input_offsets;
+    std::vector<SlotIndex> input_slots;
+    std::vector<NodeIndex> input_nodes;
+    std::vector<PortIndex> input_ports;
+    std::vector<uint32_t> output_offsets;
+    std::vector<BDIType> output_types;
+    std::vector<NodeIndex> slot_owners;
+    std::vector<uint32_t> output_name_offsets; // Relative to the end of the graph name
+    std::string output_names;
+    std::vector<uint32_t> consumer_offsets;
+    std::vector<NodeIndex> consumers;
+    std::vector<uint32_t> ctrl_succ_offsets;
+    std::vector<NodeIndex> ctrl_succs;
+    std::vector<uint32_t> ctrl_pred_offsets;
+    std::vector<NodeIndex> ctrl_preds;
+    size_t dangling_edges = 0;
+ };
+ std::unique_ptr<CompiledGraph> CompiledGraph::compile(const BDIGraph& graph) {
+    Columns c;
+    c.name = graph.getName();
+    // Dense numbering, sorted by NodeID so the layout is deterministic regardless of hash order
+    std::vector<const BDINode*> nodes;
+    nodes.reserve(graph.getNodeCount());
+    for (const auto& [id, node_ptr] : graph) {
+        if (node_ptr) nodes.push_back(node_ptr.get());
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const BDINode* a, const BDINode* b) { return a->id < b->id; });
+    const size_t n = nodes.size();
+    c.node_ids.resize(n);
+    c.operations.resize(n);
+    c.flags.resize(n, FLAG_NONE);
+    c.metadata_handles.resize(n);
+    c.region_ids.resize(n);
+    c.payload_types.resize(n);
+    c.payload_offsets.assign(n + 1, 0);
+    c.input_offsets.assign(n + 1, 0);
+    c.output_offsets.assign(n + 1, 0);
+    c.ctrl_succ_offsets.assign(n + 1, 0);
+    c.ctrl_pred_offsets.assign(n + 1, 0);
+    // Pass 1: fixed-size columns and CSR offsets
+    for (size_t i = 0; i < n; ++i) {
+        const BDINode& node = *nodes[i];
+        c.node_ids[i] = node.id;
+        c.operations[i] = node.operation;
+        c.metadata_handles[i] = node.metadata_handle;
+        c.region_ids[i] = node.region_id;
+        c.payload_types[i] = node.payload.type;
+        if (node.control_inputs.empty() && node.control_outputs.empty()) c.flags[i] |= FLAG_FLOATING;
+        if (node.payload.type != BDIType::UNKNOWN) c.flags[i] |= FLAG_HAS_PAYLOAD;
+        c.payload_offsets[i + 1] = c.payload_offsets[i] + static_cast<uint32_t>(node.payload.data.size());
+        c.input_offsets[i + 1] = c.input_offsets[i] + static_cast<uint32_t>(node.data_inputs.size());
+        c.output_offsets[i + 1] = c.output_offsets[i] + static_cast<uint32_t>(node.data_outputs.size());
+        c.ctrl_succ_offsets[i + 1] = c.ctrl_succ_offsets[i] + static_cast<uint32_t>(node.control_outputs.size());
+        c.ctrl_pred_offsets[i + 1] = c.ctrl_pred_offsets[i] + static_cast<uint32_t>(node.control_inputs.size());
+    }
+    c.first_id = n ? c.node_ids.front() : 0;
+    c.ids_dense = n == 0 || c.node_ids.back() - c.first_id == n - 1;
+    c.payload_bytes.resize(c.payload_offsets[n]);
+    c.input_slots.resize(c.input_offsets[n]);
+    c.input_nodes.resize(c.input_offsets[n]);
+    c.input_ports.resize(c.input_offsets[n]);
+    c.output_types.resize(c.output_offsets[n]);
+    c.slot_owners.resize(c.output_offsets[n]);
+    c.output_name_offsets.assign(c.output_offsets[n] + 1, 0);
+    c.ctrl_succs.resize(c.ctrl_succ_offsets[n]);
+    c.ctrl_preds.resize(c.ctrl_pred_offsets[n]);
+    std::vector<uint32_t> consumer_counts(n + 1, 0);
+    // Pass 2: fill the shared arrays, resolving NodeIDs to dense indices
+    auto resolve = [&](NodeID id) -> NodeIndex {
+        if (c.ids_dense) return id >= c.first_id && id - c.first_id < n ? static_cast<NodeIndex>(id - c.first_id) : INVALID_NODE_INDEX;
+        auto it = std::lower_bound(c.node_ids.begin(), c.node_ids.end(), id);
+        return it != c.node_ids.end() && *it == id ? static_cast<NodeIndex>(it - c.node_ids.begin()) : INVALID_NODE_INDEX;
+    };
+    for (size_t i = 0; i < n; ++i) {
+        const BDINode& node = *nodes[i];
+        std::copy(node.payload.data.begin(), node.payload.data.end(), c.payload_bytes.begin() + c.payload_offsets[i]);
+        for (size_t p = 0; p < node.data_outputs.size(); ++p) {
+            const size_t slot = c.output_offsets[i] + p;
+            c.output_types[slot] = node.data_outputs[p].type;
+            c.slot_owners[slot] = static_cast<NodeIndex>(i);
+            c.output_names += node.data_outputs[p].name;
+            c.output_name_offsets[slot + 1] = static_cast<uint32_t>(c.output_names.size());
+        }
+        for (size_t k = 0; k < node.data_inputs.size(); ++k) {
+            const PortRef& ref = node.data_inputs[k];
+            const uint32_t at = c.input_offsets[i] + static_cast<uint32_t>(k);
+            c.input_ports[at] = ref.port_index;
+            c.input_nodes[at] = INVALID_NODE_INDEX;
+            c.input_slots[at] = INVALID_SLOT_INDEX;
+            if (ref.node_id == 0) continue; // Unconnected input (operand may come from the payload)
+            NodeIndex src = resolve(ref.node_id);
+            if (src == INVALID_NODE_INDEX) { ++c.dangling_edges; continue; }
+            c.input_nodes[at] = src;
+            ++consumer_counts[src + 1];
+            if (ref.port_index < c.output_offsets[src + 1] - c.output_offsets[src]) {
+                c.input_slots[at] = c.output_offsets[src] + ref.port_index;
+            }
+        }
+        for (size_t k = 0; k < node.control_outputs.size(); ++k) {
+            NodeIndex dst = resolve(node.control_outputs[k]);
+            if (dst == INVALID_NODE_INDEX) ++c.dangling_edges;
+            c.ctrl_succs[c.ctrl_succ_offsets[i] + k] = dst;
+        }
+        for (size_t k = 0; k < node.control_inputs.size(); ++k) {
+            NodeIndex src = resolve(node.control_inputs[k]);
+            if (src == INVALID_NODE_INDEX) ++c.dangling_edges;
+            c.ctrl_preds[c.ctrl_pred_offsets[i] + k] = src;
+        }
+    }
+    // Pass 3: reverse data edges
+    for (size_t i = 0; i < n; ++i) consumer_counts[i + 1] += consumer_counts[i];
+    c.consumer_offsets = consumer_counts;
+    c.consumers.resize(consumer_counts[n]);
+    for (size_t i = 0; i < n; ++i) {
+        for (uint32_t k = c.input_offsets[i]; k < c.input_offsets[i + 1]; ++k) {
+            if (c.input_nodes[k] != INVALID_NODE_INDEX) c.consumers[consumer_counts[c.input_nodes[k]]++] = static_cast<NodeIndex>(i);
+        }
+    }
+    return pack(c);
+ }
+ std::unique_ptr<CompiledGraph> CompiledGraph::pack(const Columns& c) {
+    // Lay out header + sections, then copy every column into one buffer
+    GraphImageHeader header{};
+    std::memcpy(header.magic, GRAPH_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FORMAT_VERSION;
+    header.header_size = sizeof(GraphImageHeader);
+    header.node_count = c.node_ids.size();
+    header.slot_count = c.output_types.size();
+    header.dangling_edges = c.dangling_edges;
+    header.first_id = c.first_id;
+    header.ids_dense = c.ids_dense ? 1 : 0;
+    header.name_length = static_cast<uint32_t>(c.name.size());
+    header.bdi_type_size = sizeof(BDIType);
+    header.operation_type_size = sizeof(BDIOperationType);
+    struct Source { const void* data; size_t size; };
+    auto bytes = [](const auto& v) { return Source{v.data(), v.size() * sizeof(v[0])}; };
+    std::string strings = c.name + c.output_names;
+    const Source sources[] = {
+        bytes(c.node_ids), bytes(c.operations), bytes(c.flags), bytes(c.metadata_handles), bytes(c.region_ids),
+        bytes(c.payload_types), bytes(c.payload_offsets), bytes(c.payload_bytes),
+        bytes(c.input_offsets), bytes(c.input_slots), bytes(c.input_nodes), bytes(c.input_ports),
+        bytes(c.output_offsets), bytes(c.output_types), bytes(c.slot_owners), bytes(c.output_name_offsets),
+        bytes(c.consumer_offsets), bytes(c.consumers),
+        bytes(c.ctrl_succ_offsets), bytes(c.ctrl_succs), bytes(c.ctrl_pred_offsets), bytes(c.ctrl_preds),
+        bytes(strings)};
+    static_assert(std::size(sources) == static_cast<size_t>(GraphSection::SECTION_COUNT));
+    size_t offset = sizeof(GraphImageHeader);
+    for (size_t s = 0; s < std::size(sources); ++s) {
+        offset = alignSection(offset);
+        header.sections[s] = {offset, sources[s].size};
+        offset += sources[s].size;
+    }
+    header.file_size = alignSection(offset);
+    // operator new[] alignment (>= 16) covers GRAPH_SECTION_ALIGNMENT; value-init zeroes the padding
+    std::shared_ptr<std::byte[]> buffer(new std::byte[header.file_size]());
+    for (size_t s = 0; s < std::size(sources); ++s) {
+        if (sources[s].size) std::memcpy(buffer.get() + header.sections[s].offset, sources[s].data, sources[s].size);
+    }
+    header.checksum = checksum64(buffer.get() + header.header_size, header.file_size - header.header_size);
+    std::memcpy(buffer.get(), &header, sizeof(header));
+    std::unique_ptr<CompiledGraph> cg(new CompiledGraph());
+    cg->image_ = std::shared_ptr<const std::byte>(buffer, buffer.get());
+    cg->image_size_ = header.file_size;
+    cg->bindSections();
+    return cg;
+ }
+ std::unique_ptr<CompiledGraph> CompiledGraph::fromImage(std::shared_ptr<const std::byte> image, size_t size, bool verify) {
+    if (!image || size < sizeof(GraphImageHeader)) return nullptr;
+    if (reinterpret_cast<uintptr_t>(image.get()) % GRAPH_SECTION_ALIGNMENT != 0) return nullptr;
+    const auto& header = *reinterpret_cast<const GraphImageHeader*>(image.get());
+    if (std::memcmp(header.magic, GRAPH_IMAGE_MAGIC, sizeof(header.magic)) != 0) return nullptr;
+    if (header.version != GRAPH_FORMAT_VERSION || header.header_size != sizeof(GraphImageHeader)) return nullptr;
+    if (header.bdi_type_size != sizeof(BDIType) || header.operation_type_size != sizeof(BDIOperationType)) return nullptr;
+    if (header.file_size > size) return nullptr; // Truncated
+    if (verify && checksum64(image.get() + header.header_size, header.file_size - header.header_size) != header.checksum) {
+        return nullptr;
+    }
+    std::unique_ptr<CompiledGraph> cg(new CompiledGraph());
+    cg->image_ = std::move(image);
+    cg->image_size_ = header.file_size;
+    if (!cg->bindSections()) return nullptr;
+    if (verify && !cg->verifyIndices()) return nullptr;
+    return cg;
+ }
+ bool CompiledGraph::bindSections() {
+    const auto& header = *reinterpret_cast<const GraphImageHeader*>(image_.get());
+    const std::byte* base = image_.get();
+    const size_t n = header.node_count;
+    const size_t slots = header.slot_count;
+    bool ok = n < INVALID_NODE_INDEX && slots < INVALID_SLOT_INDEX;
+    // Bind section s as an array of T; 'count' is checked when the length is implied by the header
+    auto bind = [&]<typename T>(std::span<const T>& out, GraphSection s, std::optional<size_t> count) {
+        const GraphSectionEntry& e = header.sections[static_cast<size_t>(s)];
+        if (e.offset % alignof(T) != 0 || e.offset < header.header_size || e.offset > header.file_size ||
+            e.size > header.file_size - e.offset || e.size % sizeof(T) != 0 || (count && e.size / sizeof(T) != *count)) {
+            ok = false;
+            return;
+        }
+        out = {reinterpret_cast<const T*>(base + e.offset), static_cast<size_t>(e.size / sizeof(T))};
+    };
+    // CSR offsets must have n + 1 entries, start at 0 and end at the length of their values section
+    auto bindCsr = [&]<typename T>(std::span<const uint32_t>& offsets, GraphSection os, size_t rows,
+                                   std::span<const T>& values, GraphSection vs) {
+        bind(offsets, os, rows + 1);
+        bind(values, vs, std::nullopt);
+        if (ok && (offsets.front() != 0 || offsets.back() != values.size())) ok = false;
+    };
+    bind(node_ids_, GraphSection::NODE_IDS, n);
+    bind(operations_, GraphSection::OPERATIONS, n);
+    bind(flags_, GraphSection::FLAGS, n);
+    bind(metadata_handles_, GraphSection::METADATA_HANDLES, n);
+    bind(region_ids_, GraphSection::REGION_IDS, n);
+    bind(payload_types_, GraphSection::PAYLOAD_TYPES, n);
+    bindCsr(payload_offsets_, GraphSection::PAYLOAD_OFFSETS, n, payload_bytes_, GraphSection::PAYLOAD_BYTES);
+    bindCsr(input_offsets_, GraphSection::INPUT_OFFSETS, n, input_slots_, GraphSection::INPUT_SLOTS);
+    bind(input_nodes_, GraphSection::INPUT_NODES, input_slots_.size());
+    bind(input_ports_, GraphSection::INPUT_PORTS, input_slots_.size());
+    bindCsr(output_offsets_, GraphSection::OUTPUT_OFFSETS, n, output_types_, GraphSection::OUTPUT_TYPES);
+    bind(slot_owners_, GraphSection::SLOT_OWNERS, slots);
+    bindCsr(consumer_offsets_, GraphSection::CONSUMER_OFFSETS, n, consumers_, GraphSection::CONSUMERS);
+    bindCsr(ctrl_succ_offsets_, GraphSection::CTRL_SUCC_OFFSETS, n, ctrl_succs_, GraphSection::CTRL_SUCCS);
+    bindCsr(ctrl_pred_offsets_, GraphSection::CTRL_PRED_OFFSETS, n, ctrl_preds_, GraphSection::CTRL_PREDS);
+    bind(strings_, GraphSection::STRINGS, std::nullopt);
+    if (!ok || output_types_.size() != slots || header.name_length > strings_.size()) return false;
+    // The engines index per-operation tables by opcode, so even an unverified image must not carry unknown ones
+    if (!std::all_of(operations_.begin(), operations_.end(), isKnownOperation)) return false;
+    name_.assign(reinterpret_cast<const char*>(strings_.data()), header.name_length);
+    strings_ = strings_.subspan(header.name_length);
+    bind(output_name_offsets_, GraphSection::OUTPUT_NAME_OFFSETS, slots + 1);
+    if (!ok || output_name_offsets_.front() != 0 || output_name_offsets_.back() != strings_.size()) return false;
+    first_id_ = header.first_id;
+    ids_dense_ = header.ids_dense != 0;
+    dangling_edges_ = header.dangling_edges;
+    return true;
+ }
+ bool CompiledGraph::verifyIndices() const {
+    // Full scan for untrusted images: monotonic CSR offsets and every stored index in range
+    const size_t n = node_ids_.size();
+    const size_t slots = output_types_.size();
+    auto monotonic = [](std::span<const uint32_t> offsets) {
+        return std::is_sorted(offsets.begin(), offsets.end());
+    };
+    auto nodesInRange = [n](std::span<const NodeIndex> indices) {
+        return std::all_of(indices.begin(), indices.end(), [n](NodeIndex i) { return i == INVALID_NODE_INDEX || i < n; });
+    };
+    if (!monotonic(payload_offsets_) || !monotonic(input_offsets_) || !monotonic(output_offsets_) ||
+        !monotonic(output_name_offsets_) || !monotonic(consumer_offsets_) || !monotonic(ctrl_succ_offsets_) ||
+        !monotonic(ctrl_pred_offsets_)) {
+        return false;
+    }
+    if (!std::is_sorted(node_ids_.begin(), node_ids_.end())) return false;
+    if (ids_dense_ && n != 0 && (node_ids_.front() != first_id_ || node_ids_.back() - first_id_ != n - 1)) return false;
+    if (!nodesInRange(input_nodes_) || !nodesInRange(slot_owners_) || !nodesInRange(consumers_) ||
+        !nodesInRange(ctrl_succs_) || !nodesInRange(ctrl_preds_)) {
+        return false;
+    }
+    for (SlotIndex slot : input_slots_) {
+        if (slot != INVALID_SLOT_INDEX && slot >= slots) return false;
+    }
+    return true;
+ }
+ bool CompiledGraph::writeImage(std::ostream& os) const {
+    os.write(reinterpret_cast<const char*>(image_.get()), static_cast<std::streamsize>(image_size_));
+    return static_cast<bool>(os);
+ }
+ std::optional<NodeIndex> CompiledGraph::indexOf(NodeID node_id) const {
+    if (node_ids_.empty() || node_id < first_id_) return std::nullopt;
+    if (ids_dense_) {
+        NodeID offset = node_id - first_id_;
+        if (offset < node_ids_.size()) return static_cast<NodeIndex>(offset);
+        return std::nullopt;
+    }
+    auto it = std::lower_bound(node_ids_.begin(), node_ids_.end(), node_id);
+    if (it == node_ids_.end() || *it != node_id) return std::nullopt;
+    return static_cast<NodeIndex>(it - node_ids_.begin());
+ }
+ bool CompiledGraph::validate(std::vector<ValidationIssue>* issues, size_t max_threads) const {
+    bool valid = true;
+    auto report = [&](NodeID node_id, ValidationError error) {
+        valid = false;
+        if (issues) issues->push_back({node_id, 0, error});
+        return issues != nullptr;
+    };
+    // Dangling data inputs look unconnected in the flat arrays, so they are only counted; dangling
+    // control edges are also reported at their node
+    if (dangling_edges_ != 0 && !report(0, ValidationError::DANGLING_EDGE)) return false;
+    if (node_ids_.size() >= std::numeric_limits<NodeIndex>::max()) {
+        report(0, ValidationError::TOO_MANY_NODES);
+        return false;
+    }
+    const NodeIndex n = static_cast<NodeIndex>(node_ids_.size());
+    size_t threads = max_threads ? max_threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    threads = std::clamp<size_t>(n / PARALLEL_VALIDATION_CHUNK, 1, threads);
+    if (threads == 1) {
+        valid = validateNodes(0, n, issues, nullptr) && valid;
+    } else {
+        // One contiguous chunk per thread; issues are concatenated in chunk order, so they stay sorted
+        std::vector<std::vector<ValidationIssue>> chunk_issues(issues ? threads : 0);
+        std::vector<char> chunk_valid(threads, 1);
+        std::atomic<bool> stop{false}; // Set by the first failure when issues are not collected
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        auto run = [&](size_t t) {
+            const NodeIndex first = static_cast<NodeIndex>(n * t / threads);
+            const NodeIndex last = static_cast<NodeIndex>(n * (t + 1) / threads);
+            chunk_valid[t] = validateNodes(first, last, issues ? &chunk_issues[t] : nullptr, issues ? nullptr : &stop);
+            if (!chunk_valid[t]) stop.store(true, std::memory_order_relaxed);
+        };
+        for (size_t t = 1; t < threads; ++t) workers.emplace_back(run, t);
+        run(0);
+        for (std::thread& worker : workers) worker.join();
+        for (size_t t = 0; t < threads; ++t) {
+            valid = valid && chunk_valid[t];
+            if (issues) issues->insert(issues->end(), chunk_issues[t].begin(), chunk_issues[t].end());
+        }
+    }
+    if (!valid && !issues) return false;
+    return validateAcyclic(issues) && valid;
+ }
+ bool CompiledGraph::validateNodes(NodeIndex first, NodeIndex last, std::vector<ValidationIssue>* issues,
+                                   const std::atomic<bool>* stop) const {
+    bool valid = true;
+    NodeIndex i = first;
+    auto report = [&](size_t port, ValidationError error) {
+        valid = false;
+        if (issues) issues->push_back({node_ids_[i], static_cast<PortIndex>(port), error});
+        return issues != nullptr;
+    };
+    for (; i < last; ++i) {
+        // Another chunk already failed
+        if (stop && (i & 1023) == 0 && stop->load(std::memory_order_relaxed)) return false;
+        auto successors = controlSuccessors(i);
+        for (size_t k = 0; k < successors.size(); ++k) {
+            if (successors[k] == INVALID_NODE_INDEX && !report(k, ValidationError::DANGLING_EDGE)) return false;
+        }
+        for (NodeIndex predecessor : controlPredecessors(i)) {
+            if (predecessor == INVALID_NODE_INDEX && !report(0, ValidationError::DANGLING_EDGE)) return false;
+        }
+        // Every connected input must name an existing output port of its source
+        auto slots = inputSlots(i);
+        auto srcs = inputNodes(i);
+        for (size_t k = 0; k < slots.size(); ++k) {
+            if (srcs[k] != INVALID_NODE_INDEX && slots[k] == INVALID_SLOT_INDEX && !report(k, ValidationError::MISSING_OUTPUT_PORT)) {
+                return false;
+            }
+        }
+        auto input_type = [&](size_t k) -> std::optional<BDIType> {
+            if (slots[k] == INVALID_SLOT_INDEX) {
+                if (srcs[k] == INVALID_NODE_INDEX) return std::nullopt;
+                return BDIType::UNKNOWN; // Missing port, reported above
+            }
+            const BDIType declared = output_types_[slots[k]];
+            if (slots[k] != output_offsets_[srcs[k]]) return declared;
+            return getProducedType(operations_[srcs[k]], declared, payload_types_[srcs[k]]);
+        };
+        const BDIType declared_result = outputCount(i) ? output_types_[output_offsets_[i]] : BDIType::UNKNOWN;
+        if (!checkOperation(operations_[i], slots.size(), input_type, payload_types_[i], payloadBytes(i).size(),
+                            successors.size(), declared_result, report)) {
+            return false;
+        }
+    }
+    return valid;
+ }
+ bool CompiledGraph::validateAcyclic(std::vector<ValidationIssue>* issues) const {
+    // Kahn's algorithm over the data edges: peel off nodes whose producers have all been peeled
+    const NodeIndex n = static_cast<NodeIndex>(node_ids_.size());
+    std::vector<uint32_t> pending(n); // Unpeeled producer edges per node
+    std::vector<NodeIndex> ready;
+    ready.reserve(n);
+    for (NodeIndex i = 0; i < n; ++i) {
+        for (NodeIndex src : inputNodes(i)) pending[i] += src != INVALID_NODE_INDEX;
+        if (pending[i] == 0) ready.push_back(i);
+    }
+    for (size_t r = 0; r < ready.size(); ++r) {
+        for (NodeIndex consumer : dataConsumers(ready[r])) {
+            if (--pending[consumer] == 0) ready.push_back(consumer);
+        }
+    }
+    if (ready.size() == n) return true;
+    if (!issues) return false;
+    // Peel the rest from the other end as well (nodes none of whose remaining consumers are left): what
+    // remains lies on a cycle or on a path between two cycles
+    std::vector<uint32_t> remaining_consumers(n, 0);
+    std::vector<NodeIndex> sinks;
+    for (NodeIndex i = 0; i < n; ++i) {
+        if (pending[i] == 0) continue;
+        for (NodeIndex consumer : dataConsumers(i)) remaining_consumers[i] += pending[consumer] != 0;
+        if (remaining_consumers[i] == 0) sinks.push_back(i);
+    }
+    for (size_t r = 0; r < sinks.size(); ++r) {
+        const NodeIndex node = sinks[r];
+        pending[node] = 0;
+        for (NodeIndex src : inputNodes(node)) {
+            if (src != INVALID_NODE_INDEX && pending[src] != 0 && --remaining_consumers[src] == 0) sinks.push_back(src);
+        }
+    }
+    for (NodeIndex i = 0; i < n; ++i) {
+        if (pending[i] != 0) issues->push_back({node_ids_[i], 0, ValidationError::DATA_CYCLE});
+    }
+    return false;
+ }
+ } // namespace bdi::core::graph
@@ -0,0 +1,149 @@
+// File: bdi/core/graph/CompiledGraph.hpp
+ #ifndef BDI_CORE_GRAPH_COMPILEDGRAPH_HPP
+ #define BDI_CORE_GRAPH_COMPILEDGRAPH_HPP
+ #include "BDIGraph.hpp"
+ #include "../serialization/BinaryGraphFormat.hpp"
+ #include <atomic>
+ #include <cstddef>
+ #include <cstdint>
+ #include <iosfwd>
+ #include <memory>
+ #include <optional>
+ #include <span>
+ #include <string>
+ #include <string_view>
+ #include <vector>
+ namespace bdi::core::graph {
+ // Dense index of a node inside a CompiledGraph (0..getNodeCount()-1)
+ using NodeIndex = uint32_t;
+ inline constexpr NodeIndex INVALID_NODE_INDEX = ~NodeIndex{0};
+ // Dense index of an output port across the whole graph (value slot)
+ using SlotIndex = uint32_t;
+ inline constexpr SlotIndex INVALID_SLOT_INDEX = ~SlotIndex{0};
+ // Immutable, contiguous view of a finished BDIGraph used for execution and validation.
+ // Nodes are renumbered densely (sorted by NodeID) and every per-node attribute is stored in its own
+ // flat array. Variable-length lists (data inputs, output ports, control edges, payload bytes) are CSR:
+ // an offsets array of size N+1 indexing into one shared array.
+ // All arrays live in a single image buffer laid out exactly as the on-disk format
+ // (BinaryGraphFormat.hpp), so writing a graph is one write and loading one is an mmap.
+ class CompiledGraph {
+ public:
+    // Per-node flags derived at compile time
+    enum NodeFlags : uint8_t {
+        FLAG_NONE = 0,
+        FLAG_FLOATING = 1 << 0, // No control edges: pure node evaluated on demand by its consumers
+        FLAG_HAS_PAYLOAD = 1 << 1
+    };
+    // Build the view. The source graph may be mutated or destroyed afterwards.
+    static std::unique_ptr<CompiledGraph> compile(const BDIGraph& graph);
+    // Wrap an existing image (e.g. a memory-mapped file) without copying it. The shared_ptr keeps the
+    // owner of the bytes (mapping or buffer) alive; they must not change while the graph exists.
+    // Header and section bounds are always checked. 'verify' additionally checks the checksum and every
+    // stored offset and index, which touches the whole image; skip it only for images you wrote yourself.
+    // Returns nullptr on a malformed, corrupt or foreign image.
+    static std::unique_ptr<CompiledGraph> fromImage(std::shared_ptr<const std::byte> image, size_t size,
+                                                    bool verify = true);
+    // The serialized form of this graph (header + sections)
+    std::span<const std::byte> image() const { return {image_.get(), image_size_}; }
+    bool writeImage(std::ostream& os) const;
+    // --- Node Table --
+    size_t getNodeCount() const { return node_ids_.size(); }
+    const std::string& getName() const { return name_; }
+    std::optional<NodeIndex> indexOf(NodeID node_id) const;
+    NodeID nodeIdAt(NodeIndex idx) const { return node_ids_[idx]; }
+    BDIOperationType operation(NodeIndex idx) const { return operations_[idx]; }
+    uint8_t flags(NodeIndex idx) const { return flags_[idx]; }
+    bool isFloating(NodeIndex idx) const { return (flags_[idx] & FLAG_FLOATING) != 0; }
+    MetadataHandle metadataHandle(NodeIndex idx) const { return metadata_handles_[idx]; }
+    RegionID regionId(NodeIndex idx) const { return region_ids_[idx]; }
+    // --- Payloads --
+    BDIType payloadType(NodeIndex idx) const { return payload_types_[idx]; }
+    std::span<const std::byte> payloadBytes(NodeIndex idx) const {
+        return {payload_bytes_.data() + payload_offsets_[idx], payload_offsets_[idx + 1] - payload_offsets_[idx]};
+    }
+    // --- Data Edges --
+    // Source output slot for each data input (INVALID_SLOT_INDEX if unconnected or dangling)
+    std::span<const SlotIndex> inputSlots(NodeIndex idx) const { return csr(input_offsets_, input_slots_, idx); }
+    // Producing node for each data input (INVALID_NODE_INDEX if unconnected or dangling)
+    std::span<const NodeIndex> inputNodes(NodeIndex idx) const { return csr(input_offsets_, input_nodes_, idx); }
+    // Output ports: slot = outputSlotBase(idx) + port
+    SlotIndex outputSlotBase(NodeIndex idx) const { return output_offsets_[idx]; }
+    uint32_t outputCount(NodeIndex idx) const { return output_offsets_[idx + 1] - output_offsets_[idx]; }
+    std::span<const BDIType> outputTypes(NodeIndex idx) const { return csr(output_offsets_, output_types_, idx); }
+    size_t getSlotCount() const { return output_types_.size(); }
+    BDIType slotType(SlotIndex slot) const { return output_types_[slot]; }
+    std::string_view slotName(SlotIndex slot) const {
+        return {reinterpret_cast<const char*>(strings_.data()) + output_name_offsets_[slot],
+                output_name_offsets_[slot + 1] - output_name_offsets_[slot]};
+    }
+    NodeIndex slotOwner(SlotIndex slot) const { return slot_owners_[slot]; }
+    // Consumers of a node (any output port), one entry per consuming input
+    std::span<const NodeIndex> dataConsumers(NodeIndex idx) const { return csr(consumer_offsets_, consumers_, idx); }
+    // --- Control Edges --
+    std::span<const NodeIndex> controlSuccessors(NodeIndex idx) const { return csr(ctrl_succ_offsets_, ctrl_succs_, idx); }
+    std::span<const NodeIndex> controlPredecessors(NodeIndex idx) const { return csr(ctrl_pred_offsets_, ctrl_preds_, idx); }
+    // --- Validation --
+    // Every node against its operation signature (edges, ports, operand and result types, successors,
+    // payload size), then a check that the data edges are acyclic. Node checks run on up to
+    // 'max_threads' threads (0: one per core) in chunks of at least PARALLEL_VALIDATION_CHUNK nodes; the
+    // cycle check is linear in nodes and edges. 'issues' (optional) receives every problem found, by
+    // node; without it validation stops at the first.
+    static constexpr size_t PARALLEL_VALIDATION_CHUNK = 16384;
+    bool validate(std::vector<ValidationIssue>* issues = nullptr, size_t max_threads = 0) const;
+ private:
+    struct Columns; // Growable arrays used while compiling, packed into the image afterwards
+    CompiledGraph() = default;
+    template <typename T>
+    static std::span<const T> csr(std::span<const uint32_t> offsets, std::span<const T> values, NodeIndex idx) {
+        return {values.data() + offsets[idx], offsets[idx + 1] - offsets[idx]};
+    }
+    static std::unique_ptr<CompiledGraph> pack(const Columns& columns);
+    // Point every span at its section; false if a section is out of bounds or inconsistent
+    bool bindSections();
+    bool verifyIndices() const;
+    // Signature checks of nodes [first, last); see validate()
+    bool validateNodes(NodeIndex first, NodeIndex last, std::vector<ValidationIssue>* issues,
+                       const std::atomic<bool>* stop) const;
+    bool validateAcyclic(std::vector<ValidationIssue>* issues) const;
+    std::shared_ptr<const std::byte> image_;
+    size_t image_size_ = 0;
+    std::string name_;
+    // Node table (structure-of-arrays, indexed by NodeIndex)
+    std::span<const NodeID> node_ids_; // Sorted ascending
+    std::span<const BDIOperationType> operations_;
+    std::span<const uint8_t> flags_;
+    std::span<const MetadataHandle> metadata_handles_;
+    std::span<const RegionID> region_ids_;
+    NodeID first_id_ = 0;
+    bool ids_dense_ = false; // node_ids_[i] == first_id_ + i for all i
+    // Payloads
+    std::span<const BDIType> payload_types_;
+    std::span<const uint32_t> payload_offsets_;
+    std::span<const std::byte> payload_bytes_;
+    // Data inputs (CSR)
+    std::span<const uint32_t> input_offsets_;
+    std::span<const SlotIndex> input_slots_;
+    std::span<const NodeIndex> input_nodes_;
+    std::span<const PortIndex> input_ports_; // Original port index, kept for validation of dangling refs
+    // Output ports (CSR)
+    std::span<const uint32_t> output_offsets_;
+    std::span<const BDIType> output_types_;
+    std::span<const NodeIndex> slot_owners_;
+    std::span<const uint32_t> output_name_offsets_;
+    // Reverse data edges (CSR)
+    std::span<const uint32_t> consumer_offsets_;
+    std::span<const NodeIndex> consumers_;
+    // Control edges (CSR)
+    std::span<const uint32_t> ctrl_succ_offsets_;
+    std::span<const NodeIndex> ctrl_succs_;
+    std::span<const uint32_t> ctrl_pred_offsets_;
+    std::span<const NodeIndex> ctrl_preds_;
+    std::span<const std::byte> strings_;
+    size_t dangling_edges_ = 0; // Edges whose endpoint did not resolve during compile
+ };
+ // BDIGraph::freeze needs the CompiledGraph definition
+ inline std::shared_ptr<const CompiledGraph> BDIGraph::freeze() const {
+    return CompiledGraph::compile(*this);
+ }
+ } // namespace bdi::core::graph
+ #endif // BDI_CORE_GRAPH_COMPILEDGRAPH_HPP
@@ -0,0 +1,269 @@
+// File: bdi/tests/ConcurrencyTests.cpp
+ // Channel rings (full, empty, wraparound, racing producers and consumers), parked-task queues, and
+ // TaskScheduler tasks suspending on channel sends and receives until a task or the host resumes them
+ #include "TestSupport.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/concurrency/TaskScheduler.hpp"
+ #include <atomic>
+ #include <memory>
+ #include <thread>
+ #include <vector>
+ using namespace bdi::tests;
+ using bdi::runtime::WorkStealingPool;
+ using bdi::runtime::concurrency::Channel;
+ using bdi::runtime::concurrency::ChannelID;
+ using bdi::runtime::concurrency::ChannelKind;
+ using bdi::runtime::concurrency::MpmcRing;
+ using bdi::runtime::concurrency::SpscRing;
+ using bdi::runtime::concurrency::TaskScheduler;
+ using bdi::runtime::concurrency::TypedPayload;
+ namespace {
+ // Single thread: fills to capacity, drains in order, then runs many laps past the end of the cells
+ template <typename Ring>
+ void checkRing(size_t requested, size_t capacity) {
+    Ring ring(requested);
+    BDI_CHECK(ring.capacity() == capacity);
+    int value = 0;
+    BDI_CHECK(!ring.tryRecv(value) && !ring.canRecv() && ring.canSend());
+    for (int i = 0; i < static_cast<int>(capacity); ++i) {
+        value = i;
+        BDI_CHECK(ring.trySend(value));
+    }
+    value = -1;
+    BDI_CHECK(!ring.trySend(value) && !ring.canSend() && ring.canRecv());
+    for (int i = 0; i < static_cast<int>(capacity); ++i) BDI_CHECK(ring.tryRecv(value) && value == i);
+    BDI_CHECK(!ring.tryRecv(value) && !ring.canRecv());
+    int next_send = 0;
+    int next_recv = 0;
+    for (int lap = 0; lap < 1000; ++lap) {
+        const int batch = 1 + lap % static_cast<int>(capacity);
+        for (int i = 0; i < batch; ++i) {
+            value = next_send++;
+            BDI_CHECK(ring.trySend(value));
+        }
+        for (int i = 0; i < batch; ++i) BDI_CHECK(ring.tryRecv(value) && value == next_recv++);
+    }
+    BDI_CHECK(!ring.tryRecv(value));
+ }
+ void testSpscRing() {
+    checkRing<SpscRing<int>>(0, 1);
+    checkRing<SpscRing<int>>(5, 8);
+    checkRing<SpscRing<int>>(16, 16);
+    // One producer thread against this one: every value, in order
+    constexpr int COUNT = 200000;
+    SpscRing<int> ring(4);
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i) {
+            int value = i;
+            while (!ring.trySend(value)) std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    while (expected < COUNT) {
+        int value = -1;
+        if (!ring.tryRecv(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!BDI_CHECK(value == expected)) break;
+        ++expected;
+    }
+    producer.join();
+ }
+ void testMpmcRing() {
+    checkRing<MpmcRing<int>>(0, 2);
+    checkRing<MpmcRing<int>>(1, 2);
+    checkRing<MpmcRing<int>>(5, 8);
+    // Many producers and consumers: each value received exactly once, and each consumer sees every
+    // producer's values in the order they were sent
+    constexpr int PRODUCERS = 4;
+    constexpr int CONSUMERS = 4;
+    constexpr int PER_PRODUCER = 50000;
+    constexpr int TOTAL = PRODUCERS * PER_PRODUCER;
+    MpmcRing<int> ring(8);
+    std::vector<std::atomic<int>> seen(TOTAL);
+    std::atomic<int> received{0};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                int value = p * PER_PRODUCER + i;
+                while (!ring.trySend(value)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < CONSUMERS; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int> last(PRODUCERS, -1);
+            while (received.load() < TOTAL) {
+                int value = -1;
+                if (!ring.tryRecv(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                received.fetch_add(1);
+                if (value < 0 || value >= TOTAL) {
+                    errors.fetch_add(1);
+                    continue;
+                }
+                seen[value].fetch_add(1);
+                const int producer = value / PER_PRODUCER;
+                if (value <= last[producer]) errors.fetch_add(1);
+                last[producer] = value;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    BDI_CHECK(errors.load() == 0);
+    int once = 0;
+    for (const std::atomic<int>& count : seen) once += count.load() == 1;
+    BDI_CHECK(once == TOTAL);
+    int value = 0;
+    BDI_CHECK(!ring.tryRecv(value));
+ }
+ // Channel: failed sends keep the value, parkers queue only while they would have to wait, and
+ // take*() hands them back oldest first
+ void testChannelParking() {
+    for (ChannelKind kind : {ChannelKind::SPSC, ChannelKind::MPMC}) {
+        Channel channel(kind, 2);
+        BDI_CHECK(channel.getKind() == kind && channel.getCapacity() == 2);
+        int markers[3] = {};
+        auto task = [&](int i) { return std::coroutine_handle<>::from_address(&markers[i]); };
+        BDI_CHECK(!channel.takeReceiver() && !channel.takeSender());
+        BDI_CHECK(!channel.parkSender(task(0))); // Room: retry instead
+        BDI_CHECK(channel.parkReceiver(task(0)) && channel.parkReceiver(task(1)));
+        TypedPayload value = RuntimeValue::make(BDIType::INT64, int64_t{7}).toPayload();
+        BDI_CHECK(channel.trySend(value));
+        BDI_CHECK(channel.takeReceiver() == task(0) && channel.takeReceiver() == task(1) && !channel.takeReceiver());
+        BDI_CHECK(!channel.parkReceiver(task(2))); // A value is waiting
+        value = RuntimeValue::make(BDIType::INT64, int64_t{8}).toPayload();
+        BDI_CHECK(channel.trySend(value));
+        TypedPayload kept = RuntimeValue::make(BDIType::INT64, int64_t{9}).toPayload();
+        BDI_CHECK(!channel.trySend(kept) && RuntimeValue::fromPayload(kept).as<int64_t>() == 9);
+        BDI_CHECK(channel.parkSender(task(2)));
+        TypedPayload out;
+        BDI_CHECK(channel.tryRecv(out) && RuntimeValue::fromPayload(out).as<int64_t>() == 7);
+        BDI_CHECK(channel.takeSender() == task(2) && !channel.takeSender());
+        BDI_CHECK(channel.tryRecv(out) && RuntimeValue::fromPayload(out).as<int64_t>() == 8);
+        BDI_CHECK(!channel.tryRecv(out) && !channel.canRecv());
+    }
+ }
+ // Graph sending 'count' INT64 values starting at 'first' on 'channel'
+ struct Producer {
+    TestGraph t;
+    NodeID start = 0;
+    Producer(ChannelID channel, int64_t first, int count) {
+        start = t.start();
+        const NodeID id = t.constant(BDIType::UINT64, uint64_t{channel});
+        for (int i = 0; i < count; ++i) {
+            const NodeID value = t.constant(BDIType::INT64, first + i);
+            t.op(BDIOperationType::COMM_CHANNEL_SEND, {id, value}, BDIType::UNKNOWN, true);
+        }
+        t.op(BDIOperationType::META_END, {}, BDIType::UNKNOWN, true);
+    }
+ };
+ // Graph receiving 'count' INT64 values on 'channel' and returning their sum
+ struct Consumer {
+    TestGraph t;
+    NodeID start = 0;
+    Consumer(ChannelID channel, int count) {
+        start = t.start();
+        const NodeID id = t.constant(BDIType::UINT64, uint64_t{channel});
+        NodeID sum = t.constant(BDIType::INT64, int64_t{0});
+        for (int i = 0; i < count; ++i) {
+            const NodeID value = t.op(BDIOperationType::COMM_CHANNEL_RECV, {id}, BDIType::INT64, true);
+            sum = t.op(BDIOperationType::ARITH_ADD, {sum, value}, BDIType::INT64, false);
+        }
+        t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, true);
+    }
+ };
+ int64_t returned(TaskScheduler& scheduler, TaskScheduler::TaskID id) {
+    const auto value = scheduler.getMachine(id).getReturnValue();
+    return value ? value->as<int64_t>() : -1;
+ }
+ // Producers and consumers on one small channel; every task parks many times on the way
+ void checkPipeline(size_t threads, ChannelKind kind, int pairs, int per_task) {
+    WorkStealingPool pool(threads);
+    TaskScheduler scheduler(pool);
+    const ChannelID channel = scheduler.createChannel(kind == ChannelKind::SPSC ? 1 : 2, kind);
+    std::vector<std::unique_ptr<Producer>> producers;
+    std::vector<std::unique_ptr<Consumer>> consumers;
+    std::vector<std::shared_ptr<const bdi::core::graph::CompiledGraph>> compiled;
+    std::vector<TaskScheduler::TaskID> consumer_tasks;
+    for (int i = 0; i < pairs; ++i) {
+        // Consumers first, so they start out parked on an empty channel
+        consumers.push_back(std::make_unique<Consumer>(channel, per_task));
+        compiled.push_back(consumers.back()->t.graph.freeze());
+        consumer_tasks.push_back(scheduler.spawn(*compiled.back(), consumers.back()->start));
+    }
+    for (int i = 0; i < pairs; ++i) {
+        producers.push_back(std::make_unique<Producer>(channel, int64_t{i} * per_task, per_task));
+        compiled.push_back(producers.back()->t.graph.freeze());
+        scheduler.spawn(*compiled.back(), producers.back()->start);
+    }
+    BDI_CHECK(scheduler.waitIdle());
+    BDI_CHECK(scheduler.getFinishedTaskCount() == static_cast<size_t>(2 * pairs));
+    const int64_t total = int64_t{pairs} * per_task;
+    int64_t sum = 0;
+    for (TaskScheduler::TaskID id : consumer_tasks) {
+        BDI_CHECK(scheduler.getTaskResult(id) == true);
+        sum += returned(scheduler, id);
+    }
+    BDI_CHECK(sum == total * (total - 1) / 2);
+    BDI_CHECK(!scheduler.tryRecv(channel));
+ }
+ void testTaskPipelines() {
+    checkPipeline(1, ChannelKind::SPSC, 1, 200);
+    checkPipeline(4, ChannelKind::SPSC, 1, 200);
+    checkPipeline(1, ChannelKind::MPMC, 16, 20);
+    checkPipeline(4, ChannelKind::MPMC, 16, 20);
+ }
+ // Tasks waiting on the host: waitIdle() returns with them parked, and each host send or receive resumes
+ // them for exactly one more step
+ void testHostWakeups() {
+    WorkStealingPool pool(2);
+    TaskScheduler scheduler(pool);
+    BDI_CHECK(scheduler.getChannel(0) == nullptr && scheduler.getChannel(1) == nullptr);
+    const ChannelID in = scheduler.createChannel(1, ChannelKind::SPSC);
+    const ChannelID out = scheduler.createChannel(2, ChannelKind::SPSC);
+    BDI_CHECK(in == 1 && out == 2 && scheduler.getChannelCount() == 2);
+    BDI_CHECK(!scheduler.trySend(99, RuntimeValue::make(BDIType::INT64, int64_t{1}).toPayload()) && !scheduler.tryRecv(0));
+    Consumer consumer(in, 5);
+    Producer producer(out, 100, 6);
+    auto consumer_graph = consumer.t.graph.freeze();
+    auto producer_graph = producer.t.graph.freeze();
+    const auto receiving = scheduler.spawn(*consumer_graph, consumer.start);
+    const auto sending = scheduler.spawn(*producer_graph, producer.start);
+    BDI_CHECK(!scheduler.waitIdle()); // Both parked: nothing to receive, no room for a third value
+    BDI_CHECK(scheduler.getFinishedTaskCount() == 0 && !scheduler.getTaskResult(receiving) && !scheduler.getTaskResult(sending));
+    for (int64_t i = 1; i <= 5; ++i) {
+        BDI_CHECK(scheduler.trySend(in, RuntimeValue::make(BDIType::INT64, i).toPayload()));
+        BDI_CHECK(!scheduler.waitIdle()); // The producer is still parked
+        BDI_CHECK(scheduler.getTaskResult(receiving).has_value() == (i == 5));
+    }
+    BDI_CHECK(returned(scheduler, receiving) == 15);
+    BDI_CHECK(!scheduler.tryRecv(in));
+    for (int64_t i = 0; i < 6; ++i) {
+        const auto value = scheduler.tryRecv(out);
+        BDI_CHECK(value && RuntimeValue::fromPayload(*value).as<int64_t>() == 100 + i);
+        BDI_CHECK(scheduler.waitIdle() == (i >= 3)); // Finished once its last send found room
+    }
+    BDI_CHECK(scheduler.getTaskResult(sending) == true && scheduler.getFinishedTaskCount() == 2);
+    BDI_CHECK(!scheduler.tryRecv(out));
+    // A task that cannot start counts as failed
+    TestGraph t;
+    t.start();
+    auto graph = t.graph.freeze();
+    const auto broken = scheduler.spawn(*graph, 12345);
+    BDI_CHECK(!scheduler.waitIdle() && scheduler.getTaskResult(broken) == false);
+ }
+ } // namespace
+ int main() {
+    testSpscRing();
+    testMpmcRing();
+    testChannelParking();
+    testTaskPipelines();
+    testHostWakeups();
+    return bdi::tests::finish("ConcurrencyTests");
+ }
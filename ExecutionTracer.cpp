@@ -0,0 +1,294 @@
+// File: bdi/runtime/trace/ExecutionTracer.cpp
+ #include "ExecutionTracer.hpp"
+ #include <algorithm>
+ #include <cinttypes>
+ #include <cstdio>
+ #include <ostream>
+ #include <string>
+ namespace bdi::runtime::trace {
+ namespace {
+ std::atomic<uint64_t> next_tracer_id{1};
+ size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+ }
+ void accumulate(NodeProfile& into, const NodeProfile& from) {
+    into.count += from.count;
+    into.samples += from.samples;
+    into.sampled_cycles += from.sampled_cycles;
+    into.native_entries += from.native_entries;
+    into.native_steps += from.native_steps;
+    into.native_samples += from.native_samples;
+    into.native_sampled_cycles += from.native_sampled_cycles;
+ }
+ bool isEmpty(const NodeProfile& profile) {
+    return profile.count == 0 && profile.native_entries == 0;
+ }
+ } // namespace
+ // --- TraceRing --
+ TraceRing::TraceRing(size_t capacity)
+    : events_(std::make_unique<TraceEvent[]>(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)))),
+      mask_(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1) {}
+ size_t TraceRing::drain(std::vector<TraceEvent>& out) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i != head; ++i) out.push_back(events_[i & mask_]);
+    tail_.store(head, std::memory_order_release);
+    return static_cast<size_t>(head - tail);
+ }
+ // --- NodeProfile --
+ double NodeProfile::estimatedCycles() const {
+    double cycles = 0.0;
+    if (samples != 0) cycles += static_cast<double>(sampled_cycles) * static_cast<double>(count) / static_cast<double>(samples);
+    if (native_samples != 0) {
+        cycles += static_cast<double>(native_sampled_cycles) * static_cast<double>(native_entries) /
+                  static_cast<double>(native_samples);
+    }
+    return cycles;
+ }
+ // --- ThreadTrace --
+ ThreadTrace::ThreadTrace(ExecutionTracer& tracer, std::thread::id thread, uint32_t index, size_t ring_capacity)
+    : tracer_(tracer), thread_(thread), thread_index_(index), ring_(ring_capacity) {}
+ void ThreadTrace::bindGraph(const CompiledGraph& graph, bool new_snapshot) {
+    sample_period_ = tracer_.getSamplePeriod();
+    countdown_ = std::min(countdown_, nextSampleInterval());
+    record_events_ = tracer_.record_events_.load(std::memory_order_relaxed);
+    if (!new_snapshot && graph_ == &graph && graph_image_ == graph.image().data() &&
+        counts_.size() == graph.getNodeCount()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tracer_.mutex_);
+        foldCounters();
+    }
+    graph_ = &graph;
+    graph_image_ = graph.image().data();
+    counts_.assign(graph.getNodeCount(), 0);
+    counters_.assign(graph.getNodeCount(), NodeProfile{});
+    for (NodeIndex i = 0; i < counters_.size(); ++i) {
+        counters_[i].node_id = graph.nodeIdAt(i);
+        counters_[i].metadata = graph.metadataHandle(i);
+        counters_[i].operation = graph.operation(i);
+    }
+ }
+ void ThreadTrace::foldCounters() {
+    for (NodeIndex i = 0; i < counters_.size(); ++i) {
+        const NodeProfile counters = nodeProfile(i);
+        if (isEmpty(counters)) continue;
+        auto [it, inserted] = folded_.try_emplace(counters.node_id, counters);
+        if (!inserted) accumulate(it->second, counters);
+    }
+    counts_.clear();
+    counters_.clear();
+    graph_ = nullptr;
+    graph_image_ = nullptr;
+ }
+ uint32_t ThreadTrace::nextSampleInterval() {
+    if (sample_period_ <= 1) return 1;
+    sample_rng_ ^= sample_rng_ << 13; // xorshift64
+    sample_rng_ ^= sample_rng_ >> 7;
+    sample_rng_ ^= sample_rng_ << 17;
+    return sample_period_ / 2 + static_cast<uint32_t>(sample_rng_ % sample_period_);
+ }
+ TraceEvent ThreadTrace::makeEvent(TraceEventKind kind, NodeIndex node, uint64_t begin, uint64_t end) const {
+    TraceEvent event;
+    event.begin = begin;
+    event.end = end;
+    event.node_id = counters_[node].node_id;
+    event.metadata = counters_[node].metadata;
+    event.operation = counters_[node].operation;
+    event.kind = kind;
+    return event;
+ }
+ void ThreadTrace::recordNode(NodeIndex node, uint64_t begin) {
+    const uint64_t end = readCycleCounter();
+    NodeProfile& counters = counters_[node];
+    ++counters.samples;
+    counters.sampled_cycles += end - begin;
+    if (record_events_) ring_.push(makeEvent(TraceEventKind::NODE, node, begin, end));
+ }
+ void ThreadTrace::recordNative(NodeIndex node, uint64_t begin, uint64_t steps) {
+    const uint64_t end = readCycleCounter();
+    NodeProfile& counters = counters_[node];
+    ++counters.native_samples;
+    counters.native_sampled_cycles += end - begin;
+    if (record_events_) {
+        TraceEvent event = makeEvent(TraceEventKind::NATIVE_REGION, node, begin, end);
+        event.steps = static_cast<uint32_t>(std::min<uint64_t>(steps, UINT32_MAX));
+        ring_.push(event);
+    }
+ }
+ void ThreadTrace::recordRun(NodeIndex entry, uint64_t begin, uint64_t end) {
+    if (record_events_) ring_.push(makeEvent(TraceEventKind::RUN, entry, begin, end));
+ }
+ // --- ExecutionTracer --
+ ExecutionTracer::ExecutionTracer(size_t ring_capacity)
+    : ring_capacity_(ring_capacity), tracer_id_(next_tracer_id.fetch_add(1, std::memory_order_relaxed)),
+      start_cycles_(readCycleCounter()), start_time_(std::chrono::steady_clock::now()) {}
+ ThreadTrace& ExecutionTracer::threadTrace() {
+    // One-entry cache per thread; the id (not the address) tells whether it belongs to this tracer
+    thread_local uint64_t cached_tracer = 0;
+    thread_local ThreadTrace* cached_trace = nullptr;
+    if (cached_tracer == tracer_id_) return *cached_trace;
+    const std::thread::id self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThreadTrace* trace = nullptr;
+    for (const auto& existing : threads_) {
+        if (existing->thread_ == self) trace = existing.get();
+    }
+    if (!trace) {
+        threads_.push_back(std::unique_ptr<ThreadTrace>(
+            new ThreadTrace(*this, self, static_cast<uint32_t>(threads_.size()), ring_capacity_)));
+        trace = threads_.back().get();
+    }
+    cached_tracer = tracer_id_;
+    cached_trace = trace;
+    return *trace;
+ }
+ void ExecutionTracer::drainEvents() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& thread : threads_) thread->ring_.drain(thread->drained_);
+ }
+ uint64_t ExecutionTracer::getDroppedEventCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t dropped = 0;
+    for (const auto& thread : threads_) dropped += thread->ring_.getDroppedCount();
+    return dropped;
+ }
+ std::vector<NodeProfile> ExecutionTracer::getNodeProfile() const {
+    std::unordered_map<NodeID, NodeProfile> merged;
+    auto add = [&](const NodeProfile& profile) {
+        if (isEmpty(profile)) return;
+        auto [it, inserted] = merged.try_emplace(profile.node_id, profile);
+        if (!inserted) accumulate(it->second, profile);
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& thread : threads_) {
+            for (const auto& [id, profile] : thread->folded_) add(profile);
+            for (NodeIndex i = 0; i < thread->counters_.size(); ++i) add(thread->nodeProfile(i));
+        }
+    }
+    std::vector<NodeProfile> profile;
+    profile.reserve(merged.size());
+    for (const auto& [id, entry] : merged) profile.push_back(entry);
+    std::sort(profile.begin(), profile.end(), [](const NodeProfile& a, const NodeProfile& b) {
+        const double ca = a.estimatedCycles(), cb = b.estimatedCycles();
+        if (ca != cb) return ca > cb;
+        if (a.count != b.count) return a.count > b.count;
+        return a.node_id < b.node_id;
+    });
+    return profile;
+ }
+ OperationProfileTable ExecutionTracer::getOperationProfile() const {
+    OperationProfileTable table{};
+    for (const NodeProfile& node : getNodeProfile()) {
+        const size_t op = static_cast<size_t>(node.operation);
+        if (op >= table.size()) continue;
+        table[op].count += node.count;
+        table[op].samples += node.samples;
+        table[op].sampled_cycles += node.sampled_cycles;
+    }
+    return table;
+ }
+ double ExecutionTracer::getCyclesPerMicrosecond() const {
+    // Needs a few milliseconds of wall time for a stable ratio
+    while (std::chrono::steady_clock::now() - start_time_ < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const uint64_t cycles = readCycleCounter() - start_cycles_;
+    const double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time_).count();
+    return micros > 0.0 && cycles != 0 ? static_cast<double>(cycles) / micros : 1.0;
+ }
+ bool ExecutionTracer::writeChromeTrace(std::ostream& os) {
+    drainEvents();
+    const double cycles_per_us = getCyclesPerMicrosecond();
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t origin = UINT64_MAX;
+    for (const auto& thread : threads_) {
+        for (const TraceEvent& event : thread->drained_) origin = std::min(origin, event.begin);
+    }
+    char buffer[320];
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto emit = [&](int length) {
+        if (length <= 0) return;
+        if (!first) os << ",";
+        os << "\n" << std::string_view(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1));
+        first = false;
+    };
+    for (const auto& thread : threads_) {
+        const uint32_t tid = thread->thread_index_;
+        emit(std::snprintf(buffer, sizeof(buffer),
+                           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"bdi-%" PRIu32 "\"}}",
+                           tid, tid));
+        for (const TraceEvent& event : thread->drained_) {
+            const double ts = static_cast<double>(event.begin - origin) / cycles_per_us;
+            const double dur = static_cast<double>(event.end - event.begin) / cycles_per_us;
+            const char* category = event.kind == TraceEventKind::RUN ? "run"
+                                   : event.kind == TraceEventKind::NATIVE_REGION ? "native" : "node";
+            const char* name = event.kind == TraceEventKind::RUN ? "execute" : getOperationName(event.operation);
+            emit(std::snprintf(buffer, sizeof(buffer),
+                               "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32
+                               ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"node\":%" PRIu64 ",\"metadata\":%" PRIu64
+                               ",\"steps\":%" PRIu32 "}}",
+                               name, category, tid, ts, dur, static_cast<uint64_t>(event.node_id),
+                               static_cast<uint64_t>(event.metadata), event.steps));
+        }
+    }
+    os << "\n]}\n";
+    return static_cast<bool>(os);
+ }
+ bool ExecutionTracer::writeFlatProfile(std::ostream& os) const {
+    const std::vector<NodeProfile> nodes = getNodeProfile();
+    const double cycles_per_us = getCyclesPerMicrosecond();
+    double total = 0.0;
+    for (const NodeProfile& node : nodes) total += node.estimatedCycles();
+    char buffer[256];
+    auto line = [&](int length) {
+        if (length > 0) os << std::string_view(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1)) << "\n";
+    };
+    line(std::snprintf(buffer, sizeof(buffer), "# Flat profile (sample period %" PRIu32 ", %.1f cycles/us, %" PRIu64 " events dropped)",
+                       getSamplePeriod(), cycles_per_us, getDroppedEventCount()));
+    line(std::snprintf(buffer, sizeof(buffer), "%7s %12s %12s %-20s %12s %14s %10s %12s", "%time", "node_id", "metadata",
+                       "operation", "count", "est_cycles", "cyc/exec", "native_steps"));
+    for (const NodeProfile& node : nodes) {
+        const double cycles = node.estimatedCycles();
+        const uint64_t executions = node.count + node.native_entries;
+        line(std::snprintf(buffer, sizeof(buffer), "%6.2f%% %12" PRIu64 " %12" PRIu64 " %-20s %12" PRIu64 " %14.0f %10.1f %12" PRIu64,
+                           total > 0.0 ? 100.0 * cycles / total : 0.0, static_cast<uint64_t>(node.node_id),
+                           static_cast<uint64_t>(node.metadata), getOperationName(node.operation), node.count, cycles,
+                           executions ? cycles / static_cast<double>(executions) : 0.0, node.native_steps));
+    }
+    os << "\n";
+    line(std::snprintf(buffer, sizeof(buffer), "# By operation (interpreted)"));
+    line(std::snprintf(buffer, sizeof(buffer), "%-20s %12s %14s %10s", "operation", "count", "est_cycles", "cyc/exec"));
+    const OperationProfileTable ops = getOperationProfile();
+    for (size_t op = 0; op < ops.size(); ++op) {
+        const OperationProfile& entry = ops[op];
+        if (entry.count == 0) continue;
+        const double per_exec = entry.samples ? static_cast<double>(entry.sampled_cycles) / static_cast<double>(entry.samples) : 0.0;
+        line(std::snprintf(buffer, sizeof(buffer), "%-20s %12" PRIu64 " %14.0f %10.1f",
+                           getOperationName(static_cast<BDIOperationType>(op)), entry.count,
+                           per_exec * static_cast<double>(entry.count), per_exec));
+    }
+    return static_cast<bool>(os);
+ }
+ void ExecutionTracer::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TraceEvent> discarded;
+    for (const auto& thread : threads_) {
+        thread->ring_.drain(discarded);
+        thread->drained_.clear();
+        thread->folded_.clear();
+        std::fill(thread->counts_.begin(), thread->counts_.end(), 0);
+        for (NodeProfile& counters : thread->counters_) {
+            counters.samples = counters.sampled_cycles = 0;
+            counters.native_entries = counters.native_steps = 0;
+            counters.native_samples = counters.native_sampled_cycles = 0;
+        }
+        discarded.clear();
+    }
+ }
+ } // namespace bdi::runtime::trace
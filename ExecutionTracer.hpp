@@ -0,0 +1,228 @@
+// File: bdi/runtime/trace/ExecutionTracer.hpp
+ #ifndef BDI_RUNTIME_TRACE_EXECUTIONTRACER_HPP
+ #define BDI_RUNTIME_TRACE_EXECUTIONTRACER_HPP
+ #include "../../core/graph/CompiledGraph.hpp"
+ #include <array>
+ #include <atomic>
+ #include <chrono>
+ #include <cstddef>
+ #include <cstdint>
+ #include <iosfwd>
+ #include <memory>
+ #include <mutex>
+ #include <thread>
+ #include <unordered_map>
+ #include <vector>
+ #if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+ #endif
+ // Tracing hooks in the execution engines. Build with BDI_TRACING=0 to compile them out entirely; with
+ // them compiled in, an engine without an enabled tracer pays one pointer test per step.
+ #if !defined(BDI_TRACING)
+    #define BDI_TRACING 1
+ #endif
+ namespace bdi::runtime::trace {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::MetadataHandle;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::NodeIndex;
+ // Timestamp in cycles: the TSC on x86, the virtual counter on AArch64, steady_clock nanoseconds elsewhere
+ inline uint64_t readCycleCounter() {
+ #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+ #elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+ #else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+ #endif
+ }
+ enum class TraceEventKind : uint8_t {
+    NODE,          // One interpreted node
+    NATIVE_REGION, // One entry into JIT code; 'steps' nodes ran natively
+    RUN            // One execute() call; the node is the entry node
+ };
+ struct TraceEvent {
+    uint64_t begin = 0; // readCycleCounter()
+    uint64_t end = 0;
+    NodeID node_id = 0;
+    MetadataHandle metadata = 0;
+    uint32_t steps = 0;
+    BDIOperationType operation = BDIOperationType::META_NOP;
+    TraceEventKind kind = TraceEventKind::NODE;
+ };
+ // Fixed-capacity single-producer / single-consumer queue of events. The owning thread pushes without
+ // locks or allocation; a full ring drops new events (counted) rather than blocking execution.
+ class TraceRing {
+ public:
+    explicit TraceRing(size_t capacity); // Rounded up to a power of two
+    bool push(const TraceEvent& event) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ > mask_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ > mask_) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        events_[head & mask_] = event;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer side: move every queued event to 'out'; returns how many
+    size_t drain(std::vector<TraceEvent>& out);
+    size_t getCapacity() const { return mask_ + 1; }
+    uint64_t getDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+ private:
+    std::unique_ptr<TraceEvent[]> events_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t tail_cache_ = 0; // Producer's last view of tail_
+    std::atomic<uint64_t> dropped_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+ };
+ // Flat profile entry for one node. Interpreted executions are counted exactly; their cycles are measured
+ // on a sample of them (see ExecutionTracer::setSamplePeriod). JIT regions are attributed to their entry node.
+ struct NodeProfile {
+    NodeID node_id = 0;
+    MetadataHandle metadata = 0;
+    BDIOperationType operation = BDIOperationType::META_NOP;
+    uint64_t count = 0;          // Interpreted executions
+    uint64_t samples = 0;        // Executions that were timed...
+    uint64_t sampled_cycles = 0; // ...and the cycles they took
+    uint64_t native_entries = 0; // Entries into a JIT region starting here
+    uint64_t native_steps = 0;   // Nodes those entries ran
+    uint64_t native_samples = 0;
+    uint64_t native_sampled_cycles = 0;
+    // Cycles for all executions, extrapolated from the samples
+    double estimatedCycles() const;
+ };
+ struct OperationProfile {
+    uint64_t count = 0;
+    uint64_t samples = 0;
+    uint64_t sampled_cycles = 0;
+ };
+ using OperationProfileTable = std::array<OperationProfile, static_cast<size_t>(BDIOperationType::OPERATION_TYPE_COUNT)>;
+ class ExecutionTracer;
+ // Counters and event ring of one thread. Only that thread writes them; engines fetch it once per run
+ // through ExecutionTracer::threadTrace() and call the inline hooks per step.
+ class ThreadTrace {
+ public:
+    // Size the counters for 'graph'. Counters of a previously bound graph are folded into the profile
+    // first. A graph is recognized by its address and image; pass 'new_snapshot' when 'graph' may be a
+    // different graph than the one bound before even so.
+    void bindGraph(const CompiledGraph& graph, bool new_snapshot = false);
+    // Per interpreted node: returns the start timestamp if this execution is sampled, else 0
+    uint64_t enterNode(NodeIndex node) {
+        ++counts_[node];
+        return sampleNow();
+    }
+    void leaveNode(NodeIndex node, uint64_t begin) {
+        if (begin != 0) recordNode(node, begin);
+    }
+    // Per entry into native code at 'node'; the code ran 'steps' nodes
+    uint64_t enterNative(NodeIndex node) {
+        ++counters_[node].native_entries;
+        return sampleNow();
+    }
+    void leaveNative(NodeIndex node, uint64_t begin, uint64_t steps) {
+        counters_[node].native_steps += steps;
+        if (begin != 0) recordNative(node, begin, steps);
+    }
+    // One execute() call from 'entry' (always recorded)
+    void recordRun(NodeIndex entry, uint64_t begin, uint64_t end);
+    uint32_t getThreadIndex() const { return thread_index_; }
+ private:
+    friend class ExecutionTracer;
+    ThreadTrace(ExecutionTracer& tracer, std::thread::id thread, uint32_t index, size_t ring_capacity);
+    uint64_t sampleNow() {
+        if (--countdown_ != 0) return 0;
+        countdown_ = nextSampleInterval();
+        return readCycleCounter();
+    }
+    // Random in [period / 2, period * 3 / 2): a fixed interval would keep sampling the same nodes of a
+    // loop whose length divides it
+    uint32_t nextSampleInterval();
+    void recordNode(NodeIndex node, uint64_t begin);
+    void recordNative(NodeIndex node, uint64_t begin, uint64_t steps);
+    TraceEvent makeEvent(TraceEventKind kind, NodeIndex node, uint64_t begin, uint64_t end) const;
+    void foldCounters(); // Move the counters into folded_ (caller holds the tracer's mutex)
+    NodeProfile nodeProfile(NodeIndex node) const { // counters_ with the count filled in
+        NodeProfile profile = counters_[node];
+        profile.count = counts_[node];
+        return profile;
+    }
+    ExecutionTracer& tracer_;
+    std::thread::id thread_;
+    uint32_t thread_index_ = 0;
+    uint32_t sample_period_ = 1;
+    uint32_t countdown_ = 1;
+    uint64_t sample_rng_ = 0x9E3779B97F4A7C15ull;
+    bool record_events_ = true;
+    const CompiledGraph* graph_ = nullptr;
+    const std::byte* graph_image_ = nullptr;
+    // Per NodeIndex of graph_. The count touched on every step has its own array, so counting a large
+    // graph does not pull the rest of each entry through the cache.
+    std::vector<uint64_t> counts_;
+    std::vector<NodeProfile> counters_; // Everything else; 'count' is only filled in when folding
+    TraceRing ring_;
+    // Guarded by the tracer's mutex
+    std::unordered_map<NodeID, NodeProfile> folded_; // Counters of graphs bound before graph_
+    std::vector<TraceEvent> drained_;
+ };
+ // Execution tracer and per-node profiler shared by the engines that run on it (BDIVirtualMachine,
+ // ParallelExecutor). Each thread records into its own ThreadTrace, so recording never takes a lock.
+ // Interpreted nodes are counted exactly. Timing every node would cost more than a fast interpreter step
+ // (two counter reads), so one execution in 'sample period' is timed and recorded as an event; the
+ // profile extrapolates cycles from the samples. A sample period of 1 times and records every node.
+ // Reports (profiles, exports, reset) must not run while an engine is executing on this tracer;
+ // drainEvents() may.
+ class ExecutionTracer {
+ public:
+    static constexpr uint32_t DEFAULT_SAMPLE_PERIOD = 256;
+    static constexpr size_t DEFAULT_RING_CAPACITY = size_t{1} << 16;
+    explicit ExecutionTracer(size_t ring_capacity = DEFAULT_RING_CAPACITY);
+    ExecutionTracer(const ExecutionTracer&) = delete;
+    ExecutionTracer& operator=(const ExecutionTracer&) = delete;
+    // Engines check this when a run starts; a disabled tracer costs nothing beyond that check
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    // Applies from the next bindGraph() of each thread
+    void setSamplePeriod(uint32_t period) { sample_period_.store(period ? period : 1, std::memory_order_relaxed); }
+    uint32_t getSamplePeriod() const { return sample_period_.load(std::memory_order_relaxed); }
+    // Counters only (no events in the rings)
+    void setRecordEvents(bool record) { record_events_.store(record, std::memory_order_relaxed); }
+    // The calling thread's trace, created on first use
+    ThreadTrace& threadTrace();
+    // --- Reports --
+    // Move queued events out of every ring (keeps them for writeChromeTrace). Call periodically on long
+    // runs so the rings do not fill up.
+    void drainEvents();
+    uint64_t getDroppedEventCount() const;
+    // All threads and graphs merged, by NodeID; sorted by estimated cycles, highest first
+    std::vector<NodeProfile> getNodeProfile() const;
+    OperationProfileTable getOperationProfile() const;
+    // Chrome trace event format (chrome://tracing, ui.perfetto.dev); drains the rings first
+    bool writeChromeTrace(std::ostream& os);
+    // Text table of getNodeProfile() and getOperationProfile()
+    bool writeFlatProfile(std::ostream& os) const;
+    // Drop all counters and events (threads and bound graphs stay registered)
+    void reset();
+    // Cycle counter ticks per microsecond, measured against steady_clock since construction
+    double getCyclesPerMicrosecond() const;
+ private:
+    friend class ThreadTrace;
+    const size_t ring_capacity_;
+    const uint64_t tracer_id_; // Distinguishes tracers in the per-thread cache, even at a reused address
+    std::atomic<bool> enabled_{true};
+    std::atomic<uint32_t> sample_period_{DEFAULT_SAMPLE_PERIOD};
+    std::atomic<bool> record_events_{true};
+    const uint64_t start_cycles_;
+    const std::chrono::steady_clock::time_point start_time_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadTrace>> threads_;
+ };
+ } // namespace bdi::runtime::trace
+ #endif // BDI_RUNTIME_TRACE_EXECUTIONTRACER_HPP
@@ -0,0 +1,56 @@
+// File: bdi/tests/FloatingChainTests.cpp
+ // Floating producers are evaluated on demand; a chain far deeper than the native stack could hold as
+ // recursion must run in every engine
+ #include "TestSupport.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/BatchExecutor.hpp"
+ #include "../runtime/ThreadedInterpreter.hpp"
+ using namespace bdi::tests;
+ using bdi::runtime::BatchExecutor;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::ThreadedInterpreter;
+ namespace {
+ constexpr int64_t CHAIN_LENGTH = 1'000'000;
+ // start -> branch(chain >= 0) -> end(chain), where chain is CHAIN_LENGTH floating increments of 0
+ // with a diamond (x + x) every 1000 nodes
+ TestGraph makeChain(NodeID& start) {
+    TestGraph t;
+    start = t.start();
+    NodeID value = t.constant(BDIType::INT64, int64_t{0});
+    for (int64_t i = 0; i < CHAIN_LENGTH; ++i) {
+        value = i % 1000 == 999 ? t.op(BDIOperationType::ARITH_SUB, {value, value}, BDIType::INT64, false)
+                                : t.op(BDIOperationType::ARITH_INC, {value}, BDIType::INT64, false);
+    }
+    const NodeID zero = t.constant(BDIType::INT64, int64_t{0});
+    const NodeID positive = t.op(BDIOperationType::CMP_GE, {value, zero}, BDIType::BOOL, false);
+    const NodeID branch = t.op(BDIOperationType::CTRL_BRANCH_COND, {positive}, BDIType::UNKNOWN, true);
+    const NodeID end = t.op(BDIOperationType::META_END, {value}, BDIType::UNKNOWN, true);
+    t.graph.connectControl(branch, end); // False target: the same end
+    return t;
+ }
+ } // namespace
+ int main() {
+    NodeID start = 0;
+    TestGraph t = makeChain(start);
+    // Every 1000th node resets the chain, so the result counts the increments after the last reset
+    const int64_t expected = CHAIN_LENGTH % 1000 == 0 ? 0 : CHAIN_LENGTH % 1000;
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return bdi::tests::finish("FloatingChainTests");
+    BDIVirtualMachine vm;
+    vm.setJitThreshold(1);
+    BDI_CHECK(vm.execute(*compiled, start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int64_t>() == expected);
+    BatchExecutor batch;
+    BDI_CHECK(batch.execute(*compiled, start, 2, {}));
+    for (size_t lane = 0; lane < 2; ++lane) {
+        BDI_CHECK(batch.getReturnValue(lane) && batch.getReturnValue(lane)->as<int64_t>() == expected);
+    }
+    // Read by the branch and the end: lowered once, not once per reading block
+    auto program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(!program->requires_vm && program->code.size() < static_cast<size_t>(CHAIN_LENGTH) + 100);
+    ThreadedInterpreter threaded;
+    BDI_CHECK(threaded.execute(*program, start) && !threaded.ranOnFallback());
+    BDI_CHECK(threaded.getReturnValue() && threaded.getReturnValue()->as<int64_t>() == expected);
+    return bdi::tests::finish("FloatingChainTests");
+ }
@@ -0,0 +1,55 @@
+// File: bdi/core/graph/GraphArena.hpp
+ #ifndef BDI_CORE_GRAPH_GRAPHARENA_HPP
+ #define BDI_CORE_GRAPH_GRAPHARENA_HPP
+ #include <cstddef>
+ #include <cstdint>
+ #include <memory_resource>
+ namespace bdi::core::graph {
+ // Allocation counters of one graph
+ struct GraphAllocationStats {
+    uint64_t allocations = 0;      // Requests served by the arena (nodes, edge lists, map entries)
+    uint64_t bytes_allocated = 0;
+    uint64_t chunk_allocations = 0; // Blocks the arena took from the heap
+    uint64_t chunk_bytes = 0;
+ };
+ // Bump allocator owned by a BDIGraph. Nodes, their edge lists and the node index are carved out of
+ // large chunks; deallocate() is a no-op and everything is returned to the heap at once when the
+ // graph is destroyed. Memory of removed nodes and of outgrown edge lists is reclaimed only then.
+ // Not thread-safe (neither is graph editing).
+ class GraphArena : public std::pmr::memory_resource {
+ public:
+    static constexpr size_t INITIAL_CHUNK_SIZE = 64 * 1024;
+    GraphArena() : upstream_(this), bump_(INITIAL_CHUNK_SIZE, &upstream_) {}
+    GraphArena(const GraphArena&) = delete;
+    GraphArena& operator=(const GraphArena&) = delete;
+    const GraphAllocationStats& getStats() const { return stats_; }
+ private:
+    // Counts the chunk requests the bump resource sends to the heap
+    class ChunkCounter : public std::pmr::memory_resource {
+    public:
+        explicit ChunkCounter(GraphArena* owner) : owner_(owner) {}
+    private:
+        GraphArena* owner_;
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            ++owner_->stats_.chunk_allocations;
+            owner_->stats_.chunk_bytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+    GraphAllocationStats stats_;
+    ChunkCounter upstream_;
+    std::pmr::monotonic_buffer_resource bump_;
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++stats_.allocations;
+        stats_.bytes_allocated += bytes;
+        return bump_.allocate(bytes, alignment);
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+ };
+ } // namespace bdi::core::graph
+ #endif // BDI_CORE_GRAPH_GRAPHARENA_HPP
@@ -0,0 +1,60 @@
+// File: bdi/frontend/api/GraphBuilder.cpp
+ #include "GraphBuilder.hpp"
+ namespace bdi::frontend::api {
+ GraphBuilder::GraphBuilder(MetadataStore& metadata_store, const std::string& graph_name)
+    : metadata_store_(metadata_store), graph_(std::make_unique<BDIGraph>(graph_name)) {}
+ NodeID GraphBuilder::addNode(BDIOperationType op, const std::string& debug_name, std::optional<MetadataVariant> initial_metadata) {
+    if (!graph_) return 0;
+    const NodeID node_id = graph_->addNode(op);
+    // A debug name without other metadata is kept as a semantic tag
+    if (!initial_metadata && !debug_name.empty()) initial_metadata = SemanticTag{debug_name};
+    if (initial_metadata) setNodeMetadata(node_id, std::move(*initial_metadata));
+    return node_id;
+ }
+ bool GraphBuilder::setNodePayload(NodeID node_id, TypedPayload payload) {
+    BDINode* node = getNodeMutable(node_id);
+    if (!node) return false;
+    node->payload = std::move(payload);
+    return true;
+ }
+ bool GraphBuilder::defineDataOutput(NodeID node_id, PortIndex output_idx, BDIType type, const std::string& name) {
+    BDINode* node = getNodeMutable(node_id);
+    if (!node) return false;
+    if (node->data_outputs.size() <= output_idx) node->data_outputs.resize(output_idx + 1);
+    node->data_outputs[output_idx] = bdi::core::graph::PortInfo(type, name.empty() ? bdi::core::graph::InternedName() : bdi::core::graph::InternedName(name));
+    return true;
+ }
+ bool GraphBuilder::connectData(NodeID from_node_id, PortIndex from_port_idx, NodeID to_node_id, PortIndex to_input_idx) {
+    return graph_ && graph_->connectData(from_node_id, from_port_idx, to_node_id, to_input_idx);
+ }
+ bool GraphBuilder::connectControl(NodeID from_node_id, NodeID to_node_id) {
+    return graph_ && graph_->connectControl(from_node_id, to_node_id);
+ }
+ bool GraphBuilder::setNodeMetadata(NodeID node_id, MetadataVariant metadata) {
+    BDINode* node = getNodeMutable(node_id);
+    if (!node) return false;
+    // Same kind as the current entry: new version of it; otherwise a new entry
+    if (node->metadata_handle && metadata_store_.updateMetadata(node->metadata_handle, metadata)) return true;
+    node->metadata_handle = metadata_store_.addMetadata(std::move(metadata));
+    return true;
+ }
+ std::optional<MetadataHandle> GraphBuilder::getNodeMetadataHandle(NodeID node_id) {
+    BDINode* node = getNodeMutable(node_id);
+    if (!node || node->metadata_handle == 0) return std::nullopt;
+    return node->metadata_handle;
+ }
+ std::unique_ptr<BDIGraph> GraphBuilder::finalizeGraph() {
+    return std::move(graph_);
+ }
+ BDIGraph& GraphBuilder::getGraph() {
+    return *graph_;
+ }
+ const BDIGraph& GraphBuilder::getGraph() const {
+    return *graph_;
+ }
+ BDINode* GraphBuilder::getNodeMutable(NodeID node_id) {
+    if (!graph_) return nullptr;
+    auto node = graph_->getNode(node_id);
+    return node ? &node->get() : nullptr;
+ }
+ } // namespace bdi::frontend::api
@@ -34,6 +34,9 @@
     bool connectData(NodeID from_node_id, PortIndex from_port_idx, NodeID to_node_id, PortIndex to_input_idx);
     // Connect control flow: from_node -> to_node
     bool connectControl(NodeID from_node_id, NodeID to_node_id);
+    // Group many edits so the graph's consumer index is rebuilt once (see BDIGraph::beginEdit)
+    void beginEdit() { graph_->beginEdit(); }
+    void commitEdit() { graph_->commitEdit(); }
     // TODO: Add methods for metadata, region assignment, etc.
     // Finalize and retrieve the built graph
     // Transfers ownership of the graph to the caller
@@ -0,0 +1,102 @@
+// File: bdi/tests/GraphFormatTests.cpp
+ // Graph images and node streams: round trips, and rejection of opcodes outside BDIOperationType
+ #include "TestSupport.hpp"
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "../core/serialization/BinaryGraphFormat.hpp"
+ #include "../core/serialization/GraphImageFile.hpp"
+ #include "../core/serialization/GraphStream.hpp"
+ #include <cstring>
+ #include <filesystem>
+ #include <memory>
+ #include <sstream>
+ #include <unistd.h>
+ using namespace bdi::core::graph;
+ using namespace bdi::core::serialization;
+ using bdi::tests::TestGraph;
+ namespace {
+ TestGraph makeGraph() {
+    TestGraph t;
+    t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{20});
+    const NodeID b = t.constant(BDIType::INT32, int32_t{22});
+    const NodeID sum = t.op(BDIOperationType::ARITH_ADD, {a, b}, BDIType::INT32, true);
+    t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, true);
+    return t;
+ }
+ // Copy of 'image' in a buffer aligned for fromImage()
+ std::shared_ptr<std::byte> copyImage(std::span<const std::byte> image) {
+    std::shared_ptr<std::byte> copy(new (std::align_val_t{GRAPH_SECTION_ALIGNMENT}) std::byte[image.size()],
+                                    [](std::byte* p) { operator delete[](p, std::align_val_t{GRAPH_SECTION_ALIGNMENT}); });
+    std::memcpy(copy.get(), image.data(), image.size());
+    return copy;
+ }
+ void testImageOpcodes() {
+    TestGraph t = makeGraph();
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    const std::span<const std::byte> image = compiled->image();
+    BDI_CHECK(CompiledGraph::fromImage(copyImage(image), image.size(), true) != nullptr);
+    BDI_CHECK(CompiledGraph::fromImage(copyImage(image), image.size(), false) != nullptr);
+    // Unknown opcode in the first node: rejected with and without the full verification
+    std::shared_ptr<std::byte> corrupt = copyImage(image);
+    const auto& header = *reinterpret_cast<const GraphImageHeader*>(corrupt.get());
+    const uint64_t at = header.sections[static_cast<size_t>(GraphSection::OPERATIONS)].offset;
+    const auto bad = static_cast<std::underlying_type_t<BDIOperationType>>(BDIOperationType::OPERATION_TYPE_COUNT);
+    std::memcpy(corrupt.get() + at, &bad, sizeof(bad));
+    BDI_CHECK(CompiledGraph::fromImage(corrupt, image.size(), false) == nullptr);
+    BDI_CHECK(CompiledGraph::fromImage(corrupt, image.size(), true) == nullptr);
+ }
+ void testImageFile() {
+    TestGraph t = makeGraph();
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / ("bdi_graph_format_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    const std::string path = (dir / "graph.bdi").string();
+    // Saved twice: the second save replaces the first and leaves no temporary behind
+    BDI_CHECK(saveGraphImage(*compiled, path));
+    BDI_CHECK(saveGraphImage(*compiled, path));
+    BDI_CHECK(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 1);
+    auto loaded = loadGraphImage(path, true);
+    BDI_CHECK(loaded != nullptr);
+    if (loaded) {
+        const auto a = compiled->image();
+        const auto b = loaded->image();
+        BDI_CHECK(a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+    BDI_CHECK(!saveGraphImage(*compiled, (dir / "missing" / "graph.bdi").string()));
+    fs::remove_all(dir);
+ }
+ void testStreamOpcodes() {
+    TestGraph t = makeGraph();
+    std::stringstream good;
+    {
+        GraphStreamWriter writer(good, "good");
+        for (const auto& [id, node] : t.graph) writer.writeNode(*node);
+        BDI_CHECK(writer.finish());
+    }
+    GraphStreamReader reader(good);
+    size_t nodes = 0;
+    while (reader.next()) ++nodes;
+    BDI_CHECK(reader.isComplete() && nodes == t.graph.getNodeCount());
+    std::stringstream bad;
+    {
+        GraphStreamWriter writer(bad, "bad");
+        BDINode node(1, static_cast<BDIOperationType>(0x7777));
+        writer.writeNode(node);
+        writer.finish();
+    }
+    GraphStreamReader bad_reader(bad);
+    BDI_CHECK(bad_reader.next() == nullptr);
+    BDI_CHECK(!bad_reader.isComplete());
+ }
+ } // namespace
+ int main() {
+    testImageOpcodes();
+    testImageFile();
+    testStreamOpcodes();
+    return bdi::tests::finish("GraphFormatTests");
+ }
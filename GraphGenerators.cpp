@@ -0,0 +1,205 @@
+// File: bdi/benchmarks/GraphGenerators.cpp
+ #include "GraphGenerators.hpp"
+ #include "../frontend/api/GraphBuilder.hpp"
+ #include "../runtime/OperationSemantics.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ #include <algorithm>
+ #include <cstring>
+ #include <initializer_list>
+ #include <random>
+ #include <span>
+ namespace bdi::benchmarks {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::frontend::api::GraphBuilder;
+ using bdi::runtime::getScalarOperationArity;
+ using bdi::runtime::isScalarType;
+ using bdi::runtime::RuntimeValue;
+ using bdi::runtime::storeAs;
+ namespace {
+ using Op = BDIOperationType;
+ // Operations that cannot fail on any operand value (no division)
+ constexpr Op INTEGER_OPS[] = {Op::ARITH_ADD, Op::ARITH_SUB, Op::ARITH_MUL, Op::ARITH_NEG, Op::ARITH_INC,
+                               Op::BIT_AND, Op::BIT_OR, Op::BIT_XOR, Op::BIT_NOT, Op::BIT_SHL, Op::BIT_SHR,
+                               Op::BIT_ROL, Op::BIT_POPCOUNT, Op::ARITH_FMA};
+ constexpr Op FLOAT_OPS[] = {Op::ARITH_ADD, Op::ARITH_SUB, Op::ARITH_MUL, Op::ARITH_NEG, Op::ARITH_FMA};
+ std::span<const Op> operationsFor(BDIType type) {
+    if (type == BDIType::FLOAT32 || type == BDIType::FLOAT64) return FLOAT_OPS;
+    return INTEGER_OPS;
+ }
+ // GraphBuilder plus the control chain being extended
+ class Emitter {
+ public:
+    Emitter(bdi::meta::MetadataStore& store, const char* name) : builder_(store, name) {
+        entry_ = builder_.addNode(Op::META_START);
+        tail_ = entry_;
+    }
+    GraphBuilder& builder() { return builder_; }
+    NodeID entry() const { return entry_; }
+    // Append 'node' to the control chain
+    void chain(NodeID node) {
+        builder_.connectControl(tail_, node);
+        tail_ = node;
+    }
+    void setTail(NodeID node) { tail_ = node; }
+    // Floating constant (evaluated once per run)
+    NodeID constant(BDIType type, int64_t value) {
+        const NodeID node = builder_.addNode(Op::META_NOP);
+        const RuntimeValue payload = isScalarType(type) ? storeAs<int64_t>(type, value) : RuntimeValue::make<int64_t>(type, value);
+        builder_.setNodePayload(node, payload.toPayload());
+        builder_.defineDataOutput(node, 0, type);
+        return node;
+    }
+    // Scalar operation on 'inputs'; operands beyond them come from 'immediate'
+    NodeID operation(Op op, BDIType type, std::initializer_list<NodeID> inputs, int64_t immediate = 1) {
+        return operation(op, type, std::span<const NodeID>(inputs.begin(), inputs.size()), immediate);
+    }
+    NodeID operation(Op op, BDIType type, std::span<const NodeID> inputs, int64_t immediate = 1) {
+        const NodeID node = builder_.addNode(op);
+        builder_.defineDataOutput(node, 0, type);
+        for (size_t k = 0; k < inputs.size(); ++k) builder_.connectData(inputs[k], 0, node, static_cast<uint32_t>(k));
+        if (inputs.size() < getScalarOperationArity(op)) builder_.setNodePayload(node, storeAs<int64_t>(type, immediate).toPayload());
+        return node;
+    }
+    // META_END returning 'value'
+    void finish(NodeID value) {
+        const NodeID end = builder_.addNode(Op::META_END);
+        builder_.connectData(value, 0, end, 0);
+        chain(end);
+    }
+    GeneratedGraph release() {
+        GeneratedGraph generated;
+        generated.graph = builder_.finalizeGraph();
+        generated.entry = entry_;
+        return generated;
+    }
+ private:
+    GraphBuilder builder_;
+    NodeID entry_ = 0;
+    NodeID tail_ = 0;
+ };
+ } // namespace
+ GeneratedGraph generateChain(bdi::meta::MetadataStore& store, const ChainOptions& options) {
+    Emitter emit(store, "chain");
+    std::span<const Op> ops = operationsFor(options.type);
+    NodeID value = emit.constant(options.type, 3);
+    for (size_t i = 0; i < options.length; ++i) {
+        const Op op = ops[i % ops.size()];
+        value = emit.operation(op, options.type, {value}, static_cast<int64_t>(i % 7 + 1));
+        emit.chain(value);
+    }
+    emit.finish(value);
+    return emit.release();
+ }
+ GeneratedGraph generateWideDag(bdi::meta::MetadataStore& store, const WideDagOptions& options) {
+    Emitter emit(store, "wide_dag");
+    std::mt19937_64 rng(options.seed);
+    std::span<const Op> ops = operationsFor(options.type);
+    const size_t width = std::max<size_t>(options.width, 1);
+    std::vector<NodeID> layer(width), next(width);
+    for (size_t i = 0; i < width; ++i) layer[i] = emit.constant(options.type, static_cast<int64_t>(i % 13) + 1);
+    for (size_t d = 0; d < options.depth; ++d) {
+        for (size_t i = 0; i < width; ++i) {
+            const Op op = ops[rng() % ops.size()];
+            const NodeID inputs[] = {layer[rng() % width], layer[rng() % width]};
+            next[i] = emit.operation(op, options.type, std::span<const NodeID>(inputs, std::min<size_t>(2, getScalarOperationArity(op))));
+            emit.chain(next[i]);
+        }
+        std::swap(layer, next);
+    }
+    emit.finish(layer[0]);
+    return emit.release();
+ }
+ GeneratedGraph generateRandomDag(bdi::meta::MetadataStore& store, const RandomDagOptions& options) {
+    Emitter emit(store, "random_dag");
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::span<const Op> ops = operationsFor(options.type);
+    std::vector<NodeID> values;
+    for (int64_t i = 0; i < 8; ++i) values.push_back(emit.constant(options.type, i * 5 - 7));
+    const size_t window = std::max<size_t>(options.window, 1);
+    NodeID inputs[3];
+    for (size_t i = 0; i < options.nodes; ++i) {
+        const Op op = ops[rng() % ops.size()];
+        const size_t fan_in = std::min({getScalarOperationArity(op), std::max<size_t>(options.max_fan_in, 1),
+                                        static_cast<size_t>(1 + rng() % 3)});
+        for (size_t k = 0; k < fan_in; ++k) inputs[k] = values[values.size() - 1 - rng() % std::min(window, values.size())];
+        const NodeID node = emit.operation(op, options.type, std::span<const NodeID>(inputs, fan_in),
+                                           static_cast<int64_t>(rng() % 31));
+        if (unit(rng) >= options.floating_fraction) emit.chain(node);
+        values.push_back(node);
+    }
+    emit.finish(values.back());
+    return emit.release();
+ }
+ GeneratedGraph generateLoopCfg(bdi::meta::MetadataStore& store, const LoopCfgOptions& options) {
+    Emitter emit(store, "loop_cfg");
+    GraphBuilder& builder = emit.builder();
+    std::mt19937_64 rng(options.seed);
+    std::span<const Op> ops = operationsFor(options.type);
+    const size_t blocks = std::max<size_t>(options.blocks, 1);
+    std::vector<NodeID> pool;
+    for (int64_t i = 0; i < 4; ++i) pool.push_back(emit.constant(options.type, i * 3 + 1));
+    // Block heads first, so branches can target any block
+    std::vector<NodeID> heads(blocks);
+    for (NodeID& head : heads) head = builder.addNode(Op::CTRL_JUMP);
+    emit.chain(heads[0]);
+    for (size_t b = 0; b < blocks; ++b) {
+        emit.setTail(heads[b]);
+        NodeID value = pool[rng() % pool.size()];
+        for (size_t i = 0; i < options.block_size; ++i) {
+            const Op op = ops[rng() % ops.size()];
+            const NodeID inputs[] = {value, pool[rng() % pool.size()]};
+            value = emit.operation(op, options.type, std::span<const NodeID>(inputs, std::min<size_t>(2, getScalarOperationArity(op))),
+                                   static_cast<int64_t>(rng() % 5 + 1));
+            emit.chain(value);
+        }
+        if (b + 1 == blocks) {
+            emit.chain(heads[0]);
+            break;
+        }
+        // Loop back to an earlier block or fall through to the next one
+        const NodeID bound = emit.constant(options.type, static_cast<int64_t>(rng() % 64));
+        const NodeID condition = emit.operation(Op::CMP_LT, BDIType::BOOL, {value, bound});
+        emit.chain(condition);
+        const NodeID branch = builder.addNode(Op::CTRL_BRANCH_COND);
+        builder.connectData(condition, 0, branch, 0);
+        emit.chain(branch);
+        builder.connectControl(branch, heads[b + 1]);
+        builder.connectControl(branch, heads[rng() % (b + 1)]);
+    }
+    GeneratedGraph generated = emit.release();
+    generated.max_steps = options.max_steps;
+    return generated;
+ }
+ GeneratedGraph generateVectorGraph(bdi::meta::MetadataStore& store, const VectorGraphOptions& options) {
+    Emitter emit(store, "vector_graph");
+    GraphBuilder& builder = emit.builder();
+    std::mt19937_64 rng(options.seed);
+    const size_t buffer_count = std::max<size_t>(options.buffers, 3);
+    const size_t bytes = options.elements * getBdiTypeSize(options.element_type);
+    auto memory = std::make_unique<bdi::runtime::memory::MemoryManager>();
+    std::vector<NodeID> pointers;
+    for (size_t i = 0; i < buffer_count; ++i) {
+        void* buffer = memory->allocate(0, std::max<size_t>(bytes, 1), 64);
+        if (buffer) std::memset(buffer, 0, bytes); // Zero: valid for every element type
+        pointers.push_back(emit.constant(BDIType::POINTER, static_cast<int64_t>(reinterpret_cast<uintptr_t>(buffer))));
+    }
+    const NodeID count = emit.constant(BDIType::UINT64, static_cast<int64_t>(options.elements));
+    for (size_t i = 0; i < options.nodes; ++i) {
+        // [dst, lhs, rhs, count]; the payload names the element type
+        const NodeID node = builder.addNode(rng() % 2 ? Op::VEC_ADD : Op::VEC_MUL);
+        builder.setNodePayload(node, bdi::core::payload::TypedPayload(options.element_type, bdi::core::types::BinaryData{}));
+        builder.defineDataOutput(node, 0, BDIType::POINTER, "dst");
+        builder.connectData(pointers[(i + 2) % buffer_count], 0, node, 0);
+        builder.connectData(pointers[i % buffer_count], 0, node, 1);
+        builder.connectData(pointers[(i + 1) % buffer_count], 0, node, 2);
+        builder.connectData(count, 0, node, 3);
+        emit.chain(node);
+    }
+    const NodeID end = builder.addNode(Op::META_END);
+    emit.chain(end);
+    GeneratedGraph generated = emit.release();
+    generated.memory = std::move(memory);
+    return generated;
+ }
+ } // namespace bdi::benchmarks
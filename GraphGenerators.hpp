@@ -0,0 +1,72 @@
+// File: bdi/benchmarks/GraphGenerators.hpp
+ #ifndef BDI_BENCHMARKS_GRAPHGENERATORS_HPP
+ #define BDI_BENCHMARKS_GRAPHGENERATORS_HPP
+ #include "../core/graph/BDIGraph.hpp"
+ #include "../meta/MetadataStore.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <memory>
+ #include <vector>
+ namespace bdi::benchmarks {
+ using bdi::core::graph::BDIGraph;
+ using bdi::core::graph::NodeID;
+ using bdi::core::types::BDIType;
+ // Synthetic graphs for benchmarking, built through GraphBuilder. Every generator is deterministic for a
+ // given seed, and every graph runs on BDIVirtualMachine from 'entry'.
+ struct GeneratedGraph {
+    std::unique_ptr<BDIGraph> graph;
+    NodeID entry = 0;
+    // Step limit for execute(); 0 = none. Loop CFGs never exit (the IR has no loop-carried values yet)
+    // and run until they reach it.
+    uint64_t max_steps = 0;
+    // Blocks the graph's POINTER constants refer to (nullptr if none): set it on the engine, and keep it
+    // alive as long as the graph runs
+    std::unique_ptr<bdi::runtime::memory::MemoryManager> memory;
+ };
+ // One long dependency chain: every operation reads the previous one (no parallelism, no reuse)
+ struct ChainOptions {
+    size_t length = 10000;
+    BDIType type = BDIType::INT64;
+ };
+ // 'depth' layers of 'width' operations, each reading two random nodes of the layer above
+ struct WideDagOptions {
+    size_t width = 1000;
+    size_t depth = 10;
+    BDIType type = BDIType::INT64;
+    uint64_t seed = 1;
+ };
+ // Random operations reading up to 'max_fan_in' of the 'window' most recent values. A fraction are
+ // floating (no control edges, evaluated on demand).
+ struct RandomDagOptions {
+    size_t nodes = 10000;
+    size_t max_fan_in = 3;
+    size_t window = 64;
+    double floating_fraction = 0.25;
+    BDIType type = BDIType::INT64;
+    uint64_t seed = 1;
+ };
+ // Basic blocks of 'block_size' operations ending in a conditional branch to the next block or back to
+ // a random earlier one; the last block jumps back to the first
+ struct LoopCfgOptions {
+    size_t blocks = 64;
+    size_t block_size = 8;
+    uint64_t max_steps = 1000000;
+    BDIType type = BDIType::INT32;
+    uint64_t seed = 1;
+ };
+ // VEC_ADD / VEC_MUL kernel nodes over 'buffers' MemoryManager blocks of 'elements' elements each
+ struct VectorGraphOptions {
+    size_t nodes = 1000;
+    size_t elements = 4096;
+    size_t buffers = 8;
+    BDIType element_type = BDIType::FLOAT32;
+    uint64_t seed = 1;
+ };
+ GeneratedGraph generateChain(bdi::meta::MetadataStore& store, const ChainOptions& options);
+ GeneratedGraph generateWideDag(bdi::meta::MetadataStore& store, const WideDagOptions& options);
+ GeneratedGraph generateRandomDag(bdi::meta::MetadataStore& store, const RandomDagOptions& options);
+ GeneratedGraph generateLoopCfg(bdi::meta::MetadataStore& store, const LoopCfgOptions& options);
+ GeneratedGraph generateVectorGraph(bdi::meta::MetadataStore& store, const VectorGraphOptions& options);
+ } // namespace bdi::benchmarks
+ #endif // BDI_BENCHMARKS_GRAPHGENERATORS_HPP
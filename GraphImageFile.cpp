@@ -0,0 +1,98 @@
+// File: bdi/core/serialization/GraphImageFile.cpp
+ #include "GraphImageFile.hpp"
+ #include <cerrno>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <fstream>
+ #if defined(__unix__) || defined(__APPLE__)
+ #define BDI_HAS_MMAP 1
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #endif
+ namespace bdi::core::serialization {
+ #ifdef BDI_HAS_MMAP
+ namespace {
+ bool writeAll(int fd, std::span<const std::byte> bytes) {
+    while (!bytes.empty()) {
+        const ssize_t written = ::write(fd, bytes.data(), bytes.size());
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes = bytes.subspan(static_cast<size_t>(written));
+    }
+    return true;
+ }
+ // Flush the directory entry of a rename; filesystems that cannot fsync a directory do not need to
+ bool syncDirectory(const std::string& dir) {
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0 || errno == EINVAL;
+    ::close(fd);
+    return ok;
+ }
+ } // namespace
+ #endif
+ bool saveGraphImage(const CompiledGraph& graph, const std::string& path) {
+ #ifdef BDI_HAS_MMAP
+    // Unique temporary in the target directory (same filesystem, so the rename is atomic), made
+    // durable before it replaces 'path'; the directory is synced so the rename survives a crash too
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    std::string tmp = path + ".XXXXXX";
+    const int fd = ::mkstemp(tmp.data());
+    if (fd < 0) return false;
+    // mkstemp creates the file 0600; images are mapped by other processes, so give it the usual mode
+    bool ok = ::fchmod(fd, 0644) == 0 && writeAll(fd, graph.image()) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return syncDirectory(dir);
+ #else
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out || !graph.writeImage(out)) return false;
+        out.flush();
+        if (!out) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+ #endif
+ }
+ namespace {
+ std::shared_ptr<const std::byte> readWholeFile(const std::string& path, size_t& size) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return nullptr;
+    size = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+    std::shared_ptr<std::byte[]> buffer(new std::byte[size]);
+    if (!in.read(reinterpret_cast<char*>(buffer.get()), static_cast<std::streamsize>(size))) return nullptr;
+    return std::shared_ptr<const std::byte>(buffer, buffer.get());
+ }
+ } // namespace
+ std::shared_ptr<const CompiledGraph> loadGraphImage(const std::string& path, bool verify) {
+    size_t size = 0;
+    std::shared_ptr<const std::byte> image;
+ #ifdef BDI_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = static_cast<size_t>(st.st_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // A full verify reads the image front to back
+            if (verify) ::madvise(addr, size, MADV_SEQUENTIAL);
+            image = std::shared_ptr<const std::byte>(static_cast<const std::byte*>(addr),
+                                                     [size](const std::byte* p) { ::munmap(const_cast<std::byte*>(p), size); });
+        }
+    }
+    ::close(fd); // The mapping keeps its own reference to the file
+ #endif
+    if (!image) image = readWholeFile(path, size);
+    if (!image) return nullptr;
+    return CompiledGraph::fromImage(std::move(image), size, verify);
+ }
+ } // namespace bdi::core::serialization
@@ -0,0 +1,18 @@
+// File: bdi/core/serialization/GraphImageFile.hpp
+ #ifndef BDI_CORE_SERIALIZATION_GRAPHIMAGEFILE_HPP
+ #define BDI_CORE_SERIALIZATION_GRAPHIMAGEFILE_HPP
+ #include "../graph/CompiledGraph.hpp"
+ #include <memory>
+ #include <string>
+ namespace bdi::core::serialization {
+ using bdi::core::graph::CompiledGraph;
+ // Write the image of a compiled graph to 'path': a temporary in the same directory is synced, renamed
+ // over it and the directory synced, so a crash leaves the old or the new image, never a torn one
+ bool saveGraphImage(const CompiledGraph& graph, const std::string& path);
+ // Map an image file read-only and execute it in place: no per-node allocation, pages are faulted in
+ // on first touch and shared between processes mapping the same file. The mapping lives as long as the
+ // returned graph. Falls back to reading the file into memory where mmap is unavailable.
+ // See CompiledGraph::fromImage for 'verify'.
+ std::shared_ptr<const CompiledGraph> loadGraphImage(const std::string& path, bool verify = true);
+ } // namespace bdi::core::serialization
+ #endif // BDI_CORE_SERIALIZATION_GRAPHIMAGEFILE_HPP
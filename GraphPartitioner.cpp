@@ -0,0 +1,332 @@
+// File: bdi/runtime/distributed/GraphPartitioner.cpp
+ #include "GraphPartitioner.hpp"
+ #include "../RuntimeValue.hpp"
+ #include <algorithm>
+ #include <cmath>
+ #include <map>
+ #include <memory>
+ #include <set>
+ #include <tuple>
+ #include <unordered_set>
+ namespace bdi::runtime::distributed {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::PortRef;
+ namespace {
+ enum class Placement : uint8_t { FLOATING, REPLICATED, OWNED };
+ bool isReplicatedOperation(BDIOperationType op) {
+    return op == BDIOperationType::META_START || op == BDIOperationType::CONCURRENCY_JOIN ||
+           bdi::core::graph::getOperationSignature(op).has(bdi::core::graph::OP_CONTROL);
+ }
+ bool isReturn(BDIOperationType op) {
+    return op == BDIOperationType::META_END || op == BDIOperationType::CTRL_RETURN;
+ }
+ struct Analysis {
+    std::unordered_map<NodeID, const BDINode*> nodes;
+    std::unordered_map<NodeID, Placement> placement;
+    std::vector<NodeID> owned; // In control order from the entry, then unreachable ones by ID
+    std::vector<NodeID> sorted_ids;
+ };
+ Analysis analyze(const BDIGraph& graph, NodeID entry) {
+    Analysis a;
+    for (const auto& [id, node] : graph) {
+        a.nodes.emplace(id, node.get());
+        a.sorted_ids.push_back(id);
+    }
+    std::sort(a.sorted_ids.begin(), a.sorted_ids.end());
+    for (NodeID id : a.sorted_ids) {
+        const BDINode& node = *a.nodes[id];
+        const bool positioned = id == entry || !node.control_inputs.empty() || !node.control_outputs.empty();
+        a.placement[id] = !positioned ? Placement::FLOATING
+                          : isReplicatedOperation(node.operation) ? Placement::REPLICATED : Placement::OWNED;
+    }
+    // Control order: depth first from the entry, successors in order
+    std::unordered_set<NodeID> seen;
+    std::vector<NodeID> stack{entry};
+    while (!stack.empty()) {
+        const NodeID id = stack.back();
+        stack.pop_back();
+        if (!a.nodes.count(id) || !seen.insert(id).second) continue;
+        if (a.placement[id] == Placement::OWNED) a.owned.push_back(id);
+        const auto& successors = a.nodes[id]->control_outputs;
+        for (auto it = successors.rbegin(); it != successors.rend(); ++it) stack.push_back(*it);
+    }
+    for (NodeID id : a.sorted_ids) {
+        if (a.placement[id] == Placement::OWNED && !seen.count(id)) a.owned.push_back(id);
+    }
+    return a;
+ }
+ // Owned producers an owned node reads, directly or through floating nodes
+ std::vector<NodeID> ownedSources(const Analysis& a, NodeID id,
+                                  std::unordered_map<NodeID, std::vector<NodeID>>& floating_memo) {
+    std::set<NodeID> out;
+    for (const PortRef& ref : a.nodes.at(id)->data_inputs) {
+        if (ref.node_id == 0 || !a.nodes.count(ref.node_id)) continue;
+        const Placement placement = a.placement.at(ref.node_id);
+        if (placement == Placement::OWNED) {
+            out.insert(ref.node_id);
+        } else if (placement == Placement::FLOATING) {
+            auto it = floating_memo.find(ref.node_id);
+            if (it == floating_memo.end()) {
+                floating_memo[ref.node_id] = {}; // Breaks cycles among floating nodes
+                auto sources = ownedSources(a, ref.node_id, floating_memo);
+                it = floating_memo.insert_or_assign(ref.node_id, std::move(sources)).first;
+            }
+            out.insert(it->second.begin(), it->second.end());
+        }
+    }
+    return {out.begin(), out.end()};
+ }
+ // Contiguous blocks of the control order, then greedy moves of single nodes towards the partition most
+ // of their neighbours are in, as long as that cuts edges and keeps the sizes within bounds
+ void assignMinCut(const Analysis& a, size_t k, const PartitionOptions& options,
+                   std::unordered_map<NodeID, uint32_t>& owner) {
+    const size_t n = a.owned.size();
+    std::unordered_map<NodeID, size_t> index;
+    for (size_t i = 0; i < n; ++i) index[a.owned[i]] = i;
+    std::vector<std::vector<size_t>> neighbours(n);
+    std::unordered_map<NodeID, std::vector<NodeID>> floating_memo;
+    for (size_t i = 0; i < n; ++i) {
+        for (NodeID source : ownedSources(a, a.owned[i], floating_memo)) {
+            const size_t j = index[source];
+            if (j == i) continue;
+            neighbours[i].push_back(j);
+            neighbours[j].push_back(i);
+        }
+    }
+    std::vector<uint32_t> part(n);
+    std::vector<size_t> size(k, 0);
+    for (size_t i = 0; i < n; ++i) {
+        part[i] = static_cast<uint32_t>(i * k / n);
+        ++size[part[i]];
+    }
+    const size_t max_size = std::max<size_t>(1, static_cast<size_t>(std::ceil(static_cast<double>(n) / static_cast<double>(k) * (1.0 + options.imbalance))));
+    std::vector<size_t> links(k);
+    for (size_t pass = 0; pass < options.refinement_passes; ++pass) {
+        bool moved = false;
+        for (size_t i = 0; i < n; ++i) {
+            std::fill(links.begin(), links.end(), 0);
+            for (size_t j : neighbours[i]) ++links[part[j]];
+            const uint32_t from = part[i];
+            uint32_t best = from;
+            for (uint32_t p = 0; p < k; ++p) {
+                if (p != from && size[p] < max_size && links[p] > links[best]) best = p;
+            }
+            if (best == from || size[from] == 1) continue;
+            --size[from];
+            ++size[best];
+            part[i] = best;
+            moved = true;
+        }
+        if (!moved) break;
+    }
+    for (size_t i = 0; i < n; ++i) owner[a.owned[i]] = part[i];
+ }
+ } // namespace
+ std::optional<PartitionPlan> partitionGraph(const BDIGraph& graph, NodeID entry_node_id, const PartitionOptions& options) {
+    if (!graph.getNode(entry_node_id)) return std::nullopt;
+    if (options.strategy == PartitionStrategy::MIN_CUT && options.partition_count == 0) return std::nullopt;
+    const Analysis a = analyze(graph, entry_node_id);
+    PartitionPlan plan;
+    // --- Assignment --
+    size_t partition_count = 1;
+    std::vector<std::vector<RegionID>> partition_regions(1);
+    if (options.strategy == PartitionStrategy::BY_REGION) {
+        std::map<RegionID, uint32_t> regions;
+        for (NodeID id : a.owned) regions.emplace(a.nodes.at(id)->region_id, 0);
+        if (!regions.empty()) {
+            partition_count = regions.size();
+            partition_regions.assign(partition_count, {});
+            uint32_t next = 0;
+            for (auto& [region, p] : regions) {
+                p = next++;
+                partition_regions[p].push_back(region);
+            }
+        }
+        for (NodeID id : a.owned) plan.owner[id] = regions[a.nodes.at(id)->region_id];
+    } else {
+        partition_count = std::max<size_t>(1, std::min(options.partition_count, a.owned.size()));
+        partition_regions.assign(partition_count, {});
+        if (!a.owned.empty()) assignMinCut(a, partition_count, options, plan.owner);
+    }
+    auto ownerOf = [&](NodeID id) -> std::optional<uint32_t> { return plan.getOwner(id); };
+    // --- Boundaries and Floating Copies --
+    // Per partition: floating nodes it needs; globally: one channel per (producer, port, consumer partition)
+    std::vector<std::unordered_set<NodeID>> floating(partition_count);
+    std::map<std::tuple<NodeID, PortIndex, uint32_t>, size_t> channel_index;
+    for (uint32_t p = 0; p < partition_count; ++p) {
+        std::vector<NodeID> stack;
+        auto need = [&](NodeID consumer) {
+            for (const PortRef& ref : a.nodes.at(consumer)->data_inputs) {
+                if (ref.node_id == 0 || !a.nodes.count(ref.node_id)) continue;
+                const Placement placement = a.placement.at(ref.node_id);
+                if (placement == Placement::FLOATING) {
+                    if (floating[p].insert(ref.node_id).second) stack.push_back(ref.node_id);
+                } else if (placement == Placement::OWNED && *ownerOf(ref.node_id) != p) {
+                    const auto key = std::make_tuple(ref.node_id, ref.port_index, p);
+                    if (channel_index.emplace(key, plan.channels.size()).second) {
+                        BoundaryChannel channel;
+                        channel.id = plan.channels.size() + 1;
+                        channel.producer = ref.node_id;
+                        channel.port = ref.port_index;
+                        channel.type = a.nodes.at(ref.node_id)->getOutputType(ref.port_index);
+                        channel.from = *ownerOf(ref.node_id);
+                        channel.to = p;
+                        plan.channels.push_back(channel);
+                    }
+                }
+            }
+        };
+        for (NodeID id : a.sorted_ids) {
+            const Placement placement = a.placement.at(id);
+            if (placement == Placement::FLOATING) continue;
+            if (placement == Placement::OWNED && *ownerOf(id) != p) continue;
+            // A return value computed elsewhere is not shipped around: that partition reports it
+            if (isReturn(a.nodes.at(id)->operation)) {
+                const auto& inputs = a.nodes.at(id)->data_inputs;
+                if (!inputs.empty() && ownerOf(inputs[0].node_id).value_or(p) != p) continue;
+            }
+            need(id);
+        }
+        while (!stack.empty()) {
+            const NodeID id = stack.back();
+            stack.pop_back();
+            need(id);
+        }
+    }
+    // --- Generated Node IDs --
+    NodeID next_id = a.sorted_ids.empty() ? 1 : a.sorted_ids.back() + 1;
+    std::unordered_map<NodeID, std::vector<size_t>> sends_after; // Producer -> its channels
+    std::vector<std::unordered_map<NodeID, std::vector<size_t>>> recvs_at(partition_count);
+    for (size_t c = 0; c < plan.channels.size(); ++c) {
+        BoundaryChannel& channel = plan.channels[c];
+        channel.send_node = next_id++;
+        channel.recv_node = next_id++;
+        sends_after[channel.producer].push_back(c);
+        recvs_at[channel.to][channel.producer].push_back(c);
+    }
+    auto channelPayload = [](BoundaryChannelID id) { return RuntimeValue::make(BDIType::UINT64, id).toPayload(); };
+    // --- Partition Graphs --
+    for (uint32_t p = 0; p < partition_count; ++p) {
+        auto kept = [&](NodeID id) {
+            const Placement placement = a.placement.at(id);
+            return placement == Placement::REPLICATED || (placement == Placement::OWNED && *ownerOf(id) == p) ||
+                   (placement == Placement::FLOATING && floating[p].count(id));
+        };
+        // Where control arriving at 'id' goes in this partition: the node itself, the receives standing in
+        // for a node of another partition, or (for nodes with neither) on to its successor. 0: the path ends.
+        std::unordered_map<NodeID, NodeID> resolved;
+        auto resolve = [&](NodeID id) {
+            std::vector<NodeID> chain;
+            NodeID target = 0;
+            while (id != 0 && a.nodes.count(id)) {
+                if (auto it = resolved.find(id); it != resolved.end()) {
+                    target = it->second;
+                    break;
+                }
+                if (kept(id)) {
+                    target = id;
+                    break;
+                }
+                auto recvs = recvs_at[p].find(id);
+                if (recvs != recvs_at[p].end()) {
+                    target = plan.channels[recvs->second.front()].recv_node;
+                    break;
+                }
+                if (std::find(chain.begin(), chain.end(), id) != chain.end()) break; // Loop without a kept node
+                chain.push_back(id);
+                const auto& successors = a.nodes.at(id)->control_outputs;
+                id = successors.empty() ? 0 : successors[0];
+            }
+            for (NodeID skipped : chain) resolved[skipped] = target;
+            return target;
+        };
+        BDIGraph part(graph.getName() + "/" + std::to_string(p));
+        std::vector<std::unique_ptr<BDINode>> nodes;
+        auto rewriteInputs = [&](const BDINode& from, BDINode& to) {
+            for (const PortRef& ref : from.data_inputs) {
+                const auto source_owner = ref.node_id ? ownerOf(ref.node_id) : std::nullopt;
+                if (source_owner && *source_owner != p) {
+                    const size_t c = channel_index.at(std::make_tuple(ref.node_id, ref.port_index, p));
+                    to.data_inputs.push_back(PortRef{plan.channels[c].recv_node, 0});
+                } else {
+                    to.data_inputs.push_back(ref);
+                }
+            }
+        };
+        std::vector<NodeID> terminals; // Branch targets whose path ends in this partition
+        for (NodeID id : a.sorted_ids) {
+            if (!kept(id)) continue;
+            const BDINode& source = *a.nodes.at(id);
+            auto node = std::make_unique<BDINode>(id, source.operation);
+            node->data_outputs.assign(source.data_outputs.begin(), source.data_outputs.end());
+            node->payload = source.payload;
+            node->metadata_handle = source.metadata_handle;
+            node->region_id = source.region_id;
+            const bool remote_return = isReturn(source.operation) && !source.data_inputs.empty() &&
+                                       ownerOf(source.data_inputs[0].node_id).value_or(p) != p;
+            if (!remote_return) rewriteInputs(source, *node);
+            // Control continues through the sends of this node's values, then to the resolved successors
+            BDINode* tail = node.get();
+            if (auto sends = sends_after.find(id); sends != sends_after.end()) {
+                for (size_t c : sends->second) {
+                    const BoundaryChannel& channel = plan.channels[c];
+                    auto send = std::make_unique<BDINode>(channel.send_node, BDIOperationType::COMM_CHANNEL_SEND);
+                    send->payload = channelPayload(channel.id);
+                    send->data_inputs.push_back(PortRef{0, 0});
+                    send->data_inputs.push_back(PortRef{channel.producer, channel.port});
+                    send->region_id = source.region_id;
+                    tail->control_outputs.push_back(send->id);
+                    tail = send.get();
+                    nodes.push_back(std::move(send));
+                }
+            }
+            const bool multiway = source.control_outputs.size() > 1;
+            for (NodeID successor : source.control_outputs) {
+                NodeID target = resolve(successor);
+                if (target == 0 && multiway) {
+                    // Keep the successor's position: a terminal node ends the path like the original did
+                    target = next_id++;
+                    terminals.push_back(target);
+                }
+                if (target != 0) tail->control_outputs.push_back(target);
+            }
+            nodes.push_back(std::move(node));
+        }
+        // Receives, in place of the producers of other partitions
+        for (const auto& [producer, channels] : recvs_at[p]) {
+            const BDINode& source = *a.nodes.at(producer);
+            for (size_t k = 0; k < channels.size(); ++k) {
+                const BoundaryChannel& channel = plan.channels[channels[k]];
+                if (channel.port >= source.data_outputs.size()) return std::nullopt; // Read of a port the producer lacks
+                auto recv = std::make_unique<BDINode>(channel.recv_node, BDIOperationType::COMM_CHANNEL_RECV);
+                recv->payload = channelPayload(channel.id);
+                recv->data_inputs.push_back(PortRef{0, 0});
+                recv->data_outputs.push_back(source.data_outputs[channel.port]);
+                recv->region_id = source.region_id;
+                if (k + 1 < channels.size()) {
+                    recv->control_outputs.push_back(plan.channels[channels[k + 1]].recv_node);
+                } else if (!source.control_outputs.empty()) {
+                    if (NodeID target = resolve(source.control_outputs[0])) recv->control_outputs.push_back(target);
+                }
+                nodes.push_back(std::move(recv));
+            }
+        }
+        for (NodeID id : terminals) nodes.push_back(std::make_unique<BDINode>(id, BDIOperationType::META_COMMENT));
+        // Control inputs mirror the outputs
+        std::unordered_map<NodeID, BDINode*> by_id;
+        for (auto& node : nodes) by_id[node->id] = node.get();
+        for (auto& node : nodes) {
+            for (NodeID successor : node->control_outputs) by_id.at(successor)->control_inputs.push_back(node->id);
+        }
+        part.beginEdit();
+        for (auto& node : nodes) part.addNode(std::move(node));
+        part.commitEdit();
+        GraphPartition partition(std::move(part));
+        partition.entry = resolve(entry_node_id);
+        partition.regions = partition_regions[p];
+        plan.partitions.push_back(std::move(partition));
+    }
+    for (const auto& [id, p] : plan.owner) ++plan.partitions[p].owned_nodes;
+    return plan;
+ }
+ } // namespace bdi::runtime::distributed
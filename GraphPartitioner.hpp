@@ -0,0 +1,74 @@
+// File: bdi/runtime/distributed/GraphPartitioner.hpp
+ #ifndef BDI_RUNTIME_DISTRIBUTED_GRAPHPARTITIONER_HPP
+ #define BDI_RUNTIME_DISTRIBUTED_GRAPHPARTITIONER_HPP
+ #include "../../core/graph/BDIGraph.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <optional>
+ #include <unordered_map>
+ #include <vector>
+ namespace bdi::runtime::distributed {
+ using bdi::core::graph::BDIGraph;
+ using bdi::core::graph::BDINode;
+ using bdi::core::graph::BDIType;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::PortIndex;
+ using bdi::core::graph::RegionID;
+ // Channel between two partitions, as carried by the generated COMM_CHANNEL_* nodes (payload immediate)
+ using BoundaryChannelID = uint64_t;
+ enum class PartitionStrategy : uint8_t {
+    BY_REGION, // One partition per region_id among the partitioned nodes, in ascending order
+    MIN_CUT    // 'partition_count' partitions of balanced size with few values crossing between them
+ };
+ struct PartitionOptions {
+    PartitionStrategy strategy = PartitionStrategy::BY_REGION;
+    size_t partition_count = 2;   // MIN_CUT
+    double imbalance = 0.1;       // MIN_CUT: a partition may hold this share more than the average
+    size_t refinement_passes = 8; // MIN_CUT: greedy boundary moves after the initial split
+ };
+ // Output 'port' of 'producer', computed in partition 'from' and needed in partition 'to'
+ struct BoundaryChannel {
+    BoundaryChannelID id = 0; // channels[i].id == i + 1
+    NodeID producer = 0;
+    PortIndex port = 0;
+    BDIType type = BDIType::UNKNOWN;
+    uint32_t from = 0;
+    uint32_t to = 0;
+    NodeID send_node = 0; // Generated COMM_CHANNEL_SEND in 'from', right after the producer
+    NodeID recv_node = 0; // Generated COMM_CHANNEL_RECV in 'to', where the producer would have run
+ };
+ struct GraphPartition {
+    BDIGraph graph;
+    NodeID entry = 0;              // 0: no node of the partition is reachable; nothing to run
+    std::vector<RegionID> regions; // BY_REGION: the region it holds
+    size_t owned_nodes = 0;
+    explicit GraphPartition(BDIGraph g) : graph(std::move(g)) {}
+ };
+ struct PartitionPlan {
+    std::vector<GraphPartition> partitions;
+    std::vector<BoundaryChannel> channels;
+    // Partition of every node that runs in exactly one partition (see partitionGraph)
+    std::unordered_map<NodeID, uint32_t> owner;
+    std::optional<uint32_t> getOwner(NodeID node_id) const {
+        auto it = owner.find(node_id);
+        return it == owner.end() ? std::nullopt : std::optional<uint32_t>(it->second);
+    }
+ };
+ // Splits 'graph' (run from 'entry_node_id') into subgraphs that run side by side, one per process
+ // (PartitionCoordinator), and together do what the original run does:
+ //  - Nodes on the control path that are not control nodes are assigned to one partition each.
+ //  - Control nodes (META_START, META_END, CTRL_*, CONCURRENCY_*) are replicated into every partition, so
+ //    all partitions walk the same control path. A branch condition computed elsewhere is received.
+ //  - Floating producers are copied into every partition that reads them.
+ //  - A value crossing partitions travels over a boundary channel: a COMM_CHANNEL_SEND follows the
+ //    producer, and the consumer partition runs a COMM_CHANNEL_RECV in the producer's place. Both sides
+ //    reach these at the same point of the shared control path, as often as the producer runs.
+ // Nodes keep their NodeIDs; generated nodes get IDs above the original ones. The return value of a
+ // META_END / CTRL_RETURN is kept in the partitions that have its operand locally.
+ // A graph with no node to assign yields one partition. nullopt if the entry node does not exist,
+ // MIN_CUT is asked for zero partitions, or a value crossing partitions is read from an output port its
+ // producer does not declare.
+ std::optional<PartitionPlan> partitionGraph(const BDIGraph& graph, NodeID entry_node_id,
+                                             const PartitionOptions& options = {});
+ } // namespace bdi::runtime::distributed
+ #endif // BDI_RUNTIME_DISTRIBUTED_GRAPHPARTITIONER_HPP
@@ -0,0 +1,547 @@
+// File: bdi/optimizer/GraphPasses.cpp
+ #include "GraphPasses.hpp"
+ #include "../runtime/OperationSemantics.hpp"
+ #include <algorithm>
+ #include <bit>
+ #include <functional>
+ #include <optional>
+ #include <type_traits>
+ #include <unordered_map>
+ #include <unordered_set>
+ #include <vector>
+ namespace bdi::optimizer {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::PortIndex;
+ using bdi::core::graph::RegionID;
+ using bdi::core::payload::TypedPayload;
+ using bdi::core::types::BDIType;
+ using bdi::core::types::getBdiTypeSize;
+ using bdi::runtime::RuntimeValue;
+ namespace {
+ using Op = BDIOperationType;
+ // Readers of each node as {consumer, input index}, the convention of BDIGraph::getDataConsumersFor
+ using UseMap = std::unordered_map<NodeID, std::vector<PortRef>>;
+ // Floating nodes have no control edges: the VM evaluates them when a value is read, once per step
+ bool isFloating(const BDINode& node) {
+    return node.control_inputs.empty() && node.control_outputs.empty();
+ }
+ BDINode* findNode(BDIGraph& graph, NodeID id) {
+    auto node = graph.getNode(id);
+    return node ? &node->get() : nullptr;
+ }
+ const BDINode* findNode(const BDIGraph& graph, NodeID id) {
+    auto node = graph.getNode(id);
+    return node ? &node->get() : nullptr;
+ }
+ // Passes visit nodes in NodeID order so their output does not depend on hash-map iteration order
+ std::vector<NodeID> sortedNodeIds(const BDIGraph& graph) {
+    std::vector<NodeID> ids;
+    ids.reserve(graph.getNodeCount());
+    for (const auto& [id, node] : graph) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+ }
+ UseMap buildUseMap(const BDIGraph& graph) {
+    UseMap uses;
+    for (NodeID id : sortedNodeIds(graph)) {
+        const BDINode& node = *findNode(graph, id);
+        for (size_t k = 0; k < node.data_inputs.size(); ++k) {
+            const PortRef& ref = node.data_inputs[k];
+            if (ref.node_id != 0) uses[ref.node_id].push_back(PortRef{id, static_cast<PortIndex>(k)});
+        }
+    }
+    return uses;
+ }
+ // Sources before their readers; nodes on data cycles are left out
+ std::vector<NodeID> dataOrder(const BDIGraph& graph, const UseMap& uses) {
+    std::unordered_map<NodeID, size_t> pending;
+    std::vector<NodeID> order;
+    for (NodeID id : sortedNodeIds(graph)) {
+        size_t count = 0;
+        for (const PortRef& ref : findNode(graph, id)->data_inputs) count += ref.node_id != 0;
+        pending[id] = count;
+        if (count == 0) order.push_back(id);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+        auto it = uses.find(order[head]);
+        if (it == uses.end()) continue;
+        for (const PortRef& use : it->second) {
+            if (--pending[use.node_id] == 0) order.push_back(use.node_id);
+        }
+    }
+    return order;
+ }
+ // Point readers of 'from' at map(old reference) instead; the use map follows
+ void redirectUses(BDIGraph& graph, UseMap& uses, NodeID from, const std::function<PortRef(const PortRef&)>& map) {
+    auto it = uses.find(from);
+    if (it == uses.end()) return;
+    std::vector<PortRef> moved = std::move(it->second);
+    uses.erase(it);
+    for (const PortRef& use : moved) {
+        BDINode* reader = findNode(graph, use.node_id);
+        if (!reader || use.port_index >= reader->data_inputs.size()) continue;
+        PortRef& input = reader->data_inputs[use.port_index];
+        if (input.node_id != from) continue;
+        input = map(input);
+        uses[input.node_id].push_back(use);
+    }
+ }
+ void moveUse(UseMap& uses, NodeID source, const PortRef& from, const PortRef& to) {
+    auto it = uses.find(source);
+    if (it == uses.end()) return;
+    auto use = std::find(it->second.begin(), it->second.end(), from);
+    if (use != it->second.end()) *use = to;
+ }
+ const PortRef* inputRef(const BDINode& node, size_t k) {
+    return k < node.data_inputs.size() && node.data_inputs[k].node_id != 0 ? &node.data_inputs[k] : nullptr;
+ }
+ BDIType declaredResultType(const BDINode& node) {
+    return node.data_outputs.empty() ? BDIType::UNKNOWN : node.data_outputs[0].type;
+ }
+ // Floating META_NOP with a value payload: published before the first step of every run
+ bool isConstantNode(const BDINode& node) {
+    return node.operation == Op::META_NOP && isFloating(node) && !node.data_outputs.empty() &&
+           RuntimeValue::fromPayload(node.payload).isSet();
+ }
+ // The value operand k has in every run, if it is a constant
+ std::optional<RuntimeValue> constantOperand(const BDIGraph& graph, const BDINode& node, size_t k) {
+    RuntimeValue value;
+    if (const PortRef* ref = inputRef(node, k)) {
+        const BDINode* source = findNode(graph, ref->node_id);
+        if (source && ref->port_index == 0 && isConstantNode(*source)) value = RuntimeValue::fromPayload(source->payload);
+    } else {
+        value = RuntimeValue::fromPayload(node.payload); // Unwired operands read the payload immediate
+    }
+    if (!value.isSet()) return std::nullopt;
+    return value;
+ }
+ // Type of every value operand k reads, where it is known without running the graph (UNKNOWN otherwise)
+ BDIType operandType(const BDIGraph& graph, const BDINode& node, size_t k) {
+    const PortRef* ref = inputRef(node, k);
+    if (!ref) return RuntimeValue::fromPayload(node.payload).type;
+    const BDINode* source = findNode(graph, ref->node_id);
+    if (!source || ref->port_index != 0 || source->data_outputs.empty()) return BDIType::UNKNOWN;
+    const BDIOperationType op = source->operation;
+    if (op == Op::META_NOP) return RuntimeValue::fromPayload(source->payload).type;
+    if (!runtime::isScalarOperation(op)) return BDIType::UNKNOWN;
+    if (op >= Op::LOGIC_AND && op <= Op::CMP_GE) return BDIType::BOOL;
+    // Other scalar results are stored in the declared output type
+    const BDIType declared = declaredResultType(*source);
+    return runtime::isScalarType(declared) ? declared : BDIType::UNKNOWN;
+ }
+ bool isIntegerType(BDIType type) {
+    return runtime::isScalarType(type) && type != BDIType::BOOL && type != BDIType::FLOAT32 && type != BDIType::FLOAT64;
+ }
+ bool isUnsignedType(BDIType type) {
+    return type == BDIType::UINT8 || type == BDIType::UINT16 || type == BDIType::UINT32 || type == BDIType::UINT64;
+ }
+ bool isCommutative(BDIOperationType op) {
+    return op == Op::ARITH_ADD || op == Op::ARITH_MUL || op == Op::BIT_AND || op == Op::BIT_OR || op == Op::BIT_XOR;
+ }
+ // 'value' converted to the integer 'type' (as the operation would load it), as unsigned bits of that width
+ uint64_t integerBits(const RuntimeValue& value, BDIType type) {
+    uint64_t bits = 0;
+    runtime::dispatchScalarType(type, [&](auto tag) {
+        using T = decltype(tag);
+        if constexpr (std::is_integral_v<T>) {
+            bits = static_cast<uint64_t>(static_cast<std::make_unsigned_t<T>>(runtime::loadAs<T>(value)));
+        }
+    });
+    return bits;
+ }
+ bool isFloatTwo(const RuntimeValue& value, BDIType type) {
+    bool two = false;
+    runtime::dispatchScalarType(type, [&](auto tag) {
+        using T = decltype(tag);
+        if constexpr (std::is_floating_point_v<T>) two = runtime::loadAs<T>(value) == T(2);
+    });
+    return two;
+ }
+ NodeID addConstant(BDIGraph& graph, const RuntimeValue& value) {
+    NodeID id = graph.addNode(Op::META_NOP);
+    BDINode& node = *findNode(graph, id);
+    node.payload = value.toPayload();
+    node.data_outputs.emplace_back(value.type);
+    return id;
+ }
+ // Make operand k of a scalar node read 'value': through the payload when no other operand reads it,
+ // otherwise through a new constant node
+ void setConstantOperand(BDIGraph& graph, BDINode& node, size_t k, const RuntimeValue& value, PassResult& result) {
+    const size_t arity = runtime::getScalarOperationArity(node.operation);
+    bool payload_free = true;
+    for (size_t j = 0; j < arity; ++j) {
+        if (j != k && !inputRef(node, j)) payload_free = false;
+    }
+    if (payload_free) {
+        node.payload = value.toPayload();
+        if (k < node.data_inputs.size()) node.data_inputs[k] = PortRef{};
+        return;
+    }
+    NodeID constant = addConstant(graph, value);
+    ++result.nodes_added;
+    graph.connectData(constant, 0, node.id, static_cast<PortIndex>(k));
+ }
+ void eraseOne(std::pmr::vector<NodeID>& list, NodeID id) {
+    auto it = std::find(list.begin(), list.end(), id);
+    if (it != list.end()) list.erase(it);
+ }
+ // --- CSE Key --
+ struct NodeKey {
+    BDIOperationType operation;
+    BDIType payload_type;
+    std::vector<std::byte> payload;
+    std::vector<PortRef> inputs;
+    std::vector<BDIType> outputs;
+    RegionID region;
+    bool operator==(const NodeKey&) const = default;
+ };
+ struct NodeKeyHash {
+    static void combine(size_t& seed, size_t value) { seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); }
+    size_t operator()(const NodeKey& key) const {
+        size_t seed = static_cast<size_t>(key.operation);
+        combine(seed, static_cast<size_t>(key.payload_type));
+        for (std::byte b : key.payload) combine(seed, static_cast<size_t>(b));
+        for (const PortRef& ref : key.inputs) {
+            combine(seed, std::hash<NodeID>{}(ref.node_id));
+            combine(seed, ref.port_index);
+        }
+        for (BDIType type : key.outputs) combine(seed, static_cast<size_t>(type));
+        combine(seed, std::hash<RegionID>{}(key.region));
+        return seed;
+    }
+ };
+ NodeKey makeKey(const BDINode& node) {
+    NodeKey key{node.operation, node.payload.type, {}, {}, {}, node.region_id};
+    key.payload.assign(node.payload.data.begin(), node.payload.data.end());
+    key.inputs.assign(node.data_inputs.begin(), node.data_inputs.end());
+    for (const auto& port : node.data_outputs) key.outputs.push_back(port.type);
+    return key;
+ }
+ // --- Control Splicing --
+ // No-op control nodes with a single successor can be bypassed; a node without predecessors may be an entry
+ bool isSpliceable(const BDINode& node) {
+    const BDIOperationType op = node.operation;
+    if (op != Op::CTRL_JUMP && op != Op::META_NOP && op != Op::META_COMMENT) return false;
+    return !node.control_inputs.empty() && node.control_outputs.size() == 1 && node.control_outputs[0] != node.id;
+ }
+ // Predecessors jump straight to the successor, keeping their successor order (branch targets)
+ void spliceControlNode(BDIGraph& graph, BDINode& node) {
+    const NodeID id = node.id;
+    const NodeID next = node.control_outputs[0];
+    BDINode* target = findNode(graph, next);
+    if (!target) return;
+    eraseOne(target->control_inputs, id);
+    std::vector<NodeID> predecessors(node.control_inputs.begin(), node.control_inputs.end());
+    std::sort(predecessors.begin(), predecessors.end());
+    predecessors.erase(std::unique(predecessors.begin(), predecessors.end()), predecessors.end());
+    for (NodeID pred_id : predecessors) {
+        BDINode* pred = findNode(graph, pred_id);
+        if (!pred) continue;
+        for (NodeID& succ : pred->control_outputs) {
+            if (succ != id) continue;
+            succ = next;
+            target->control_inputs.push_back(pred_id);
+        }
+    }
+    node.control_inputs.clear();
+    node.control_outputs.clear();
+ }
+ // An operand of a fused node: a wired port or the payload immediate of the node it came from
+ struct FusedOperand {
+    PortRef source;
+    RuntimeValue immediate;
+ };
+ FusedOperand fusedOperand(const BDINode& node, size_t k) {
+    if (const PortRef* ref = inputRef(node, k)) return {*ref, {}};
+    return {PortRef{}, RuntimeValue::fromPayload(node.payload)};
+ }
+ } // namespace
+ PassResult foldConstants(BDIGraph& graph) {
+    PassResult result;
+    graph.beginEdit(); // Nodes are edited in place; the consumer index is rebuilt once at the end
+    const UseMap uses = buildUseMap(graph);
+    // In data order, folded floating nodes are constants by the time their readers are visited
+    for (NodeID id : dataOrder(graph, uses)) {
+        BDINode& node = *findNode(graph, id);
+        const BDIOperationType op = node.operation;
+        if (op == Op::CTRL_BRANCH_COND) {
+            auto condition = constantOperand(graph, node, 0);
+            if (!condition || node.control_outputs.size() < 2) continue;
+            const size_t taken = runtime::isTruthy(*condition) ? 0 : 1;
+            const NodeID target = node.control_outputs[taken];
+            for (size_t k = 0; k < node.control_outputs.size(); ++k) {
+                if (k == taken) continue;
+                if (BDINode* other = findNode(graph, node.control_outputs[k])) eraseOne(other->control_inputs, id);
+            }
+            node.control_outputs.assign(1, target);
+            node.operation = Op::CTRL_JUMP;
+            node.data_inputs.clear();
+            node.payload = TypedPayload{};
+            ++result.nodes_rewritten;
+        } else if (op == Op::META_ASSERT) {
+            auto condition = constantOperand(graph, node, 0);
+            if (!condition || !runtime::isTruthy(*condition)) continue; // A failing assert stays a failure
+            node.operation = Op::META_NOP;
+            node.data_inputs.clear();
+            node.payload = TypedPayload{}; // Publishes nothing
+            ++result.nodes_rewritten;
+        } else if (runtime::isScalarOperation(op)) {
+            RuntimeValue operands[3];
+            const size_t arity = runtime::getScalarOperationArity(op);
+            bool constant = true;
+            for (size_t k = 0; k < arity && constant; ++k) {
+                auto value = constantOperand(graph, node, k);
+                if (value) operands[k] = *value;
+                else constant = false;
+            }
+            RuntimeValue value;
+            if (!constant || !runtime::evaluateScalar(op, declaredResultType(node), operands, value) || !value.isSet()) continue;
+            // A META_NOP publishes its payload on output 0 when executed (or up front when floating)
+            node.operation = Op::META_NOP;
+            node.payload = value.toPayload();
+            node.data_inputs.clear();
+            ++result.nodes_rewritten;
+        }
+    }
+    graph.commitEdit();
+    return result;
+ }
+ PassResult eliminateCommonSubexpressions(BDIGraph& graph) {
+    PassResult result;
+    graph.beginEdit();
+    UseMap uses = buildUseMap(graph);
+    std::unordered_map<NodeKey, NodeID, NodeKeyHash> seen;
+    std::vector<NodeID> duplicates;
+    // In data order the inputs of a node already point at representatives, so chains collapse in one pass
+    for (NodeID id : dataOrder(graph, uses)) {
+        const BDINode& node = *findNode(graph, id);
+        if (!isFloating(node) || (node.operation != Op::META_NOP && !runtime::isScalarOperation(node.operation))) continue;
+        auto [it, inserted] = seen.try_emplace(makeKey(node), id);
+        if (inserted) continue;
+        const NodeID representative = it->second;
+        redirectUses(graph, uses, id, [&](const PortRef& ref) { return PortRef{representative, ref.port_index}; });
+        duplicates.push_back(id);
+    }
+    result.nodes_removed = graph.removeNodes(duplicates);
+    graph.commitEdit();
+    return result;
+ }
+ PassResult eliminateDeadNodes(BDIGraph& graph, NodeID entry) {
+    PassResult result;
+    graph.beginEdit();
+    const std::vector<NodeID> ids = sortedNodeIds(graph);
+    // Control nodes run only if control reaches them from the entry (without one, from every control node
+    // that has no predecessor). They keep alive what they read, back to META_END's return value, and live
+    // nodes keep alive what they read in turn; unreachable control nodes and their cones are dropped
+    std::unordered_set<NodeID> live;
+    std::vector<NodeID> work;
+    if (entry != 0) {
+        if (findNode(graph, entry) && live.insert(entry).second) work.push_back(entry);
+    } else {
+        for (NodeID id : ids) {
+            const BDINode& node = *findNode(graph, id);
+            if (node.control_inputs.empty() && !node.control_outputs.empty() && live.insert(id).second) work.push_back(id);
+        }
+    }
+    std::vector<NodeID> reached(work.begin(), work.end());
+    while (!reached.empty()) {
+        const BDINode& node = *findNode(graph, reached.back());
+        reached.pop_back();
+        for (NodeID next : node.control_outputs) {
+            if (findNode(graph, next) && live.insert(next).second) {
+                work.push_back(next);
+                reached.push_back(next);
+            }
+        }
+    }
+    while (!work.empty()) {
+        const BDINode& node = *findNode(graph, work.back());
+        work.pop_back();
+        for (const PortRef& ref : node.data_inputs) {
+            if (ref.node_id != 0 && findNode(graph, ref.node_id) && live.insert(ref.node_id).second) work.push_back(ref.node_id);
+        }
+    }
+    std::vector<NodeID> dead;
+    std::unordered_set<NodeID> read;
+    for (NodeID id : ids) {
+        if (!live.count(id)) {
+            dead.push_back(id);
+            continue;
+        }
+        for (const PortRef& ref : findNode(graph, id)->data_inputs) read.insert(ref.node_id);
+    }
+    for (NodeID id : ids) {
+        BDINode& node = *findNode(graph, id);
+        if (read.count(id) || !isSpliceable(node)) continue;
+        spliceControlNode(graph, node);
+        dead.push_back(id);
+    }
+    result.nodes_removed = graph.removeNodes(dead);
+    graph.commitEdit();
+    return result;
+ }
+ PassResult reduceStrength(BDIGraph& graph) {
+    PassResult result;
+    graph.beginEdit();
+    UseMap uses = buildUseMap(graph);
+    std::vector<NodeID> bypassed;
+    for (NodeID id : sortedNodeIds(graph)) {
+        BDINode& node = *findNode(graph, id);
+        const BDIOperationType op = node.operation;
+        if (!runtime::isScalarBinaryOperation(op) || op >= Op::LOGIC_AND) continue; // Arithmetic and bitwise only
+        // Variable operand x and constant c; commutative operations may have them the other way round
+        size_t c_idx = 1;
+        auto c = constantOperand(graph, node, 1);
+        if (!c && isCommutative(op)) {
+            c = constantOperand(graph, node, 0);
+            c_idx = 0;
+        }
+        if (!c) continue;
+        const size_t x_idx = 1 - c_idx;
+        const PortRef* x_ref = inputRef(node, x_idx);
+        if (!x_ref || x_ref->node_id == id) continue;
+        const PortRef x = *x_ref;
+        // The operation computes in the type of operand 0; x must be known to have that type
+        const BDIType type = operandType(graph, node, x_idx);
+        if (type == BDIType::UNKNOWN || type != operandType(graph, node, 0)) continue;
+        bool identity = false;
+        BDIOperationType reduced = op;
+        uint64_t reduced_operand = 0;
+        if (isIntegerType(type)) {
+            const uint64_t bits = integerBits(*c, type);
+            const uint64_t width = getBdiTypeSize(type) * 8;
+            const uint64_t ones = width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            const bool unsigned_rhs = isUnsignedType(type) && c_idx == 1;
+            switch (op) {
+                case Op::ARITH_MUL:
+                    if (bits == 1) identity = true;
+                    else if (std::has_single_bit(bits)) { reduced = Op::BIT_SHL; reduced_operand = std::countr_zero(bits); }
+                    break;
+                case Op::ARITH_DIV:
+                    if (!unsigned_rhs) break;
+                    if (bits == 1) identity = true;
+                    else if (std::has_single_bit(bits)) { reduced = Op::BIT_SHR; reduced_operand = std::countr_zero(bits); }
+                    break;
+                case Op::ARITH_MOD:
+                    if (unsigned_rhs && std::has_single_bit(bits)) { reduced = Op::BIT_AND; reduced_operand = bits - 1; }
+                    break;
+                case Op::ARITH_ADD:
+                case Op::BIT_OR:
+                case Op::BIT_XOR:
+                    identity = bits == 0;
+                    break;
+                case Op::ARITH_SUB:
+                    identity = c_idx == 1 && bits == 0;
+                    break;
+                case Op::BIT_SHL:
+                case Op::BIT_SHR:
+                case Op::BIT_ASHR:
+                case Op::BIT_ROL:
+                case Op::BIT_ROR:
+                    identity = c_idx == 1 && bits % width == 0; // Counts are taken modulo the width
+                    break;
+                case Op::BIT_AND:
+                    identity = bits == ones;
+                    break;
+                default:
+                    break;
+            }
+        } else if (op == Op::ARITH_MUL && isFloatTwo(*c, type)) {
+            // x * 2 and x + x round the same exact value
+            node.operation = Op::ARITH_ADD;
+            if (node.data_inputs.size() < 2) node.data_inputs.resize(2);
+            node.data_inputs[0] = x;
+            node.data_inputs[1] = x;
+            ++result.nodes_rewritten;
+            continue;
+        }
+        if (identity) {
+            // Only a floating node reads x in the same step as its readers do; the result must also keep
+            // x's type and be read on output 0 only (other outputs of a scalar node are never written)
+            const BDIType declared = declaredResultType(node);
+            if (!isFloating(node) || (declared != BDIType::UNKNOWN && declared != type)) continue;
+            bool port_zero = true;
+            if (auto it = uses.find(id); it != uses.end()) {
+                for (const PortRef& use : it->second) {
+                    const BDINode* reader = findNode(graph, use.node_id);
+                    if (reader && reader->data_inputs[use.port_index].port_index != 0) port_zero = false;
+                }
+            }
+            if (!port_zero) continue;
+            redirectUses(graph, uses, id, [&](const PortRef&) { return x; });
+            bypassed.push_back(id);
+        } else if (reduced != op) {
+            node.operation = reduced;
+            if (c_idx == 0) {
+                node.data_inputs[0] = x; // x becomes operand 0; its type is the computation type either way
+                if (node.data_inputs.size() > 1) node.data_inputs[1] = PortRef{};
+            }
+            setConstantOperand(graph, node, 1, runtime::storeAs<uint64_t>(type, reduced_operand), result);
+            ++result.nodes_rewritten;
+        }
+    }
+    result.nodes_removed = graph.removeNodes(bypassed);
+    graph.commitEdit();
+    return result;
+ }
+ PassResult fuseMultiplyAdd(BDIGraph& graph, bool contract_floats) {
+    PassResult result;
+    graph.beginEdit();
+    UseMap uses = buildUseMap(graph);
+    std::vector<NodeID> fused;
+    for (NodeID id : sortedNodeIds(graph)) {
+        BDINode& add = *findNode(graph, id);
+        if (add.operation != Op::ARITH_ADD) continue;
+        for (size_t m = 0; m < 2; ++m) {
+            const PortRef* ref = inputRef(add, m);
+            if (!ref || ref->port_index != 0 || ref->node_id == id) continue;
+            BDINode& mul = *findNode(graph, ref->node_id);
+            // A floating product is computed in the step that reads it, from the same a and b the FMA reads
+            if (mul.operation != Op::ARITH_MUL || !isFloating(mul)) continue;
+            auto mul_uses = uses.find(mul.id);
+            if (mul_uses == uses.end() || mul_uses->second.size() != 1) continue;
+            // The product is computed and stored in the type of its first operand, and the sum must be
+            // computed in that type too
+            const BDIType type = operandType(graph, mul, 0);
+            const BDIType declared = declaredResultType(mul);
+            if (!runtime::isScalarType(type) || type == BDIType::BOOL) continue;
+            if (declared != BDIType::UNKNOWN && declared != type) continue;
+            if (m == 1 && operandType(graph, add, 0) != type) continue;
+            if ((type == BDIType::FLOAT32 || type == BDIType::FLOAT64) && !contract_floats) continue;
+            FusedOperand operands[3] = {fusedOperand(mul, 0), fusedOperand(mul, 1), fusedOperand(add, 1 - m)};
+            bool usable = true;
+            for (const FusedOperand& operand : operands) {
+                if (operand.source.node_id == 0 ? !operand.immediate.isSet()
+                                                : operand.source.node_id == mul.id) usable = false;
+            }
+            if (!usable) continue;
+            // One immediate stays in the payload; a second, different one needs its own constant node
+            std::optional<RuntimeValue> immediate;
+            for (FusedOperand& operand : operands) {
+                if (operand.source.node_id != 0) continue;
+                if (!immediate || *immediate == operand.immediate) {
+                    immediate = operand.immediate;
+                } else {
+                    operand.source = PortRef{addConstant(graph, operand.immediate), 0};
+                    ++result.nodes_added;
+                }
+            }
+            for (size_t k = 0; k < 2; ++k) {
+                if (inputRef(mul, k)) moveUse(uses, operands[k].source.node_id, PortRef{mul.id, PortIndex(k)}, PortRef{id, PortIndex(k)});
+            }
+            if (inputRef(add, 1 - m)) moveUse(uses, operands[2].source.node_id, PortRef{id, PortIndex(1 - m)}, PortRef{id, 2});
+            add.operation = Op::ARITH_FMA;
+            add.data_inputs.assign(3, PortRef{});
+            for (size_t k = 0; k < 3; ++k) add.data_inputs[k] = operands[k].source;
+            if (immediate) add.payload = immediate->toPayload();
+            uses.erase(mul.id);
+            fused.push_back(mul.id);
+            ++result.nodes_rewritten;
+            break;
+        }
+    }
+    result.nodes_removed = graph.removeNodes(fused);
+    graph.commitEdit();
+    return result;
+ }
+ } // namespace bdi::optimizer
@@ -0,0 +1,44 @@
+// File: bdi/optimizer/GraphPasses.hpp
+ #ifndef BDI_OPTIMIZER_GRAPHPASSES_HPP
+ #define BDI_OPTIMIZER_GRAPHPASSES_HPP
+ #include "../core/graph/BDIGraph.hpp"
+ #include <cstddef>
+ namespace bdi::optimizer {
+ using bdi::core::graph::BDIGraph;
+ using bdi::core::graph::BDINode;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::PortRef;
+ // What one pass did to the graph
+ struct PassResult {
+    size_t nodes_removed = 0;
+    size_t nodes_added = 0;     // Constants materialized for rewritten operands
+    size_t nodes_rewritten = 0; // Nodes changed in place (operation, operands or payload)
+    bool changed() const { return nodes_removed != 0 || nodes_added != 0 || nodes_rewritten != 0; }
+ };
+ // --- Passes --
+ // Each pass expects a graph that passes validateGraph() and leaves one that does. A run of the rewritten
+ // graph from a kept entry node succeeds or fails like the original and produces the same return value,
+ // prints and memory effects, as executed by BDIVirtualMachine; step counts and the output values of
+ // removed or rewritten nodes may differ. Only fuseMultiplyAdd with 'contract_floats' changes results.
+ // Scalar operations whose operands are all constants (floating META_NOP nodes or payload immediates)
+ // become META_NOP constants holding the result; constant branches become jumps, passing asserts no-ops.
+ // Operations that would fail at run time (division by zero, ...) are left in place.
+ PassResult foldConstants(BDIGraph& graph);
+ // Merges floating pure nodes (scalar operations and constants) with the same operation, payload, inputs
+ // and output types. Floating nodes are evaluated on demand within a step, so duplicates always agree.
+ PassResult eliminateCommonSubexpressions(BDIGraph& graph);
+ // Removes control nodes that control cannot reach from 'entry' and nodes that no reachable node reads
+ // (directly or through other nodes), then splices no-op control nodes (CTRL_JUMP, META_NOP,
+ // META_COMMENT) out of the control path. Without an entry, every control node without control
+ // predecessors is kept as a potential entry point; cycles no such node reaches are dropped.
+ PassResult eliminateDeadNodes(BDIGraph& graph, NodeID entry = 0);
+ // Integer multiply / unsigned divide / unsigned modulo by a power of two become shifts and masks,
+ // float x * 2 becomes x + x, and floating identity operations (x + 0, x * 1, x & ~0, ...) are bypassed.
+ // Only applied where the operand types are known statically (constant or declared output types).
+ PassResult reduceStrength(BDIGraph& graph);
+ // ARITH_ADD fed by a floating ARITH_MUL that has no other reader becomes one ARITH_FMA.
+ // Integer fusion is exact (both wrap modulo 2^n); float fusion rounds once instead of twice and
+ // only happens with 'contract_floats'.
+ PassResult fuseMultiplyAdd(BDIGraph& graph, bool contract_floats = false);
+ } // namespace bdi::optimizer
+ #endif // BDI_OPTIMIZER_GRAPHPASSES_HPP
@@ -0,0 +1,190 @@
+// File: bdi/core/serialization/GraphStream.cpp
+ #include "GraphStream.hpp"
+ #include <istream>
+ #include <ostream>
+ #include <span>
+ #include <type_traits>
+ namespace bdi::core::serialization {
+ namespace {
+ // Records larger than this are rejected by the reader (guards allocation on corrupt input)
+ constexpr uint32_t kMaxRecordSize = 1u << 30;
+ constexpr uint64_t kChecksumSeed = 0x9E3779B97F4A7C15ull;
+ class Encoder {
+ public:
+    explicit Encoder(std::vector<std::byte>& out) : out_(out) {}
+    template <typename T>
+    void put(T value) {
+        uint64_t v = static_cast<uint64_t>(value);
+        for (size_t i = 0; i < sizeof(T); ++i) out_.push_back(static_cast<std::byte>(v >> (8 * i)));
+    }
+    void putBytes(const void* data, size_t size) {
+        put(static_cast<uint32_t>(size));
+        const auto* p = static_cast<const std::byte*>(data);
+        out_.insert(out_.end(), p, p + size);
+    }
+ private:
+    std::vector<std::byte>& out_;
+ };
+ class Decoder {
+ public:
+    Decoder(const std::byte* data, size_t size) : p_(data), end_(data + size) {}
+    template <typename T>
+    bool get(T& value) {
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) return false;
+        uint64_t v = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) v |= static_cast<uint64_t>(p_[i]) << (8 * i);
+        p_ += sizeof(T);
+        value = static_cast<T>(v);
+        return true;
+    }
+    // Length-prefixed byte string, viewed in place
+    bool getBytes(std::span<const std::byte>& out) {
+        uint32_t size = 0;
+        if (!get(size) || static_cast<size_t>(end_ - p_) < size) return false;
+        out = {p_, size};
+        p_ += size;
+        return true;
+    }
+    bool count(uint32_t& n, size_t min_element_size) {
+        return get(n) && static_cast<size_t>(end_ - p_) / min_element_size >= n;
+    }
+    bool atEnd() const { return p_ == end_; }
+ private:
+    const std::byte* p_;
+    const std::byte* end_;
+ };
+ using OpRepr = std::underlying_type_t<bdi::core::graph::BDIOperationType>;
+ using TypeRepr = std::underlying_type_t<bdi::core::types::BDIType>;
+ void writeRaw(std::ostream& os, const std::vector<std::byte>& bytes) {
+    os.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+ }
+ bool readRaw(std::istream& is, std::vector<std::byte>& bytes, size_t size) {
+    bytes.resize(size);
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size)));
+ }
+ } // namespace
+ GraphStreamWriter::GraphStreamWriter(std::ostream& os, const std::string& graph_name) : os_(os), checksum_(kChecksumSeed) {
+    Encoder enc(record_);
+    for (char c : GRAPH_STREAM_MAGIC) enc.put(static_cast<uint8_t>(c));
+    enc.put(GRAPH_FORMAT_VERSION);
+    enc.putBytes(graph_name.data(), graph_name.size());
+    writeRaw(os_, record_);
+    ok_ = static_cast<bool>(os_);
+ }
+ bool GraphStreamWriter::writeNode(const BDINode& node) {
+    if (!ok_ || finished_) return false;
+    record_.clear();
+    Encoder enc(record_);
+    enc.put(uint32_t{0}); // Length, patched below
+    enc.put(node.id);
+    enc.put(static_cast<OpRepr>(node.operation));
+    enc.put(node.metadata_handle);
+    enc.put(node.region_id);
+    enc.put(static_cast<TypeRepr>(node.payload.type));
+    enc.putBytes(node.payload.data.data(), node.payload.data.size());
+    enc.put(static_cast<uint32_t>(node.data_inputs.size()));
+    for (const auto& ref : node.data_inputs) {
+        enc.put(ref.node_id);
+        enc.put(ref.port_index);
+    }
+    enc.put(static_cast<uint32_t>(node.data_outputs.size()));
+    for (const auto& port : node.data_outputs) {
+        enc.put(static_cast<TypeRepr>(port.type));
+        enc.putBytes(port.name.data(), port.name.size());
+    }
+    enc.put(static_cast<uint32_t>(node.control_inputs.size()));
+    for (NodeID id : node.control_inputs) enc.put(id);
+    enc.put(static_cast<uint32_t>(node.control_outputs.size()));
+    for (NodeID id : node.control_outputs) enc.put(id);
+    const size_t body = record_.size() - sizeof(uint32_t);
+    if (body > kMaxRecordSize) return ok_ = false;
+    for (size_t i = 0; i < sizeof(uint32_t); ++i) record_[i] = static_cast<std::byte>(body >> (8 * i));
+    checksum_ = checksum64(record_.data() + sizeof(uint32_t), body, checksum_);
+    writeRaw(os_, record_);
+    ++node_count_;
+    return ok_ = static_cast<bool>(os_);
+ }
+ bool GraphStreamWriter::finish() {
+    if (!ok_ || finished_) return false;
+    finished_ = true;
+    record_.clear();
+    Encoder enc(record_);
+    enc.put(uint32_t{0}); // End marker (a node record is never empty)
+    enc.put(node_count_);
+    enc.put(checksum_);
+    writeRaw(os_, record_);
+    os_.flush();
+    return ok_ = static_cast<bool>(os_);
+ }
+ GraphStreamReader::GraphStreamReader(std::istream& is) : is_(is), checksum_(kChecksumSeed) {
+    constexpr size_t kFixed = sizeof(GRAPH_STREAM_MAGIC) + sizeof(uint32_t) * 2;
+    if (!readRaw(is_, record_, kFixed)) return;
+    Decoder dec(record_.data(), record_.size());
+    for (char c : GRAPH_STREAM_MAGIC) {
+        uint8_t b = 0;
+        if (!dec.get(b) || b != static_cast<uint8_t>(c)) return;
+    }
+    uint32_t version = 0, name_length = 0;
+    if (!dec.get(version) || version != GRAPH_FORMAT_VERSION || !dec.get(name_length)) return;
+    if (name_length > kMaxRecordSize || !readRaw(is_, record_, name_length)) return;
+    graph_name_.assign(reinterpret_cast<const char*>(record_.data()), record_.size());
+    open_ = true;
+ }
+ std::unique_ptr<BDINode> GraphStreamReader::next() {
+    if (!open_ || done_) return nullptr;
+    auto fail = [this]() -> std::unique_ptr<BDINode> { done_ = true; return nullptr; };
+    if (!readRaw(is_, record_, sizeof(uint32_t))) return fail();
+    uint32_t length = 0;
+    Decoder(record_.data(), record_.size()).get(length);
+    if (length == 0) {
+        // Trailer
+        done_ = true;
+        uint64_t count = 0, checksum = 0;
+        if (!readRaw(is_, record_, sizeof(uint64_t) * 2)) return nullptr;
+        Decoder dec(record_.data(), record_.size());
+        complete_ = dec.get(count) && dec.get(checksum) && count == node_count_ && checksum == checksum_;
+        return nullptr;
+    }
+    if (length > kMaxRecordSize || !readRaw(is_, record_, length)) return fail();
+    checksum_ = checksum64(record_.data(), record_.size(), checksum_);
+    Decoder dec(record_.data(), record_.size());
+    auto node = std::make_unique<BDINode>();
+    OpRepr op = 0;
+    TypeRepr type = 0;
+    uint32_t n = 0;
+    std::span<const std::byte> bytes;
+    if (!dec.get(node->id) || !dec.get(op) || !dec.get(node->metadata_handle) || !dec.get(node->region_id) ||
+        !dec.get(type) || !dec.getBytes(bytes)) {
+        return fail();
+    }
+    node->operation = static_cast<bdi::core::graph::BDIOperationType>(op);
+    if (!bdi::core::graph::isKnownOperation(node->operation)) return fail();
+    node->payload.data.assign(bytes.begin(), bytes.end());
+    node->payload.type = static_cast<bdi::core::types::BDIType>(type);
+    if (!dec.count(n, sizeof(NodeID) + sizeof(uint32_t))) return fail();
+    node->data_inputs.resize(n);
+    for (auto& ref : node->data_inputs) {
+        if (!dec.get(ref.node_id) || !dec.get(ref.port_index)) return fail();
+    }
+    if (!dec.count(n, sizeof(TypeRepr) + sizeof(uint32_t))) return fail();
+    node->data_outputs.resize(n);
+    for (auto& port : node->data_outputs) {
+        if (!dec.get(type) || !dec.getBytes(bytes)) return fail();
+        port.name = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        port.type = static_cast<bdi::core::types::BDIType>(type);
+    }
+    if (!dec.count(n, sizeof(NodeID))) return fail();
+    node->control_inputs.resize(n);
+    for (auto& id : node->control_inputs) {
+        if (!dec.get(id)) return fail();
+    }
+    if (!dec.count(n, sizeof(NodeID))) return fail();
+    node->control_outputs.resize(n);
+    for (auto& id : node->control_outputs) {
+        if (!dec.get(id)) return fail();
+    }
+    if (!dec.atEnd()) return fail();
+    ++node_count_;
+    return node;
+ }
+ } // namespace bdi::core::serialization
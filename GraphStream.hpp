@@ -0,0 +1,55 @@
+// File: bdi/core/serialization/GraphStream.hpp
+ #ifndef BDI_CORE_SERIALIZATION_GRAPHSTREAM_HPP
+ #define BDI_CORE_SERIALIZATION_GRAPHSTREAM_HPP
+ #include "BinaryGraphFormat.hpp"
+ #include "../graph/BDINode.hpp"
+ #include <cstdint>
+ #include <iosfwd>
+ #include <memory>
+ #include <string>
+ #include <vector>
+ namespace bdi::core::serialization {
+ using bdi::core::graph::BDINode;
+ using bdi::core::graph::NodeID;
+ // Record stream of BDINodes for graphs that do not fit in memory (or that are produced/consumed
+ // incrementally). Only one node is held at a time on either side.
+ // Layout: magic, version, graph name, then one length-prefixed record per node, then an end marker
+ // (length 0) followed by the node count and a checksum over all record bytes.
+ // All integers are little-endian and encoded byte by byte, so streams are portable across hosts.
+ class GraphStreamWriter {
+ public:
+    GraphStreamWriter(std::ostream& os, const std::string& graph_name);
+    bool writeNode(const BDINode& node);
+    // Write the trailer; the stream is not readable without it
+    bool finish();
+    uint64_t getNodeCount() const { return node_count_; }
+ private:
+    std::ostream& os_;
+    std::vector<std::byte> record_; // Reused encode buffer
+    uint64_t node_count_ = 0;
+    uint64_t checksum_ = 0;
+    bool finished_ = false;
+    bool ok_ = true;
+ };
+ class GraphStreamReader {
+ public:
+    explicit GraphStreamReader(std::istream& is);
+    // False if the stream header was missing or unsupported
+    bool isOpen() const { return open_; }
+    const std::string& getGraphName() const { return graph_name_; }
+    // Next node, or nullptr at the end of the stream or on error (check isComplete())
+    std::unique_ptr<BDINode> next();
+    // True once the trailer was read and its count and checksum matched
+    bool isComplete() const { return complete_; }
+ private:
+    std::istream& is_;
+    std::string graph_name_;
+    std::vector<std::byte> record_;
+    uint64_t node_count_ = 0;
+    uint64_t checksum_ = 0;
+    bool open_ = false;
+    bool done_ = false;
+    bool complete_ = false;
+ };
+ } // namespace bdi::core::serialization
+ #endif // BDI_CORE_SERIALIZATION_GRAPHSTREAM_HPP
@@ -0,0 +1,323 @@
+// File: bdi/tests/GraphTests.cpp
+ // BDIGraph editing: the consumer index against a full scan of the inputs over random edit sequences,
+ // nodes replaced under their own ID inside a bulk edit, arena accounting, interned port names, and
+ // what removeNode() leaves of a node
+ #include "TestSupport.hpp"
+ #include <algorithm>
+ #include <atomic>
+ #include <map>
+ #include <memory>
+ #include <random>
+ #include <sstream>
+ #include <string>
+ #include <thread>
+ #include <vector>
+ using namespace bdi::tests;
+ using bdi::core::graph::BDINode;
+ using bdi::core::graph::GraphAllocationStats;
+ using bdi::core::graph::InternedName;
+ using bdi::core::graph::PortIndex;
+ using bdi::core::graph::PortRef;
+ namespace {
+ std::vector<NodeID> nodeIds(const BDIGraph& graph) {
+    std::vector<NodeID> ids;
+    for (const auto& [id, node] : graph) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+ }
+ bool sameConsumers(std::vector<PortRef> a, std::vector<PortRef> b) {
+    auto less = [](const PortRef& x, const PortRef& y) {
+        return x.node_id != y.node_id ? x.node_id < y.node_id : x.port_index < y.port_index;
+    };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    return a == b;
+ }
+ // getDataConsumersFor() answers what a scan of every data input finds. Outside an edit, no edge
+ // references a missing node and every control edge is listed on both ends, as often on each.
+ bool consistent(const BDIGraph& graph) {
+    std::map<std::pair<NodeID, PortIndex>, std::vector<PortRef>> scan;
+    for (const auto& [id, node] : graph) {
+        for (size_t k = 0; k < node->data_inputs.size(); ++k) {
+            const PortRef& ref = node->data_inputs[k];
+            if (ref.node_id != 0) scan[{ref.node_id, ref.port_index}].push_back(PortRef{id, static_cast<PortIndex>(k)});
+        }
+    }
+    for (const auto& [source, consumers] : scan) {
+        if (!sameConsumers(graph.getDataConsumersFor(source.first, source.second), consumers)) return false;
+    }
+    for (const auto& [id, node] : graph) {
+        for (PortIndex port = 0; port <= node->data_outputs.size(); ++port) {
+            if (!scan.count({id, port}) && !graph.getDataConsumersFor(id, port).empty()) return false;
+        }
+    }
+    if (graph.isEditing()) return true;
+    for (const auto& [id, node] : graph) {
+        for (const PortRef& ref : node->data_inputs) {
+            if (ref.node_id != 0 && !graph.getNode(ref.node_id)) return false;
+        }
+        for (NodeID succ : node->control_outputs) {
+            auto other = graph.getNode(succ);
+            if (!other) return false;
+            const auto& inputs = other->get().control_inputs;
+            if (std::count(inputs.begin(), inputs.end(), id) !=
+                std::count(node->control_outputs.begin(), node->control_outputs.end(), succ)) {
+                return false;
+            }
+        }
+        for (NodeID pred : node->control_inputs) {
+            auto other = graph.getNode(pred);
+            if (!other) return false;
+            const auto& outputs = other->get().control_outputs;
+            if (std::count(outputs.begin(), outputs.end(), id) !=
+                std::count(node->control_inputs.begin(), node->control_inputs.end(), pred)) {
+                return false;
+            }
+        }
+    }
+    return true;
+ }
+ std::unique_ptr<BDINode> makeNode(NodeID id, size_t outputs) {
+    auto node = std::make_unique<BDINode>(id, BDIOperationType::META_NOP);
+    for (size_t k = 0; k < outputs; ++k) node->data_outputs.push_back({BDIType::INT32});
+    return node;
+ }
+ void testRandomEdits() {
+    for (uint64_t seed = 1; seed <= 8; ++seed) {
+        std::mt19937_64 rng(seed);
+        BDIGraph graph;
+        size_t depth = 0;
+        auto pick = [&](const std::vector<NodeID>& ids) { return ids[rng() % ids.size()]; };
+        for (int step = 0; step < 4000; ++step) {
+            const std::vector<NodeID> ids = nodeIds(graph);
+            const unsigned action = ids.size() < 4 ? 0 : static_cast<unsigned>(rng() % 10);
+            switch (action) {
+                case 0: {
+                    const NodeID id = graph.addNode(BDIOperationType::META_NOP);
+                    graph.getNode(id)->get().data_outputs.push_back({BDIType::INT32});
+                    break;
+                }
+                case 1:
+                    graph.connectData(pick(ids), static_cast<PortIndex>(rng() % 2), pick(ids), static_cast<PortIndex>(rng() % 3));
+                    break;
+                case 2:
+                    graph.disconnectData(pick(ids), static_cast<PortIndex>(rng() % 3));
+                    break;
+                case 3:
+                    graph.connectControl(pick(ids), pick(ids));
+                    break;
+                case 4: {
+                    // Mostly an existing edge
+                    const NodeID from = pick(ids);
+                    const auto& outputs = graph.getNode(from)->get().control_outputs;
+                    graph.disconnectControl(from, outputs.empty() || rng() % 4 == 0 ? pick(ids) : outputs[rng() % outputs.size()]);
+                    break;
+                }
+                case 5:
+                    if (ids.size() > 8) graph.removeNode(pick(ids));
+                    break;
+                case 6:
+                    if (depth < 3) {
+                        graph.beginEdit();
+                        ++depth;
+                    }
+                    break;
+                case 7:
+                    if (depth > 0) {
+                        graph.commitEdit();
+                        --depth;
+                    }
+                    break;
+                case 8: {
+                    // Remove and re-add under the same ID, sometimes reconnecting a predecessor
+                    if (depth == 0) break;
+                    const NodeID id = pick(ids);
+                    graph.removeNode(id);
+                    BDI_CHECK(graph.addNode(makeNode(id, 1 + rng() % 2)) == id);
+                    if (rng() % 2) graph.connectControl(pick(ids), id);
+                    break;
+                }
+                default: {
+                    // Direct input edit, allowed inside an edit only
+                    if (depth == 0) break;
+                    auto& inputs = graph.getNode(pick(ids))->get().data_inputs;
+                    if (inputs.size() < 3) inputs.resize(3);
+                    inputs[rng() % 3] = PortRef{pick(ids), 0};
+                    break;
+                }
+            }
+            if (!BDI_CHECK(consistent(graph))) {
+                std::fprintf(stderr, "  seed %llu step %d action %u\n", static_cast<unsigned long long>(seed), step, action);
+                return;
+            }
+        }
+        for (; depth > 0; --depth) graph.commitEdit();
+        BDI_CHECK(consistent(graph));
+    }
+ }
+ // Replaced under its own ID in one bulk edit: readers keep reading the ID, control edges follow the
+ // replacement's lists. A removed ID that is not re-added loses every edge.
+ void testReplaceInEdit() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{1});
+    const NodeID reader = t.op(BDIOperationType::ARITH_ADD, {a, a}, BDIType::INT32, true);
+    const NodeID end = t.op(BDIOperationType::META_END, {reader}, BDIType::UNKNOWN, true);
+    BDIGraph& g = t.graph;
+    g.beginEdit();
+    BDI_CHECK(g.removeNode(reader));
+    BDI_CHECK(g.removeNode(a));
+    auto replacement = makeNode(reader, 1);
+    replacement->operation = BDIOperationType::ARITH_SUB;
+    BDI_CHECK(g.addNode(std::move(replacement)) == reader);
+    BDI_CHECK(g.connectControl(start, reader));
+    g.commitEdit();
+    BDI_CHECK(consistent(g));
+    // 'end' still reads the replacement; its old control edge to 'end' was not re-made
+    BDI_CHECK(g.getNode(end)->get().data_inputs[0].node_id == reader);
+    BDI_CHECK(sameConsumers(g.getDataConsumersFor(reader, 0), {PortRef{end, 0}}));
+    BDI_CHECK(g.getControlSuccessors(start) == std::vector<NodeID>{reader});
+    BDI_CHECK(g.getControlPredecessors(end).empty());
+    // 'a' is gone along with its edges
+    BDI_CHECK(!g.getNode(a));
+    BDI_CHECK(g.getNode(reader)->get().data_inputs.empty());
+ }
+ // Every node, edge list and index entry comes from the arena, which takes few, growing chunks from the
+ // heap and never gives anything back before the graph goes
+ void testArenaAccounting() {
+    BDIGraph graph;
+    const GraphAllocationStats empty = graph.getAllocationStats();
+    const NodeID first = graph.addNode(BDIOperationType::META_START);
+    GraphAllocationStats stats = graph.getAllocationStats();
+    BDI_CHECK(stats.allocations >= empty.allocations + 2); // The node and its index entry
+    BDI_CHECK(stats.bytes_allocated >= empty.bytes_allocated + sizeof(BDINode));
+    BDI_CHECK(stats.chunk_allocations == 1 && stats.chunk_bytes >= bdi::core::graph::GraphArena::INITIAL_CHUNK_SIZE);
+    // Edge lists grow in the arena
+    const NodeID second = graph.addNode(BDIOperationType::ARITH_ADD);
+    stats = graph.getAllocationStats();
+    BDI_CHECK(graph.connectControl(first, second));
+    BDI_CHECK(graph.getAllocationStats().allocations >= stats.allocations + 2); // One list on each end
+    // A node built on the heap is copied in, edge lists included
+    auto outside = std::make_unique<BDINode>(0, BDIOperationType::META_NOP);
+    outside->data_outputs.push_back({BDIType::INT32});
+    outside->control_outputs.push_back(second);
+    BDI_CHECK(outside->data_outputs.get_allocator().resource() == std::pmr::get_default_resource());
+    stats = graph.getAllocationStats();
+    const NodeID moved = graph.addNode(std::move(outside));
+    BDI_CHECK(graph.getAllocationStats().allocations >= stats.allocations + 3);
+    BDI_CHECK(graph.getNode(moved)->get().data_outputs.get_allocator().resource() !=
+              std::pmr::get_default_resource());
+    // Many nodes: a handful of chunks, and every byte served fits in them
+    for (int i = 0; i < 20000; ++i) {
+        const NodeID id = graph.addNode(BDIOperationType::ARITH_ADD);
+        graph.getNode(id)->get().data_outputs.push_back({BDIType::INT64});
+        graph.connectData(id - 1, 0, id, 0);
+    }
+    stats = graph.getAllocationStats();
+    BDI_CHECK(stats.allocations > 60000);
+    BDI_CHECK(stats.chunk_allocations > 1 && stats.chunk_allocations < 20);
+    BDI_CHECK(stats.chunk_bytes >= stats.bytes_allocated);
+    // Removal frees nothing, and the counters never go down
+    std::vector<NodeID> removed;
+    for (NodeID id = 100; id < 10100; ++id) removed.push_back(id);
+    BDI_CHECK(graph.removeNodes(removed) == removed.size());
+    const GraphAllocationStats after = graph.getAllocationStats();
+    BDI_CHECK(after.bytes_allocated == stats.bytes_allocated && after.chunk_bytes == stats.chunk_bytes);
+    BDI_CHECK(after.allocations == stats.allocations);
+    // Moving the graph moves the arena, counters and all
+    BDIGraph other(std::move(graph));
+    BDI_CHECK(other.getAllocationStats().allocations == after.allocations && other.getNodeCount() == 20003 - removed.size());
+ }
+ // Equal names share one table entry whatever they were made from, across graphs, threads and a
+ // serialization round trip; the empty name takes no entry
+ void testNameInterning() {
+    const std::string text = "GraphTests.interning." + std::to_string(InternedName::getTableSize());
+    const size_t before = InternedName::getTableSize();
+    const InternedName a(text);
+    const InternedName b{std::string_view(text)};
+    const InternedName c(text.c_str());
+    BDI_CHECK(InternedName::getTableSize() == before + 1);
+    BDI_CHECK(a == b && b == c && a.data() == b.data() && b.data() == c.data());
+    BDI_CHECK(a.data() != text.data() && a == std::string_view(text) && a.size() == text.size());
+    const InternedName other(text + "x");
+    BDI_CHECK(!(a == other) && InternedName::getTableSize() == before + 2);
+    const InternedName none;
+    BDI_CHECK(none == InternedName("") && none == InternedName(std::string()) && none.empty() && none.size() == 0);
+    BDI_CHECK(none.view().empty() && InternedName::getTableSize() == before + 2);
+    // Port names in different graphs, and a name outliving its graph
+    InternedName kept;
+    {
+        BDIGraph one;
+        BDIGraph two;
+        const NodeID x = one.addNode(BDIOperationType::META_NOP);
+        const NodeID y = two.addNode(BDIOperationType::META_NOP);
+        one.getNode(x)->get().data_outputs.push_back({BDIType::INT32, text});
+        two.getNode(y)->get().data_outputs.push_back({BDIType::INT64, std::string(text)});
+        kept = one.getNode(x)->get().data_outputs[0].name;
+        BDI_CHECK(kept == two.getNode(y)->get().data_outputs[0].name && kept.data() == a.data());
+        // Read back from the record stream
+        std::stringstream stream;
+        BDI_CHECK(one.serialize(stream));
+        auto copy = BDIGraph::deserialize(stream);
+        BDI_CHECK(copy && copy->getNode(x) && copy->getNode(x)->get().data_outputs[0].name.data() == a.data());
+    }
+    BDI_CHECK(kept.str() == text && InternedName::getTableSize() == before + 2);
+    // Racing threads interning the same new names agree on every entry
+    constexpr int THREADS = 4;
+    constexpr int NAMES = 500;
+    std::vector<std::vector<const char*>> seen(THREADS, std::vector<const char*>(NAMES));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < NAMES; ++i) seen[t][i] = InternedName(text + ".thread." + std::to_string(i)).data();
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (int t = 1; t < THREADS; ++t) BDI_CHECK(seen[t] == seen[0]);
+    BDI_CHECK(InternedName::getTableSize() == before + 2 + NAMES);
+ }
+ // A removed node is gone for good: its ID is not handed out again, a node re-added under it is a new
+ // node without the old edges, and the nodes that stay are not moved
+ void testNodeLifetime() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{1});
+    const NodeID sum = t.op(BDIOperationType::ARITH_ADD, {a, a}, BDIType::INT32, true);
+    const NodeID end = t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, true);
+    BDIGraph& g = t.graph;
+    const BDINode* start_node = &g.getNode(start)->get();
+    const BDINode* end_node = &g.getNode(end)->get();
+    const BDINode* old_sum = &g.getNode(sum)->get();
+    BDI_CHECK(g.removeNode(sum) && !g.getNode(sum) && !g.removeNode(sum));
+    BDI_CHECK(g.getNodeCount() == 3 && consistent(g));
+    // Edges to it are gone on both ends
+    BDI_CHECK(g.getControlSuccessors(start).empty() && g.getControlPredecessors(end).empty());
+    BDI_CHECK(g.getDataConsumersFor(a, 0).empty() && g.getNode(end)->get().data_inputs[0].node_id == 0);
+    // New IDs are fresh; a node asked for under the old ID gets it, with nothing of the old one
+    for (int i = 0; i < 1000; ++i) BDI_CHECK(g.addNode(BDIOperationType::META_NOP) > end);
+    BDI_CHECK(g.addNode(makeNode(sum, 1)) == sum);
+    const BDINode& replacement = g.getNode(sum)->get();
+    BDI_CHECK(&replacement != old_sum); // Arena memory is not reused
+    BDI_CHECK(replacement.data_inputs.empty() && replacement.control_inputs.empty() && replacement.control_outputs.empty());
+    BDI_CHECK(g.getDataConsumersFor(sum, 0).empty() && consistent(g));
+    // The nodes that stayed did not move, through all the insertions
+    BDI_CHECK(&g.getNode(start)->get() == start_node && &g.getNode(end)->get() == end_node);
+    BDI_CHECK(start_node->id == start && end_node->operation == BDIOperationType::META_END);
+    // Removed inside an edit: gone at once, edges swept at commit
+    g.beginEdit();
+    BDI_CHECK(g.connectData(sum, 0, end, 0) && g.removeNode(sum) && !g.getNode(sum));
+    g.commitEdit();
+    BDI_CHECK(g.getNode(end)->get().data_inputs[0].node_id == 0 && consistent(g));
+    // Moving the graph keeps every node where it is
+    BDIGraph moved(std::move(g));
+    BDI_CHECK(&moved.getNode(start)->get() == start_node && &moved.getNode(end)->get() == end_node);
+ }
+ } // namespace
+ int main() {
+    testRandomEdits();
+    testReplaceInEdit();
+    testArenaAccounting();
+    testNameInterning();
+    testNodeLifetime();
+    return bdi::tests::finish("GraphTests");
+ }
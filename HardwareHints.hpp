@@ -0,0 +1,21 @@
+// File: bdi/meta/HardwareHints.hpp
+ #ifndef BDI_META_HARDWAREHINTS_HPP
+ #define BDI_META_HARDWAREHINTS_HPP
+ #include <cstdint>
+ namespace bdi::meta {
+ // Execution unit a node would like to run on
+ enum class ExecutionUnit : uint8_t {
+    ANY,
+    CPU_SCALAR, // No SIMD (e.g. for bit-exact reproduction of reference results)
+    CPU_SIMD,
+    GPU,
+    FPGA
+ };
+ // Per-node hardware hints, attached through the node's metadata handle
+ struct HardwareHints {
+    ExecutionUnit preferred_unit = ExecutionUnit::ANY;
+    uint32_t alignment = 0;      // Guaranteed byte alignment of the node's buffer operands (0 = unknown)
+    uint32_t latency_cycles = 0; // Expected latency, for schedulers (0 = unknown)
+ };
+ } // namespace bdi::meta
+ #endif // BDI_META_HARDWAREHINTS_HPP
@@ -0,0 +1,38 @@
+// File: bdi/core/graph/InternedName.cpp
+ #include "InternedName.hpp"
+ #include <mutex>
+ #include <shared_mutex>
+ #include <unordered_set>
+ namespace bdi::core::graph {
+ namespace {
+ struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+ };
+ struct NameTable {
+    std::shared_mutex mutex;
+    // Node-based set: element addresses are stable across rehashing
+    std::unordered_set<std::string, NameHash, std::equal_to<>> names;
+ };
+ NameTable& table() {
+    static NameTable instance; // Lives until exit; handles may outlive any graph
+    return instance;
+ }
+ } // namespace
+ const std::string* InternedName::intern(std::string_view text) {
+    if (text.empty()) return nullptr;
+    NameTable& t = table();
+    {
+        std::shared_lock<std::shared_mutex> lock(t.mutex);
+        auto it = t.names.find(text);
+        if (it != t.names.end()) return &*it;
+    }
+    std::unique_lock<std::shared_mutex> lock(t.mutex);
+    return &*t.names.emplace(text).first;
+ }
+ size_t InternedName::getTableSize() {
+    NameTable& t = table();
+    std::shared_lock<std::shared_mutex> lock(t.mutex);
+    return t.names.size();
+ }
+ } // namespace bdi::core::graph
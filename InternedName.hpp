@@ -0,0 +1,32 @@
+// File: bdi/core/graph/InternedName.hpp
+ #ifndef BDI_CORE_GRAPH_INTERNEDNAME_HPP
+ #define BDI_CORE_GRAPH_INTERNEDNAME_HPP
+ #include <cstddef>
+ #include <string>
+ #include <string_view>
+ namespace bdi::core::graph {
+ // Handle to a string in the process-wide name table. Equal strings share one entry, so a handle
+ // is one pointer, copies never allocate and equality is a pointer compare.
+ // Entries are never freed: intended for the small, repetitive vocabulary of port and debug names.
+ class InternedName {
+ public:
+    InternedName() = default;
+    InternedName(std::string_view text) : entry_(intern(text)) {}
+    InternedName(const std::string& text) : InternedName(std::string_view(text)) {}
+    InternedName(const char* text) : InternedName(std::string_view(text)) {}
+    std::string_view view() const { return entry_ ? std::string_view(*entry_) : std::string_view(); }
+    operator std::string_view() const { return view(); }
+    const char* data() const { return view().data(); }
+    size_t size() const { return entry_ ? entry_->size() : 0; }
+    bool empty() const { return size() == 0; }
+    std::string str() const { return std::string(view()); }
+    bool operator==(const InternedName& other) const { return entry_ == other.entry_; }
+    bool operator==(std::string_view text) const { return view() == text; }
+    // Number of distinct names interned so far
+    static size_t getTableSize();
+ private:
+    const std::string* entry_ = nullptr; // nullptr is the empty name
+    static const std::string* intern(std::string_view text);
+ };
+ } // namespace bdi::core::graph
+ #endif // BDI_CORE_GRAPH_INTERNEDNAME_HPP
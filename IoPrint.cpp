@@ -0,0 +1,29 @@
+// File: bdi/runtime/IoPrint.cpp
+ #include "IoPrint.hpp"
+ #include "OperationSemantics.hpp"
+ #include <iostream>
+ #include <mutex>
+ #include <sstream>
+ namespace bdi::runtime {
+ namespace {
+ std::mutex print_mutex;
+ void printLine(NodeID node_id, const uint32_t* lane, const RuntimeValue& value) {
+    // Formatted outside the lock; the lock only covers the write
+    std::ostringstream line;
+    line << "[BDI " << node_id;
+    if (lane) line << " #" << *lane;
+    line << "] ";
+    if (value.type == BDIType::FLOAT32 || value.type == BDIType::FLOAT64) line << loadAs<double>(value);
+    else line << loadAs<int64_t>(value);
+    line << '\n';
+    std::lock_guard lock(print_mutex);
+    std::cout << line.view();
+ }
+ } // namespace
+ void printValue(NodeID node_id, const RuntimeValue& value) {
+    printLine(node_id, nullptr, value);
+ }
+ void printValue(NodeID node_id, uint32_t lane, const RuntimeValue& value) {
+    printLine(node_id, &lane, value);
+ }
+ } // namespace bdi::runtime
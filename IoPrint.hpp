@@ -0,0 +1,15 @@
+// File: bdi/runtime/IoPrint.hpp
+ #ifndef BDI_RUNTIME_IOPRINT_HPP
+ #define BDI_RUNTIME_IOPRINT_HPP
+ #include "../core/graph/BDINode.hpp"
+ #include "RuntimeValue.hpp"
+ #include <cstdint>
+ namespace bdi::runtime {
+ using bdi::core::graph::NodeID;
+ // IO_PRINT for every engine: writes "[BDI <node>] <value>" (batch lanes: "[BDI <node> #<lane>] <value>")
+ // to std::cout as one line under a process-wide lock, so lines of concurrent workers never interleave.
+ // Floats print as double, everything else as int64. Not flushed; the stream buffers as usual.
+ void printValue(NodeID node_id, const RuntimeValue& value);
+ void printValue(NodeID node_id, uint32_t lane, const RuntimeValue& value);
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_IOPRINT_HPP
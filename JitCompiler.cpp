@@ -0,0 +1,661 @@
+// File: bdi/runtime/jit/JitCompiler.cpp
+ #include "JitCompiler.hpp"
+ #include "../OperationSemantics.hpp"
+ #include <algorithm>
+ #include <cstring>
+ #include <type_traits>
+ #include <unordered_map>
+ #include <vector>
+ #if BDI_JIT_X86_64
+ #include <sys/mman.h>
+ #include <unistd.h>
+ #endif
+ namespace bdi::runtime::jit {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::INVALID_NODE_INDEX;
+ using bdi::core::graph::INVALID_SLOT_INDEX;
+ using bdi::core::graph::SlotIndex;
+ static_assert(sizeof(RuntimeValue) == 16 && offsetof(RuntimeValue, type) == 0 && offsetof(RuntimeValue, bits) == 8,
+               "Generated code addresses slot fields by offset");
+ static_assert(offsetof(JitFrame, slots) == 0 && offsetof(JitFrame, step_budget) == 8 && offsetof(JitFrame, steps) == 16,
+               "Generated code addresses frame fields by offset");
+ JitCode::~JitCode() {
+ #if BDI_JIT_X86_64
+    if (memory_) munmap(memory_, mapped_size_);
+ #endif
+ }
+ #if BDI_JIT_X86_64
+ namespace {
+ using Op = BDIOperationType;
+ // --- Machine Code Emitter --
+ // The subset of x86-64 the region compiler uses. Labels are patched with rel32 displacements at finish().
+ enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+ enum Cond : uint8_t { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+                       CC_NS = 0x9, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+ // Opcodes of the "op r/m64, r64" ALU forms
+ enum Alu : uint8_t { ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_XOR = 0x31, ALU_CMP = 0x39, ALU_TEST = 0x85 };
+ // ModRM extensions of the group opcodes (F7, 83, D3)
+ enum Ext : uint8_t { EXT_ROL = 0, EXT_ROR = 1, EXT_NOT = 2, EXT_NEG = 3, EXT_SHL = 4, EXT_SHR = 5, EXT_DIV = 6,
+                      EXT_IDIV = 7, EXT_SAR = 7 };
+ enum ImmOp : uint8_t { IMM_ADD = 0, IMM_AND = 4, IMM_SUB = 5, IMM_XOR = 6, IMM_CMP = 7 };
+ class Assembler {
+ public:
+    using Label = uint32_t;
+    Label newLabel() {
+        labels_.push_back(-1);
+        return static_cast<Label>(labels_.size() - 1);
+    }
+    void bind(Label label) { labels_[label] = static_cast<int64_t>(code_.size()); }
+    void jmp(Label label) { byte(0xE9); fixup(label); }
+    void jcc(Cond cond, Label label) { byte(0x0F); byte(0x80 | cond); fixup(label); }
+    void push(Reg r) { if (r >= R8) byte(0x41); byte(0x50 | (r & 7)); }
+    void pop(Reg r) { if (r >= R8) byte(0x41); byte(0x58 | (r & 7)); }
+    void ret() { byte(0xC3); }
+    void movImm(Reg r, uint64_t value) {
+        if (value <= UINT32_MAX) { // mov r32, imm32 zero-extends
+            if (r >= R8) byte(0x41);
+            byte(0xB8 | (r & 7));
+            imm(value, 4);
+        } else if (static_cast<int64_t>(value) == static_cast<int32_t>(value)) {
+            rexRm(true, 0, r);
+            byte(0xC7);
+            modrm(0, r);
+            imm(value, 4);
+        } else {
+            byte(0x48 | (r >= R8 ? 1 : 0));
+            byte(0xB8 | (r & 7));
+            imm(value, 8);
+        }
+    }
+    void mov(Reg dst, Reg src) { aluRR(0x89, dst, src); }
+    void load(Reg dst, Reg base, int32_t disp) { rexMem(true, dst, base); byte(0x8B); mem(dst, base, disp); }
+    void store(Reg base, int32_t disp, Reg src) { rexMem(true, src, base); byte(0x89); mem(src, base, disp); }
+    void storeByte(Reg base, int32_t disp, uint8_t value) { rexMem(false, 0, base); byte(0xC6); mem(0, base, disp); byte(value); }
+    void cmpByte(Reg base, int32_t disp, uint8_t value) { rexMem(false, 0, base); byte(0x80); mem(7, base, disp); byte(value); }
+    void alu(Alu op, Reg dst, Reg src) { aluRR(op, dst, src); }
+    void aluImm(ImmOp op, Reg r, int8_t value) { rexRm(true, 0, r); byte(0x83); modrm(op, r); byte(static_cast<uint8_t>(value)); }
+    void imul(Reg dst, Reg src) { rexRm(true, dst, src); byte(0x0F); byte(0xAF); modrm(dst, src); }
+    void unary(Ext ext, Reg r) { rexRm(true, 0, r); byte(0xF7); modrm(ext, r); }
+    void cqo() { byte(0x48); byte(0x99); }
+    void bsr(Reg dst, Reg src) { rexRm(true, dst, src); byte(0x0F); byte(0xBD); modrm(dst, src); }
+    void bsf(Reg dst, Reg src) { rexRm(true, dst, src); byte(0x0F); byte(0xBC); modrm(dst, src); }
+    void popcnt(Reg dst, Reg src) { byte(0xF3); rexRm(true, dst, src); byte(0x0F); byte(0xB8); modrm(dst, src); }
+    // Shift or rotate the low 'width' bits of r by CL
+    void shiftCl(Ext ext, Reg r, unsigned width) {
+        if (width == 16) byte(0x66);
+        rexRm(width == 64, 0, r, width == 8 && r >= RSP);
+        byte(width == 8 ? 0xD2 : 0xD3);
+        modrm(ext, r);
+    }
+    // setcc into the low byte of r, then zero-extend it
+    void setcc(Cond cond, Reg r) {
+        rexRm(false, 0, r, r >= RSP);
+        byte(0x0F); byte(0x90 | cond); modrm(0, r);
+        extend(r, 8, false);
+    }
+    // Replace r by its low 'width' bits, sign- or zero-extended to 64
+    void extend(Reg r, unsigned width, bool sign) {
+        switch (width) {
+            case 8:  rexRm(true, r, r); byte(0x0F); byte(sign ? 0xBE : 0xB6); modrm(r, r); break;
+            case 16: rexRm(true, r, r); byte(0x0F); byte(sign ? 0xBF : 0xB7); modrm(r, r); break;
+            case 32:
+                if (sign) { rexRm(true, r, r); byte(0x63); modrm(r, r); }
+                else { rexRm(false, r, r); byte(0x89); modrm(r, r); } // mov r32, r32 clears the upper half
+                break;
+            default: break;
+        }
+    }
+    // Resolve labels; false if one was never bound
+    bool finish(std::vector<uint8_t>& out) {
+        for (const auto& [at, label] : fixups_) {
+            if (labels_[label] < 0) return false;
+            const int32_t rel = static_cast<int32_t>(labels_[label] - static_cast<int64_t>(at + 4));
+            std::memcpy(code_.data() + at, &rel, 4);
+        }
+        out = std::move(code_);
+        return true;
+    }
+ private:
+    std::vector<uint8_t> code_;
+    std::vector<int64_t> labels_; // Code offset, -1 while unbound
+    std::vector<std::pair<size_t, Label>> fixups_;
+    void byte(uint8_t b) { code_.push_back(b); }
+    void imm(uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i) byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void fixup(Label label) {
+        fixups_.emplace_back(code_.size(), label);
+        imm(0, 4);
+    }
+    // REX for a register-direct ModRM; 'force' selects SPL/BPL/SIL/DIL for byte operands
+    void rexRm(bool w, uint8_t reg, uint8_t rm, bool force = false) {
+        const uint8_t rex = 0x40 | (w ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+        if (rex != 0x40 || force) byte(rex);
+    }
+    void rexMem(bool w, uint8_t reg, uint8_t base) { rexRm(w, reg, base); }
+    void modrm(uint8_t reg, uint8_t rm) { byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+    void mem(uint8_t reg, uint8_t base, int32_t disp) {
+        byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == RSP) byte(0x24); // SIB: base only
+        imm(static_cast<uint32_t>(disp), 4);
+    }
+    void aluRR(uint8_t op, Reg dst, Reg src) { rexRm(true, src, dst); byte(op); modrm(src, dst); }
+ };
+ // --- Types --
+ // Integer and BOOL values live in registers in canonical form: their C++ value (BOOL as uint8_t) sign- or
+ // zero-extended to 64 bits. Slots hold the value's own bytes zero-extended, as RuntimeValue::make writes them.
+ bool isIntegerType(BDIType type) {
+    switch (type) {
+        case BDIType::BOOL: case BDIType::INT8: case BDIType::UINT8: case BDIType::INT16: case BDIType::UINT16:
+        case BDIType::INT32: case BDIType::UINT32: case BDIType::INT64: case BDIType::UINT64:
+            return true;
+        default:
+            return false;
+    }
+ }
+ bool isSignedType(BDIType type) {
+    return type == BDIType::INT8 || type == BDIType::INT16 || type == BDIType::INT32 || type == BDIType::INT64;
+ }
+ unsigned bitWidth(BDIType type) { return static_cast<unsigned>(getBdiTypeSize(type) * 8); }
+ // loadAs<T>(value) for the integer type T behind 'type', in canonical form
+ uint64_t canonicalValue(const RuntimeValue& value, BDIType type) {
+    uint64_t bits = 0;
+    dispatchScalarType(type, [&](auto tag) {
+        using T = decltype(tag);
+        if constexpr (std::is_integral_v<T>) {
+            const T v = loadAs<T>(value);
+            bits = std::is_signed_v<T> ? static_cast<uint64_t>(static_cast<int64_t>(v)) : static_cast<uint64_t>(v);
+        }
+    });
+    return bits;
+ }
+ bool hasPopcnt() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+ }
+ // --- Region Compiler --
+ class RegionCompiler {
+ public:
+    RegionCompiler(const CompiledGraph& graph, const JitCompiler::PayloadResolver& payload)
+        : g_(graph), payload_(payload), has_popcnt_(hasPopcnt()),
+          types_(graph.getNodeCount(), BDIType::UNKNOWN), type_state_(graph.getNodeCount(), 0),
+          value_state_(graph.getNodeCount(), 0), label_of_(graph.getNodeCount(), NO_LABEL),
+          inline_mark_(graph.getNodeCount(), 0), height_(graph.getNodeCount(), 0) {}
+    // Collect the region: jittable control nodes reachable from 'entry', breadth first
+    bool selectRegion(NodeIndex entry, size_t max_nodes);
+    bool emit(std::vector<uint8_t>& code);
+    size_t getNodeCount() const { return region_.size(); }
+ private:
+    static constexpr uint32_t NO_LABEL = ~0u;
+    // Floating producers are analysed and inlined recursively; deeper cones stay with the interpreter,
+    // which evaluates them with an explicit stack
+    static constexpr uint32_t MAX_INLINE_HEIGHT = 256;
+    enum : uint8_t { STATE_NONE, STATE_ACTIVE, STATE_DONE, STATE_REJECTED };
+    const CompiledGraph& g_;
+    const JitCompiler::PayloadResolver& payload_;
+    const bool has_popcnt_;
+    std::vector<BDIType> types_;       // Static result type per node (UNKNOWN: depends on the run)
+    std::vector<uint8_t> type_state_;
+    uint32_t type_depth_ = 0;          // resultType() calls in progress
+    std::vector<uint8_t> value_state_; // Whether evaluateValue() can compile the node
+    std::vector<NodeIndex> region_;
+    std::vector<uint32_t> label_of_;   // Per NodeIndex, for region members
+    std::vector<uint32_t> inline_mark_; // Control node whose code last evaluated this floating node
+    std::vector<uint32_t> height_;      // Longest chain of inlined floating producers ending at the node
+    uint32_t mark_ = 0;
+    Assembler as_;
+    std::unordered_map<NodeIndex, Assembler::Label> exits_;
+    Assembler::Label epilogue_ = 0;
+    // Analysis
+    BDIType resultType(NodeIndex node);
+    BDIType operandType(NodeIndex node, size_t k);
+    bool isWired(NodeIndex node, size_t k) const;
+    bool canEvaluate(NodeIndex node, uint32_t depth = 0);
+    bool isMember(NodeIndex node);
+    NodeIndex successor(NodeIndex node, size_t k) const;
+    // Code generation
+    Assembler::Label exitLabel(NodeIndex node);
+    Assembler::Label targetLabel(NodeIndex node) {
+        return node != INVALID_NODE_INDEX && label_of_[node] != NO_LABEL ? label_of_[node] : exitLabel(node);
+    }
+    static int32_t slotOffset(SlotIndex slot) { return static_cast<int32_t>(slot * sizeof(RuntimeValue)); }
+    void emitControlNode(size_t position);
+    void prepareOperands(NodeIndex node, size_t count, Assembler::Label deopt);
+    void loadOperand(Reg dst, NodeIndex node, size_t k, BDIType as_type);
+    void canonicalize(Reg r, BDIType type) { as_.extend(r, bitWidth(type), isSignedType(type)); }
+    void storeResult(NodeIndex node, BDIType type);
+    void storeAs(NodeIndex node, BDIType type);
+    void evaluateValue(NodeIndex node, Assembler::Label deopt);
+    void evaluateArithmetic(NodeIndex node, Assembler::Label deopt);
+ };
+ bool RegionCompiler::isWired(NodeIndex node, size_t k) const {
+    auto slots = g_.inputSlots(node);
+    return k < slots.size() && slots[k] != INVALID_SLOT_INDEX;
+ }
+ // Type of the value on a scalar node's output 0 as evaluateScalar produces it
+ BDIType RegionCompiler::resultType(NodeIndex node) {
+    if (type_state_[node] == STATE_DONE) return types_[node];
+    if (type_state_[node] == STATE_ACTIVE) return BDIType::UNKNOWN; // Cycle of UNKNOWN declared types
+    if (type_depth_ >= MAX_INLINE_HEIGHT) return BDIType::UNKNOWN; // Too deep to analyse here: not compiled
+    type_state_[node] = STATE_ACTIVE;
+    ++type_depth_;
+    const Op op = g_.operation(node);
+    const BDIType declared = g_.outputCount(node) ? g_.slotType(g_.outputSlotBase(node)) : BDIType::UNKNOWN;
+    BDIType type = BDIType::UNKNOWN;
+    if (op == Op::META_NOP) type = payload_(node).type;
+    else if (op >= Op::LOGIC_AND && op <= Op::CMP_GE) type = BDIType::BOOL;
+    else if (op >= Op::CONV_TRUNC && op <= Op::CONV_BITCAST) type = declared;
+    else if (isScalarOperation(op)) type = declared != BDIType::UNKNOWN ? declared : operandType(node, 0);
+    --type_depth_;
+    types_[node] = isIntegerType(type) ? type : BDIType::UNKNOWN;
+    type_state_[node] = STATE_DONE;
+    return types_[node];
+ }
+ // Type operand k of 'node' has when the node runs (guarded at run time unless produced inline)
+ BDIType RegionCompiler::operandType(NodeIndex node, size_t k) {
+    if (!isWired(node, k)) {
+        const BDIType type = payload_(node).type;
+        return isIntegerType(type) ? type : BDIType::UNKNOWN;
+    }
+    const SlotIndex slot = g_.inputSlots(node)[k];
+    const NodeIndex src = g_.inputNodes(node)[k];
+    const Op op = g_.operation(src);
+    if (op == Op::META_NOP || (isScalarOperation(op) && !g_.isFloating(src))) {
+        // Both only ever write output 0
+        return slot == g_.outputSlotBase(src) ? resultType(src) : BDIType::UNKNOWN;
+    }
+    if (g_.isFloating(src)) return slot == g_.outputSlotBase(src) ? resultType(src) : BDIType::UNKNOWN;
+    const BDIType declared = g_.slotType(slot);
+    return isIntegerType(declared) ? declared : BDIType::UNKNOWN;
+ }
+ // Scalar node whose operands all have known integer types and whose floating producers compile too
+ bool RegionCompiler::canEvaluate(NodeIndex node, uint32_t depth) {
+    if (value_state_[node] == STATE_DONE) return true;
+    if (value_state_[node] != STATE_NONE) return false; // Rejected, or a cycle among floating nodes
+    if (depth >= MAX_INLINE_HEIGHT) return false;
+    value_state_[node] = STATE_ACTIVE;
+    const Op op = g_.operation(node);
+    const size_t arity = getScalarOperationArity(op);
+    bool ok = arity != 0 && op != Op::CONV_FLOAT_TO_INT && op != Op::CONV_INT_TO_FLOAT &&
+              (op != Op::BIT_POPCOUNT || has_popcnt_);
+    uint32_t height = 1;
+    for (size_t k = 0; ok && k < arity; ++k) {
+        // Producers first, so that the type analysis below finds their types already computed
+        if (isWired(node, k)) {
+            const NodeIndex src = g_.inputNodes(node)[k];
+            if (g_.isFloating(src) && g_.operation(src) != Op::META_NOP) {
+                ok = canEvaluate(src, depth + 1);
+                if (!ok) break;
+                height = std::max(height, height_[src] + 1);
+            }
+        }
+        if (operandType(node, k) == BDIType::UNKNOWN) { ok = false; break; }
+        if (!isWired(node, k) && !payload_(node).isSet()) ok = false;
+    }
+    ok = ok && height <= MAX_INLINE_HEIGHT;
+    height_[node] = height;
+    if (ok) {
+        const BDIType declared = g_.outputCount(node) ? g_.slotType(g_.outputSlotBase(node)) : BDIType::UNKNOWN;
+        if (op >= Op::CONV_TRUNC && op <= Op::CONV_EXTEND_ZERO) ok = isIntegerType(declared);
+        else if (op == Op::CONV_BITCAST) ok = isIntegerType(declared) && getBdiTypeSize(declared) == getBdiTypeSize(operandType(node, 0));
+        else if (!(op >= Op::LOGIC_AND && op <= Op::CMP_GE)) ok = declared == BDIType::UNKNOWN || isIntegerType(declared);
+    }
+    value_state_[node] = ok ? STATE_DONE : STATE_REJECTED;
+    return ok;
+ }
+ // Control successor k as determineNextNode() picks it (INVALID_NODE_INDEX halts)
+ NodeIndex RegionCompiler::successor(NodeIndex node, size_t k) const {
+    auto successors = g_.controlSuccessors(node);
+    return k < successors.size() ? successors[k] : INVALID_NODE_INDEX;
+ }
+ bool RegionCompiler::isMember(NodeIndex node) {
+    switch (g_.operation(node)) {
+        case Op::META_START:
+        case Op::META_COMMENT:
+        case Op::CTRL_JUMP:
+            return true;
+        case Op::META_NOP:
+            return g_.outputCount(node) == 0 || isIntegerType(payload_(node).type);
+        case Op::CTRL_BRANCH_COND: {
+            if (g_.controlSuccessors(node).size() < 2) return false;
+            if (!isWired(node, 0)) return operandType(node, 0) != BDIType::UNKNOWN && payload_(node).isSet();
+            const NodeIndex src = g_.inputNodes(node)[0];
+            if (g_.isFloating(src) && g_.operation(src) != Op::META_NOP && !canEvaluate(src)) return false;
+            return operandType(node, 0) != BDIType::UNKNOWN;
+        }
+        default:
+            return canEvaluate(node);
+    }
+ }
+ bool RegionCompiler::selectRegion(NodeIndex entry, size_t max_nodes) {
+    if (g_.getSlotCount() > INT32_MAX / sizeof(RuntimeValue)) return false;
+    std::vector<NodeIndex> queue{entry};
+    std::vector<uint8_t> queued(g_.getNodeCount(), 0);
+    queued[entry] = 1;
+    for (size_t head = 0; head < queue.size() && region_.size() < max_nodes; ++head) {
+        const NodeIndex node = queue[head];
+        if (!isMember(node)) continue;
+        label_of_[node] = as_.newLabel();
+        region_.push_back(node);
+        const size_t successors = g_.operation(node) == Op::CTRL_BRANCH_COND ? 2 : 1;
+        for (size_t k = 0; k < successors; ++k) {
+            const NodeIndex next = successor(node, k);
+            if (next != INVALID_NODE_INDEX && !queued[next]) {
+                queued[next] = 1;
+                queue.push_back(next);
+            }
+        }
+    }
+    return !region_.empty() && region_.front() == entry;
+ }
+ // Hands 'node' (not executed) back to the interpreter
+ Assembler::Label RegionCompiler::exitLabel(NodeIndex node) {
+    auto [it, inserted] = exits_.try_emplace(node, 0);
+    if (inserted) it->second = as_.newLabel();
+    return it->second;
+ }
+ bool RegionCompiler::emit(std::vector<uint8_t>& code) {
+    // rdi = frame, rbx = slots, r12 = steps taken, r13 = step budget
+    epilogue_ = as_.newLabel();
+    as_.push(RBX);
+    as_.push(R12);
+    as_.push(R13);
+    as_.load(RBX, RDI, 0);
+    as_.load(R13, RDI, 8);
+    as_.alu(ALU_XOR, R12, R12);
+    for (size_t i = 0; i < region_.size(); ++i) emitControlNode(i);
+    for (const auto& [node, label] : exits_) {
+        as_.bind(label);
+        as_.movImm(RAX, node);
+        as_.jmp(epilogue_);
+    }
+    as_.bind(epilogue_);
+    as_.store(RDI, 16, R12);
+    as_.pop(R13);
+    as_.pop(R12);
+    as_.pop(RBX);
+    as_.ret();
+    return as_.finish(code);
+ }
+ void RegionCompiler::emitControlNode(size_t position) {
+    const NodeIndex node = region_[position];
+    const NodeIndex fallthrough = position + 1 < region_.size() ? region_[position + 1] : INVALID_NODE_INDEX;
+    const Assembler::Label deopt = exitLabel(node);
+    as_.bind(label_of_[node]);
+    as_.alu(ALU_CMP, R12, R13);
+    as_.jcc(CC_AE, deopt);
+    ++mark_; // Floating producers are evaluated once per step
+    const Op op = g_.operation(node);
+    if (op == Op::CTRL_BRANCH_COND) {
+        prepareOperands(node, 1, deopt);
+        loadOperand(RAX, node, 0, operandType(node, 0));
+        as_.aluImm(IMM_ADD, R12, 1);
+        as_.alu(ALU_TEST, RAX, RAX);
+        as_.jcc(CC_NE, targetLabel(successor(node, 0)));
+        const NodeIndex target = successor(node, 1);
+        if (target != fallthrough || target == INVALID_NODE_INDEX) as_.jmp(targetLabel(target));
+        return;
+    }
+    if (op == Op::META_NOP) {
+        if (g_.outputCount(node)) {
+            // Publish the payload as it is, bits beyond the type's size included
+            const RuntimeValue value = payload_(node);
+            const int32_t offset = slotOffset(g_.outputSlotBase(node));
+            as_.movImm(RAX, value.bits);
+            as_.store(RBX, offset + 8, RAX);
+            as_.storeByte(RBX, offset, static_cast<uint8_t>(value.type));
+        }
+    } else if (op != Op::META_START && op != Op::META_COMMENT && op != Op::CTRL_JUMP) {
+        evaluateValue(node, deopt);
+    }
+    as_.aluImm(IMM_ADD, R12, 1);
+    const NodeIndex target = successor(node, 0);
+    if (target != fallthrough || target == INVALID_NODE_INDEX) as_.jmp(targetLabel(target));
+ }
+ // Evaluate floating producers of the first 'count' operands and check the types of the others
+ void RegionCompiler::prepareOperands(NodeIndex node, size_t count, Assembler::Label deopt) {
+    for (size_t k = 0; k < count; ++k) {
+        if (!isWired(node, k)) continue;
+        const NodeIndex src = g_.inputNodes(node)[k];
+        if (g_.isFloating(src) && g_.operation(src) != Op::META_NOP) {
+            if (inline_mark_[src] != mark_) {
+                inline_mark_[src] = mark_;
+                evaluateValue(src, deopt);
+            }
+            continue;
+        }
+        // An unset slot (never produced) fails the check too, as it fails the interpreter
+        as_.cmpByte(RBX, slotOffset(g_.inputSlots(node)[k]), static_cast<uint8_t>(operandType(node, k)));
+        as_.jcc(CC_NE, deopt);
+    }
+ }
+ // Operand k converted to 'as_type' (loadAs), in canonical form
+ void RegionCompiler::loadOperand(Reg dst, NodeIndex node, size_t k, BDIType as_type) {
+    if (!isWired(node, k)) {
+        as_.movImm(dst, canonicalValue(payload_(node), as_type));
+        return;
+    }
+    as_.load(dst, RBX, slotOffset(g_.inputSlots(node)[k]) + 8);
+    const BDIType own = operandType(node, k);
+    canonicalize(dst, own);
+    if (as_type != own) canonicalize(dst, as_type);
+ }
+ // Write rax (raw bits, zero-extended) with 'type' to the node's output 0
+ void RegionCompiler::storeResult(NodeIndex node, BDIType type) {
+    if (!g_.outputCount(node)) return;
+    const int32_t offset = slotOffset(g_.outputSlotBase(node));
+    if (isSignedType(type)) as_.extend(RAX, bitWidth(type), false);
+    as_.store(RBX, offset + 8, RAX);
+    as_.storeByte(RBX, offset, static_cast<uint8_t>(type));
+ }
+ // storeAs(type, rax): BOOL normalized to 0/1, any other type truncated to its width
+ void RegionCompiler::storeAs(NodeIndex node, BDIType type) {
+    if (type == BDIType::BOOL) {
+        as_.alu(ALU_TEST, RAX, RAX);
+        as_.setcc(CC_NE, RAX);
+    } else {
+        canonicalize(RAX, type);
+    }
+    storeResult(node, type);
+ }
+ void RegionCompiler::evaluateValue(NodeIndex node, Assembler::Label deopt) {
+    const Op op = g_.operation(node);
+    const size_t arity = getScalarOperationArity(op);
+    prepareOperands(node, arity, deopt);
+    const BDIType declared = g_.outputCount(node) ? g_.slotType(g_.outputSlotBase(node)) : BDIType::UNKNOWN;
+    const BDIType a_type = operandType(node, 0);
+    if (op >= Op::LOGIC_AND && op <= Op::LOGIC_NOT) {
+        loadOperand(RAX, node, 0, a_type);
+        as_.alu(ALU_TEST, RAX, RAX);
+        as_.setcc(CC_NE, RAX);
+        if (op == Op::LOGIC_NOT) {
+            as_.aluImm(IMM_XOR, RAX, 1);
+        } else {
+            loadOperand(RCX, node, 1, operandType(node, 1));
+            as_.alu(ALU_TEST, RCX, RCX);
+            as_.setcc(CC_NE, RCX);
+            as_.alu(op == Op::LOGIC_AND ? ALU_AND : op == Op::LOGIC_OR ? ALU_OR : ALU_XOR, RAX, RCX);
+        }
+        storeResult(node, BDIType::BOOL);
+        return;
+    }
+    if (op >= Op::CMP_EQ && op <= Op::CMP_GE) {
+        const bool sign = isSignedType(a_type);
+        Cond cond = CC_E;
+        switch (op) {
+            case Op::CMP_NE: cond = CC_NE; break;
+            case Op::CMP_LT: cond = sign ? CC_L : CC_B; break;
+            case Op::CMP_LE: cond = sign ? CC_LE : CC_BE; break;
+            case Op::CMP_GT: cond = sign ? CC_G : CC_A; break;
+            case Op::CMP_GE: cond = sign ? CC_GE : CC_AE; break;
+            default: break;
+        }
+        loadOperand(RAX, node, 0, a_type);
+        loadOperand(RCX, node, 1, a_type);
+        as_.alu(ALU_CMP, RAX, RCX);
+        as_.setcc(cond, RAX);
+        storeResult(node, BDIType::BOOL);
+        return;
+    }
+    switch (op) {
+        case Op::CONV_TRUNC:
+            loadOperand(RAX, node, 0, a_type);
+            storeAs(node, declared);
+            return;
+        case Op::CONV_EXTEND_SIGN:
+        case Op::CONV_EXTEND_ZERO:
+            // Reinterpret the operand's bits as a signed / unsigned integer of its size, then convert
+            loadOperand(RAX, node, 0, a_type);
+            as_.extend(RAX, bitWidth(a_type), op == Op::CONV_EXTEND_SIGN);
+            storeAs(node, declared);
+            return;
+        case Op::CONV_BITCAST:
+            // The bits are kept as they are
+            if (isWired(node, 0)) as_.load(RAX, RBX, slotOffset(g_.inputSlots(node)[0]) + 8);
+            else as_.movImm(RAX, payload_(node).bits);
+            if (g_.outputCount(node)) {
+                const int32_t offset = slotOffset(g_.outputSlotBase(node));
+                as_.store(RBX, offset + 8, RAX);
+                as_.storeByte(RBX, offset, static_cast<uint8_t>(declared));
+            }
+            return;
+        default:
+            evaluateArithmetic(node, deopt);
+            storeAs(node, declared != BDIType::UNKNOWN ? declared : a_type);
+            return;
+    }
+ }
+ // Arithmetic and bitwise operations in the type of operand 0; the result is left in rax
+ void RegionCompiler::evaluateArithmetic(NodeIndex node, Assembler::Label deopt) {
+    const Op op = g_.operation(node);
+    const size_t arity = getScalarOperationArity(op);
+    const BDIType type = operandType(node, 0);
+    const unsigned width = bitWidth(type);
+    const bool sign = isSignedType(type);
+    loadOperand(RAX, node, 0, type);
+    if (arity > 1) loadOperand(RCX, node, 1, type);
+    if (arity > 2) loadOperand(R8, node, 2, type);
+    switch (op) {
+        case Op::ARITH_ADD: as_.alu(ALU_ADD, RAX, RCX); break;
+        case Op::ARITH_SUB: as_.alu(ALU_SUB, RAX, RCX); break;
+        case Op::ARITH_MUL: as_.imul(RAX, RCX); break;
+        case Op::ARITH_FMA: as_.imul(RAX, RCX); as_.alu(ALU_ADD, RAX, R8); break;
+        case Op::ARITH_NEG: as_.unary(EXT_NEG, RAX); break;
+        case Op::ARITH_INC: as_.aluImm(IMM_ADD, RAX, 1); break;
+        case Op::ARITH_DEC: as_.aluImm(IMM_SUB, RAX, 1); break;
+        case Op::ARITH_ABS:
+            if (sign) {
+                const Assembler::Label done = as_.newLabel();
+                as_.alu(ALU_TEST, RAX, RAX);
+                as_.jcc(CC_NS, done);
+                as_.unary(EXT_NEG, RAX);
+                as_.bind(done);
+            }
+            break;
+        case Op::ARITH_DIV:
+        case Op::ARITH_MOD: {
+            // Division by zero is an execution error: leave it to the interpreter
+            as_.alu(ALU_TEST, RCX, RCX);
+            as_.jcc(CC_E, deopt);
+            const Assembler::Label done = as_.newLabel();
+            if (sign) {
+                const Assembler::Label divide = as_.newLabel();
+                as_.aluImm(IMM_CMP, RCX, -1);
+                as_.jcc(CC_NE, divide);
+                if (op == Op::ARITH_DIV) as_.unary(EXT_NEG, RAX);
+                else as_.alu(ALU_XOR, RAX, RAX);
+                as_.jmp(done);
+                as_.bind(divide);
+                as_.cqo();
+                as_.unary(EXT_IDIV, RCX);
+            } else {
+                as_.alu(ALU_XOR, RDX, RDX);
+                as_.unary(EXT_DIV, RCX);
+            }
+            if (op == Op::ARITH_MOD) as_.mov(RAX, RDX);
+            as_.bind(done);
+            break;
+        }
+        case Op::BIT_AND: as_.alu(ALU_AND, RAX, RCX); break;
+        case Op::BIT_OR:  as_.alu(ALU_OR, RAX, RCX); break;
+        case Op::BIT_XOR: as_.alu(ALU_XOR, RAX, RCX); break;
+        case Op::BIT_NOT: as_.unary(EXT_NOT, RAX); break;
+        case Op::BIT_SHL:
+        case Op::BIT_SHR:
+        case Op::BIT_ASHR:
+        case Op::BIT_ROL:
+        case Op::BIT_ROR:
+            // Counts are taken modulo the width
+            as_.aluImm(IMM_AND, RCX, static_cast<int8_t>(width - 1));
+            if (op == Op::BIT_SHL) {
+                as_.shiftCl(EXT_SHL, RAX, 64);
+            } else if (op == Op::BIT_SHR || op == Op::BIT_ASHR) {
+                as_.extend(RAX, width, op == Op::BIT_ASHR);
+                as_.shiftCl(op == Op::BIT_SHR ? EXT_SHR : EXT_SAR, RAX, 64);
+            } else {
+                as_.shiftCl(op == Op::BIT_ROL ? EXT_ROL : EXT_ROR, RAX, width);
+            }
+            break;
+        case Op::BIT_POPCOUNT:
+            as_.extend(RAX, width, false);
+            as_.popcnt(RAX, RAX);
+            break;
+        case Op::BIT_LZCNT:
+        case Op::BIT_TZCNT: {
+            // Zero counts all bits; bsr/bsf leave their destination undefined for it
+            const Assembler::Label done = as_.newLabel();
+            as_.extend(RAX, width, false);
+            as_.movImm(RCX, width);
+            as_.alu(ALU_TEST, RAX, RAX);
+            as_.jcc(CC_E, done);
+            if (op == Op::BIT_LZCNT) {
+                as_.bsr(RAX, RAX);
+                as_.movImm(RCX, width - 1);
+                as_.alu(ALU_SUB, RCX, RAX);
+            } else {
+                as_.bsf(RCX, RAX);
+            }
+            as_.bind(done);
+            as_.mov(RAX, RCX);
+            break;
+        }
+        default:
+            break;
+    }
+    canonicalize(RAX, type);
+ }
+ } // namespace
+ #endif // BDI_JIT_X86_64
+ bool JitCompiler::isAvailable() {
+    return BDI_JIT_X86_64 != 0;
+ }
+ std::unique_ptr<JitCode> JitCompiler::compileRegion(const CompiledGraph& graph, NodeIndex entry,
+                                                     const PayloadResolver& payload, size_t max_nodes) {
+ #if BDI_JIT_X86_64
+    if (entry >= graph.getNodeCount() || max_nodes == 0) return nullptr;
+    RegionCompiler compiler(graph, payload);
+    std::vector<uint8_t> code;
+    if (!compiler.selectRegion(entry, max_nodes) || !compiler.emit(code)) return nullptr;
+    // Map writable, copy, then flip to executable (never both at once)
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mapped_size = (code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, mapped_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped_size);
+        return nullptr;
+    }
+    std::unique_ptr<JitCode> result(new JitCode());
+    result->memory_ = memory;
+    result->mapped_size_ = mapped_size;
+    result->code_size_ = code.size();
+    result->node_count_ = compiler.getNodeCount();
+    result->entry_ = reinterpret_cast<JitCode::EntryFunction>(memory);
+    return result;
+ #else
+    (void)graph; (void)entry; (void)payload; (void)max_nodes;
+    return nullptr;
+ #endif
+ }
+ } // namespace bdi::runtime::jit
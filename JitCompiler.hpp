@@ -0,0 +1,67 @@
+// File: bdi/runtime/jit/JitCompiler.hpp
+ #ifndef BDI_RUNTIME_JIT_JITCOMPILER_HPP
+ #define BDI_RUNTIME_JIT_JITCOMPILER_HPP
+ #include "../../core/graph/CompiledGraph.hpp"
+ #include "../RuntimeValue.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <functional>
+ #include <memory>
+ // Native code generation needs an x86-64 target and mmap/mprotect for executable memory
+ #if !defined(BDI_JIT_X86_64)
+    #if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+        #define BDI_JIT_X86_64 1
+    #else
+        #define BDI_JIT_X86_64 0
+    #endif
+ #endif
+ namespace bdi::runtime::jit {
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeIndex;
+ // Interface between the VM and native code. Generated code addresses the fields by offset.
+ struct JitFrame {
+    RuntimeValue* slots = nullptr; // The VM's value slots, read and written in place
+    uint64_t step_budget = 0;      // Steps native code may take before handing back (step limit)
+    uint64_t steps = 0;            // Steps taken, set on return
+ };
+ // Native code for one region of a CompiledGraph: control nodes reachable from an entry node.
+ // Each node updates the value slots exactly as the interpreter would. Code hands back at a node
+ // boundary: when control leaves the region, at the step budget, or before a node whose operands do not
+ // have the types the code was compiled for or that would fail (division by zero, unset operand, ...).
+ // The interpreter then executes that node itself.
+ class JitCode {
+ public:
+    ~JitCode();
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+    // Returns the node to continue at (not executed yet), or INVALID_NODE_INDEX if execution halted
+    NodeIndex run(JitFrame& frame) const { return entry_(&frame); }
+    size_t getNodeCount() const { return node_count_; }
+    size_t getCodeSize() const { return code_size_; }
+ private:
+    friend class JitCompiler;
+    using EntryFunction = NodeIndex (*)(JitFrame*);
+    JitCode() = default;
+    void* memory_ = nullptr;
+    size_t mapped_size_ = 0;
+    size_t code_size_ = 0;
+    size_t node_count_ = 0;
+    EntryFunction entry_ = nullptr;
+ };
+ // Compiles regions of CTRL_JUMP, CTRL_BRANCH_COND and scalar ARITH_*, BIT_*, LOGIC_*, CMP_* and
+ // integer CONV_* nodes whose operand types are known before running (declared output types, constant
+ // payloads), over BOOL and the integer types. Floating producers are evaluated inline, once per step.
+ // Floating-point values and every other operation are left to the interpreter.
+ class JitCompiler {
+ public:
+    // Payload of a node as the VM sees it (overrides included); baked into the code as immediates
+    using PayloadResolver = std::function<RuntimeValue(NodeIndex)>;
+    static constexpr size_t DEFAULT_MAX_REGION_NODES = 1024;
+    static bool isAvailable();
+    // nullptr if the entry node cannot be compiled or native code is not available
+    static std::unique_ptr<JitCode> compileRegion(const CompiledGraph& graph, NodeIndex entry,
+                                                  const PayloadResolver& payload,
+                                                  size_t max_nodes = DEFAULT_MAX_REGION_NODES);
+ };
+ } // namespace bdi::runtime::jit
+ #endif // BDI_RUNTIME_JIT_JITCOMPILER_HPP
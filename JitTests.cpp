@@ -0,0 +1,156 @@
+// File: bdi/tests/JitTests.cpp
+ // Native code against the interpreter: every ARITH / BIT / LOGIC / CMP / CONV opcode over every scalar
+ // type, on edge values (wrap-around, shift counts at and past the width, division by zero, NaN)
+ #include "TestSupport.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/OperationSemantics.hpp"
+ #include <cmath>
+ #include <cstring>
+ #include <limits>
+ #include <vector>
+ using namespace bdi::tests;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::getScalarOperationArity;
+ namespace {
+ constexpr BDIType TYPES[] = {BDIType::BOOL, BDIType::INT8, BDIType::UINT8, BDIType::INT16, BDIType::UINT16,
+                              BDIType::INT32, BDIType::UINT32, BDIType::INT64, BDIType::UINT64,
+                              BDIType::FLOAT32, BDIType::FLOAT64};
+ bool isFloat(BDIType type) { return type == BDIType::FLOAT32 || type == BDIType::FLOAT64; }
+ RuntimeValue fromBits(BDIType type, uint64_t bits) {
+    if (type == BDIType::BOOL) return RuntimeValue::make<uint8_t>(type, bits & 1);
+    RuntimeValue value = RuntimeValue::make<uint64_t>(BDIType::UINT64, bits);
+    const size_t size = getBdiTypeSize(type);
+    if (size < sizeof(uint64_t)) value.bits &= (uint64_t{1} << (size * 8)) - 1;
+    value.type = type;
+    return value;
+ }
+ // Edge values of 'type'. 'few' keeps the ones that matter most, for the third FMA operand.
+ std::vector<RuntimeValue> edgeValues(BDIType type, bool few = false) {
+    std::vector<RuntimeValue> values;
+    if (type == BDIType::FLOAT32 || type == BDIType::FLOAT64) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> doubles = {0.0, 1.0, -1.0, nan};
+        if (!few) doubles.insert(doubles.end(), {-0.0, 0.5, -2.5, inf, -inf, 1e300, 3e9, -129.75, 255.5});
+        for (double d : doubles) {
+            values.push_back(type == BDIType::FLOAT32 ? RuntimeValue::make(type, static_cast<float>(d)) : RuntimeValue::make(type, d));
+        }
+        return values;
+    }
+    const unsigned width = static_cast<unsigned>(getBdiTypeSize(type) * 8);
+    const uint64_t sign = uint64_t{1} << (width - 1);
+    std::vector<uint64_t> bits = {0, 1, ~uint64_t{0}, sign, sign - 1};
+    if (!few) bits.insert(bits.end(), {2, 3, sign + 1, width - 1, width, width + 1, 2 * width, 255, 0x5A5A5A5A5A5A5A5Aull});
+    for (uint64_t b : bits) values.push_back(fromBits(type, b));
+    return values;
+ }
+ bool sameValue(const std::optional<RuntimeValue>& a, const std::optional<RuntimeValue>& b) {
+    if (!a || !b) return !a && !b;
+    return a->type == b->type && a->bits == b->bits;
+ }
+ // One scalar node as the run's only work. The operands are floating constants, or, with
+ // 'immediate_last', the last one is the node's payload (baked into native code).
+ class OpCase {
+ public:
+    OpCase(BDIOperationType op, BDIType type, BDIType result, bool immediate_last) {
+        start_ = t_.start();
+        const size_t arity = getScalarOperationArity(op);
+        const size_t wired = immediate_last && arity > 1 ? arity - 1 : arity;
+        for (size_t k = 0; k < wired; ++k) operands_.push_back(t_.constant(type, RuntimeValue::make<uint64_t>(type, 0)));
+        switch (wired) {
+            case 1: node_ = t_.op(op, {operands_[0]}, result, true); break;
+            case 2: node_ = t_.op(op, {operands_[0], operands_[1]}, result, true); break;
+            default: node_ = t_.op(op, {operands_[0], operands_[1], operands_[2]}, result, true); break;
+        }
+        t_.op(BDIOperationType::META_END, {node_}, BDIType::UNKNOWN, true);
+        compiled_ = t_.graph.freeze();
+        interpreter_.setJitThreshold(0);
+        native_.setJitThreshold(1);
+    }
+    bool valid() const { return compiled_ != nullptr; }
+    // Runs both engines on 'values'; false if they disagree
+    bool run(const std::vector<RuntimeValue>& values) {
+        for (size_t k = 0; k < values.size(); ++k) {
+            const NodeID target = k < operands_.size() ? operands_[k] : node_;
+            interpreter_.setNodePayload(target, values[k]);
+            native_.setNodePayload(target, values[k]);
+        }
+        const bool interpreted = interpreter_.execute(*compiled_, start_);
+        const bool native = native_.execute(*compiled_, start_);
+        native_steps_ += native_.getNativeStepCount();
+        return interpreted == native && sameValue(interpreter_.getReturnValue(), native_.getReturnValue());
+    }
+    uint64_t nativeSteps() const { return native_steps_; }
+ private:
+    TestGraph t_;
+    NodeID start_ = 0;
+    NodeID node_ = 0;
+    std::vector<NodeID> operands_;
+    std::shared_ptr<const bdi::core::graph::CompiledGraph> compiled_;
+    BDIVirtualMachine interpreter_;
+    BDIVirtualMachine native_;
+    uint64_t native_steps_ = 0;
+ };
+ void report(BDIOperationType op, BDIType type, BDIType result, const std::vector<RuntimeValue>& values) {
+    std::fprintf(stderr, "  op %u type %u result %u operands", static_cast<unsigned>(op), static_cast<unsigned>(type),
+                 static_cast<unsigned>(result));
+    for (const RuntimeValue& v : values) std::fprintf(stderr, " 0x%llx", static_cast<unsigned long long>(v.bits));
+    std::fprintf(stderr, "\n");
+ }
+ // Every operand combination of edge values; returns the steps native code took
+ uint64_t checkOperation(BDIOperationType op, BDIType type, BDIType result, bool immediate_last) {
+    OpCase c(op, type, result, immediate_last);
+    BDI_CHECK(c.valid());
+    if (!c.valid()) return 0;
+    const std::vector<RuntimeValue> edges = edgeValues(type);
+    const std::vector<RuntimeValue> few = edgeValues(type, true);
+    std::vector<RuntimeValue> values(getScalarOperationArity(op));
+    auto check = [&] {
+        if (!BDI_CHECK(c.run(values))) report(op, type, result, values);
+    };
+    for (const RuntimeValue& a : edges) {
+        values[0] = a;
+        if (values.size() == 1) {
+            check();
+            continue;
+        }
+        for (const RuntimeValue& b : edges) {
+            values[1] = b;
+            if (values.size() == 2) {
+                check();
+                continue;
+            }
+            for (const RuntimeValue& d : few) {
+                values[2] = d;
+                check();
+            }
+        }
+    }
+    return c.nativeSteps();
+ }
+ void testScalarOperations() {
+    using Op = BDIOperationType;
+    uint64_t integer_native_steps = 0;
+    for (auto o = static_cast<uint32_t>(Op::ARITH_ADD); o <= static_cast<uint32_t>(Op::CONV_BITCAST); ++o) {
+        const auto op = static_cast<Op>(o);
+        if (getScalarOperationArity(op) == 0) continue; // Gaps in the enum (e.g. reserved opcodes)
+        const bool conversion = op >= Op::CONV_TRUNC && op <= Op::CONV_BITCAST;
+        for (BDIType type : TYPES) {
+            if (conversion) {
+                for (BDIType result : TYPES) checkOperation(op, type, result, false);
+                continue;
+            }
+            const BDIType result = (op >= Op::LOGIC_AND && op <= Op::CMP_GE) ? BDIType::BOOL : type;
+            const uint64_t steps = checkOperation(op, type, result, false);
+            if (!isFloat(type)) integer_native_steps += steps;
+            if (getScalarOperationArity(op) > 1) checkOperation(op, type, result, true);
+        }
+    }
+    BDI_CHECK(integer_native_steps > 0);
+ }
+ } // namespace
+ int main() {
+    if (!bdi::runtime::jit::JitCompiler::isAvailable()) return bdi::tests::finish("JitTests");
+    testScalarOperations();
+    return bdi::tests::finish("JitTests");
+ }
@@ -0,0 +1,278 @@
+// File: bdi/tests/KernelTests.cpp
+ // Vector kernels of every supported ISA against the scalar table: odd lengths and tails, unaligned
+ // starts, every element type, guard bytes past the end. Then buffer bounds on the graph operations.
+ #include "TestSupport.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/kernels/VectorKernels.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ #include <cmath>
+ #include <cstring>
+ #include <random>
+ #include <vector>
+ using namespace bdi::tests;
+ using namespace bdi::runtime::kernels;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::memory::MemoryManager;
+ namespace {
+ constexpr size_t LENGTHS[] = {0, 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 100, 127, 129, 1000, 1031};
+ constexpr std::byte GUARD{0xA5};
+ constexpr KernelIsa ISAS[] = {KernelIsa::AVX2, KernelIsa::AVX512};
+ // 64-byte aligned storage; at(offset) is 'offset' bytes past the aligned base. Filled with GUARD.
+ class Buffer {
+ public:
+    explicit Buffer(size_t bytes) : raw_(bytes + 128, GUARD) {
+        const auto address = reinterpret_cast<uintptr_t>(raw_.data());
+        base_ = raw_.data() + (64 - address % 64) % 64;
+    }
+    std::byte* at(size_t offset) { return base_ + offset; }
+    // Nothing but GUARD in [from, to)
+    bool guarded(size_t from, size_t to) const {
+        for (size_t i = from; i < to; ++i) {
+            if (base_[i] != GUARD) return false;
+        }
+        return true;
+    }
+ private:
+    std::vector<std::byte> raw_;
+    std::byte* base_ = nullptr;
+ };
+ // Random values; floats are small multiples of 1/8 so sums and products are exact
+ template <typename T>
+ void fill(T* values, size_t count, std::mt19937_64& rng) {
+    for (size_t i = 0; i < count; ++i) {
+        if constexpr (std::is_floating_point_v<T>) values[i] = static_cast<T>(static_cast<int>(rng() % 2001) - 1000) / T(8);
+        else values[i] = static_cast<T>(rng());
+    }
+ }
+ template <typename T>
+ T reference(bool add, T a, T b) {
+    if constexpr (std::is_floating_point_v<T>) return add ? a + b : a * b;
+    else return static_cast<T>(add ? static_cast<uint64_t>(a) + static_cast<uint64_t>(b) : static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+ }
+ // add / mul of one element kind: unaligned kernels from every start offset, aligned ones from aligned
+ // starts, in place (dst == lhs) as well; nothing written past 'count'
+ template <typename T>
+ void checkBinary(const VectorKernelTable& table, ElementKind kind) {
+    const size_t k = static_cast<size_t>(kind);
+    std::mt19937_64 rng(k + 1);
+    for (bool add : {true, false}) {
+        for (size_t count : LENGTHS) {
+            for (size_t shift = 0; shift < 4; ++shift) {
+                // Shift 0: every buffer 64-byte aligned. Otherwise they start at different element offsets.
+                const size_t offsets[] = {shift, shift ? (shift + 1) % 4 : 0, shift ? (shift + 2) % 4 : 0};
+                for (int aligned = 0; aligned <= (shift == 0 && table.vector_bytes <= 64 ? 1 : 0); ++aligned) {
+                    const size_t bytes = (count + 4) * sizeof(T);
+                    Buffer dst(bytes + 64), lhs(bytes), rhs(bytes);
+                    T* a = reinterpret_cast<T*>(lhs.at(offsets[0] * sizeof(T)));
+                    T* b = reinterpret_cast<T*>(rhs.at(offsets[1] * sizeof(T)));
+                    T* out = reinterpret_cast<T*>(dst.at(offsets[2] * sizeof(T)));
+                    fill(a, count, rng);
+                    fill(b, count, rng);
+                    std::vector<T> expected(count);
+                    for (size_t i = 0; i < count; ++i) expected[i] = reference(add, a[i], b[i]);
+                    (add ? table.add : table.mul)[k][aligned](out, a, b, count);
+                    const size_t end = (offsets[2] + count) * sizeof(T);
+                    bool same = (count == 0 || std::memcmp(out, expected.data(), count * sizeof(T)) == 0) &&
+                                dst.guarded(end, end + 64) && dst.guarded(0, offsets[2] * sizeof(T));
+                    // In place
+                    (add ? table.add : table.mul)[k][aligned](a, a, b, count);
+                    same = same && (count == 0 || std::memcmp(a, expected.data(), count * sizeof(T)) == 0);
+                    if (!BDI_CHECK(same)) {
+                        std::fprintf(stderr, "  %s kind %zu %s count %zu shift %zu aligned %d\n", getKernelIsaName(table.isa), k,
+                                     add ? "add" : "mul", count, shift, aligned);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+ }
+ // gather / scatter / shuffle for one element size, against plain loops
+ template <typename T>
+ void checkPermutes(const VectorKernelTable& table) {
+    const size_t s = static_cast<size_t>(std::countr_zero(sizeof(T)));
+    std::mt19937_64 rng(sizeof(T));
+    for (size_t count : LENGTHS) {
+        for (size_t stride : {1, 2, 3, 7}) {
+            const size_t spread = count ? (count - 1) * stride + 1 : 0;
+            Buffer packed(count * sizeof(T) + 64), strided(spread * sizeof(T) + 64);
+            T* wide = reinterpret_cast<T*>(strided.at(sizeof(T)));
+            fill(wide, spread, rng);
+            T* narrow = reinterpret_cast<T*>(packed.at(sizeof(T)));
+            table.gather[s](narrow, wide, count, stride);
+            bool same = packed.guarded(sizeof(T) * (count + 1), sizeof(T) * (count + 1) + 64);
+            for (size_t i = 0; i < count; ++i) same = same && std::memcmp(&narrow[i], &wide[i * stride], sizeof(T)) == 0;
+            // Scatter new values back: written elements match, the ones between stay
+            std::vector<T> before(wide, wide + spread);
+            fill(narrow, count, rng);
+            table.scatter[s](wide, narrow, count, stride);
+            for (size_t i = 0; i < spread; ++i) {
+                const T& expected = i % stride == 0 ? narrow[i / stride] : before[i];
+                same = same && std::memcmp(&wide[i], &expected, sizeof(T)) == 0;
+            }
+            same = same && strided.guarded(sizeof(T) * (spread + 1), sizeof(T) * (spread + 1) + 64);
+            if (!BDI_CHECK(same)) {
+                std::fprintf(stderr, "  %s size %zu count %zu stride %zu\n", getKernelIsaName(table.isa), sizeof(T), count, stride);
+                return;
+            }
+        }
+        const size_t src_count = count + 5;
+        std::vector<T> src(src_count);
+        fill(src.data(), src_count, rng);
+        std::vector<uint32_t> indices(count);
+        for (uint32_t& index : indices) index = static_cast<uint32_t>(rng() % src_count);
+        Buffer out(count * sizeof(T) + 64);
+        T* dst = reinterpret_cast<T*>(out.at(sizeof(T) * 3));
+        table.shuffle[s](dst, src.data(), indices.data(), count);
+        bool same = out.guarded(sizeof(T) * (count + 3), sizeof(T) * (count + 3) + 64);
+        for (size_t i = 0; i < count; ++i) same = same && std::memcmp(&dst[i], &src[indices[i]], sizeof(T)) == 0;
+        BDI_CHECK(same);
+    }
+ }
+ // Matmul and FFT against the scalar table: FMA contraction and butterfly order change roundings
+ template <typename T>
+ void checkFloatKernels(const VectorKernelTable& table) {
+    const VectorKernelTable& scalar = getVectorKernels(KernelIsa::SCALAR);
+    const size_t f = std::is_same_v<T, double> ? 1 : 0;
+    const T tolerance = std::is_same_v<T, double> ? T(1e-9) : T(1e-3);
+    std::mt19937_64 rng(f + 7);
+    for (size_t m : {1, 3, 8, 17}) {
+        for (size_t n : {1, 5, 16, 33}) {
+            for (size_t k : {1, 7, 20}) {
+                std::vector<T> a(m * k), b(k * n), c(m * n), expected(m * n);
+                fill(a.data(), a.size(), rng);
+                fill(b.data(), b.size(), rng);
+                table.matmul[f](c.data(), a.data(), b.data(), m, n, k);
+                scalar.matmul[f](expected.data(), a.data(), b.data(), m, n, k);
+                bool close = true;
+                for (size_t i = 0; i < c.size(); ++i) close = close && std::abs(c[i] - expected[i]) <= tolerance * (1 + std::abs(expected[i]));
+                if (!BDI_CHECK(close)) return;
+            }
+        }
+    }
+    for (size_t count = 1; count <= 1024; count *= 2) {
+        std::vector<T> data(2 * count), expected(2 * count), original(2 * count);
+        fill(original.data(), original.size(), rng);
+        data = original;
+        expected = original;
+        BDI_CHECK(table.fft[f](data.data(), count, false) && scalar.fft[f](expected.data(), count, false));
+        bool close = true;
+        for (size_t i = 0; i < data.size(); ++i) close = close && std::abs(data[i] - expected[i]) <= tolerance * count * (1 + std::abs(expected[i]));
+        BDI_CHECK(table.fft[f](data.data(), count, true));
+        for (size_t i = 0; i < data.size(); ++i) close = close && std::abs(data[i] - original[i]) <= tolerance * count * (1 + std::abs(original[i]));
+        if (!BDI_CHECK(close)) return;
+    }
+    BDI_CHECK(!table.fft[f](std::vector<T>(12).data(), 6, false)); // Not a power of two
+ }
+ void checkCopyFill(const VectorKernelTable& table) {
+    std::mt19937_64 rng(3);
+    for (size_t bytes : {size_t{0}, size_t{1}, size_t{7}, size_t{63}, size_t{65}, size_t{4097}, size_t{300000}}) {
+        for (size_t shift : {0, 1, 13}) {
+            Buffer src(bytes + shift), dst(bytes + 64 + shift);
+            for (size_t i = 0; i < bytes; ++i) src.at(shift)[i] = static_cast<std::byte>(rng());
+            table.copy(dst.at(shift + 1), src.at(shift), bytes);
+            BDI_CHECK((bytes == 0 || std::memcmp(dst.at(shift + 1), src.at(shift), bytes) == 0) &&
+                      dst.guarded(shift + 1 + bytes, shift + 65 + bytes) && dst.guarded(0, shift + 1));
+            const uint64_t pattern = rng();
+            table.fill(dst.at(shift), pattern, bytes);
+            bool same = dst.guarded(shift + bytes + 1, shift + bytes + 64);
+            for (size_t i = 0; i < bytes; ++i) same = same && dst.at(shift)[i] == static_cast<std::byte>(pattern >> (8 * (i % 8)));
+            BDI_CHECK(same);
+        }
+    }
+ }
+ void testIsas() {
+    for (KernelIsa isa : ISAS) {
+        if (!isKernelIsaSupported(isa)) {
+            std::printf("KernelTests: %s not supported here, skipped\n", getKernelIsaName(isa));
+            continue;
+        }
+        const VectorKernelTable& table = getVectorKernels(isa);
+        BDI_CHECK(table.isa == isa);
+        checkBinary<int8_t>(table, ElementKind::I8);
+        checkBinary<int16_t>(table, ElementKind::I16);
+        checkBinary<int32_t>(table, ElementKind::I32);
+        checkBinary<int64_t>(table, ElementKind::I64);
+        checkBinary<float>(table, ElementKind::F32);
+        checkBinary<double>(table, ElementKind::F64);
+        checkPermutes<uint8_t>(table);
+        checkPermutes<uint16_t>(table);
+        checkPermutes<uint32_t>(table);
+        checkPermutes<uint64_t>(table);
+        checkFloatKernels<float>(table);
+        checkFloatKernels<double>(table);
+        checkCopyFill(table);
+    }
+    // The reference itself on the same cases
+    checkBinary<int32_t>(getVectorKernels(KernelIsa::SCALAR), ElementKind::I32);
+    checkBinary<double>(getVectorKernels(KernelIsa::SCALAR), ElementKind::F64);
+    checkPermutes<uint16_t>(getVectorKernels(KernelIsa::SCALAR));
+ }
+ RuntimeValue pointer(const void* address) {
+    return RuntimeValue::make(BDIType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)));
+ }
+ RuntimeValue count(uint64_t value) { return RuntimeValue::make(BDIType::UINT64, value); }
+ // Every buffer extent must lie inside one live block
+ void testBufferBounds() {
+    MemoryManager memory;
+    auto* block = static_cast<int32_t*>(memory.allocate(0, 64 * sizeof(int32_t)));
+    auto* other = static_cast<int32_t*>(memory.allocate(0, 64 * sizeof(int32_t)));
+    BDI_CHECK(block && other);
+    if (!block || !other) return;
+    for (int i = 0; i < 64; ++i) block[i] = other[i] = i;
+    const KernelBufferCheck buffers{&MemoryManager::checkKernelBuffer, &memory};
+    auto add = [&](const void* dst, const void* src, uint64_t n, const KernelBufferCheck& check) {
+        const RuntimeValue operands[] = {pointer(dst), pointer(src), pointer(src), count(n)};
+        return executeKernelOperation(BDIOperationType::VEC_ADD, BDIType::INT32, operands, check);
+    };
+    BDI_CHECK(add(block, other, 64, buffers) && block[63] == 63 * 2);
+    BDI_CHECK(!add(block, other, 65, buffers));                  // One element past both blocks
+    BDI_CHECK(!add(block + 1, other, 64, buffers));              // Destination runs past its block
+    BDI_CHECK(!add(block, other + 60, 8, buffers));              // Source runs past its block
+    BDI_CHECK(add(block + 60, other + 60, 4, buffers));          // Tail that fits
+    BDI_CHECK(add(block, nullptr, 0, buffers));                  // Nothing touched
+    int32_t host[64] = {};
+    BDI_CHECK(!add(host, host, 64, buffers));                    // Not a block
+    BDI_CHECK(!add(block, other, 64, KernelBufferCheck{}));      // No checker: nothing is a buffer
+    BDI_CHECK(block[0] == 0 && host[0] == 0);
+    // Strided load: the extent is (count - 1) * stride + 1 elements of the source
+    const RuntimeValue fits[] = {pointer(block), pointer(other), count(16), count(4)};
+    BDI_CHECK(executeKernelOperation(BDIOperationType::VEC_LOAD_PACKED, BDIType::INT32, fits, buffers) && block[15] == 60);
+    const RuntimeValue past[] = {pointer(block), pointer(other), count(17), count(4)};
+    BDI_CHECK(!executeKernelOperation(BDIOperationType::VEC_LOAD_PACKED, BDIType::INT32, past, buffers));
+    // Freed blocks are no longer buffers
+    BDI_CHECK(memory.free(other));
+    BDI_CHECK(!add(block, other, 1, buffers));
+ }
+ // The VM fails a kernel node whose buffers are not inside its MemoryManager's blocks
+ void testVirtualMachineBounds() {
+    MemoryManager memory;
+    auto* block = static_cast<float*>(memory.allocate(0, 32 * sizeof(float)));
+    BDI_CHECK(block != nullptr);
+    if (!block) return;
+    for (int i = 0; i < 32; ++i) block[i] = static_cast<float>(i);
+    for (uint64_t n : {uint64_t{32}, uint64_t{33}}) {
+        TestGraph t;
+        const NodeID start = t.start();
+        const NodeID address = t.constant(BDIType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(block)));
+        const NodeID elements = t.constant(BDIType::UINT64, n);
+        const NodeID node = t.op(BDIOperationType::VEC_MUL, {address, address, address, elements}, BDIType::POINTER, true);
+        t.graph.getNode(node)->get().payload = RuntimeValue::make(BDIType::FLOAT32, 0.0f).toPayload();
+        t.op(BDIOperationType::META_END, {node}, BDIType::UNKNOWN, true);
+        auto compiled = t.graph.freeze();
+        BDI_CHECK(compiled != nullptr);
+        if (!compiled) return;
+        BDIVirtualMachine vm;
+        BDI_CHECK(!vm.execute(*compiled, start)); // No MemoryManager
+        vm.setMemoryManager(&memory);
+        BDI_CHECK(vm.execute(*compiled, start) == (n == 32));
+    }
+    BDI_CHECK(block[31] == 31.0f * 31.0f); // Only the run that fit wrote
+ }
+ } // namespace
+ int main() {
+    testIsas();
+    testBufferBounds();
+    testVirtualMachineBounds();
+    return bdi::tests::finish("KernelTests");
+ }
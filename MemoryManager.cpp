@@ -0,0 +1,392 @@
+// File: bdi/runtime/memory/MemoryManager.cpp
+ #include "MemoryManager.hpp"
+ #include "../kernels/VectorKernels.hpp"
+ #include <algorithm>
+ #include <bit>
+ #include <cstdlib>
+ #if defined(__linux__)
+ #include <sys/mman.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+ #endif
+ namespace bdi::runtime::memory {
+ namespace {
+ // Size classes: multiples of 16 up to 128, then four steps per doubling (at most 20% rounding loss).
+ // Every power of two is a class, so any alignment up to MAX_SMALL_BYTES has a class that is a multiple of it.
+ constexpr size_t SIZE_CLASS_COUNT = 8 + 4 * 7;
+ constexpr std::array<uint32_t, SIZE_CLASS_COUNT> makeSizeClasses() {
+    std::array<uint32_t, SIZE_CLASS_COUNT> sizes{};
+    size_t n = 0;
+    for (uint32_t size = 16; size <= 128; size += 16) sizes[n++] = size;
+    for (uint32_t base = 128; n < SIZE_CLASS_COUNT; base *= 2) {
+        for (uint32_t step = 1; step <= 4; ++step) sizes[n++] = base + step * (base / 4);
+    }
+    return sizes;
+ }
+ constexpr std::array<uint32_t, SIZE_CLASS_COUNT> SIZE_CLASSES = makeSizeClasses();
+ static_assert(SIZE_CLASSES.back() == MemoryManager::MAX_SMALL_BYTES);
+ // Smallest class holding 'bytes' whose blocks (at multiples of it from a slab start) are 'alignment'-aligned
+ uint16_t findSizeClass(size_t bytes, size_t alignment) {
+    auto it = std::lower_bound(SIZE_CLASSES.begin(), SIZE_CLASSES.end(), bytes);
+    while (it != SIZE_CLASSES.end() && *it % alignment != 0) ++it;
+    return it == SIZE_CLASSES.end() ? UINT16_MAX : static_cast<uint16_t>(it - SIZE_CLASSES.begin());
+ }
+ #if defined(__linux__)
+ constexpr int MPOL_BIND_MODE = 2; // <linux/mempolicy.h>; the libnuma headers are not required
+ // Map 'bytes' (a multiple of CHUNK_BYTES) at a CHUNK_BYTES-aligned address
+ unsigned char* mapAligned(size_t bytes, bool huge_pages, bool& hugetlb_failed, bool& huge_out) {
+    constexpr size_t align = MemoryManager::CHUNK_BYTES;
+    huge_out = false;
+    if (huge_pages && !hugetlb_failed) {
+        // Reserved hugetlbfs pages: 2 MiB aligned by construction
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            huge_out = true;
+            return static_cast<unsigned char*>(p);
+        }
+        hugetlb_failed = true; // None reserved (the common case): don't pay for the attempt again
+    }
+    void* raw = mmap(nullptr, bytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    auto* start = static_cast<unsigned char*>(raw);
+    auto* base = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(start) + align - 1) & ~(align - 1));
+    if (base != start) munmap(start, static_cast<size_t>(base - start));
+    const size_t tail = static_cast<size_t>((start + bytes + align) - (base + bytes));
+    if (tail) munmap(base + bytes, tail);
+    // Transparent huge pages: the aligned range lets the kernel back each chunk with 2 MiB pages
+    if (huge_pages) huge_out = madvise(base, bytes, MADV_HUGEPAGE) == 0;
+    return base;
+ }
+ bool bindToNode(void* base, size_t bytes, int node) {
+    std::vector<unsigned long> mask(static_cast<size_t>(node) / (8 * sizeof(unsigned long)) + 1, 0);
+    mask[static_cast<size_t>(node) / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, base, bytes, MPOL_BIND_MODE, mask.data(), mask.size() * 8 * sizeof(unsigned long) + 1, 0) == 0;
+ }
+ void unmapAligned(unsigned char* base, size_t bytes) {
+    munmap(base, bytes);
+ }
+ #else
+ unsigned char* mapAligned(size_t bytes, bool, bool&, bool& huge_out) {
+    huge_out = false;
+    return static_cast<unsigned char*>(std::aligned_alloc(MemoryManager::CHUNK_BYTES, bytes));
+ }
+ bool bindToNode(void*, size_t, int) { return false; }
+ void unmapAligned(unsigned char* base, size_t) { std::free(base); }
+ #endif
+ } // namespace
+ MemoryManager::MemoryManager() = default;
+ MemoryManager::~MemoryManager() {
+    for (auto& [id, region] : regions_) {
+        for (auto& chunk : region->chunks) unmapAligned(chunk->base, chunk->bytes);
+    }
+ }
+ // --- Regions --
+ MemoryManager::Region& MemoryManager::getOrCreateRegion(RegionID region) {
+    {
+        std::shared_lock lock(regions_mutex_);
+        auto it = regions_.find(region);
+        if (it != regions_.end()) return *it->second;
+    }
+    std::unique_lock lock(regions_mutex_);
+    auto& slot = regions_[region];
+    if (!slot) {
+        slot = std::make_unique<Region>();
+        slot->id = region;
+        slot->partial.resize(SIZE_CLASS_COUNT);
+    }
+    return *slot;
+ }
+ bool MemoryManager::configureRegion(RegionID region, const RegionOptions& options) {
+    Region& r = getOrCreateRegion(region);
+    std::lock_guard lock(r.mutex);
+    if (!r.chunks.empty()) return false;
+    r.options = options;
+    r.hugetlb_failed = false;
+    return true;
+ }
+ size_t MemoryManager::releaseRegion(RegionID region) {
+    Region* r = nullptr;
+    {
+        std::shared_lock lock(regions_mutex_);
+        auto it = regions_.find(region);
+        if (it == regions_.end()) return 0;
+        r = it->second.get();
+    }
+    std::lock_guard lock(r->mutex);
+    size_t released = 0;
+    {
+        std::unique_lock directory_lock(directory_mutex_);
+        for (const auto& chunk : r->chunks) unlistChunk(*chunk);
+    }
+    for (const auto& chunk : r->chunks) {
+        released += chunk->bytes;
+        unmapAligned(chunk->base, chunk->bytes);
+    }
+    r->chunks.clear();
+    for (auto& list : r->partial) list.clear();
+    r->empty_slabs.clear();
+    r->carving = nullptr;
+    r->allocated_bytes = r->requested_bytes = r->live_blocks = 0;
+    return released;
+ }
+ // --- Chunks --
+ MemoryManager::Chunk* MemoryManager::mapChunk(Region& region, size_t bytes, bool large) {
+    auto chunk = std::make_unique<Chunk>();
+    chunk->base = mapAligned(bytes, region.options.huge_pages, region.hugetlb_failed, chunk->huge_pages);
+    if (!chunk->base) return nullptr;
+    chunk->region = &region;
+    chunk->bytes = bytes;
+    chunk->large = large;
+    // Binding before first touch places every page on the node
+    if (region.options.numa_node >= 0) chunk->numa_bound = bindToNode(chunk->base, bytes, region.options.numa_node);
+    {
+        std::unique_lock lock(directory_mutex_);
+        // Every CHUNK_BYTES step of a large mapping, so addresses inside it resolve too
+        for (size_t at = 0; at < bytes; at += CHUNK_BYTES) directory_[reinterpret_cast<uintptr_t>(chunk->base + at)] = chunk.get();
+    }
+    region.chunks.push_back(std::move(chunk));
+    return region.chunks.back().get();
+ }
+ void MemoryManager::unmapChunk(Region& region, Chunk* chunk) {
+    {
+        std::unique_lock lock(directory_mutex_);
+        unlistChunk(*chunk);
+    }
+    unmapAligned(chunk->base, chunk->bytes);
+    auto it = std::find_if(region.chunks.begin(), region.chunks.end(), [chunk](const auto& c) { return c.get() == chunk; });
+    std::swap(*it, region.chunks.back());
+    region.chunks.pop_back();
+ }
+ void MemoryManager::unlistChunk(const Chunk& chunk) {
+    for (size_t at = 0; at < chunk.bytes; at += CHUNK_BYTES) directory_.erase(reinterpret_cast<uintptr_t>(chunk.base + at));
+ }
+ MemoryManager::Chunk* MemoryManager::findChunk(const void* ptr) const {
+    const uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t{CHUNK_BYTES} - 1);
+    auto it = directory_.find(base);
+    return it == directory_.end() ? nullptr : it->second;
+ }
+ std::optional<RegionID> MemoryManager::findRegion(const void* ptr) const {
+    std::shared_lock lock(directory_mutex_);
+    const Chunk* chunk = findChunk(ptr);
+    if (!chunk) return std::nullopt;
+    return chunk->region->id;
+ }
+ std::optional<MemoryBlock> MemoryManager::findBlock(const void* ptr) const {
+    Chunk* chunk = nullptr;
+    {
+        std::shared_lock lock(directory_mutex_);
+        chunk = findChunk(ptr);
+    }
+    if (!chunk) return std::nullopt;
+    // Same lifetime argument as free()
+    const Region& region = *chunk->region;
+    std::lock_guard lock(region.mutex);
+    const auto* at = static_cast<const unsigned char*>(ptr);
+    if (chunk->large) {
+        if (chunk->large_requested == 0 || at >= chunk->base + chunk->large_requested) return std::nullopt;
+        return MemoryBlock{region.id, chunk->base, chunk->large_requested};
+    }
+    const size_t offset = static_cast<size_t>(at - chunk->base);
+    if (offset / SLAB_BYTES >= chunk->carved) return std::nullopt;
+    const Slab& slab = chunk->slabs[offset / SLAB_BYTES];
+    if (slab.size_class == NO_CLASS) return std::nullopt;
+    const size_t block_size = SIZE_CLASSES[slab.size_class];
+    const size_t index = offset % SLAB_BYTES / block_size;
+    if (index >= slab.bumped || slab.sizes[index] == 0) return std::nullopt;
+    // Past the requested bytes, in the size-class padding, is outside the block
+    unsigned char* base = slab.base + index * block_size;
+    if (at >= base + slab.sizes[index]) return std::nullopt;
+    return MemoryBlock{region.id, base, slab.sizes[index]};
+ }
+ bool MemoryManager::containsRange(const void* ptr, size_t bytes) const {
+    const auto block = findBlock(ptr);
+    if (!block) return false;
+    // 'ptr' is inside the block, so nothing can wrap
+    const uintptr_t end = reinterpret_cast<uintptr_t>(block->base) + block->bytes;
+    return bytes <= end - reinterpret_cast<uintptr_t>(ptr);
+ }
+ bool MemoryManager::checkKernelBuffer(const void* manager, uint64_t address, uint64_t bytes) {
+    return manager && static_cast<const MemoryManager*>(manager)->containsRange(reinterpret_cast<const void*>(address), bytes);
+ }
+ // --- Allocation --
+ void* MemoryManager::allocate(RegionID region, size_t bytes, size_t alignment) {
+    if (bytes == 0 || !std::has_single_bit(alignment) || alignment > CHUNK_BYTES) return nullptr;
+    alignment = std::max(alignment, MIN_ALIGNMENT);
+    Region& r = getOrCreateRegion(region);
+    std::lock_guard lock(r.mutex);
+    if (bytes <= MAX_SMALL_BYTES) {
+        const uint16_t size_class = findSizeClass(bytes, alignment);
+        if (size_class != NO_CLASS) return allocateSmall(r, size_class, bytes);
+    }
+    return allocateLarge(r, bytes);
+ }
+ MemoryManager::Slab* MemoryManager::takeSlab(Region& region, uint16_t size_class) {
+    Slab* slab = nullptr;
+    if (!region.empty_slabs.empty()) {
+        slab = region.empty_slabs.back();
+        region.empty_slabs.pop_back();
+    } else {
+        if (!region.carving || region.carving->carved == SLABS_PER_CHUNK) {
+            region.carving = mapChunk(region, CHUNK_BYTES, false);
+            if (!region.carving) return nullptr;
+        }
+        Chunk& chunk = *region.carving;
+        slab = &chunk.slabs[chunk.carved];
+        slab->base = chunk.base + chunk.carved * SLAB_BYTES;
+        ++chunk.carved;
+    }
+    slab->size_class = size_class;
+    slab->capacity = static_cast<uint32_t>(SLAB_BYTES / SIZE_CLASSES[size_class]);
+    slab->sizes = std::make_unique<uint16_t[]>(slab->capacity);
+    slab->queued = true;
+    region.partial[size_class].push_back(slab);
+    return slab;
+ }
+ void* MemoryManager::allocateSmall(Region& region, uint16_t size_class, size_t bytes) {
+    auto& partial = region.partial[size_class];
+    Slab* slab = partial.empty() ? takeSlab(region, size_class) : partial.back();
+    if (!slab) return nullptr;
+    const size_t block_size = SIZE_CLASSES[size_class];
+    void* block;
+    if (slab->free_list) {
+        block = slab->free_list;
+        slab->free_list = *static_cast<void**>(block);
+    } else {
+        block = slab->base + slab->bumped++ * block_size;
+    }
+    slab->sizes[(static_cast<unsigned char*>(block) - slab->base) / block_size] = static_cast<uint16_t>(bytes);
+    ++slab->used;
+    if (!slab->hasRoom()) {
+        partial.pop_back(); // The slab taken is always the list's last
+        slab->queued = false;
+    }
+    region.allocated_bytes += block_size;
+    region.requested_bytes += bytes;
+    ++region.live_blocks;
+    return block;
+ }
+ void* MemoryManager::allocateLarge(Region& region, size_t bytes) {
+    if (bytes > SIZE_MAX - CHUNK_BYTES) return nullptr;
+    const size_t mapped = (bytes + CHUNK_BYTES - 1) & ~(CHUNK_BYTES - 1);
+    Chunk* chunk = mapChunk(region, mapped, true);
+    if (!chunk) return nullptr;
+    chunk->large_requested = bytes;
+    region.allocated_bytes += mapped;
+    region.requested_bytes += bytes;
+    ++region.live_blocks;
+    return chunk->base;
+ }
+ // --- Deallocation --
+ bool MemoryManager::free(void* ptr) {
+    Chunk* chunk = nullptr;
+    {
+        std::shared_lock lock(directory_mutex_);
+        chunk = findChunk(ptr);
+    }
+    if (!chunk) return false;
+    // Regions are never destroyed, so this stays valid; the chunk does as long as its region is not being
+    // released concurrently (freeing into a region that is being released is a caller error)
+    Region& region = *chunk->region;
+    std::lock_guard lock(region.mutex);
+    if (!chunk->large) return freeSmall(region, *chunk, ptr);
+    if (ptr != chunk->base || chunk->large_requested == 0) return false;
+    region.allocated_bytes -= chunk->bytes;
+    region.requested_bytes -= chunk->large_requested;
+    --region.live_blocks;
+    unmapChunk(region, chunk);
+    return true;
+ }
+ bool MemoryManager::freeSmall(Region& region, Chunk& chunk, void* ptr) {
+    const size_t offset = static_cast<size_t>(static_cast<unsigned char*>(ptr) - chunk.base);
+    if (offset / SLAB_BYTES >= chunk.carved) return false;
+    Slab& slab = chunk.slabs[offset / SLAB_BYTES];
+    if (slab.size_class == NO_CLASS) return false;
+    const size_t block_size = SIZE_CLASSES[slab.size_class];
+    const size_t in_slab = offset % SLAB_BYTES;
+    const size_t index = in_slab / block_size;
+    if (in_slab % block_size != 0 || index >= slab.bumped || slab.sizes[index] == 0) return false;
+    region.allocated_bytes -= block_size;
+    region.requested_bytes -= slab.sizes[index];
+    --region.live_blocks;
+    slab.sizes[index] = 0;
+    *static_cast<void**>(ptr) = slab.free_list;
+    slab.free_list = ptr;
+    auto& partial = region.partial[slab.size_class];
+    if (--slab.used == 0) {
+        // Hand the whole slab back, so any size class can reuse it
+        if (slab.queued) partial.erase(std::find(partial.begin(), partial.end(), &slab));
+        slab.free_list = nullptr;
+        slab.sizes.reset();
+        slab.bumped = slab.capacity = 0;
+        slab.size_class = NO_CLASS;
+        slab.queued = false;
+        region.empty_slabs.push_back(&slab);
+    } else if (!slab.queued) {
+        slab.queued = true;
+        partial.push_back(&slab);
+    }
+    return true;
+ }
+ // --- Usage Reports --
+ RegionUsage MemoryManager::describe(const Region& region) {
+    RegionUsage usage;
+    usage.region = region.id;
+    usage.numa_node = region.options.numa_node;
+    usage.allocated_bytes = region.allocated_bytes;
+    usage.requested_bytes = region.requested_bytes;
+    usage.live_blocks = region.live_blocks;
+    for (const auto& chunk : region.chunks) {
+        usage.reserved_bytes += chunk->bytes;
+        ++usage.chunks;
+        usage.huge_page_chunks += chunk->huge_pages;
+        usage.numa_bound_chunks += chunk->numa_bound;
+        if (chunk->large) {
+            ++usage.large_blocks;
+            usage.large_bytes += chunk->bytes;
+            continue;
+        }
+        for (uint32_t i = 0; i < chunk->carved; ++i) {
+            const Slab& slab = chunk->slabs[i];
+            if (slab.size_class == NO_CLASS) continue;
+            ++usage.slabs;
+            usage.slab_free_bytes += static_cast<size_t>(slab.capacity - slab.used) * SIZE_CLASSES[slab.size_class];
+        }
+    }
+    usage.idle_bytes = usage.reserved_bytes - usage.allocated_bytes - usage.slab_free_bytes;
+    return usage;
+ }
+ std::optional<RegionUsage> MemoryManager::getRegionUsage(RegionID region) const {
+    std::shared_lock lock(regions_mutex_);
+    auto it = regions_.find(region);
+    if (it == regions_.end()) return std::nullopt;
+    std::lock_guard region_lock(it->second->mutex);
+    return describe(*it->second);
+ }
+ std::vector<RegionUsage> MemoryManager::getUsage() const {
+    std::shared_lock lock(regions_mutex_);
+    std::vector<RegionUsage> usage;
+    usage.reserve(regions_.size());
+    for (const auto& [id, region] : regions_) {
+        std::lock_guard region_lock(region->mutex);
+        usage.push_back(describe(*region));
+    }
+    std::sort(usage.begin(), usage.end(), [](const RegionUsage& a, const RegionUsage& b) { return a.region < b.region; });
+    return usage;
+ }
+ // --- Vectorised Copy / Fill --
+ void MemoryManager::copy(void* dst, const void* src, size_t bytes) {
+    if (bytes) kernels::getVectorKernels().copy(dst, src, bytes);
+ }
+ bool MemoryManager::fill(void* dst, uint64_t value, size_t element_size, size_t count) {
+    uint64_t pattern;
+    switch (element_size) {
+        case 1: pattern = (value & 0xFF) * 0x0101010101010101ull; break;
+        case 2: pattern = (value & 0xFFFF) * 0x0001000100010001ull; break;
+        case 4: pattern = (value & 0xFFFFFFFFull) * 0x0000000100000001ull; break;
+        case 8: pattern = value; break;
+        default: return false;
+    }
+    if (count) kernels::getVectorKernels().fill(dst, pattern, element_size * count);
+    return true;
+ }
+ } // namespace bdi::runtime::memory
@@ -0,0 +1,151 @@
+// File: bdi/runtime/memory/MemoryManager.hpp
+ #ifndef BDI_RUNTIME_MEMORY_MEMORYMANAGER_HPP
+ #define BDI_RUNTIME_MEMORY_MEMORYMANAGER_HPP
+ #include "../../core/graph/BDINode.hpp"
+ #include <array>
+ #include <cstddef>
+ #include <cstdint>
+ #include <memory>
+ #include <mutex>
+ #include <optional>
+ #include <shared_mutex>
+ #include <unordered_map>
+ #include <vector>
+ namespace bdi::runtime::memory {
+ using bdi::core::graph::RegionID;
+ // How a region's memory is backed; set before its first allocation
+ struct RegionOptions {
+    int numa_node = -1;     // Bind the region's pages to this NUMA node (mbind); -1 = default policy
+    bool huge_pages = true; // Back chunks with 2 MiB pages where available (hugetlbfs, else transparent)
+ };
+ // Usage report of one region
+ struct RegionUsage {
+    RegionID region = 0;
+    size_t reserved_bytes = 0;  // Mapped for the region
+    size_t allocated_bytes = 0; // Live blocks, at their size-class / mapping size
+    size_t requested_bytes = 0; // Live blocks, as requested
+    size_t live_blocks = 0;
+    size_t large_blocks = 0;     // Live blocks with a mapping of their own
+    size_t large_bytes = 0;      // Their mappings (included in allocated_bytes)
+    size_t slabs = 0;            // Slabs holding at least one live block
+    size_t slab_free_bytes = 0;  // Free blocks inside those slabs
+    size_t idle_bytes = 0;       // Reserved but in no slab or block (reusable by any size)
+    size_t chunks = 0;           // Mappings, slab chunks and large blocks alike
+    size_t huge_page_chunks = 0; // Of those, backed by huge pages
+    size_t numa_bound_chunks = 0; // Of those, bound to numa_node
+    int numa_node = -1;
+    // Share of the allocated bytes lost to size-class rounding
+    double internalFragmentation() const {
+        return allocated_bytes ? 1.0 - static_cast<double>(requested_bytes) / static_cast<double>(allocated_bytes) : 0.0;
+    }
+    // Share of the slab bytes in use that is free but stranded in partially used slabs
+    double externalFragmentation() const {
+        const size_t slab_bytes = slab_free_bytes + (allocated_bytes - large_bytes);
+        return slab_bytes ? static_cast<double>(slab_free_bytes) / static_cast<double>(slab_bytes) : 0.0;
+    }
+ };
+ // A live block, as allocated
+ struct MemoryBlock {
+    RegionID region = 0;
+    void* base = nullptr;
+    size_t bytes = 0; // Requested size
+ };
+ // Memory behind MEM_ALLOC / MEM_FREE, one pool per BDINode::region_id.
+ // Each region maps 2 MiB chunks (optionally huge-page backed and NUMA bound) and carves them into 64 KiB
+ // slabs, each serving one size class from an intrusive free list. Blocks larger than a size class get a
+ // mapping of their own. Releasing a region unmaps all of its memory at once, whatever is still live.
+ // Regions are independent: each has its own lock, and a block is freed into the region that owns it.
+ class MemoryManager {
+ public:
+    static constexpr size_t CHUNK_BYTES = size_t{2} << 20;
+    static constexpr size_t SLAB_BYTES = size_t{64} << 10;
+    static constexpr size_t SLABS_PER_CHUNK = CHUNK_BYTES / SLAB_BYTES;
+    static constexpr size_t MIN_ALIGNMENT = 16;
+    static constexpr size_t MAX_SMALL_BYTES = SLAB_BYTES / 4; // Larger blocks are mapped individually
+    MemoryManager();
+    ~MemoryManager(); // Unmaps every region
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+    // False if the region already holds memory (options apply to chunks mapped from then on otherwise)
+    bool configureRegion(RegionID region, const RegionOptions& options);
+    // 'alignment' must be a power of two no larger than CHUNK_BYTES. Null on failure or for 0 bytes.
+    void* allocate(RegionID region, size_t bytes, size_t alignment = MIN_ALIGNMENT);
+    // False, freeing nothing, if 'ptr' is not the start of a live block of this manager
+    bool free(void* ptr);
+    // Bulk free: unmaps all of the region's memory, invalidating every block in it. Returns the bytes
+    // unmapped. The region keeps its options.
+    size_t releaseRegion(RegionID region);
+    // Region owning the block at 'ptr'
+    std::optional<RegionID> findRegion(const void* ptr) const;
+    // Live block containing 'ptr' (anywhere in its requested bytes); nullopt for freed or foreign memory
+    std::optional<MemoryBlock> findBlock(const void* ptr) const;
+    // [ptr, ptr + bytes) lies inside one live block
+    bool containsRange(const void* ptr, size_t bytes) const;
+    // kernels::KernelBufferCheck function over a (possibly null) const MemoryManager* context
+    static bool checkKernelBuffer(const void* manager, uint64_t address, uint64_t bytes);
+    std::optional<RegionUsage> getRegionUsage(RegionID region) const;
+    std::vector<RegionUsage> getUsage() const; // Every region, by ID
+    // --- Vectorised Copy / Fill --
+    // Through the best VectorKernelTable for this machine; large sizes bypass the cache
+    static void copy(void* dst, const void* src, size_t bytes);
+    // 'count' elements of 'element_size' (1, 2, 4 or 8) bytes, each set to the low bytes of 'value'
+    static bool fill(void* dst, uint64_t value, size_t element_size, size_t count);
+ private:
+    static constexpr uint16_t NO_CLASS = UINT16_MAX;
+    struct Region;
+    struct Slab {
+        unsigned char* base = nullptr;
+        void* free_list = nullptr; // Freed blocks, linked through their first word
+        std::unique_ptr<uint16_t[]> sizes; // Requested size per block, 0 = free
+        uint32_t bumped = 0;       // Blocks handed out from the never-used tail
+        uint32_t used = 0;
+        uint32_t capacity = 0;
+        uint16_t size_class = NO_CLASS;
+        bool queued = false; // In its class's partial list, which holds exactly the slabs with room
+        bool hasRoom() const { return free_list || bumped < capacity; }
+    };
+    // One mapping: a slab chunk or a single large block
+    struct Chunk {
+        Region* region = nullptr;
+        unsigned char* base = nullptr;
+        size_t bytes = 0;
+        size_t large_requested = 0; // Large block: requested size (0 once freed); slab chunk: 0
+        bool large = false;
+        bool huge_pages = false;
+        bool numa_bound = false;
+        uint32_t carved = 0; // Slabs carved so far (slab chunks)
+        std::array<Slab, SLABS_PER_CHUNK> slabs{};
+    };
+    struct Region {
+        RegionID id = 0;
+        RegionOptions options;
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::vector<std::vector<Slab*>> partial; // Per size class: its slabs with room
+        std::vector<Slab*> empty_slabs;          // Carved slabs without blocks, for any class
+        Chunk* carving = nullptr;                // Slab chunk with slabs left to carve
+        bool hugetlb_failed = false;             // No hugetlbfs pages: use transparent huge pages only
+        size_t allocated_bytes = 0;
+        size_t requested_bytes = 0;
+        size_t live_blocks = 0;
+    };
+    // Lock order: regions_mutex_, then a region's mutex, then directory_mutex_
+    mutable std::shared_mutex regions_mutex_;
+    std::unordered_map<RegionID, std::unique_ptr<Region>> regions_;
+    // Chunks by base address: free() finds the owner of a block from the chunk its address falls into
+    mutable std::shared_mutex directory_mutex_;
+    std::unordered_map<uintptr_t, Chunk*> directory_;
+    Region& getOrCreateRegion(RegionID region);
+    Chunk* findChunk(const void* ptr) const; // Under directory_mutex_
+    void unlistChunk(const Chunk& chunk);     // Under directory_mutex_
+    // Under the region's lock
+    Chunk* mapChunk(Region& region, size_t bytes, bool large);
+    void unmapChunk(Region& region, Chunk* chunk);
+    Slab* takeSlab(Region& region, uint16_t size_class);
+    void* allocateSmall(Region& region, uint16_t size_class, size_t bytes);
+    void* allocateLarge(Region& region, size_t bytes);
+    bool freeSmall(Region& region, Chunk& chunk, void* ptr);
+    static RegionUsage describe(const Region& region);
+ };
+ } // namespace bdi::runtime::memory
+ #endif // BDI_RUNTIME_MEMORY_MEMORYMANAGER_HPP
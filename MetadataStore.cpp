@@ -0,0 +1,132 @@
+// File: bdi/meta/MetadataStore.cpp
+ #include "MetadataStore.hpp"
+ #include <thread>
+ namespace bdi::meta {
+ namespace {
+ // Call 'fn' with a null pointer of the alternative type for 'kind' (not NONE)
+ template <typename Fn>
+ decltype(auto) visitKind(MetadataKind kind, Fn&& fn) {
+    switch (kind) {
+        case MetadataKind::SEMANTIC_TAG: return fn(static_cast<SemanticTag*>(nullptr));
+        case MetadataKind::DSL_PROVENANCE: return fn(static_cast<DSLProvenance*>(nullptr));
+        case MetadataKind::PROOF_TAG: return fn(static_cast<ProofTag*>(nullptr));
+        default: return fn(static_cast<HardwareHints*>(nullptr));
+    }
+ }
+ bool isStoredKind(MetadataKind kind) {
+    return kind != MetadataKind::NONE && kind < MetadataKind::KIND_COUNT;
+ }
+ } // namespace
+ MetadataStore::~MetadataStore() = default;
+ // --- Appends --
+ uint64_t MetadataStore::reserve(MetadataKind kind, size_t count) {
+    return visitKind(kind, [&](auto* tag) { return column<std::remove_pointer_t<decltype(tag)>>().reserve(count); });
+ }
+ MetadataHandle MetadataStore::publish(uint64_t row, MetadataVariant&& metadata, uint64_t epoch) {
+    const MetadataKind kind = static_cast<MetadataKind>(metadata.index());
+    std::visit([&](auto&& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (!std::is_same_v<T, std::monostate>) column<T>().publish(row, std::move(value), epoch);
+    }, std::move(metadata));
+    return makeMetadataHandle(kind, row);
+ }
+ MetadataHandle MetadataStore::addMetadata(MetadataVariant metadata) {
+    const MetadataKind kind = static_cast<MetadataKind>(metadata.index());
+    if (kind == MetadataKind::NONE) return 0;
+    return publish(reserve(kind, 1), std::move(metadata), epoch_.load(std::memory_order_acquire));
+ }
+ std::vector<MetadataHandle> MetadataStore::addMetadataBatch(std::span<MetadataVariant> metadata) {
+    constexpr size_t KINDS = static_cast<size_t>(MetadataKind::KIND_COUNT);
+    std::array<size_t, KINDS> counts{};
+    for (const MetadataVariant& entry : metadata) ++counts[entry.index()];
+    std::array<uint64_t, KINDS> next{};
+    for (size_t kind = 1; kind < KINDS; ++kind) {
+        if (counts[kind]) next[kind] = reserve(static_cast<MetadataKind>(kind), counts[kind]);
+    }
+    const uint64_t epoch = epoch_.load(std::memory_order_acquire);
+    std::vector<MetadataHandle> handles(metadata.size(), 0);
+    for (size_t i = 0; i < metadata.size(); ++i) {
+        const size_t kind = metadata[i].index();
+        if (kind != 0) handles[i] = publish(next[kind]++, std::move(metadata[i]), epoch);
+    }
+    return handles;
+ }
+ bool MetadataStore::updateMetadata(MetadataHandle handle, MetadataVariant metadata) {
+    const MetadataKind kind = getMetadataKind(handle);
+    if (!isStoredKind(kind) || static_cast<MetadataKind>(metadata.index()) != kind) return false;
+    const uint64_t epoch = enterUpdate();
+    const bool updated = std::visit([&](auto&& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, std::monostate>) return false;
+        else return column<T>().update(handle & METADATA_ROW_MASK, std::move(value), epoch);
+    }, std::move(metadata));
+    leaveUpdate(epoch);
+    return updated;
+ }
+ // --- Lookups --
+ std::optional<MetadataVariant> MetadataStore::getMetadata(MetadataHandle handle) const {
+    const MetadataKind kind = getMetadataKind(handle);
+    if (!isStoredKind(kind)) return std::nullopt;
+    return visitKind(kind, [&](auto* tag) -> std::optional<MetadataVariant> {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        const T* value = get<T>(handle);
+        return value ? std::optional<MetadataVariant>(*value) : std::nullopt;
+    });
+ }
+ uint64_t MetadataStore::getReservedCount(MetadataKind kind) const {
+    if (!isStoredKind(kind)) return 0;
+    return visitKind(kind, [&](auto* tag) { return column<std::remove_pointer_t<decltype(tag)>>().getReservedCount(); });
+ }
+ // --- Snapshots --
+ uint64_t MetadataStore::enterUpdate() {
+    for (;;) {
+        const uint64_t epoch = epoch_.load();
+        updaters_[epoch & 1].fetch_add(1);
+        if (epoch_.load() == epoch) return epoch;
+        // A snapshot advanced the epoch in between: join the new one instead
+        updaters_[epoch & 1].fetch_sub(1);
+    }
+ }
+ MetadataSnapshot MetadataStore::snapshot() const {
+    std::lock_guard lock(snapshot_mutex_);
+    // Updates from here on get a later epoch; wait for those still writing in this one
+    const uint64_t epoch = epoch_.fetch_add(1);
+    while (updaters_[epoch & 1].load() != 0) std::this_thread::yield();
+    live_snapshots_.insert(epoch);
+    return MetadataSnapshot(this, epoch);
+ }
+ void MetadataStore::releaseSnapshot(uint64_t epoch) const {
+    std::lock_guard lock(snapshot_mutex_);
+    live_snapshots_.erase(live_snapshots_.find(epoch));
+ }
+ size_t MetadataStore::reclaim() {
+    std::vector<uint64_t> live;
+    {
+        std::lock_guard lock(snapshot_mutex_);
+        live.assign(live_snapshots_.begin(), live_snapshots_.end());
+    }
+    size_t freed = 0;
+    std::apply([&](auto&... columns) { ((freed += columns.reclaim(live)), ...); }, columns_);
+    return freed;
+ }
+ std::optional<MetadataVariant> MetadataSnapshot::getMetadata(MetadataHandle handle) const {
+    const MetadataKind kind = getMetadataKind(handle);
+    if (!store_ || !isStoredKind(kind)) return std::nullopt;
+    return visitKind(kind, [&](auto* tag) -> std::optional<MetadataVariant> {
+        using T = std::remove_pointer_t<decltype(tag)>;
+        const T* value = get<T>(handle);
+        return value ? std::optional<MetadataVariant>(*value) : std::nullopt;
+    });
+ }
+ // --- MetadataWriter --
+ MetadataHandle MetadataWriter::addMetadata(MetadataVariant metadata) {
+    const size_t kind = metadata.index();
+    if (kind == 0) return 0;
+    Range& range = ranges_[kind];
+    if (range.next == range.end) {
+        range.next = store_.reserve(static_cast<MetadataKind>(kind), chunk_);
+        range.end = range.next + chunk_;
+    }
+    return store_.publish(range.next++, std::move(metadata), store_.epoch_.load(std::memory_order_acquire));
+ }
+ } // namespace bdi::meta
@@ -0,0 +1,298 @@
+// File: bdi/meta/MetadataStore.hpp
+ #ifndef BDI_META_METADATASTORE_HPP
+ #define BDI_META_METADATASTORE_HPP
+ #include "HardwareHints.hpp"
+ #include <algorithm>
+ #include <array>
+ #include <atomic>
+ #include <bit>
+ #include <cstddef>
+ #include <cstdint>
+ #include <mutex>
+ #include <optional>
+ #include <set>
+ #include <span>
+ #include <string>
+ #include <tuple>
+ #include <type_traits>
+ #include <utility>
+ #include <variant>
+ #include <vector>
+ namespace bdi::meta {
+ // Handle stored in BDINode::metadata_handle: the metadata kind in the top byte, the row of that kind's
+ // column below it. 0 means no metadata.
+ using MetadataHandle = uint64_t;
+ // Free-form description of what a node means (intent, naming)
+ struct SemanticTag {
+    std::string description;
+ };
+ // Where a node came from in a DSL program
+ struct DSLProvenance {
+    std::string dsl_name;
+    std::string source_location; // e.g. "model.dsl:42:7"
+    std::string construct;       // DSL construct the node was decomposed from
+ };
+ // Link to a formal proof artifact or derivation
+ struct ProofTag {
+    std::array<uint8_t, 32> hash{}; // Hash of the derivation
+    std::string proof_system;       // e.g. "lean4"
+ };
+ using MetadataVariant = std::variant<std::monostate, SemanticTag, DSLProvenance, ProofTag, HardwareHints>;
+ // Variant index of each alternative; also the kind byte of its handles
+ enum class MetadataKind : uint8_t {
+    NONE,
+    SEMANTIC_TAG,
+    DSL_PROVENANCE,
+    PROOF_TAG,
+    HARDWARE_HINTS,
+    KIND_COUNT
+ };
+ static_assert(static_cast<size_t>(MetadataKind::KIND_COUNT) == std::variant_size_v<MetadataVariant>);
+ inline constexpr unsigned METADATA_KIND_SHIFT = 56;
+ inline constexpr uint64_t METADATA_ROW_MASK = (uint64_t{1} << METADATA_KIND_SHIFT) - 1;
+ inline constexpr MetadataKind getMetadataKind(MetadataHandle handle) {
+    return static_cast<MetadataKind>(handle >> METADATA_KIND_SHIFT);
+ }
+ inline constexpr MetadataHandle makeMetadataHandle(MetadataKind kind, uint64_t row) {
+    return kind == MetadataKind::NONE ? 0 : (static_cast<uint64_t>(kind) << METADATA_KIND_SHIFT) | (row & METADATA_ROW_MASK);
+ }
+ namespace detail {
+ template <typename T, size_t I = 0>
+ constexpr MetadataKind kindOf() {
+    if constexpr (std::is_same_v<std::variant_alternative_t<I, MetadataVariant>, T>) return static_cast<MetadataKind>(I);
+    else return kindOf<T, I + 1>();
+ }
+ // Append-only column of one metadata kind. Rows live in segments of doubling size reached through a
+ // fixed directory, so a row never moves once allocated and a read is two dependent loads without locks.
+ // Each row is a chain of versions, newest first; the first version is stored in the row itself.
+ template <typename T>
+ class MetadataColumn {
+ public:
+    struct Version {
+        T value{};
+        uint64_t epoch = 0; // Store epoch the version was written in (see MetadataStore::snapshot)
+        const Version* older = nullptr;
+    };
+    static constexpr size_t FIRST_SEGMENT_ROWS = 1024;
+    static constexpr size_t SEGMENT_COUNT = 40; // FIRST_SEGMENT_ROWS * 2^40 rows
+    MetadataColumn() = default;
+    MetadataColumn(const MetadataColumn&) = delete;
+    MetadataColumn& operator=(const MetadataColumn&) = delete;
+    ~MetadataColumn() {
+        for (uint64_t index : updated_rows_) {
+            Row& r = *row(index);
+            for (const Version* v = r.head.load(std::memory_order_relaxed); v;) {
+                const Version* older = v->older;
+                if (v != &r.initial) delete v;
+                v = older;
+            }
+        }
+        for (size_t s = 0; s < SEGMENT_COUNT; ++s) delete[] segments_[s].load(std::memory_order_relaxed);
+    }
+    // First of 'count' consecutive rows owned by the caller until it publishes them
+    uint64_t reserve(size_t count) { return next_row_.fetch_add(count, std::memory_order_relaxed); }
+    uint64_t getReservedCount() const { return next_row_.load(std::memory_order_relaxed); }
+    // Write the first version of a reserved row and make it visible
+    void publish(uint64_t index, T value, uint64_t epoch) {
+        Row& r = *row(index, true);
+        r.initial.value = std::move(value);
+        r.initial.epoch = epoch;
+        r.head.store(&r.initial, std::memory_order_release);
+    }
+    // Put a new version in front; false if the row has not been published
+    bool update(uint64_t index, T value, uint64_t epoch) {
+        Row* r = row(index);
+        if (!r) return false;
+        const Version* older = r->head.load(std::memory_order_acquire);
+        if (!older) return false;
+        Version* version = new Version{std::move(value), epoch, older};
+        while (!r->head.compare_exchange_weak(older, version, std::memory_order_release, std::memory_order_acquire)) {
+            version->older = older;
+        }
+        if (older == &r->initial) { // First update of the row: remember it for reclaim() and destruction
+            std::lock_guard lock(updated_mutex_);
+            updated_rows_.push_back(index);
+        }
+        return true;
+    }
+    // Newest version (nullptr if the row is not published)
+    const T* latest(uint64_t index) const {
+        const Row* r = row(index);
+        const Version* v = r ? r->head.load(std::memory_order_acquire) : nullptr;
+        return v ? &v->value : nullptr;
+    }
+    // Newest version written in an epoch up to 'epoch'
+    const T* at(uint64_t index, uint64_t epoch) const {
+        const Row* r = row(index);
+        const Version* v = r ? r->head.load(std::memory_order_acquire) : nullptr;
+        while (v && v->epoch > epoch) v = v->older;
+        return v ? &v->value : nullptr;
+    }
+    // Drop older versions no snapshot in 'live_epochs' (ascending) can see; returns how many
+    size_t reclaim(std::span<const uint64_t> live_epochs) {
+        size_t freed = 0;
+        std::lock_guard lock(updated_mutex_);
+        for (uint64_t index : updated_rows_) {
+            Row& r = *row(index);
+            const Version* newer = r.head.load(std::memory_order_relaxed);
+            while (const Version* v = newer->older) {
+                // Needed by a snapshot taken after v was written and before 'newer' was
+                auto it = std::lower_bound(live_epochs.begin(), live_epochs.end(), v->epoch);
+                if (it != live_epochs.end() && *it < newer->epoch) {
+                    newer = v;
+                    continue;
+                }
+                const_cast<Version*>(newer)->older = v->older;
+                if (v == &r.initial) r.initial.value = T{};
+                else delete v;
+                ++freed;
+            }
+        }
+        return freed;
+    }
+ private:
+    struct Row {
+        std::atomic<const Version*> head{nullptr};
+        Version initial;
+    };
+    // Segment s holds rows [FIRST_SEGMENT_ROWS * (2^s - 1), FIRST_SEGMENT_ROWS * (2^(s+1) - 1))
+    static size_t segmentOf(uint64_t index) { return std::bit_width(index / FIRST_SEGMENT_ROWS + 1) - 1; }
+    static uint64_t segmentBase(size_t s) { return FIRST_SEGMENT_ROWS * ((uint64_t{1} << s) - 1); }
+    Row* row(uint64_t index, bool allocate = false) const {
+        const size_t s = segmentOf(index);
+        if (s >= SEGMENT_COUNT) return nullptr;
+        Row* segment = segments_[s].load(std::memory_order_acquire);
+        if (!segment) {
+            if (!allocate) return nullptr;
+            // The first writer into a segment allocates it; a writer losing the race frees its copy
+            Row* fresh = new Row[FIRST_SEGMENT_ROWS << s];
+            if (segments_[s].compare_exchange_strong(segment, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) segment = fresh;
+            else delete[] fresh;
+        }
+        return segment + (index - segmentBase(s));
+    }
+    mutable std::array<std::atomic<Row*>, SEGMENT_COUNT> segments_{};
+    alignas(64) std::atomic<uint64_t> next_row_{0};
+    std::mutex updated_mutex_;
+    std::vector<uint64_t> updated_rows_; // Rows with versions on the heap
+ };
+ } // namespace detail
+ class MetadataSnapshot;
+ // Metadata of graph nodes (semantic tags, DSL provenance, proof tags, hardware hints), shared by
+ // builder threads, passes and execution engines without a global lock:
+ //  - Each kind is its own column, so a lookup of hardware hints never touches strings of other kinds
+ //    and appends of different kinds do not contend.
+ //  - Reads are lock-free: get() returns a pointer into the column, valid until reclaim().
+ //  - Appends reserve rows with one atomic add per kind, per call or per batch (addMetadataBatch(), or
+ //    MetadataWriter, which reserves handles in chunks).
+ //  - updateMetadata() keeps the previous version for snapshots taken before it (copy-on-write).
+ // Handles of one kind are dense in the order their rows were reserved.
+ class MetadataStore {
+ public:
+    MetadataStore() = default;
+    MetadataStore(const MetadataStore&) = delete;
+    MetadataStore& operator=(const MetadataStore&) = delete;
+    ~MetadataStore();
+    // --- Appends --
+    // Handle of the new entry (0 for std::monostate)
+    MetadataHandle addMetadata(MetadataVariant metadata);
+    // Append many entries, reserving the rows of each kind at once; handles in the order of 'metadata'
+    // (whose values are moved from)
+    std::vector<MetadataHandle> addMetadataBatch(std::span<MetadataVariant> metadata);
+    // Replace the entry behind 'handle' with a value of the same kind. Readers see either version;
+    // snapshots taken before keep the old one. False for an unknown handle or a different kind.
+    bool updateMetadata(MetadataHandle handle, MetadataVariant metadata);
+    // --- Lookups (lock-free) --
+    // Current entry, or nullptr if 'handle' holds no T
+    template <typename T>
+    const T* get(MetadataHandle handle) const {
+        if (getMetadataKind(handle) != detail::kindOf<T>()) return nullptr;
+        return column<T>().latest(handle & METADATA_ROW_MASK);
+    }
+    std::optional<MetadataVariant> getMetadata(MetadataHandle handle) const;
+    std::optional<HardwareHints> getHardwareHints(MetadataHandle handle) const {
+        const HardwareHints* hints = get<HardwareHints>(handle);
+        return hints ? std::optional<HardwareHints>(*hints) : std::nullopt;
+    }
+    // Rows reserved for 'kind' so far (including rows not yet published)
+    uint64_t getReservedCount(MetadataKind kind) const;
+    // --- Snapshots --
+    // Consistent view as of now: later updates are not visible through it. Entries appended while the
+    // snapshot is taken may appear in it later, but never change in it.
+    MetadataSnapshot snapshot() const;
+    // Free versions that neither a lookup nor a live snapshot can see any more; returns how many. Old
+    // versions are otherwise kept, so get() pointers stay valid. Must not run concurrently with any
+    // other use of the store.
+    size_t reclaim();
+ private:
+    friend class MetadataSnapshot;
+    friend class MetadataWriter;
+    using Columns = std::tuple<detail::MetadataColumn<SemanticTag>, detail::MetadataColumn<DSLProvenance>,
+                               detail::MetadataColumn<ProofTag>, detail::MetadataColumn<HardwareHints>>;
+    template <typename T>
+    detail::MetadataColumn<T>& column() { return std::get<detail::MetadataColumn<T>>(columns_); }
+    template <typename T>
+    const detail::MetadataColumn<T>& column() const { return std::get<detail::MetadataColumn<T>>(columns_); }
+    // Publish 'metadata' in a row reserved for its kind
+    MetadataHandle publish(uint64_t row, MetadataVariant&& metadata, uint64_t epoch);
+    uint64_t reserve(MetadataKind kind, size_t count);
+    // Updates run inside a section tagged with the current epoch; snapshot() advances the epoch and
+    // waits for the sections of the old one, so an update is either in a snapshot or after it.
+    uint64_t enterUpdate();
+    void leaveUpdate(uint64_t epoch) { updaters_[epoch & 1].fetch_sub(1); }
+    void releaseSnapshot(uint64_t epoch) const;
+    Columns columns_;
+    alignas(64) mutable std::atomic<uint64_t> epoch_{1}; // Advanced by snapshot()
+    alignas(64) std::array<std::atomic<uint64_t>, 2> updaters_{}; // Open update sections, by epoch parity
+    mutable std::mutex snapshot_mutex_;
+    mutable std::multiset<uint64_t> live_snapshots_; // Epochs of snapshots not yet destroyed
+ };
+ // Read-only view of a MetadataStore at one epoch. Lookups are lock-free. Must not outlive the store.
+ class MetadataSnapshot {
+ public:
+    MetadataSnapshot(MetadataSnapshot&& other) noexcept : store_(other.store_), epoch_(other.epoch_) { other.store_ = nullptr; }
+    MetadataSnapshot& operator=(MetadataSnapshot&& other) noexcept {
+        if (this != &other) {
+            release();
+            store_ = std::exchange(other.store_, nullptr);
+            epoch_ = other.epoch_;
+        }
+        return *this;
+    }
+    ~MetadataSnapshot() { release(); }
+    template <typename T>
+    const T* get(MetadataHandle handle) const {
+        if (!store_ || getMetadataKind(handle) != detail::kindOf<T>()) return nullptr;
+        return store_->column<T>().at(handle & METADATA_ROW_MASK, epoch_);
+    }
+    std::optional<MetadataVariant> getMetadata(MetadataHandle handle) const;
+    uint64_t getEpoch() const { return epoch_; }
+ private:
+    friend class MetadataStore;
+    MetadataSnapshot(const MetadataStore* store, uint64_t epoch) : store_(store), epoch_(epoch) {}
+    void release() {
+        if (store_) store_->releaseSnapshot(epoch_);
+        store_ = nullptr;
+    }
+    const MetadataStore* store_ = nullptr;
+    uint64_t epoch_ = 0;
+ };
+ // Appender for one thread: reserves handles in chunks, so appends from many builder threads do not
+ // contend on the column counters. Reserved handles it does not use stay empty.
+ class MetadataWriter {
+ public:
+    static constexpr size_t DEFAULT_HANDLE_CHUNK = 256;
+    explicit MetadataWriter(MetadataStore& store, size_t chunk = DEFAULT_HANDLE_CHUNK)
+        : store_(store), chunk_(chunk ? chunk : 1) {}
+    MetadataHandle addMetadata(MetadataVariant metadata);
+ private:
+    struct Range {
+        uint64_t next = 0;
+        uint64_t end = 0;
+    };
+    MetadataStore& store_;
+    size_t chunk_;
+    std::array<Range, static_cast<size_t>(MetadataKind::KIND_COUNT)> ranges_{};
+ };
+ } // namespace bdi::meta
+ #endif // BDI_META_METADATASTORE_HPP
@@ -0,0 +1,159 @@
+// File: bdi/tests/MetadataTests.cpp
+ // MetadataStore: snapshots keep their versions across updates, reclaim() frees what no snapshot can see,
+ // lookups of stale or malformed handles, and lock-free readers racing one writer
+ #include "TestSupport.hpp"
+ #include "../meta/MetadataStore.hpp"
+ #include <atomic>
+ #include <string>
+ #include <thread>
+ #include <vector>
+ using namespace bdi::tests;
+ using namespace bdi::meta;
+ namespace {
+ SemanticTag tag(const std::string& description) { return SemanticTag{description}; }
+ bool reads(const SemanticTag* value, const char* description) { return value && value->description == description; }
+ void testSnapshotIsolation() {
+    MetadataStore store;
+    const MetadataHandle h = store.addMetadata(tag("a"));
+    MetadataSnapshot first = store.snapshot();
+    BDI_CHECK(store.updateMetadata(h, tag("b")));
+    BDI_CHECK(reads(first.get<SemanticTag>(h), "a"));
+    BDI_CHECK(reads(store.get<SemanticTag>(h), "b"));
+    MetadataSnapshot second = store.snapshot();
+    BDI_CHECK(store.updateMetadata(h, tag("c")));
+    BDI_CHECK(store.updateMetadata(h, tag("d")));
+    BDI_CHECK(reads(first.get<SemanticTag>(h), "a"));
+    BDI_CHECK(reads(second.get<SemanticTag>(h), "b"));
+    BDI_CHECK(reads(store.get<SemanticTag>(h), "d"));
+    BDI_CHECK(second.getEpoch() > first.getEpoch());
+    // Appended after the snapshot: not in it
+    const MetadataHandle later = store.addMetadata(tag("later"));
+    BDI_CHECK(first.get<SemanticTag>(later) == nullptr && !second.getMetadata(later).has_value());
+    BDI_CHECK(reads(store.get<SemanticTag>(later), "later"));
+    // Through getMetadata(), and after a move
+    auto variant = first.getMetadata(h);
+    BDI_CHECK(variant && std::holds_alternative<SemanticTag>(*variant) && std::get<SemanticTag>(*variant).description == "a");
+    MetadataSnapshot moved = std::move(first);
+    BDI_CHECK(reads(moved.get<SemanticTag>(h), "a"));
+    BDI_CHECK(first.get<SemanticTag>(h) == nullptr); // A moved-from snapshot sees nothing
+    // Other kinds keep their own versions
+    const MetadataHandle hints = store.addMetadata(HardwareHints{ExecutionUnit::ANY, 16, 3});
+    MetadataSnapshot third = store.snapshot();
+    BDI_CHECK(store.updateMetadata(hints, HardwareHints{ExecutionUnit::ANY, 64, 3}));
+    BDI_CHECK(third.get<HardwareHints>(hints)->alignment == 16 && store.getHardwareHints(hints)->alignment == 64);
+    BDI_CHECK(reads(third.get<SemanticTag>(h), "d"));
+ }
+ void testReclaim() {
+    MetadataStore store;
+    const MetadataHandle h = store.addMetadata(tag("a"));
+    const MetadataHandle untouched = store.addMetadata(tag("u"));
+    std::optional<MetadataSnapshot> first = store.snapshot();
+    BDI_CHECK(store.updateMetadata(h, tag("b")));
+    std::optional<MetadataSnapshot> second = store.snapshot();
+    BDI_CHECK(store.updateMetadata(h, tag("c")));
+    const SemanticTag* newest = store.get<SemanticTag>(h);
+    BDI_CHECK(store.reclaim() == 0); // "a" and "b" are both still visible
+    BDI_CHECK(reads(first->get<SemanticTag>(h), "a") && reads(second->get<SemanticTag>(h), "b"));
+    first.reset();
+    BDI_CHECK(store.reclaim() == 1); // "a"
+    BDI_CHECK(reads(second->get<SemanticTag>(h), "b"));
+    second.reset();
+    BDI_CHECK(store.reclaim() == 1); // "b"
+    BDI_CHECK(store.reclaim() == 0);
+    // The newest version never moves
+    BDI_CHECK(store.get<SemanticTag>(h) == newest && reads(newest, "c"));
+    BDI_CHECK(reads(store.get<SemanticTag>(untouched), "u"));
+    // Without snapshots, every version but the newest goes
+    for (int i = 0; i < 100; ++i) BDI_CHECK(store.updateMetadata(h, tag(std::to_string(i))));
+    BDI_CHECK(store.reclaim() == 100);
+    BDI_CHECK(reads(store.get<SemanticTag>(h), "99"));
+    // A snapshot in the middle keeps exactly the version it sees
+    for (int i = 0; i < 10; ++i) BDI_CHECK(store.updateMetadata(h, tag("x" + std::to_string(i))));
+    MetadataSnapshot middle = store.snapshot();
+    for (int i = 0; i < 10; ++i) BDI_CHECK(store.updateMetadata(h, tag("y" + std::to_string(i))));
+    BDI_CHECK(store.reclaim() == 19);
+    BDI_CHECK(reads(middle.get<SemanticTag>(h), "x9") && reads(store.get<SemanticTag>(h), "y9"));
+ }
+ void testInvalidHandles() {
+    MetadataStore store;
+    const MetadataHandle h = store.addMetadata(tag("a"));
+    const uint64_t row = h & METADATA_ROW_MASK;
+    const MetadataSnapshot snapshot = store.snapshot();
+    BDI_CHECK(store.get<ProofTag>(h) == nullptr);    // Wrong kind
+    BDI_CHECK(store.get<SemanticTag>(0) == nullptr); // No metadata
+    BDI_CHECK(!store.getMetadata(0).has_value() && !store.getHardwareHints(h).has_value());
+    // Rows never reserved, in the first segment, in a segment never allocated, and past the last one
+    for (uint64_t missing : {row + 1, uint64_t{5000}, uint64_t{1} << 40, METADATA_ROW_MASK}) {
+        const MetadataHandle stale = makeMetadataHandle(MetadataKind::SEMANTIC_TAG, missing);
+        BDI_CHECK(store.get<SemanticTag>(stale) == nullptr && snapshot.get<SemanticTag>(stale) == nullptr);
+        BDI_CHECK(!store.getMetadata(stale).has_value() && !store.updateMetadata(stale, tag("x")));
+    }
+    // Reserved by a writer but never published
+    MetadataWriter writer(store, 8);
+    const MetadataHandle written = writer.addMetadata(tag("w"));
+    const MetadataHandle reserved = written + 1;
+    BDI_CHECK(reads(store.get<SemanticTag>(written), "w"));
+    BDI_CHECK(store.getReservedCount(MetadataKind::SEMANTIC_TAG) >= (reserved & METADATA_ROW_MASK) + 1);
+    BDI_CHECK(store.get<SemanticTag>(reserved) == nullptr && !store.updateMetadata(reserved, tag("x")));
+    // Kind bytes that name no kind
+    for (uint64_t kind : {uint64_t(MetadataKind::KIND_COUNT), uint64_t{0xFF}}) {
+        const MetadataHandle bogus = (kind << METADATA_KIND_SHIFT) | row;
+        BDI_CHECK(!store.getMetadata(bogus).has_value() && !snapshot.getMetadata(bogus).has_value());
+        BDI_CHECK(!store.updateMetadata(bogus, tag("x")) && store.getReservedCount(static_cast<MetadataKind>(kind)) == 0);
+    }
+    // An update must keep the kind
+    BDI_CHECK(!store.updateMetadata(h, ProofTag{}) && reads(store.get<SemanticTag>(h), "a"));
+    BDI_CHECK(store.addMetadata(std::monostate{}) == 0);
+ }
+ // One writer updates a row (and appends) while readers check that lookups only move forward and
+ // snapshots never change. Checks in the threads are counted, then reported here.
+ void testConcurrentReaders() {
+    constexpr int UPDATES = 20000;
+    constexpr int READERS = 4;
+    MetadataStore store;
+    const MetadataHandle h = store.addMetadata(tag("0"));
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+    std::atomic<uint64_t> reads_done{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([&] {
+            long last = 0;
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                const SemanticTag* current = store.get<SemanticTag>(h);
+                const long value = current ? std::stol(current->description) : -1;
+                if (value < last) errors.fetch_add(1);
+                last = value;
+                const MetadataSnapshot snapshot = store.snapshot();
+                const SemanticTag* seen = snapshot.get<SemanticTag>(h);
+                const std::string first = seen ? seen->description : "";
+                if (!seen || std::stol(first) < last) errors.fetch_add(1);
+                std::this_thread::yield();
+                if (snapshot.get<SemanticTag>(h) != seen || seen->description != first) errors.fetch_add(1);
+                ++count;
+            }
+            reads_done.fetch_add(count);
+        });
+    }
+    std::vector<MetadataHandle> appended;
+    for (int i = 1; i <= UPDATES; ++i) {
+        if (!store.updateMetadata(h, tag(std::to_string(i)))) errors.fetch_add(1);
+        if (i % 100 == 0) appended.push_back(store.addMetadata(tag("n" + std::to_string(i))));
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers) reader.join();
+    BDI_CHECK(errors.load() == 0);
+    BDI_CHECK(reads_done.load() > 0);
+    BDI_CHECK(reads(store.get<SemanticTag>(h), std::to_string(UPDATES).c_str()));
+    for (size_t i = 0; i < appended.size(); ++i) BDI_CHECK(reads(store.get<SemanticTag>(appended[i]), ("n" + std::to_string((i + 1) * 100)).c_str()));
+    BDI_CHECK(store.reclaim() == static_cast<size_t>(UPDATES)); // Every snapshot is gone
+ }
+ } // namespace
+ int main() {
+    testSnapshotIsolation();
+    testReclaim();
+    testInvalidHandles();
+    testConcurrentReaders();
+    return bdi::tests::finish("MetadataTests");
+ }
@@ -0,0 +1,316 @@
+// File: bdi/runtime/OperationSemantics.hpp
+ #ifndef BDI_RUNTIME_OPERATIONSEMANTICS_HPP
+ #define BDI_RUNTIME_OPERATIONSEMANTICS_HPP
+ #include "RuntimeValue.hpp"
+ #include "../core/graph/OperationTypes.hpp"
+ #include <bit>
+ #include <cmath>
+ #include <cstdint>
+ #include <limits>
+ #include <type_traits>
+ namespace bdi::runtime {
+ using bdi::core::graph::BDIOperationType;
+ // Reference semantics for scalar operations.
+ // Every execution engine (interpreter, pre-decoded, batched, JIT fallback) and the constant folder
+ // evaluate scalar nodes through these helpers so that they agree bit for bit.
+ // Invoke 'fn' with a value-initialized object of the C++ type backing 'type'.
+ // BOOL is computed as uint8_t and normalized back to 0/1 on store.
+ // Returns false for non-scalar types.
+ template <typename Fn>
+ inline bool dispatchScalarType(BDIType type, Fn&& fn) {
+    switch (type) {
+        case BDIType::BOOL:    fn(uint8_t{}); return true;
+        case BDIType::INT8:    fn(int8_t{}); return true;
+        case BDIType::UINT8:   fn(uint8_t{}); return true;
+        case BDIType::INT16:   fn(int16_t{}); return true;
+        case BDIType::UINT16:  fn(uint16_t{}); return true;
+        case BDIType::INT32:   fn(int32_t{}); return true;
+        case BDIType::UINT32:  fn(uint32_t{}); return true;
+        case BDIType::INT64:   fn(int64_t{}); return true;
+        case BDIType::UINT64:  fn(uint64_t{}); return true;
+        case BDIType::FLOAT32: fn(float{}); return true;
+        case BDIType::FLOAT64: fn(double{}); return true;
+        default: return false;
+    }
+ }
+ inline bool isScalarType(BDIType type) {
+    return dispatchScalarType(type, [](auto) {});
+ }
+ // Read 'value' as C++ type T, converting numerically from its own BDIType.
+ template <typename T>
+ inline T loadAs(const RuntimeValue& value) {
+    T result{};
+    dispatchScalarType(value.type, [&](auto tag) {
+        using S = decltype(tag);
+        result = static_cast<T>(value.as<S>());
+    });
+    return result;
+ }
+ // Store C++ value into a slot of BDIType 'type' (numeric conversion, BOOL normalized).
+ template <typename T>
+ inline RuntimeValue storeAs(BDIType type, T value) {
+    RuntimeValue out;
+    dispatchScalarType(type, [&](auto tag) {
+        using D = decltype(tag);
+        if (type == BDIType::BOOL) out = RuntimeValue::make<uint8_t>(type, value != T{} ? 1 : 0);
+        else out = RuntimeValue::make<D>(type, static_cast<D>(value));
+    });
+    return out;
+ }
+ inline bool isTruthy(const RuntimeValue& value) {
+    bool truthy = value.bits != 0;
+    dispatchScalarType(value.type, [&](auto tag) {
+        using T = decltype(tag);
+        truthy = value.as<T>() != T{};
+    });
+    return truthy;
+ }
+ inline bool isScalarBinaryOperation(BDIOperationType op) {
+    switch (op) {
+        case BDIOperationType::ARITH_ADD: case BDIOperationType::ARITH_SUB:
+        case BDIOperationType::ARITH_MUL: case BDIOperationType::ARITH_DIV:
+        case BDIOperationType::ARITH_MOD:
+        case BDIOperationType::BIT_AND: case BDIOperationType::BIT_OR: case BDIOperationType::BIT_XOR:
+        case BDIOperationType::BIT_SHL: case BDIOperationType::BIT_SHR: case BDIOperationType::BIT_ASHR:
+        case BDIOperationType::BIT_ROL: case BDIOperationType::BIT_ROR:
+        case BDIOperationType::LOGIC_AND: case BDIOperationType::LOGIC_OR: case BDIOperationType::LOGIC_XOR:
+        case BDIOperationType::CMP_EQ: case BDIOperationType::CMP_NE: case BDIOperationType::CMP_LT:
+        case BDIOperationType::CMP_LE: case BDIOperationType::CMP_GT: case BDIOperationType::CMP_GE:
+            return true;
+        default:
+            return false;
+    }
+ }
+ // Number of data operands an operation consumes (immediates from the payload count towards this).
+ inline size_t getScalarOperationArity(BDIOperationType op) {
+    switch (op) {
+        case BDIOperationType::ARITH_NEG: case BDIOperationType::ARITH_ABS:
+        case BDIOperationType::ARITH_INC: case BDIOperationType::ARITH_DEC:
+        case BDIOperationType::BIT_NOT: case BDIOperationType::BIT_POPCOUNT:
+        case BDIOperationType::BIT_LZCNT: case BDIOperationType::BIT_TZCNT:
+        case BDIOperationType::LOGIC_NOT:
+        case BDIOperationType::CONV_TRUNC: case BDIOperationType::CONV_EXTEND_SIGN:
+        case BDIOperationType::CONV_EXTEND_ZERO: case BDIOperationType::CONV_FLOAT_TO_INT:
+        case BDIOperationType::CONV_INT_TO_FLOAT: case BDIOperationType::CONV_BITCAST:
+            return 1;
+        case BDIOperationType::ARITH_FMA:
+            return 3;
+        default:
+            return isScalarBinaryOperation(op) ? 2 : 0;
+    }
+ }
+ // True for every operation evaluateScalar can compute.
+ inline bool isScalarOperation(BDIOperationType op) {
+    return getScalarOperationArity(op) != 0;
+ }
+ namespace detail {
+ // Unsigned type wrapping arithmetic on U is computed in: types narrower than int would promote to
+ // (signed) int, where a product of two 16-bit values overflows
+ template <typename U>
+ using WrapType = std::common_type_t<U, unsigned>;
+ // Whether 'value' converts to integer type D without overflow (truncated toward zero, as the cast does)
+ template <typename D, typename S>
+ inline bool fitsInteger(S value) {
+    if constexpr (std::is_floating_point_v<S> && std::is_integral_v<D>) {
+        if (!std::isfinite(value)) return false;
+        const S limit = std::ldexp(S(1), std::numeric_limits<D>::digits); // max() + 1
+        const S t = std::trunc(value);
+        return t < limit && t >= (std::is_signed_v<D> ? -limit : S(0));
+    } else {
+        return true;
+    }
+ }
+ // Whether storeAs(type, value) is a defined conversion (BOOL only compares against zero)
+ template <typename S>
+ inline bool isRepresentable(BDIType type, S value) {
+    bool fits = true;
+    if (type == BDIType::BOOL) return true;
+    dispatchScalarType(type, [&](auto tag) { fits = fitsInteger<decltype(tag)>(value); });
+    return fits;
+ }
+ // loadAs(value), failing where the numeric conversion would overflow
+ template <typename T>
+ inline bool loadChecked(const RuntimeValue& value, T& out) {
+    bool fits = true;
+    dispatchScalarType(value.type, [&](auto tag) {
+        using S = decltype(tag);
+        const S v = value.as<S>();
+        fits = fitsInteger<T>(v);
+        if (fits) out = static_cast<T>(v);
+    });
+    return fits;
+ }
+ // NaN result of a float add/sub/mul/div/fma, fixed by operand order rather than by the instruction form
+ // the compiler picked (x86 propagates whichever NaN is in the first source register): the first NaN
+ // operand, quieted, or the positive default NaN when the operation itself was invalid
+ template <typename T>
+ inline T orderedNan(T r, T a, T b, T c = T(0)) {
+    if (!std::isnan(r)) return r;
+    using Bits = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+    constexpr Bits quiet = Bits(1) << (std::numeric_limits<T>::digits - 2);
+    for (T operand : {a, b, c}) {
+        if (std::isnan(operand)) return std::bit_cast<T>(Bits(std::bit_cast<Bits>(operand) | quiet));
+    }
+    return std::numeric_limits<T>::quiet_NaN();
+ }
+ // Arithmetic/bitwise kernel in operand type T. Integer arithmetic wraps (computed unsigned).
+ template <typename T>
+ inline bool applyArithmetic(BDIOperationType op, T a, T b, T c, T& r) {
+    if constexpr (std::is_floating_point_v<T>) {
+        switch (op) {
+            case BDIOperationType::ARITH_ADD: r = orderedNan(a + b, a, b); return true;
+            case BDIOperationType::ARITH_SUB: r = orderedNan(a - b, a, b); return true;
+            case BDIOperationType::ARITH_MUL: r = orderedNan(a * b, a, b); return true;
+            case BDIOperationType::ARITH_DIV: r = orderedNan(a / b, a, b); return true;
+            case BDIOperationType::ARITH_MOD: r = std::fmod(a, b); return true;
+            case BDIOperationType::ARITH_NEG: r = -a; return true;
+            case BDIOperationType::ARITH_ABS: r = std::fabs(a); return true;
+            case BDIOperationType::ARITH_INC: r = a + T(1); return true;
+            case BDIOperationType::ARITH_DEC: r = a - T(1); return true;
+            case BDIOperationType::ARITH_FMA: r = orderedNan(std::fma(a, b, c), a, b, c); return true;
+            default: return false; // Bitwise ops are undefined on floats
+        }
+    } else {
+        using U = std::make_unsigned_t<T>;
+        using W = WrapType<U>;
+        constexpr unsigned bits = std::numeric_limits<U>::digits;
+        const U ua = static_cast<U>(a), ub = static_cast<U>(b);
+        switch (op) {
+            case BDIOperationType::ARITH_ADD: r = static_cast<T>(U(ua + ub)); return true;
+            case BDIOperationType::ARITH_SUB: r = static_cast<T>(U(ua - ub)); return true;
+            case BDIOperationType::ARITH_MUL: r = static_cast<T>(U(W(ua) * W(ub))); return true;
+            case BDIOperationType::ARITH_DIV:
+            case BDIOperationType::ARITH_MOD:
+                if (b == 0) return false; // Division by zero is an execution error
+                if constexpr (std::is_signed_v<T>) {
+                    if (b == T(-1)) { // Avoid INT_MIN / -1 overflow
+                        r = op == BDIOperationType::ARITH_DIV ? static_cast<T>(U(U(0) - ua)) : T(0);
+                        return true;
+                    }
+                }
+                r = op == BDIOperationType::ARITH_DIV ? T(a / b) : T(a % b);
+                return true;
+            case BDIOperationType::ARITH_NEG: r = static_cast<T>(U(U(0) - ua)); return true;
+            case BDIOperationType::ARITH_ABS:
+                if constexpr (std::is_signed_v<T>) r = a < 0 ? static_cast<T>(U(U(0) - ua)) : a;
+                else r = a;
+                return true;
+            case BDIOperationType::ARITH_INC: r = static_cast<T>(U(ua + 1)); return true;
+            case BDIOperationType::ARITH_DEC: r = static_cast<T>(U(ua - 1)); return true;
+            case BDIOperationType::ARITH_FMA: r = static_cast<T>(U(W(ua) * W(ub) + W(static_cast<U>(c)))); return true;
+            case BDIOperationType::BIT_AND: r = static_cast<T>(U(ua & ub)); return true;
+            case BDIOperationType::BIT_OR:  r = static_cast<T>(U(ua | ub)); return true;
+            case BDIOperationType::BIT_XOR: r = static_cast<T>(U(ua ^ ub)); return true;
+            case BDIOperationType::BIT_NOT: r = static_cast<T>(U(~ua)); return true;
+            // Shift counts are taken modulo the bit width (x86 semantics)
+            case BDIOperationType::BIT_SHL: r = static_cast<T>(U(ua << (ub % bits))); return true;
+            case BDIOperationType::BIT_SHR: r = static_cast<T>(U(ua >> (ub % bits))); return true;
+            case BDIOperationType::BIT_ASHR: {
+                using S = std::make_signed_t<T>;
+                r = static_cast<T>(S(static_cast<S>(ua) >> (ub % bits)));
+                return true;
+            }
+            case BDIOperationType::BIT_ROL: r = static_cast<T>(std::rotl(ua, static_cast<int>(ub % bits))); return true;
+            case BDIOperationType::BIT_ROR: r = static_cast<T>(std::rotr(ua, static_cast<int>(ub % bits))); return true;
+            case BDIOperationType::BIT_POPCOUNT: r = static_cast<T>(std::popcount(ua)); return true;
+            case BDIOperationType::BIT_LZCNT: r = static_cast<T>(std::countl_zero(ua)); return true;
+            case BDIOperationType::BIT_TZCNT: r = static_cast<T>(std::countr_zero(ua)); return true;
+            default: return false;
+        }
+    }
+ }
+ template <typename T>
+ inline bool applyComparison(BDIOperationType op, T a, T b, bool& r) {
+    switch (op) {
+        case BDIOperationType::CMP_EQ: r = a == b; return true;
+        case BDIOperationType::CMP_NE: r = a != b; return true;
+        case BDIOperationType::CMP_LT: r = a < b; return true;
+        case BDIOperationType::CMP_LE: r = a <= b; return true;
+        case BDIOperationType::CMP_GT: r = a > b; return true;
+        case BDIOperationType::CMP_GE: r = a >= b; return true;
+        default: return false;
+    }
+ }
+ // Reinterpret the low bits of 'value' as the fixed-width integer of its own size, signed or unsigned.
+ inline RuntimeValue widenInteger(const RuntimeValue& value, bool sign_extend) {
+    size_t size = getBdiTypeSize(value.type);
+    if (size == 0 || size >= sizeof(uint64_t)) return RuntimeValue::make<uint64_t>(BDIType::UINT64, value.bits);
+    uint64_t mask = (uint64_t(1) << (size * 8)) - 1;
+    uint64_t raw = value.bits & mask;
+    if (sign_extend && (raw >> (size * 8 - 1)) != 0) raw |= ~mask;
+    return sign_extend ? RuntimeValue::make<int64_t>(BDIType::INT64, static_cast<int64_t>(raw))
+                       : RuntimeValue::make<uint64_t>(BDIType::UINT64, raw);
+ }
+ } // namespace detail
+ // Evaluate a scalar operation.
+ // 'operands' must hold getScalarOperationArity(op) values. Binary/ternary operations are computed in
+ // the type of operand 0; 'result_type' is the declared output type (UNKNOWN -> operand type, BOOL for
+ // comparisons/logic). Returns false on unsupported type/op combinations and integer division by zero.
+ inline bool evaluateScalar(BDIOperationType op, BDIType result_type, const RuntimeValue* operands, RuntimeValue& out) {
+    const RuntimeValue& a = operands[0];
+    switch (op) {
+        case BDIOperationType::LOGIC_AND: out = storeAs<bool>(BDIType::BOOL, isTruthy(a) && isTruthy(operands[1])); return true;
+        case BDIOperationType::LOGIC_OR:  out = storeAs<bool>(BDIType::BOOL, isTruthy(a) || isTruthy(operands[1])); return true;
+        case BDIOperationType::LOGIC_XOR: out = storeAs<bool>(BDIType::BOOL, isTruthy(a) != isTruthy(operands[1])); return true;
+        case BDIOperationType::LOGIC_NOT: out = storeAs<bool>(BDIType::BOOL, !isTruthy(a)); return true;
+        case BDIOperationType::CONV_TRUNC:
+        case BDIOperationType::CONV_FLOAT_TO_INT:
+        case BDIOperationType::CONV_INT_TO_FLOAT: {
+            if (!isScalarType(result_type) || !isScalarType(a.type)) return false;
+            bool ok = true;
+            dispatchScalarType(a.type, [&](auto tag) {
+                using S = decltype(tag);
+                S v = a.as<S>();
+                if constexpr (std::is_floating_point_v<S>) {
+                    if (op == BDIOperationType::CONV_INT_TO_FLOAT) { ok = false; return; }
+                    // NaN, infinities and values out of the destination's range have no defined conversion
+                    if (!std::isfinite(v) || !detail::isRepresentable(result_type, v)) { ok = false; return; }
+                } else if (op == BDIOperationType::CONV_FLOAT_TO_INT) {
+                    ok = false; return;
+                }
+                out = storeAs<S>(result_type, v);
+            });
+            return ok;
+        }
+        case BDIOperationType::CONV_EXTEND_SIGN:
+        case BDIOperationType::CONV_EXTEND_ZERO: {
+            if (!isScalarType(result_type)) return false;
+            RuntimeValue wide = detail::widenInteger(a, op == BDIOperationType::CONV_EXTEND_SIGN);
+            out = wide.type == BDIType::INT64 ? storeAs<int64_t>(result_type, wide.as<int64_t>())
+                                              : storeAs<uint64_t>(result_type, wide.as<uint64_t>());
+            return true;
+        }
+        case BDIOperationType::CONV_BITCAST: {
+            size_t size = getBdiTypeSize(result_type);
+            if (size == 0 || size != getBdiTypeSize(a.type)) return false;
+            out = a;
+            out.type = result_type;
+            return true;
+        }
+        default:
+            break;
+    }
+    bool ok = false;
+    dispatchScalarType(a.type, [&](auto tag) {
+        using T = decltype(tag);
+        const T va = a.as<T>();
+        const size_t arity = getScalarOperationArity(op);
+        // Operands 1 and 2 are converted to T; a float that does not fit an integer T fails the operation
+        T vb{}, vc{};
+        if (arity > 1 && !detail::loadChecked<T>(operands[1], vb)) return;
+        if (arity > 2 && !detail::loadChecked<T>(operands[2], vc)) return;
+        if (op >= BDIOperationType::CMP_EQ && op <= BDIOperationType::CMP_GE) {
+            bool r = false;
+            ok = detail::applyComparison<T>(op, va, vb, r);
+            if (ok) out = storeAs<bool>(BDIType::BOOL, r);
+            return;
+        }
+        T r{};
+        const BDIType out_type = result_type == BDIType::UNKNOWN ? a.type : result_type;
+        ok = detail::applyArithmetic<T>(op, va, vb, vc, r) && detail::isRepresentable(out_type, r);
+        if (ok) out = storeAs<T>(out_type, r);
+    });
+    return ok;
+ }
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_OPERATIONSEMANTICS_HPP
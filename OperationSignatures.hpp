@@ -0,0 +1,341 @@
+// File: bdi/core/graph/OperationSignatures.hpp
+ #ifndef BDI_CORE_GRAPH_OPERATIONSIGNATURES_HPP
+ #define BDI_CORE_GRAPH_OPERATIONSIGNATURES_HPP
+ #include "OperationTypes.hpp"
+ #include "../types/BDITypes.hpp"
+ #include "../types/TypeSystem.hpp"
+ #include <algorithm>
+ #include <array>
+ #include <cstddef>
+ #include <cstdint>
+ #include <initializer_list>
+ #include <optional>
+ namespace bdi::core::graph {
+ using bdi::core::types::BDIType;
+ using bdi::core::types::getBdiTypeSize;
+ using bdi::core::types::TypeSystem;
+ // Constraint on the type of an operand or result
+ enum class TypeClass : uint8_t {
+    NONE,          // Result: the operation produces no value
+    ANY,
+    SCALAR,        // BOOL, integer or floating point (truth values, printing)
+    NUMERIC,       // Integer or floating point
+    INTEGER,
+    FLOAT,
+    BOOL,
+    POINTER,
+    ADDRESS,       // POINTER, or an integer holding an address, size or index
+    FIRST_OPERAND, // Implicitly convertible to operand 0's type; results: computed in that type
+    PAYLOAD        // Result: the payload's type (constants)
+ };
+ enum OperationFlags : uint16_t {
+    OP_NONE = 0,
+    OP_PURE = 1 << 0,                 // Result depends only on the operands; no side effects
+    OP_CONTROL = 1 << 1,              // Chooses, forks or ends the control path
+    OP_READS_MEMORY = 1 << 2,
+    OP_WRITES_MEMORY = 1 << 3,
+    OP_IO = 1 << 4,
+    OP_SYNCHRONIZES = 1 << 5,         // Threads, locks, channels
+    OP_WRITES_PAYLOAD = 1 << 6,       // Changes graph state seen by later runs
+    OP_PAYLOAD_OPERANDS = 1 << 7,     // Operands that are not wired read the payload immediate
+    OP_ELEMENT_TYPE_PAYLOAD = 1 << 8, // The payload only names an element type and may carry no bytes
+    OP_KERNEL = 1 << 9,               // Runs through the vector kernel library
+    OP_EXPLICIT_RESULT = 1 << 10,     // Output 0 must declare the result type (conversions)
+    OP_SAME_SIZE_RESULT = 1 << 11     // Result type has the size of operand 0 (bit casts)
+ };
+ inline constexpr size_t MAX_SIGNATURE_OPERANDS = 6;
+ inline constexpr uint8_t VARIADIC_INPUTS = 0xFF;
+ // Static description of an operation, shared by validation, the optimizer and the engines
+ struct OperationSignature {
+    const char* name = nullptr;
+    uint8_t min_inputs = 0; // Operands that must be present (wired, or from the payload with OP_PAYLOAD_OPERANDS)
+    uint8_t max_inputs = 0; // VARIADIC_INPUTS: no limit
+    std::array<TypeClass, MAX_SIGNATURE_OPERANDS> operands{}; // Operands past the list accept ANY
+    TypeClass result = TypeClass::NONE; // Type of output 0
+    uint8_t min_successors = 0;         // Control successors required
+    uint16_t flags = OP_NONE;
+    constexpr bool has(uint16_t flag) const { return (flags & flag) != 0; }
+    constexpr TypeClass operand(size_t k) const { return k < operands.size() ? operands[k] : TypeClass::ANY; }
+ };
+ namespace detail {
+ using Op = BDIOperationType;
+ using TC = TypeClass;
+ inline constexpr size_t OPERATION_COUNT = static_cast<size_t>(Op::OPERATION_TYPE_COUNT);
+ constexpr OperationSignature signature(const char* name, uint8_t min_inputs, uint8_t max_inputs,
+                                        std::initializer_list<TypeClass> operands, TypeClass result,
+                                        uint8_t min_successors, uint16_t flags) {
+    OperationSignature s;
+    s.name = name;
+    s.min_inputs = min_inputs;
+    s.max_inputs = max_inputs;
+    s.operands.fill(TypeClass::ANY);
+    size_t k = 0;
+    for (TypeClass operand : operands) s.operands[k++] = operand;
+    s.result = result;
+    s.min_successors = min_successors;
+    s.flags = flags;
+    return s;
+ }
+ constexpr std::array<OperationSignature, OPERATION_COUNT> buildOperationSignatures() {
+    std::array<OperationSignature, OPERATION_COUNT> t{};
+    auto set = [&t](Op op, OperationSignature s) { t[static_cast<size_t>(op)] = s; };
+    constexpr uint8_t V = VARIADIC_INPUTS;
+    constexpr uint16_t SCALAR_OP = OP_PURE | OP_PAYLOAD_OPERANDS;
+    constexpr uint16_t KERNEL_OP = OP_KERNEL | OP_ELEMENT_TYPE_PAYLOAD | OP_READS_MEMORY | OP_WRITES_MEMORY;
+    // Meta
+    set(Op::META_NOP, signature("META_NOP", 0, 0, {}, TC::PAYLOAD, 0, OP_PURE));
+    set(Op::META_START, signature("META_START", 0, 0, {}, TC::NONE, 0, OP_NONE));
+    set(Op::META_END, signature("META_END", 0, 1, {TC::ANY}, TC::NONE, 0, OP_CONTROL | OP_PAYLOAD_OPERANDS));
+    set(Op::META_COMMENT, signature("META_COMMENT", 0, 0, {}, TC::NONE, 0, OP_NONE));
+    set(Op::META_ASSERT, signature("META_ASSERT", 1, 1, {TC::SCALAR}, TC::NONE, 0, OP_PAYLOAD_OPERANDS));
+    set(Op::META_VERIFY_PROOF, signature("META_VERIFY_PROOF", 0, V, {}, TC::NONE, 0, OP_NONE));
+    // Memory: [address, ...]
+    set(Op::MEM_ALLOC, signature("MEM_ALLOC", 1, 2, {TC::INTEGER, TC::INTEGER}, TC::POINTER, 0, OP_WRITES_MEMORY | OP_PAYLOAD_OPERANDS));
+    set(Op::MEM_FREE, signature("MEM_FREE", 1, 1, {TC::ADDRESS}, TC::NONE, 0, OP_WRITES_MEMORY));
+    set(Op::MEM_LOAD, signature("MEM_LOAD", 1, 2, {TC::ADDRESS, TC::INTEGER}, TC::ANY, 0, OP_READS_MEMORY));
+    set(Op::MEM_STORE, signature("MEM_STORE", 2, 3, {TC::ADDRESS, TC::ANY, TC::INTEGER}, TC::NONE, 0, OP_WRITES_MEMORY));
+    set(Op::MEM_COPY, signature("MEM_COPY", 3, 3, {TC::ADDRESS, TC::ADDRESS, TC::INTEGER}, TC::NONE, 0,
+                                OP_READS_MEMORY | OP_WRITES_MEMORY | OP_PAYLOAD_OPERANDS));
+    set(Op::MEM_SET, signature("MEM_SET", 3, 3, {TC::ADDRESS, TC::SCALAR, TC::INTEGER}, TC::NONE, 0,
+                               OP_WRITES_MEMORY | OP_PAYLOAD_OPERANDS));
+    // Arithmetic: computed in operand 0's type
+    set(Op::ARITH_ADD, signature("ARITH_ADD", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_SUB, signature("ARITH_SUB", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_MUL, signature("ARITH_MUL", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_DIV, signature("ARITH_DIV", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_MOD, signature("ARITH_MOD", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_NEG, signature("ARITH_NEG", 1, 1, {TC::NUMERIC}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_ABS, signature("ARITH_ABS", 1, 1, {TC::NUMERIC}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_INC, signature("ARITH_INC", 1, 1, {TC::NUMERIC}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_DEC, signature("ARITH_DEC", 1, 1, {TC::NUMERIC}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::ARITH_FMA, signature("ARITH_FMA", 3, 3, {TC::NUMERIC, TC::FIRST_OPERAND, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    // Bitwise: shift and rotate counts may be any integer type
+    set(Op::BIT_AND, signature("BIT_AND", 2, 2, {TC::INTEGER, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_OR, signature("BIT_OR", 2, 2, {TC::INTEGER, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_XOR, signature("BIT_XOR", 2, 2, {TC::INTEGER, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_NOT, signature("BIT_NOT", 1, 1, {TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_SHL, signature("BIT_SHL", 2, 2, {TC::INTEGER, TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_SHR, signature("BIT_SHR", 2, 2, {TC::INTEGER, TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_ASHR, signature("BIT_ASHR", 2, 2, {TC::INTEGER, TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_ROL, signature("BIT_ROL", 2, 2, {TC::INTEGER, TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_ROR, signature("BIT_ROR", 2, 2, {TC::INTEGER, TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_POPCOUNT, signature("BIT_POPCOUNT", 1, 1, {TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_LZCNT, signature("BIT_LZCNT", 1, 1, {TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    set(Op::BIT_TZCNT, signature("BIT_TZCNT", 1, 1, {TC::INTEGER}, TC::FIRST_OPERAND, 0, SCALAR_OP));
+    // Logic: operands are truth values
+    set(Op::LOGIC_AND, signature("LOGIC_AND", 2, 2, {TC::SCALAR, TC::SCALAR}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::LOGIC_OR, signature("LOGIC_OR", 2, 2, {TC::SCALAR, TC::SCALAR}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::LOGIC_XOR, signature("LOGIC_XOR", 2, 2, {TC::SCALAR, TC::SCALAR}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::LOGIC_NOT, signature("LOGIC_NOT", 1, 1, {TC::SCALAR}, TC::BOOL, 0, SCALAR_OP));
+    // Comparison: operand 1 is converted to operand 0's type
+    set(Op::CMP_EQ, signature("CMP_EQ", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::CMP_NE, signature("CMP_NE", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::CMP_LT, signature("CMP_LT", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::CMP_LE, signature("CMP_LE", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::CMP_GT, signature("CMP_GT", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    set(Op::CMP_GE, signature("CMP_GE", 2, 2, {TC::SCALAR, TC::FIRST_OPERAND}, TC::BOOL, 0, SCALAR_OP));
+    // Control flow: successors [target] / [true_target, false_target] / [continuation, case targets...]
+    set(Op::CTRL_JUMP, signature("CTRL_JUMP", 0, 0, {}, TC::NONE, 1, OP_CONTROL));
+    set(Op::CTRL_BRANCH_COND, signature("CTRL_BRANCH_COND", 1, 1, {TC::SCALAR}, TC::NONE, 2, OP_CONTROL | OP_PAYLOAD_OPERANDS));
+    set(Op::CTRL_CALL, signature("CTRL_CALL", 0, V, {}, TC::ANY, 0, OP_CONTROL));
+    set(Op::CTRL_RETURN, signature("CTRL_RETURN", 0, 1, {TC::ANY}, TC::NONE, 0, OP_CONTROL | OP_PAYLOAD_OPERANDS));
+    set(Op::CTRL_SWITCH, signature("CTRL_SWITCH", 1, 1, {TC::INTEGER}, TC::NONE, 1, OP_CONTROL));
+    // Conversions: the declared output type is the target
+    constexpr uint16_t CONV_OP = SCALAR_OP | OP_EXPLICIT_RESULT;
+    set(Op::CONV_TRUNC, signature("CONV_TRUNC", 1, 1, {TC::NUMERIC}, TC::NUMERIC, 0, CONV_OP));
+    set(Op::CONV_EXTEND_SIGN, signature("CONV_EXTEND_SIGN", 1, 1, {TC::INTEGER}, TC::INTEGER, 0, CONV_OP));
+    set(Op::CONV_EXTEND_ZERO, signature("CONV_EXTEND_ZERO", 1, 1, {TC::INTEGER}, TC::INTEGER, 0, CONV_OP));
+    set(Op::CONV_FLOAT_TO_INT, signature("CONV_FLOAT_TO_INT", 1, 1, {TC::FLOAT}, TC::INTEGER, 0, CONV_OP));
+    set(Op::CONV_INT_TO_FLOAT, signature("CONV_INT_TO_FLOAT", 1, 1, {TC::INTEGER}, TC::FLOAT, 0, CONV_OP));
+    set(Op::CONV_BITCAST, signature("CONV_BITCAST", 1, 1, {TC::ANY}, TC::ANY, 0, CONV_OP | OP_SAME_SIZE_RESULT));
+    // I/O
+    set(Op::IO_READ_PORT, signature("IO_READ_PORT", 1, 1, {TC::INTEGER}, TC::ANY, 0, OP_IO | OP_PAYLOAD_OPERANDS));
+    set(Op::IO_WRITE_PORT, signature("IO_WRITE_PORT", 2, 2, {TC::INTEGER, TC::ANY}, TC::NONE, 0, OP_IO | OP_PAYLOAD_OPERANDS));
+    set(Op::IO_PRINT, signature("IO_PRINT", 1, 1, {TC::SCALAR}, TC::NONE, 0, OP_IO | OP_PAYLOAD_OPERANDS));
+    // Concurrency: CONCURRENCY_SPAWN successors are [continuation, task entries...]
+    set(Op::CONCURRENCY_SPAWN, signature("CONCURRENCY_SPAWN", 0, 0, {}, TC::NONE, 1, OP_CONTROL | OP_SYNCHRONIZES));
+    set(Op::CONCURRENCY_JOIN, signature("CONCURRENCY_JOIN", 0, 0, {}, TC::NONE, 0, OP_SYNCHRONIZES));
+    set(Op::SYNC_MUTEX_LOCK, signature("SYNC_MUTEX_LOCK", 1, 1, {TC::ADDRESS}, TC::NONE, 0, OP_SYNCHRONIZES));
+    set(Op::SYNC_MUTEX_UNLOCK, signature("SYNC_MUTEX_UNLOCK", 1, 1, {TC::ADDRESS}, TC::NONE, 0, OP_SYNCHRONIZES));
+    set(Op::SYNC_ATOMIC_RMW, signature("SYNC_ATOMIC_RMW", 2, 2, {TC::ADDRESS, TC::INTEGER}, TC::INTEGER, 0,
+                                       OP_SYNCHRONIZES | OP_READS_MEMORY | OP_WRITES_MEMORY | OP_PAYLOAD_OPERANDS));
+    set(Op::COMM_CHANNEL_SEND, signature("COMM_CHANNEL_SEND", 2, 2, {TC::ANY, TC::ANY}, TC::NONE, 0, OP_SYNCHRONIZES | OP_PAYLOAD_OPERANDS));
+    set(Op::COMM_CHANNEL_RECV, signature("COMM_CHANNEL_RECV", 1, 1, {TC::ANY}, TC::ANY, 0, OP_SYNCHRONIZES | OP_PAYLOAD_OPERANDS));
+    // Placeholders decomposed before execution: no constraints yet
+    set(Op::DSL_RESOLVE, signature("DSL_RESOLVE", 0, V, {}, TC::ANY, 0, OP_NONE));
+    set(Op::DSL_LAMBDA_CREATE, signature("DSL_LAMBDA_CREATE", 0, V, {}, TC::ANY, 0, OP_NONE));
+    set(Op::DSL_LAMBDA_APPLY, signature("DSL_LAMBDA_APPLY", 0, V, {}, TC::ANY, 0, OP_NONE));
+    // Learning: [parameter (a constant), delta]
+    set(Op::LEARN_UPDATE_PARAM, signature("LEARN_UPDATE_PARAM", 2, 2, {TC::NUMERIC, TC::FIRST_OPERAND}, TC::FIRST_OPERAND, 0,
+                                          OP_WRITES_PAYLOAD | OP_PAYLOAD_OPERANDS));
+    set(Op::FEEDBACK_CALC_ERROR, signature("FEEDBACK_CALC_ERROR", 0, V, {}, TC::ANY, 0, OP_NONE));
+    set(Op::RECUR_PROPAGATE_STATE, signature("RECUR_PROPAGATE_STATE", 0, V, {}, TC::ANY, 0, OP_NONE));
+    // Kernels (operand conventions in VectorKernels.hpp); every operand is wired
+    set(Op::VEC_ADD, signature("VEC_ADD", 4, 4, {TC::ADDRESS, TC::ADDRESS, TC::ADDRESS, TC::INTEGER}, TC::ANY, 0, KERNEL_OP));
+    set(Op::VEC_MUL, signature("VEC_MUL", 4, 4, {TC::ADDRESS, TC::ADDRESS, TC::ADDRESS, TC::INTEGER}, TC::ANY, 0, KERNEL_OP));
+    set(Op::VEC_LOAD_PACKED, signature("VEC_LOAD_PACKED", 3, 4, {TC::ADDRESS, TC::ADDRESS, TC::INTEGER, TC::INTEGER}, TC::ANY, 0, KERNEL_OP));
+    set(Op::VEC_STORE_PACKED, signature("VEC_STORE_PACKED", 3, 4, {TC::ADDRESS, TC::ADDRESS, TC::INTEGER, TC::INTEGER}, TC::ANY, 0, KERNEL_OP));
+    set(Op::VEC_SHUFFLE, signature("VEC_SHUFFLE", 5, 5, {TC::ADDRESS, TC::ADDRESS, TC::ADDRESS, TC::INTEGER, TC::INTEGER}, TC::ANY, 0,
+                                   KERNEL_OP));
+    set(Op::GRAPH_TRAVERSE, signature("GRAPH_TRAVERSE", 0, V, {}, TC::ANY, 0, OP_NONE));
+    set(Op::LINALG_MATMUL, signature("LINALG_MATMUL", 6, 6, {TC::ADDRESS, TC::ADDRESS, TC::ADDRESS, TC::INTEGER, TC::INTEGER, TC::INTEGER},
+                                     TC::ANY, 0, KERNEL_OP));
+    set(Op::SIGNAL_FFT, signature("SIGNAL_FFT", 2, 3, {TC::ADDRESS, TC::INTEGER, TC::INTEGER}, TC::ANY, 0, KERNEL_OP));
+    return t;
+ }
+ } // namespace detail
+ // Indexed by BDIOperationType
+ inline constexpr std::array<OperationSignature, detail::OPERATION_COUNT> OPERATION_SIGNATURES = detail::buildOperationSignatures();
+ inline constexpr bool hasCompleteSignatureTable() {
+    for (const OperationSignature& s : OPERATION_SIGNATURES) {
+        if (s.name == nullptr || s.min_inputs > s.max_inputs) return false;
+    }
+    return true;
+ }
+ static_assert(hasCompleteSignatureTable(), "every BDIOperationType needs a signature");
+ // Signature of operations out of range: unconstrained, named "UNKNOWN"
+ inline constexpr OperationSignature UNKNOWN_SIGNATURE = {"UNKNOWN", 0, VARIADIC_INPUTS, {}, TypeClass::ANY, 0, OP_NONE};
+ inline constexpr bool isKnownOperation(BDIOperationType op) {
+    return op < BDIOperationType::OPERATION_TYPE_COUNT;
+ }
+ inline constexpr const OperationSignature& getOperationSignature(BDIOperationType op) {
+    return op < BDIOperationType::OPERATION_TYPE_COUNT ? OPERATION_SIGNATURES[static_cast<size_t>(op)] : UNKNOWN_SIGNATURE;
+ }
+ // Enumerator name, e.g. "ARITH_ADD" (for traces and diagnostics)
+ inline constexpr const char* getOperationName(BDIOperationType op) {
+    return getOperationSignature(op).name;
+ }
+ // Operations whose payload only names an element type; the payload may carry no bytes
+ inline constexpr bool takesElementTypePayload(BDIOperationType op) {
+    return getOperationSignature(op).has(OP_ELEMENT_TYPE_PAYLOAD);
+ }
+ // --- Type Classes --
+ inline constexpr bool isIntegerType(BDIType type) {
+    switch (type) {
+        case BDIType::INT8: case BDIType::UINT8: case BDIType::INT16: case BDIType::UINT16:
+        case BDIType::INT32: case BDIType::UINT32: case BDIType::INT64: case BDIType::UINT64:
+            return true;
+        default:
+            return false;
+    }
+ }
+ inline constexpr bool isFloatType(BDIType type) {
+    return type == BDIType::FLOAT32 || type == BDIType::FLOAT64;
+ }
+ // Whether a value of 'type' meets 'type_class'. 'first_operand' is the type of operand 0 (for
+ // FIRST_OPERAND). UNKNOWN types pass: they are only known when the graph runs.
+ inline constexpr bool satisfiesTypeClass(TypeClass type_class, BDIType type, BDIType first_operand = BDIType::UNKNOWN) {
+    if (type == BDIType::UNKNOWN) return true;
+    switch (type_class) {
+        case TypeClass::NONE: return false;
+        case TypeClass::ANY: return true;
+        case TypeClass::SCALAR: return type == BDIType::BOOL || isIntegerType(type) || isFloatType(type);
+        case TypeClass::NUMERIC: return isIntegerType(type) || isFloatType(type);
+        case TypeClass::INTEGER: return isIntegerType(type);
+        case TypeClass::FLOAT: return isFloatType(type);
+        case TypeClass::BOOL: return type == BDIType::BOOL;
+        case TypeClass::POINTER: return type == BDIType::POINTER;
+        case TypeClass::ADDRESS: return type == BDIType::POINTER || isIntegerType(type);
+        case TypeClass::FIRST_OPERAND:
+            return first_operand == BDIType::UNKNOWN || TypeSystem::canImplicitlyConvert(type, first_operand);
+        case TypeClass::PAYLOAD: return true;
+    }
+    return false;
+ }
+ // Type the operation's result has before it is stored: UNKNOWN where that depends on the declared output
+ inline constexpr BDIType getComputedResultType(const OperationSignature& signature, BDIType first_operand, BDIType payload) {
+    switch (signature.result) {
+        case TypeClass::BOOL: return BDIType::BOOL;
+        case TypeClass::POINTER: return BDIType::POINTER;
+        case TypeClass::FIRST_OPERAND: return first_operand;
+        case TypeClass::PAYLOAD: return payload;
+        default: return BDIType::UNKNOWN;
+    }
+ }
+ // Whether output 0 may be declared as 'declared' ('first_operand' / 'payload': UNKNOWN if unknown)
+ inline constexpr bool acceptsResultType(const OperationSignature& signature, BDIType declared, BDIType first_operand,
+                                         BDIType payload) {
+    if (declared == BDIType::UNKNOWN) return !signature.has(OP_EXPLICIT_RESULT);
+    if (signature.result == TypeClass::NONE) return true; // Nothing is written to the port
+    const BDIType computed = getComputedResultType(signature, first_operand, payload);
+    if (computed != BDIType::UNKNOWN) return TypeSystem::canImplicitlyConvert(computed, declared);
+    if (signature.result == TypeClass::FIRST_OPERAND || signature.result == TypeClass::PAYLOAD) return true;
+    return satisfiesTypeClass(signature.result, declared);
+ }
+ // Type a consumer sees on output 0 of a producer: the declared type, else what the operation computes
+ inline constexpr BDIType getProducedType(BDIOperationType op, BDIType declared, BDIType payload) {
+    if (declared != BDIType::UNKNOWN) return declared;
+    return getComputedResultType(getOperationSignature(op), BDIType::UNKNOWN, payload);
+ }
+ // --- Node Checks --
+ // Why a node failed validation
+ enum class ValidationError : uint8_t {
+    DANGLING_EDGE,       // Edge to a node that is not in the graph
+    MISSING_OUTPUT_PORT, // Input wired to an output port its source does not have
+    TOO_MANY_INPUTS,
+    MISSING_OPERAND,     // Required operand neither wired nor taken from the payload
+    OPERAND_TYPE,
+    RESULT_TYPE,         // Declared type of output 0 cannot hold the result
+    MISSING_SUCCESSOR,
+    PAYLOAD_SIZE,        // Payload bytes do not match the payload type
+    DATA_CYCLE,          // On (or between) cycles of data edges
+    TOO_MANY_NODES
+ };
+ // Arity, operand, result, successor and payload checks of one node against its signature, shared by
+ // BDINode::validatePorts and CompiledGraph::validate. 'input_type(k)' gives the type arriving at wired
+ // input k (UNKNOWN if not known), or std::nullopt if input k is not wired. 'report(port, error)' is called
+ // per problem and returns whether to keep checking; returns false once it asked to stop.
+ template <typename InputType, typename Report>
+ bool checkOperation(BDIOperationType op, size_t input_count, InputType&& input_type, BDIType payload_type,
+                     size_t payload_size, size_t successor_count, BDIType declared_result, Report&& report) {
+    const OperationSignature& signature = getOperationSignature(op);
+    if (signature.max_inputs != VARIADIC_INPUTS && input_count > signature.max_inputs &&
+        !report(signature.max_inputs, ValidationError::TOO_MANY_INPUTS)) {
+        return false;
+    }
+    // Operands that are not wired read the payload immediate
+    const bool payload_operands = signature.has(OP_PAYLOAD_OPERANDS) && payload_type != BDIType::UNKNOWN;
+    BDIType first_operand = BDIType::UNKNOWN;
+    const size_t operand_count = std::max<size_t>(input_count, signature.min_inputs);
+    for (size_t k = 0; k < operand_count; ++k) {
+        std::optional<BDIType> type = k < input_count ? input_type(k) : std::nullopt;
+        if (!type && payload_operands) type = payload_type;
+        if (!type) {
+            if (k < signature.min_inputs && !report(k, ValidationError::MISSING_OPERAND)) return false;
+            continue;
+        }
+        if (k == 0) first_operand = *type;
+        if (!satisfiesTypeClass(signature.operand(k), *type, first_operand) && !report(k, ValidationError::OPERAND_TYPE)) {
+            return false;
+        }
+    }
+    if (successor_count < signature.min_successors && !report(0, ValidationError::MISSING_SUCCESSOR)) return false;
+    bool result_ok = acceptsResultType(signature, declared_result, first_operand, payload_type);
+    if (signature.has(OP_SAME_SIZE_RESULT) && first_operand != BDIType::UNKNOWN && declared_result != BDIType::UNKNOWN) {
+        result_ok = result_ok && getBdiTypeSize(first_operand) == getBdiTypeSize(declared_result);
+    }
+    if (!result_ok && !report(0, ValidationError::RESULT_TYPE)) return false;
+    // Payload size must match its declared type (or be empty where the type alone is meaningful)
+    const size_t expected = getBdiTypeSize(payload_type);
+    if (expected != 0 && payload_size != expected && !(payload_size == 0 && signature.has(OP_ELEMENT_TYPE_PAYLOAD)) &&
+        !report(0, ValidationError::PAYLOAD_SIZE)) {
+        return false;
+    }
+    return true;
+ }
+ // Type operand 'k' should have, given the declared type of output 0; UNKNOWN where a whole class is accepted
+ inline constexpr BDIType getExpectedOperandType(BDIOperationType op, size_t k, BDIType declared_result) {
+    const OperationSignature& signature = getOperationSignature(op);
+    const TypeClass operand = signature.operand(k);
+    if (operand == TypeClass::BOOL) return BDIType::BOOL;
+    if (operand == TypeClass::POINTER) return BDIType::POINTER;
+    // Operations computed in operand 0's type store their result in it
+    const bool in_result_type = operand == TypeClass::FIRST_OPERAND || (k == 0 && operand != TypeClass::ANY);
+    if (signature.result == TypeClass::FIRST_OPERAND && in_result_type && k < signature.max_inputs &&
+        satisfiesTypeClass(signature.operand(0), declared_result)) {
+        return declared_result;
+    }
+    return BDIType::UNKNOWN;
+ }
+ } // namespace bdi::core::graph
+ #endif // BDI_CORE_GRAPH_OPERATIONSIGNATURES_HPP
@@ -0,0 +1,317 @@
+// File: bdi/runtime/ParallelExecutor.cpp
+ #include "ParallelExecutor.hpp"
+ #include "BDIVirtualMachine.hpp"
+ #include "IoPrint.hpp"
+ #include "OperationSemantics.hpp"
+ #include "kernels/VectorKernels.hpp"
+ #include "memory/MemoryManager.hpp"
+ namespace bdi::runtime {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::INVALID_NODE_INDEX;
+ using bdi::core::graph::INVALID_SLOT_INDEX;
+ using bdi::core::graph::SlotIndex;
+ namespace {
+ // Control successors that execution actually follows from 'node' (mirrors determineNextNode)
+ template <typename Fn>
+ void forEachFollowedSuccessor(const CompiledGraph& g, NodeIndex node, Fn&& fn) {
+    auto successors = g.controlSuccessors(node);
+    switch (g.operation(node)) {
+        case BDIOperationType::META_END:
+        case BDIOperationType::CTRL_RETURN:
+            return;
+        case BDIOperationType::CONCURRENCY_SPAWN:
+            for (NodeIndex s : successors) if (s != INVALID_NODE_INDEX) fn(s);
+            return;
+        default:
+            if (!successors.empty() && successors[0] != INVALID_NODE_INDEX) fn(successors[0]);
+            return;
+    }
+ }
+ // Operations executeNode() implements (see the class comment)
+ bool isParallelOperation(BDIOperationType op) {
+    switch (op) {
+        case BDIOperationType::META_START:
+        case BDIOperationType::META_COMMENT:
+        case BDIOperationType::META_NOP:
+        case BDIOperationType::META_END:
+        case BDIOperationType::META_ASSERT:
+        case BDIOperationType::CTRL_JUMP:
+        case BDIOperationType::CTRL_RETURN:
+        case BDIOperationType::CONCURRENCY_SPAWN:
+        case BDIOperationType::CONCURRENCY_JOIN:
+        case BDIOperationType::IO_PRINT:
+            return true;
+        default:
+            return kernels::isKernelOperation(op) || isScalarOperation(op);
+    }
+ }
+ // Floating nodes BDIVirtualMachine evaluates on demand: constants and scalar operations
+ bool isFloatingOperation(BDIOperationType op) {
+    return op == BDIOperationType::META_NOP || isScalarOperation(op);
+ }
+ } // namespace
+ ParallelExecutor::ParallelExecutor(WorkStealingPool& pool) : pool_(pool), serial_(std::make_unique<BDIVirtualMachine>()) {}
+ ParallelExecutor::~ParallelExecutor() = default;
+ bool ParallelExecutor::execute(const CompiledGraph& graph, NodeID entry_node_id) {
+    graph_ = &graph;
+    return_value_.reset();
+    ran_serially_ = false;
+    auto entry = graph.indexOf(entry_node_id);
+    if (!entry) return false;
+    if (!prepare(*entry)) {
+        ran_serially_ = true;
+        const bool ok = serial_->execute(graph, entry_node_id);
+        return_value_ = serial_->getReturnValue();
+        return ok;
+    }
+    value_slots_.assign(graph.getSlotCount(), RuntimeValue{});
+    // Floating constants hold their payload for the whole run (as in BDIVirtualMachine)
+    for (NodeIndex i = 0; i < graph.getNodeCount(); ++i) {
+        if (graph.isFloating(i) && graph.operation(i) == BDIOperationType::META_NOP && graph.outputCount(i) &&
+            (graph.flags(i) & CompiledGraph::FLAG_HAS_PAYLOAD)) {
+            value_slots_[graph.outputSlotBase(i)] = RuntimeValue::fromBytes(graph.payloadType(i), graph.payloadBytes(i));
+        }
+    }
+    failed_.store(false);
+    completed_.store(0);
+    // Collect roots before submitting any: running tasks already decrement counts
+    std::vector<NodeIndex> roots;
+    for (NodeIndex i = 0; i < graph.getNodeCount(); ++i) {
+        if (in_set_[i] && readiness_[i].load(std::memory_order_relaxed) == 0) roots.push_back(i);
+    }
+ #if BDI_TRACING
+    tracing_ = tracer_ && tracer_->isEnabled();
+    trace::ThreadTrace* trace = tracing_ ? &tracer_->threadTrace() : nullptr;
+    if (trace) trace->bindGraph(graph);
+    const uint64_t trace_begin = trace ? trace::readCycleCounter() : 0;
+ #endif
+    // Wait for this run's tasks only: the pool may be shared with other executors
+    outstanding_.store(roots.size(), std::memory_order_relaxed);
+    for (NodeIndex root : roots) pool_.submit({&ParallelExecutor::runTask, this, root});
+    {
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        done_cv_.wait(lock, [this] { return outstanding_.load(std::memory_order_acquire) == 0; });
+    }
+ #if BDI_TRACING
+    if (trace) trace->recordRun(*entry, trace_begin, trace::readCycleCounter());
+ #endif
+    const bool ok = !failed_.load() && completed_.load() == task_count_;
+    if (verify_against_serial_ && !matchesSerial(entry_node_id, ok)) return false;
+    return ok;
+ }
+ std::optional<RuntimeValue> ParallelExecutor::getOutputValue(NodeID node_id, PortIndex port_idx) const {
+    if (!graph_) return std::nullopt;
+    if (ran_serially_) return serial_->getOutputValue(node_id, port_idx);
+    auto idx = graph_->indexOf(node_id);
+    if (!idx || port_idx >= graph_->outputCount(*idx)) return std::nullopt;
+    const RuntimeValue& value = value_slots_[graph_->outputSlotBase(*idx) + port_idx];
+    if (!value.isSet()) return std::nullopt;
+    return value;
+ }
+ bool ParallelExecutor::prepare(NodeIndex entry) {
+    const CompiledGraph& g = *graph_;
+    const size_t n = g.getNodeCount();
+    in_set_.assign(n, 0);
+    readiness_ = std::make_unique<std::atomic<uint32_t>[]>(n);
+    task_count_ = 0;
+    // 1. Control-reachable nodes
+    std::vector<NodeIndex> work{entry};
+    in_set_[entry] = 1;
+    size_t end_nodes = 0;
+    while (!work.empty()) {
+        NodeIndex node = work.back();
+        work.pop_back();
+        ++task_count_;
+        if (!isParallelOperation(g.operation(node))) return false; // Including data-dependent control flow
+        switch (g.operation(node)) {
+            case BDIOperationType::META_END:
+            case BDIOperationType::CTRL_RETURN:
+                if (++end_nodes > 1) return false; // Which return value wins would depend on the schedule
+                break;
+            default:
+                break;
+        }
+        forEachFollowedSuccessor(g, node, [&](NodeIndex s) {
+            if (!in_set_[s]) { in_set_[s] = 1; work.push_back(s); }
+        });
+    }
+    // 2. Floating producers demanded by the task set (transitively)
+    for (NodeIndex i = 0; i < n; ++i) {
+        if (in_set_[i]) work.push_back(i);
+    }
+    while (!work.empty()) {
+        NodeIndex node = work.back();
+        work.pop_back();
+        for (NodeIndex src : g.inputNodes(node)) {
+            if (src == INVALID_NODE_INDEX || in_set_[src]) continue;
+            if (!g.isFloating(src) || !isFloatingOperation(g.operation(src))) return false; // The VM would not run it either
+            in_set_[src] = 1;
+            ++task_count_;
+            work.push_back(src);
+        }
+    }
+    // 3. Readiness counts: in-set data input edges + followed control edges
+    for (NodeIndex i = 0; i < n; ++i) readiness_[i].store(0, std::memory_order_relaxed);
+    for (NodeIndex i = 0; i < n; ++i) {
+        if (!in_set_[i]) continue;
+        uint32_t deps = 0;
+        for (NodeIndex src : g.inputNodes(i)) deps += src != INVALID_NODE_INDEX ? 1 : 0;
+        readiness_[i].fetch_add(deps, std::memory_order_relaxed);
+        forEachFollowedSuccessor(g, i, [&](NodeIndex s) { readiness_[s].fetch_add(1, std::memory_order_relaxed); });
+    }
+    return isAcyclic(); // A loop in the control path never becomes ready
+ }
+ bool ParallelExecutor::isAcyclic() const {
+    const CompiledGraph& g = *graph_;
+    const size_t n = g.getNodeCount();
+    std::vector<uint32_t> remaining(n);
+    std::vector<NodeIndex> ready;
+    for (NodeIndex i = 0; i < n; ++i) {
+        remaining[i] = readiness_[i].load(std::memory_order_relaxed);
+        if (in_set_[i] && remaining[i] == 0) ready.push_back(i);
+    }
+    size_t reached = 0;
+    auto decrement = [&](NodeIndex s) {
+        if (in_set_[s] && --remaining[s] == 0) ready.push_back(s);
+    };
+    while (!ready.empty()) {
+        const NodeIndex node = ready.back();
+        ready.pop_back();
+        ++reached;
+        for (NodeIndex consumer : g.dataConsumers(node)) decrement(consumer);
+        forEachFollowedSuccessor(g, node, decrement);
+    }
+    return reached == task_count_;
+ }
+ void ParallelExecutor::runTask(void* self, uint32_t node) {
+    auto* executor = static_cast<ParallelExecutor*>(self);
+ #if BDI_TRACING
+    trace::ThreadTrace* trace = executor->tracing_ ? &executor->tracer_->threadTrace() : nullptr;
+    if (trace) trace->bindGraph(*executor->graph_);
+ #endif
+    // Keep running one released successor on this worker; chains never touch the deques
+    for (NodeIndex current = node; current != INVALID_NODE_INDEX;) {
+        if (executor->failed_.load(std::memory_order_relaxed)) break;
+ #if BDI_TRACING
+        const uint64_t trace_begin = trace ? trace->enterNode(current) : 0;
+ #endif
+        if (!executor->executeNode(current)) {
+            executor->failed_.store(true, std::memory_order_relaxed);
+            break;
+        }
+ #if BDI_TRACING
+        if (trace) trace->leaveNode(current, trace_begin);
+ #endif
+        executor->completed_.fetch_add(1, std::memory_order_relaxed);
+        current = executor->release(current);
+    }
+    executor->finishTask();
+ }
+ void ParallelExecutor::finishTask() {
+    // Only a running task submits more, so the last one out sees a count of 1 that nobody raises. It
+    // drops it to zero under the lock: execute() cannot return (and the executor go away) before
+    // the notify is done.
+    size_t count = outstanding_.load(std::memory_order_relaxed);
+    while (count > 1) {
+        if (outstanding_.compare_exchange_weak(count, count - 1, std::memory_order_release, std::memory_order_relaxed)) return;
+    }
+    std::lock_guard<std::mutex> lock(done_mutex_);
+    outstanding_.store(0, std::memory_order_release);
+    done_cv_.notify_all();
+ }
+ NodeIndex ParallelExecutor::release(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    NodeIndex inline_next = INVALID_NODE_INDEX;
+    // acq_rel: the consumer that takes the count to zero sees every producer's slot writes
+    auto decrement = [&](NodeIndex s) {
+        if (!in_set_[s] || readiness_[s].fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        if (inline_next == INVALID_NODE_INDEX) {
+            inline_next = s;
+            return;
+        }
+        outstanding_.fetch_add(1, std::memory_order_relaxed); // Before the submitting task finishes
+        pool_.submit({&ParallelExecutor::runTask, this, s});
+    };
+    for (NodeIndex consumer : g.dataConsumers(node)) decrement(consumer);
+    forEachFollowedSuccessor(g, node, decrement);
+    return inline_next;
+ }
+ bool ParallelExecutor::executeNode(NodeIndex node) {
+    const CompiledGraph& g = *graph_;
+    const BDIOperationType op = g.operation(node);
+    auto slots = g.inputSlots(node);
+    RuntimeValue operands[kernels::MAX_KERNEL_OPERANDS];
+    auto gather = [&](size_t count) {
+        for (size_t k = 0; k < count; ++k) {
+            operands[k] = k < slots.size() && slots[k] != INVALID_SLOT_INDEX
+                              ? value_slots_[slots[k]]
+                              : RuntimeValue::fromBytes(g.payloadType(node), g.payloadBytes(node));
+            if (!operands[k].isSet()) return false;
+        }
+        return true;
+    };
+    const SlotIndex out_slot = g.outputCount(node) ? g.outputSlotBase(node) : INVALID_SLOT_INDEX;
+    switch (op) {
+        case BDIOperationType::META_START:
+        case BDIOperationType::META_COMMENT:
+        case BDIOperationType::CTRL_JUMP:
+        case BDIOperationType::CONCURRENCY_SPAWN:
+        case BDIOperationType::CONCURRENCY_JOIN:
+            return true;
+        case BDIOperationType::META_NOP:
+            if (out_slot != INVALID_SLOT_INDEX && (g.flags(node) & CompiledGraph::FLAG_HAS_PAYLOAD)) {
+                value_slots_[out_slot] = RuntimeValue::fromBytes(g.payloadType(node), g.payloadBytes(node));
+            }
+            return true;
+        case BDIOperationType::META_END:
+        case BDIOperationType::CTRL_RETURN:
+            if (!slots.empty()) {
+                if (!gather(1)) return false;
+                return_value_ = operands[0]; // At most one END per run (see prepare)
+            }
+            return true;
+        case BDIOperationType::META_ASSERT:
+            return gather(1) && isTruthy(operands[0]);
+        case BDIOperationType::IO_PRINT:
+            if (!gather(1)) return false;
+            printValue(g.nodeIdAt(node), operands[0]); // Whole lines: workers print concurrently
+            return true;
+        default:
+            break;
+    }
+    if (kernels::isKernelOperation(op)) {
+        // Same contract as BDIVirtualMachine::executeKernelNode; kernels are control-sequenced, so
+        // buffers are never touched by two workers at once. No hints: best ISA, probed alignment.
+        const kernels::KernelOperandCount arity = kernels::getKernelOperandCount(op);
+        if (slots.size() < arity.required || slots.size() > arity.max) return false;
+        for (SlotIndex slot : slots) {
+            if (slot == INVALID_SLOT_INDEX) return false;
+        }
+        if (!gather(slots.size())) return false;
+        const kernels::KernelBufferCheck buffers{&memory::MemoryManager::checkKernelBuffer, serial_->getMemoryManager()};
+        if (!kernels::executeKernelOperation(op, g.payloadType(node), {operands, slots.size()}, buffers)) return false;
+        if (out_slot != INVALID_SLOT_INDEX) value_slots_[out_slot] = operands[0];
+        return true;
+    }
+    if (!isScalarOperation(op)) return false;
+    RuntimeValue result;
+    if (!gather(getScalarOperationArity(op))) return false;
+    BDIType result_type = out_slot != INVALID_SLOT_INDEX ? g.slotType(out_slot) : BDIType::UNKNOWN;
+    if (!evaluateScalar(op, result_type, operands, result)) return false;
+    if (out_slot != INVALID_SLOT_INDEX) value_slots_[out_slot] = result;
+    return true;
+ }
+ bool ParallelExecutor::matchesSerial(NodeID entry_node_id, bool ok) const {
+    BDIVirtualMachine serial;
+    bool serial_ok = serial.execute(*graph_, entry_node_id);
+    if (serial_ok != ok) return false;
+    if (!ok) return true; // Partial state after a failure is schedule dependent
+    if (serial.getReturnValue() != return_value_) return false;
+    for (NodeIndex i = 0; i < graph_->getNodeCount(); ++i) {
+        for (PortIndex p = 0; p < graph_->outputCount(i); ++p) {
+            if (serial.getOutputValue(graph_->nodeIdAt(i), p) != getOutputValue(graph_->nodeIdAt(i), p)) return false;
+        }
+    }
+    return true;
+ }
+ } // namespace bdi::runtime
@@ -0,0 +1,85 @@
+// File: bdi/runtime/ParallelExecutor.hpp
+ #ifndef BDI_RUNTIME_PARALLELEXECUTOR_HPP
+ #define BDI_RUNTIME_PARALLELEXECUTOR_HPP
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "RuntimeValue.hpp"
+ #include "WorkStealingPool.hpp"
+ #include "trace/ExecutionTracer.hpp"
+ #include <atomic>
+ #include <condition_variable>
+ #include <cstdint>
+ #include <memory>
+ #include <mutex>
+ #include <optional>
+ #include <vector>
+ namespace bdi::runtime {
+ class BDIVirtualMachine;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ // Dataflow execution of a CompiledGraph on a WorkStealingPool.
+ // Every node reachable from the entry (through control edges, including all CONCURRENCY_SPAWN targets)
+ // plus the floating producers they demand becomes one task. A task's readiness count is its number of
+ // in-set data input edges plus in-set control predecessors; it is submitted as soon as the count
+ // drops to zero. CONCURRENCY_SPAWN releases all of its successors at once and CONCURRENCY_JOIN waits for
+ // all of its control predecessors, so spawned subgraphs run concurrently.
+ // Tasks may be META_START / META_COMMENT / META_NOP / META_END / META_ASSERT, CTRL_JUMP / CTRL_RETURN,
+ // CONCURRENCY_SPAWN / CONCURRENCY_JOIN, IO_PRINT, kernel operations (VectorKernels.hpp) and the scalar
+ // operations of evaluateScalar, and the task set must be acyclic with at most one META_END / CTRL_RETURN.
+ // Floating producers must be constants or scalar operations, the ones BDIVirtualMachine evaluates.
+ // execute() waits for its own tasks only, so several executors can share one pool.
+ // Any other graph (branches, loops, calls, MEM_*, LEARN_*, COMM_CHANNEL_*, SYNC_*, META_VERIFY_PROOF, ...)
+ // runs on a serial BDIVirtualMachine instead, configured through getSerialMachine(). Kernel buffers are
+ // checked against that machine's MemoryManager, as on the VM.
+ class ParallelExecutor {
+ public:
+    explicit ParallelExecutor(WorkStealingPool& pool);
+    ~ParallelExecutor();
+    bool execute(const CompiledGraph& graph, NodeID entry_node_id);
+    // The VM that runs graphs outside the supported set (memory manager, channels, proof verifier, ...)
+    BDIVirtualMachine& getSerialMachine() { return *serial_; }
+    // The last execute() fell back to getSerialMachine()
+    bool ranSerially() const { return ran_serially_; }
+    // --- State Inspection (same contract as BDIVirtualMachine) --
+    std::optional<RuntimeValue> getOutputValue(NodeID node_id, PortIndex port_idx) const;
+    std::optional<RuntimeValue> getReturnValue() const { return return_value_; }
+    // Re-run on the serial BDIVirtualMachine after each execute() and fail on any difference in
+    // success, return value or output values. For testing schedules, not for production runs.
+    void setVerifyAgainstSerial(bool verify) { verify_against_serial_ = verify; }
+    size_t getLastTaskCount() const { return task_count_; }
+    // Count and sample every task on 'tracer' (nullptr stops); each worker records into its own
+    // ThreadTrace. Ignored when built with BDI_TRACING=0.
+    void setTracer(trace::ExecutionTracer* tracer) { tracer_ = tracer; }
+ private:
+    WorkStealingPool& pool_;
+    const CompiledGraph* graph_ = nullptr;
+    std::vector<RuntimeValue> value_slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> readiness_; // Remaining dependencies per NodeIndex
+    std::vector<uint8_t> in_set_;                        // Node is a task of the current run
+    std::optional<RuntimeValue> return_value_;
+    std::atomic<bool> failed_{false};
+    std::atomic<size_t> completed_{0};
+    size_t task_count_ = 0;
+    std::atomic<size_t> outstanding_{0}; // Submitted runTask calls of this run not yet finished
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool verify_against_serial_ = false;
+    std::unique_ptr<BDIVirtualMachine> serial_;
+    bool ran_serially_ = false;
+    trace::ExecutionTracer* tracer_ = nullptr;
+    bool tracing_ = false; // tracer_ is enabled for the current run
+    // Select tasks and compute readiness counts; false if the graph is outside the supported set
+    bool prepare(NodeIndex entry);
+    // Kahn's algorithm over the readiness counts: every task would become ready
+    bool isAcyclic() const;
+    static void runTask(void* self, uint32_t node);
+    // Called once at the end of every runTask; wakes execute() when the run's last task ends
+    void finishTask();
+    bool executeNode(NodeIndex node);
+    // Decrement successors' readiness; returns one newly ready node to run inline (or INVALID_NODE_INDEX)
+    NodeIndex release(NodeIndex node);
+    bool matchesSerial(NodeID entry_node_id, bool ok) const;
+ };
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_PARALLELEXECUTOR_HPP
@@ -0,0 +1,152 @@
+// File: bdi/tests/ParallelTests.cpp
+ // ParallelExecutor against the serial VM: random DAGs compared slot by slot, the serial fallback for
+ // graphs outside the parallel operation set, and runs on a pool busy with other work
+ #include "TestSupport.hpp"
+ #include "../benchmarks/GraphGenerators.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/ParallelExecutor.hpp"
+ #include <atomic>
+ #include <chrono>
+ #include <thread>
+ using namespace bdi::tests;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::ParallelExecutor;
+ using bdi::runtime::WorkStealingPool;
+ namespace {
+ // Same success, return value and value on every output port
+ bool matches(const CompiledGraph& graph, const BDIVirtualMachine& serial, const ParallelExecutor& parallel) {
+    if (serial.getReturnValue() != parallel.getReturnValue()) return false;
+    for (NodeIndex i = 0; i < graph.getNodeCount(); ++i) {
+        const NodeID id = graph.nodeIdAt(i);
+        for (PortIndex port = 0; port < graph.outputCount(i); ++port) {
+            if (serial.getOutputValue(id, port) != parallel.getOutputValue(id, port)) return false;
+        }
+    }
+    return true;
+ }
+ void testRandomDags() {
+    WorkStealingPool pool(4);
+    ParallelExecutor parallel(pool);
+    for (uint64_t seed = 1; seed <= 12; ++seed) {
+        bdi::meta::MetadataStore store;
+        bdi::benchmarks::RandomDagOptions options;
+        options.nodes = 3000;
+        options.seed = seed;
+        options.window = 8 + seed * 16;
+        options.floating_fraction = static_cast<double>(seed % 4) * 0.25;
+        options.type = seed % 3 == 0 ? BDIType::FLOAT64 : seed % 3 == 1 ? BDIType::INT64 : BDIType::INT16;
+        auto generated = bdi::benchmarks::generateRandomDag(store, options);
+        auto compiled = generated.graph->freeze();
+        BDI_CHECK(compiled != nullptr);
+        if (!compiled) continue;
+        BDIVirtualMachine serial;
+        serial.setJitThreshold(0);
+        const bool serial_ok = serial.execute(*compiled, generated.entry);
+        // Several runs: each one is a different schedule
+        for (int run = 0; run < 3; ++run) {
+            BDI_CHECK(parallel.execute(*compiled, generated.entry) == serial_ok);
+            BDI_CHECK(!parallel.ranSerially());
+            BDI_CHECK(matches(*compiled, serial, parallel));
+        }
+    }
+ }
+ // A branch (and a MEM_ALLOC without a MemoryManager) is outside the parallel set: the serial VM runs it
+ void testSerialFallback() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{3});
+    const NodeID sum = t.op(BDIOperationType::ARITH_ADD, {a, a}, BDIType::INT32, true);
+    const NodeID condition = t.op(BDIOperationType::CMP_GT, {sum, a}, BDIType::BOOL, true);
+    const NodeID branch = t.op(BDIOperationType::CTRL_BRANCH_COND, {condition}, BDIType::UNKNOWN, true);
+    const NodeID taken = t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, false);
+    const NodeID other = t.op(BDIOperationType::META_END, {a}, BDIType::UNKNOWN, false);
+    t.graph.connectControl(branch, taken);
+    t.graph.connectControl(branch, other);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    WorkStealingPool pool(2);
+    ParallelExecutor parallel(pool);
+    BDI_CHECK(parallel.execute(*compiled, start));
+    BDI_CHECK(parallel.ranSerially());
+    BDI_CHECK(parallel.getReturnValue() && parallel.getReturnValue()->as<int32_t>() == 6);
+    BDI_CHECK(parallel.getOutputValue(sum, 0) && parallel.getOutputValue(sum, 0)->as<int32_t>() == 6);
+    TestGraph m;
+    const NodeID mem_start = m.start();
+    const NodeID block = m.op(BDIOperationType::MEM_ALLOC, {m.constant(BDIType::UINT64, uint64_t{16})}, BDIType::POINTER, true);
+    m.op(BDIOperationType::META_END, {block}, BDIType::UNKNOWN, true);
+    auto memory_graph = m.graph.freeze();
+    BDI_CHECK(memory_graph && !parallel.execute(*memory_graph, mem_start) && parallel.ranSerially());
+ }
+ // A floating kernel node: the VM only evaluates floating constants and scalar operations, so it fails,
+ // and so does the executor, on the VM
+ void testFloatingKernel() {
+    using Op = BDIOperationType;
+    int32_t buffer[4] = {1, 2, 3, 4};
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID pointer = t.constant(BDIType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(buffer)));
+    const NodeID count = t.constant(BDIType::UINT64, uint64_t{4});
+    const NodeID sum = t.op(Op::VEC_ADD, {pointer, pointer, pointer, count}, BDIType::POINTER, false);
+    t.graph.getNode(sum)->get().payload = RuntimeValue::make(BDIType::INT32, int32_t{0}).toPayload();
+    t.op(Op::META_END, {sum}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BDIVirtualMachine serial;
+    BDI_CHECK(!serial.execute(*compiled, start));
+    WorkStealingPool pool(2);
+    ParallelExecutor parallel(pool);
+    BDI_CHECK(!parallel.execute(*compiled, start));
+    BDI_CHECK(parallel.ranSerially());
+    BDI_CHECK(buffer[0] == 1 && buffer[3] == 4);
+ }
+ // execute() returns once its own tasks are done, while another task still occupies the shared pool
+ void testSharedPool() {
+    struct Blocker {
+        std::atomic<bool> release{false};
+        std::atomic<bool> timed_out{false};
+        static void run(void* context, uint32_t) {
+            auto* self = static_cast<Blocker*>(context);
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!self->release.load()) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    self->timed_out.store(true);
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    };
+    bdi::meta::MetadataStore store;
+    bdi::benchmarks::RandomDagOptions options;
+    options.nodes = 2000;
+    auto generated = bdi::benchmarks::generateRandomDag(store, options);
+    auto compiled = generated.graph->freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BDIVirtualMachine serial;
+    const bool serial_ok = serial.execute(*compiled, generated.entry);
+    WorkStealingPool pool(2);
+    Blocker blocker;
+    pool.submit({&Blocker::run, &blocker, 0});
+    ParallelExecutor parallel(pool);
+    for (int run = 0; run < 3; ++run) {
+        BDI_CHECK(parallel.execute(*compiled, generated.entry) == serial_ok);
+        BDI_CHECK(!parallel.ranSerially() && matches(*compiled, serial, parallel));
+    }
+    BDI_CHECK(!blocker.timed_out.load());
+    blocker.release.store(true);
+    pool.waitIdle();
+ }
+ } // namespace
+ int main() {
+    testRandomDags();
+    testSerialFallback();
+    testFloatingKernel();
+    testSharedPool();
+    return bdi::tests::finish("ParallelTests");
+ }
@@ -0,0 +1,156 @@
+// File: bdi/runtime/distributed/PartitionCoordinator.cpp
+ #include "PartitionCoordinator.hpp"
+ #include <algorithm>
+ #include <chrono>
+ #include <cstdio>
+ #include <iostream>
+ #include <memory>
+ #include <thread>
+ #if defined(__unix__)
+ #include <sys/types.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+ #endif
+ namespace bdi::runtime::distributed {
+ int PartitionCoordinator::runWorker(const PartitionPlan& plan, uint32_t partition, const CompiledGraph& graph,
+                                     ShmSegment& segment) const {
+    // This worker's ends of its boundary channels; channel IDs index the rings from 1
+    std::vector<ShmRing> send_rings(plan.channels.size());
+    std::vector<ShmRing> recv_rings(plan.channels.size());
+    for (const BoundaryChannel& channel : plan.channels) {
+        if (channel.from == partition) send_rings[channel.id - 1] = segment.getRing(channel.id - 1);
+        if (channel.to == partition) recv_rings[channel.id - 1] = segment.getRing(channel.id - 1);
+    }
+    BDIVirtualMachine vm;
+    vm.setMaxSteps(max_steps_);
+    vm.setChannelEndpoints({
+        [&](uint64_t id, const TypedPayload& value) {
+            return id != 0 && id <= send_rings.size() && send_rings[id - 1].send(value);
+        },
+        [&](uint64_t id) -> std::optional<TypedPayload> {
+            TypedPayload value;
+            if (id == 0 || id > recv_rings.size() || !recv_rings[id - 1].recv(value)) return std::nullopt;
+            return value;
+        }});
+    if (worker_setup_) worker_setup_(vm, partition);
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = vm.execute(graph, plan.partitions[partition].entry);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    WorkerReport& report = segment.getWorkerReport(partition);
+    report.steps = vm.getStepCount();
+    report.elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    if (ok) {
+        if (const std::optional<RuntimeValue> value = vm.getReturnValue()) {
+            report.return_value = *value;
+            report.has_return_value = 1;
+        }
+        for (size_t i = 0; i < requested_.size(); ++i) {
+            const PortRef& ref = requested_[i];
+            const std::optional<uint32_t> owner = plan.getOwner(ref.node_id);
+            if (owner && *owner != partition) continue;
+            const std::optional<RuntimeValue> value = vm.getOutputValue(ref.node_id, ref.port_index);
+            if (!value) continue;
+            OutputReport& output = segment.getOutputReport(i);
+            uint32_t unclaimed = 0;
+            if (!output.claimed.compare_exchange_strong(unclaimed, 1, std::memory_order_acq_rel)) continue;
+            output.value = *value;
+            output.ready.store(1, std::memory_order_release);
+        }
+    } else {
+        segment.abort(); // Peers blocked on this worker's channels would wait forever
+    }
+    report.state.store(ok ? WorkerState::SUCCEEDED : WorkerState::FAILED, std::memory_order_release);
+    return ok ? 0 : 1;
+ }
+ bool PartitionCoordinator::execute(const PartitionPlan& plan) {
+    const size_t count = plan.partitions.size();
+    workers_.assign(count, WorkerResult{});
+    outputs_.assign(requested_.size(), std::nullopt);
+    return_value_.reset();
+ #if defined(__unix__)
+    // Compile before forking so every worker inherits its image instead of building it
+    std::vector<std::shared_ptr<const CompiledGraph>> compiled(count);
+    for (size_t p = 0; p < count; ++p) {
+        if (plan.partitions[p].entry == 0) continue;
+        compiled[p] = plan.partitions[p].graph.freeze();
+        if (!compiled[p]) return false;
+    }
+    ShmSegment segment(plan.channels.size(), ring_bytes_, count, requested_.size());
+    if (!segment.isValid()) return false;
+    // Buffered output would be flushed once more by every child
+    std::cout.flush();
+    std::fflush(nullptr);
+    std::vector<pid_t> pids(count, -1);
+    bool ok = true;
+    for (size_t p = 0; p < count; ++p) {
+        if (!compiled[p]) continue;
+        const pid_t pid = fork();
+        if (pid == 0) {
+            const int code = runWorker(plan, static_cast<uint32_t>(p), *compiled[p], segment);
+            std::cout.flush();
+            std::fflush(nullptr);
+            _exit(code); // Skip the parent's atexit handlers and static destructors
+        }
+        if (pid < 0) {
+            ok = false;
+            segment.abort();
+            break;
+        }
+        pids[p] = pid;
+        workers_[p].started = true;
+    }
+    // Poll rather than block on one child, so a worker that dies without reporting aborts the run
+    // while its peers are still waiting on it
+    size_t running = static_cast<size_t>(std::count_if(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; }));
+    auto backoff = std::chrono::microseconds(20);
+    while (running > 0) {
+        bool reaped = false;
+        for (size_t p = 0; p < count; ++p) {
+            if (pids[p] <= 0) continue;
+            int status = 0;
+            const pid_t done = waitpid(pids[p], &status, WNOHANG);
+            if (done == 0) continue;
+            pids[p] = -1;
+            --running;
+            reaped = true;
+            WorkerResult& worker = workers_[p];
+            if (done > 0 && WIFEXITED(status)) worker.exit_code = WEXITSTATUS(status);
+            else if (done > 0 && WIFSIGNALED(status)) worker.exit_code = -WTERMSIG(status);
+            const WorkerReport& report = segment.getWorkerReport(p);
+            worker.state = report.state.load(std::memory_order_acquire);
+            if (worker.state == WorkerState::SUCCEEDED && worker.exit_code == 0) continue;
+            ok = false;
+            segment.abort();
+        }
+        if (reaped) {
+            backoff = std::chrono::microseconds(20);
+        } else {
+            std::this_thread::sleep_for(backoff);
+            backoff = std::min<std::chrono::microseconds>(backoff * 2, std::chrono::milliseconds(1));
+        }
+    }
+    for (size_t p = 0; p < count; ++p) {
+        WorkerResult& worker = workers_[p];
+        if (!worker.started) continue;
+        const WorkerReport& report = segment.getWorkerReport(p);
+        worker.steps = report.steps;
+        worker.seconds = static_cast<double>(report.elapsed_ns) * 1e-9;
+        if (report.has_return_value) worker.return_value = report.return_value;
+        if (!return_value_ && worker.return_value) return_value_ = worker.return_value;
+    }
+    for (size_t i = 0; i < requested_.size(); ++i) {
+        const OutputReport& output = segment.getOutputReport(i);
+        if (output.ready.load(std::memory_order_acquire)) outputs_[i] = output.value;
+    }
+    return ok;
+ #else
+    return false; // Needs fork() and shared mappings
+ #endif
+ }
+ std::optional<RuntimeValue> PartitionCoordinator::getOutputValue(NodeID node_id, PortIndex port_idx) const {
+    for (size_t i = 0; i < requested_.size() && i < outputs_.size(); ++i) {
+        if (requested_[i].node_id == node_id && requested_[i].port_index == port_idx) return outputs_[i];
+    }
+    return std::nullopt;
+ }
+ } // namespace bdi::runtime::distributed
@@ -0,0 +1,65 @@
+// File: bdi/runtime/distributed/PartitionCoordinator.hpp
+ #ifndef BDI_RUNTIME_DISTRIBUTED_PARTITIONCOORDINATOR_HPP
+ #define BDI_RUNTIME_DISTRIBUTED_PARTITIONCOORDINATOR_HPP
+ #include "GraphPartitioner.hpp"
+ #include "ShmTransport.hpp"
+ #include "../BDIVirtualMachine.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <functional>
+ #include <optional>
+ #include <vector>
+ namespace bdi::runtime::distributed {
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::PortRef;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::RuntimeValue;
+ // How one worker process ended
+ struct WorkerResult {
+    bool started = false;   // False for a partition with nothing to run (entry 0) or a failed fork
+    WorkerState state = WorkerState::RUNNING; // RUNNING after the run: the process died before reporting
+    int exit_code = -1;     // Exit status, or -signal if it was killed
+    uint64_t steps = 0;
+    double seconds = 0.0;   // Inside the worker's VM, excluding fork and compile
+    std::optional<RuntimeValue> return_value;
+ };
+ // Runs a PartitionPlan on this machine: one forked worker process per partition, each executing its
+ // subgraph on a BDIVirtualMachine whose COMM_CHANNEL_* boundary nodes move values through shared-memory
+ // rings (ShmSegment). The coordinator waits for every worker and collects return and output values.
+ // If any worker fails or dies, the segment is aborted so the others stop waiting on their channels.
+ // Forks from the calling thread: in a process with other threads running, only async-signal-safe work
+ // is guaranteed in the child, so create pools and schedulers in the worker setup instead.
+ class PartitionCoordinator {
+ public:
+    // Values to collect in execute(), by original NodeID. Taken from the partition owning the node, or
+    // from whichever partition computed it first for replicated and floating nodes.
+    void requestOutput(NodeID node_id, PortIndex port_idx) { requested_.push_back({node_id, port_idx}); }
+    // Data bytes per boundary channel (rounded up to a power of two of at least 4 KiB). A value must
+    // fit in half of it.
+    void setRingBytes(size_t bytes) { ring_bytes_ = bytes; }
+    void setMaxSteps(uint64_t max_steps) { max_steps_ = max_steps; } // Per worker; 0 = unlimited
+    // Called in each worker process on its VM before the run (memory manager, tracer, ...). Setting a
+    // TaskScheduler there takes the boundary channels off the rings, so don't.
+    void setWorkerSetup(std::function<void(BDIVirtualMachine&, uint32_t partition)> setup) {
+        worker_setup_ = std::move(setup);
+    }
+    // True if every partition ran to completion
+    bool execute(const PartitionPlan& plan);
+    // --- Results of the last execute() --
+    std::optional<RuntimeValue> getOutputValue(NodeID node_id, PortIndex port_idx) const;
+    // From the lowest partition that returned one
+    std::optional<RuntimeValue> getReturnValue() const { return return_value_; }
+    const std::vector<WorkerResult>& getWorkerResults() const { return workers_; }
+ private:
+    size_t ring_bytes_ = size_t{64} << 10;
+    uint64_t max_steps_ = 0;
+    std::function<void(BDIVirtualMachine&, uint32_t)> worker_setup_;
+    std::vector<PortRef> requested_;
+    std::vector<std::optional<RuntimeValue>> outputs_; // Per requested_ entry
+    std::optional<RuntimeValue> return_value_;
+    std::vector<WorkerResult> workers_;
+    // Body of a worker process; returns its exit code
+    int runWorker(const PartitionPlan& plan, uint32_t partition, const CompiledGraph& graph, ShmSegment& segment) const;
+ };
+ } // namespace bdi::runtime::distributed
+ #endif // BDI_RUNTIME_DISTRIBUTED_PARTITIONCOORDINATOR_HPP
@@ -0,0 +1,103 @@
+// File: bdi/tests/PartitionTests.cpp
+ // Partitioned runs against the single-process VM: the return value and the requested outputs agree
+ #include "TestSupport.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/distributed/GraphPartitioner.hpp"
+ #include "../runtime/distributed/PartitionCoordinator.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ #include <vector>
+ using namespace bdi::tests;
+ using namespace bdi::runtime::distributed;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::memory::MemoryManager;
+ namespace {
+ bool sameValue(const std::optional<RuntimeValue>& a, const std::optional<RuntimeValue>& b) {
+    if (!a || !b) return !a && !b;
+    return a->type == b->type && a->bits == b->bits;
+ }
+ // Two regions. Region 1 computes the condition of the first branch, which region 0 receives; its taken
+ // arm enters a loop whose counter (region 1) crosses to the exit test (region 0) every iteration.
+ //   start -> x = a + 1 [0] -> y = x * 3 [1] -> branch(y > 10) [1]
+ //     true:  head -> count = rmw(counter, 1) [1] -> sum = count + y [0] -> branch(count < 4) [0]
+ //              true: head   false: end(sum)
+ //     false: end(x)
+ struct RegionGraph {
+    TestGraph t;
+    NodeID start = 0;
+    std::vector<NodeID> outputs;
+    explicit RegionGraph(uint64_t* counter) {
+        using Op = BDIOperationType;
+        start = t.start();
+        t.region = 0;
+        const NodeID a = t.constant(BDIType::INT64, int64_t{3});
+        const NodeID one = t.constant(BDIType::INT64, int64_t{1});
+        const NodeID x = t.op(Op::ARITH_ADD, {a, one}, BDIType::INT64, true);
+        t.region = 1;
+        const NodeID three = t.constant(BDIType::INT64, int64_t{3});
+        const NodeID y = t.op(Op::ARITH_MUL, {x, three}, BDIType::INT64, true);
+        const NodeID ten = t.constant(BDIType::INT64, int64_t{10});
+        const NodeID big = t.op(Op::CMP_GT, {y, ten}, BDIType::BOOL, true);
+        const NodeID branch = t.op(Op::CTRL_BRANCH_COND, {big}, BDIType::UNKNOWN, true);
+        const NodeID head = t.op(Op::CTRL_JUMP, {}, BDIType::UNKNOWN, true);
+        const NodeID address = t.constant(BDIType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(counter)));
+        const NodeID count = t.op(Op::SYNC_ATOMIC_RMW, {address, one}, BDIType::INT64, true);
+        t.region = 0;
+        const NodeID sum = t.op(Op::ARITH_ADD, {count, y}, BDIType::INT64, true);
+        const NodeID four = t.constant(BDIType::INT64, int64_t{4});
+        const NodeID more = t.op(Op::CMP_LT, {count, four}, BDIType::BOOL, true);
+        const NodeID loop = t.op(Op::CTRL_BRANCH_COND, {more}, BDIType::UNKNOWN, true);
+        t.graph.connectControl(loop, head);
+        t.op(Op::META_END, {sum}, BDIType::UNKNOWN, true);
+        t.last_control = branch;
+        t.op(Op::META_END, {x}, BDIType::UNKNOWN, true);
+        outputs = {x, y, big, count, sum, more};
+    }
+ };
+ void testAgainstVirtualMachine() {
+    MemoryManager memory;
+    auto* counter = static_cast<uint64_t*>(memory.allocate(0, sizeof(uint64_t)));
+    BDI_CHECK(counter != nullptr);
+    if (!counter) return;
+    RegionGraph g(counter);
+    *counter = 0;
+    BDIVirtualMachine vm;
+    vm.setMemoryManager(&memory);
+    BDI_CHECK(vm.execute(g.t.graph, g.start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int64_t>() == 16);
+    const PartitionOptions by_region{PartitionStrategy::BY_REGION};
+    PartitionOptions min_cut{PartitionStrategy::MIN_CUT, 2};
+    PartitionOptions min_cut_three{PartitionStrategy::MIN_CUT, 3};
+    for (const PartitionOptions& options : {by_region, min_cut, min_cut_three}) {
+        const std::optional<PartitionPlan> plan = partitionGraph(g.t.graph, g.start, options);
+        BDI_CHECK(plan.has_value());
+        if (!plan) continue;
+        BDI_CHECK(plan->partitions.size() > 1 && !plan->channels.empty());
+        PartitionCoordinator coordinator;
+        coordinator.setMaxSteps(10000);
+        coordinator.setWorkerSetup([&](BDIVirtualMachine& worker, uint32_t) { worker.setMemoryManager(&memory); });
+        for (NodeID node : g.outputs) coordinator.requestOutput(node, 0);
+        *counter = 0; // Each worker starts from a copy of this
+        BDI_CHECK(coordinator.execute(*plan));
+        BDI_CHECK(sameValue(coordinator.getReturnValue(), vm.getReturnValue()));
+        for (NodeID node : g.outputs) BDI_CHECK(sameValue(coordinator.getOutputValue(node, 0), vm.getOutputValue(node, 0)));
+    }
+ }
+ // A value read across partitions from a port its producer does not declare
+ void testMissingPort() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{1});
+    const NodeID x = t.op(BDIOperationType::ARITH_ADD, {a, a}, BDIType::INT32, true);
+    t.region = 1;
+    const NodeID y = t.op(BDIOperationType::ARITH_ADD, {a, a}, BDIType::INT32, true);
+    t.op(BDIOperationType::META_END, {y}, BDIType::UNKNOWN, true);
+    BDI_CHECK(partitionGraph(t.graph, start).has_value());
+    BDI_CHECK(t.graph.connectData(x, 1, y, 1));
+    BDI_CHECK(!partitionGraph(t.graph, start).has_value());
+ }
+ } // namespace
+ int main() {
+    testAgainstVirtualMachine();
+    testMissingPort();
+    return bdi::tests::finish("PartitionTests");
+ }
@@ -0,0 +1,61 @@
+// File: bdi/optimizer/PassManager.cpp
+ #include "PassManager.hpp"
+ #include <iomanip>
+ #include <ostream>
+ namespace bdi::optimizer {
+ void PassManager::addPass(std::string name, PassFunction pass) {
+    passes_.push_back(Pass{std::move(name), std::move(pass)});
+ }
+ void PassManager::addDefaultPasses(bool contract_floats, NodeID entry) {
+    addPass("fold-constants", foldConstants);
+    addPass("reduce-strength", reduceStrength);
+    addPass("eliminate-common-subexpressions", eliminateCommonSubexpressions);
+    addPass("fuse-multiply-add", [contract_floats](BDIGraph& graph) { return fuseMultiplyAdd(graph, contract_floats); });
+    addPass("eliminate-dead-nodes", [entry](BDIGraph& graph) { return eliminateDeadNodes(graph, entry); });
+ }
+ bool PassManager::run(BDIGraph& graph) {
+    statistics_.clear();
+    if (!graph.validateGraph()) return false;
+    for (size_t iteration = 0; iteration < max_iterations_; ++iteration) {
+        bool changed = false;
+        for (const Pass& pass : passes_) {
+            PassStatistics stats;
+            stats.name = pass.name;
+            stats.iteration = iteration;
+            stats.nodes_before = graph.getNodeCount();
+            auto start = std::chrono::steady_clock::now();
+            stats.result = pass.run(graph);
+            stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            stats.nodes_after = graph.getNodeCount();
+            changed |= stats.result.changed();
+            statistics_.push_back(std::move(stats));
+        }
+        if (!changed) break;
+    }
+    return true;
+ }
+ void PassManager::printStatistics(std::ostream& os) const {
+    size_t total_removed = 0;
+    std::chrono::nanoseconds total_time{0};
+    for (const Pass& pass : passes_) {
+        PassResult sum;
+        std::chrono::nanoseconds time{0};
+        for (const PassStatistics& stats : statistics_) {
+            if (stats.name != pass.name) continue;
+            sum.nodes_removed += stats.result.nodes_removed;
+            sum.nodes_rewritten += stats.result.nodes_rewritten;
+            sum.nodes_added += stats.result.nodes_added;
+            time += stats.elapsed;
+        }
+        os << std::left << std::setw(34) << pass.name << std::right
+           << " removed " << std::setw(6) << sum.nodes_removed
+           << "  rewritten " << std::setw(6) << sum.nodes_rewritten
+           << "  added " << std::setw(6) << sum.nodes_added
+           << "  " << std::fixed << std::setprecision(3) << time.count() / 1e6 << " ms\n";
+        total_removed += sum.nodes_removed;
+        total_time += time;
+    }
+    os << "total: " << total_removed << " nodes removed in " << std::fixed << std::setprecision(3)
+       << total_time.count() / 1e6 << " ms\n";
+ }
+ } // namespace bdi::optimizer
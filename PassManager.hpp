@@ -0,0 +1,49 @@
+// File: bdi/optimizer/PassManager.hpp
+ #ifndef BDI_OPTIMIZER_PASSMANAGER_HPP
+ #define BDI_OPTIMIZER_PASSMANAGER_HPP
+ #include "GraphPasses.hpp"
+ #include <chrono>
+ #include <cstddef>
+ #include <functional>
+ #include <iosfwd>
+ #include <string>
+ #include <vector>
+ namespace bdi::optimizer {
+ // One execution of one pass
+ struct PassStatistics {
+    std::string name;
+    size_t iteration = 0;
+    size_t nodes_before = 0;
+    size_t nodes_after = 0;
+    PassResult result;
+    std::chrono::nanoseconds elapsed{0};
+ };
+ // Runs graph passes in order and records what each one did and how long it took.
+ // The pipeline repeats while some pass still changes the graph, up to the iteration limit, since
+ // one pass can expose work for another (a folded branch leaves a jump for DCE, CSE exposes FMAs, ...).
+ class PassManager {
+ public:
+    using PassFunction = std::function<PassResult(BDIGraph&)>;
+    void addPass(std::string name, PassFunction pass);
+    // Constant folding, strength reduction, CSE, FMA fusion, then dead-node elimination.
+    // 'contract_floats' lets FMA fusion round float multiply-adds once (see fuseMultiplyAdd); 'entry'
+    // is the node runs start from, if known (see eliminateDeadNodes).
+    void addDefaultPasses(bool contract_floats = false, NodeID entry = 0);
+    void setMaxIterations(size_t max_iterations) { max_iterations_ = max_iterations; }
+    // Returns false, leaving the graph untouched, if it does not pass validateGraph()
+    bool run(BDIGraph& graph);
+    // One entry per pass execution of the last run, in order
+    const std::vector<PassStatistics>& getStatistics() const { return statistics_; }
+    // Totals of the last run per pass: removed / rewritten / added nodes and time
+    void printStatistics(std::ostream& os) const;
+ private:
+    struct Pass {
+        std::string name;
+        PassFunction run;
+    };
+    std::vector<Pass> passes_;
+    std::vector<PassStatistics> statistics_;
+    size_t max_iterations_ = 4;
+ };
+ } // namespace bdi::optimizer
+ #endif // BDI_OPTIMIZER_PASSMANAGER_HPP
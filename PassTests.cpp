@@ -0,0 +1,77 @@
+// File: bdi/tests/PassTests.cpp
+ // Graph passes: the rewritten graph runs like the original
+ #include "TestSupport.hpp"
+ #include "../optimizer/GraphPasses.hpp"
+ #include "../optimizer/PassManager.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ using namespace bdi::optimizer;
+ using bdi::runtime::BDIVirtualMachine;
+ using namespace bdi::tests;
+ namespace {
+ std::optional<int64_t> run(BDIGraph& graph, NodeID entry) {
+    BDIVirtualMachine vm;
+    if (!vm.execute(graph, entry)) return std::nullopt;
+    auto value = vm.getReturnValue();
+    if (!value) return std::nullopt;
+    return value->as<int32_t>();
+ }
+ // start -> end(a + b), plus an unreachable loop (a cycle with no entry) and an unreachable chain
+ // that has no predecessor of its own, each with a floating cone only it reads
+ void testDeadControl() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{40});
+    const NodeID b = t.constant(BDIType::INT32, int32_t{2});
+    const NodeID sum = t.op(BDIOperationType::ARITH_ADD, {a, b}, BDIType::INT32, false);
+    const NodeID end = t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, true);
+    // Loop body: head -> print(x * x) -> back to head
+    t.last_control = 0;
+    const NodeID x = t.constant(BDIType::INT32, int32_t{7});
+    const NodeID square = t.op(BDIOperationType::ARITH_MUL, {x, x}, BDIType::INT32, false);
+    const NodeID head = t.op(BDIOperationType::META_NOP, {}, BDIType::UNKNOWN, true);
+    const NodeID print = t.op(BDIOperationType::IO_PRINT, {square}, BDIType::UNKNOWN, true);
+    t.graph.connectControl(print, head);
+    // Chain: orphan -> print(y), only kept without an explicit entry
+    t.last_control = 0;
+    const NodeID y = t.constant(BDIType::INT32, int32_t{9});
+    const NodeID orphan = t.op(BDIOperationType::META_START, {}, BDIType::UNKNOWN, true);
+    const NodeID orphan_print = t.op(BDIOperationType::IO_PRINT, {y}, BDIType::UNKNOWN, true);
+    BDI_CHECK(run(t.graph, start) == 42);
+    eliminateDeadNodes(t.graph);
+    BDI_CHECK(t.graph.validateGraph());
+    for (NodeID gone : {x, square, head, print}) BDI_CHECK(!t.graph.getNode(gone));
+    for (NodeID kept : {start, a, b, sum, end, orphan, orphan_print, y}) BDI_CHECK(t.graph.getNode(kept).has_value());
+    BDI_CHECK(run(t.graph, start) == 42);
+    // Given the entry, the other root goes too
+    eliminateDeadNodes(t.graph, start);
+    BDI_CHECK(t.graph.validateGraph());
+    for (NodeID gone : {orphan, orphan_print, y}) BDI_CHECK(!t.graph.getNode(gone));
+    BDI_CHECK(t.graph.getNodeCount() == 5);
+    BDI_CHECK(run(t.graph, start) == 42);
+ }
+ // A folded branch leaves its false arm unreachable; the default pipeline removes it
+ void testFoldedBranch() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID cond = t.constant(BDIType::BOOL, true);
+    const NodeID branch = t.op(BDIOperationType::CTRL_BRANCH_COND, {cond}, BDIType::UNKNOWN, true);
+    const NodeID one = t.constant(BDIType::INT32, int32_t{1});
+    const NodeID taken = t.op(BDIOperationType::META_END, {one}, BDIType::UNKNOWN, true);
+    t.last_control = branch;
+    const NodeID two = t.constant(BDIType::INT32, int32_t{2});
+    const NodeID doubled = t.op(BDIOperationType::ARITH_ADD, {two, two}, BDIType::INT32, false);
+    const NodeID other = t.op(BDIOperationType::META_END, {doubled}, BDIType::UNKNOWN, true);
+    BDI_CHECK(run(t.graph, start) == 1);
+    PassManager passes;
+    passes.addDefaultPasses(false, start);
+    BDI_CHECK(passes.run(t.graph));
+    for (NodeID gone : {other, doubled, two}) BDI_CHECK(!t.graph.getNode(gone));
+    BDI_CHECK(t.graph.getNode(taken).has_value());
+    BDI_CHECK(run(t.graph, start) == 1);
+ }
+ } // namespace
+ int main() {
+    testDeadControl();
+    testFoldedBranch();
+    return bdi::tests::finish("PassTests");
+ }
@@ -0,0 +1,56 @@
+// File: bdi/runtime/RuntimeValue.hpp
+ #ifndef BDI_RUNTIME_RUNTIMEVALUE_HPP
+ #define BDI_RUNTIME_RUNTIMEVALUE_HPP
+ #include "../core/types/BDITypes.hpp"
+ #include "../core/payload/TypedPayload.hpp"
+ #include <cstdint>
+ #include <cstddef>
+ #include <cstring>
+ #include <span>
+ namespace bdi::runtime {
+ using bdi::core::types::BDIType;
+ using bdi::core::types::getBdiTypeSize;
+ using bdi::core::payload::TypedPayload;
+ // Scalar value held in a VM value slot.
+ // Fixed 16 bytes, trivially copyable: the raw little-endian bits of any scalar BDIType up to 8 bytes.
+ // Wider payloads (vectors, blobs) stay in TypedPayload and are referenced by the node instead.
+ struct RuntimeValue {
+    BDIType type = BDIType::UNKNOWN;
+    uint64_t bits = 0;
+    bool isSet() const { return type != BDIType::UNKNOWN; }
+    template <typename T>
+    static RuntimeValue make(BDIType t, T value) {
+        static_assert(sizeof(T) <= sizeof(uint64_t), "RuntimeValue holds at most 8 bytes");
+        RuntimeValue v;
+        v.type = t;
+        std::memcpy(&v.bits, &value, sizeof(T));
+        return v;
+    }
+    template <typename T>
+    T as() const {
+        static_assert(sizeof(T) <= sizeof(uint64_t), "RuntimeValue holds at most 8 bytes");
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+    // Build from raw payload bytes. Returns an unset value if the bytes do not fit a scalar slot.
+    static RuntimeValue fromBytes(BDIType t, std::span<const std::byte> bytes) {
+        RuntimeValue v;
+        if (t == BDIType::UNKNOWN || bytes.size() > sizeof(uint64_t)) return v;
+        v.type = t;
+        std::memcpy(&v.bits, bytes.data(), bytes.size());
+        return v;
+    }
+    static RuntimeValue fromPayload(const TypedPayload& payload) {
+        return fromBytes(payload.type, std::span<const std::byte>(payload.data.data(), payload.data.size()));
+    }
+    TypedPayload toPayload() const {
+        size_t size = getBdiTypeSize(type);
+        bdi::core::payload::PayloadBuffer data(size);
+        if (size > 0) std::memcpy(data.data(), &bits, size);
+        return TypedPayload(type, std::move(data));
+    }
+    bool operator==(const RuntimeValue&) const = default;
+ };
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_RUNTIMEVALUE_HPP
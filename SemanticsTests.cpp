@@ -0,0 +1,78 @@
+// File: bdi/tests/SemanticsTests.cpp
+ // Scalar reference semantics: integer wrap-around without promotion overflow, range-checked float
+ // to integer conversions, and the constant folder leaving failing operations in place
+ #include "TestSupport.hpp"
+ #include "../optimizer/GraphPasses.hpp"
+ #include "../runtime/OperationSemantics.hpp"
+ #include <cmath>
+ #include <limits>
+ using namespace bdi::tests;
+ using bdi::runtime::evaluateScalar;
+ namespace {
+ std::optional<RuntimeValue> eval(BDIOperationType op, BDIType result, std::initializer_list<RuntimeValue> operands) {
+    std::vector<RuntimeValue> values(operands);
+    RuntimeValue out;
+    if (!evaluateScalar(op, result, values.data(), out)) return std::nullopt;
+    return out;
+ }
+ template <typename T>
+ RuntimeValue value(BDIType type, T v) { return RuntimeValue::make(type, v); }
+ void testNarrowMultiply() {
+    auto r = eval(BDIOperationType::ARITH_MUL, BDIType::UNKNOWN, {value(BDIType::UINT16, uint16_t{65535}), value(BDIType::UINT16, uint16_t{65535})});
+    BDI_CHECK(r && r->type == BDIType::UINT16 && r->as<uint16_t>() == 1);
+    r = eval(BDIOperationType::ARITH_MUL, BDIType::UNKNOWN, {value(BDIType::INT16, int16_t{-32768}), value(BDIType::INT16, int16_t{-1})});
+    BDI_CHECK(r && r->as<int16_t>() == -32768);
+    r = eval(BDIOperationType::ARITH_MUL, BDIType::UNKNOWN, {value(BDIType::UINT8, uint8_t{200}), value(BDIType::UINT8, uint8_t{3})});
+    BDI_CHECK(r && r->as<uint8_t>() == uint8_t(600 & 0xFF));
+    r = eval(BDIOperationType::ARITH_FMA, BDIType::UNKNOWN,
+             {value(BDIType::UINT16, uint16_t{65535}), value(BDIType::UINT16, uint16_t{65535}), value(BDIType::UINT16, uint16_t{65535})});
+    BDI_CHECK(r && r->as<uint16_t>() == 0);
+    r = eval(BDIOperationType::ARITH_FMA, BDIType::UNKNOWN,
+             {value(BDIType::INT8, int8_t{-128}), value(BDIType::INT8, int8_t{-128}), value(BDIType::INT8, int8_t{1})});
+    BDI_CHECK(r && r->as<int8_t>() == 1);
+ }
+ void testFloatToInteger() {
+    const BDIOperationType ops[] = {BDIOperationType::CONV_TRUNC, BDIOperationType::CONV_FLOAT_TO_INT};
+    for (BDIOperationType op : ops) {
+        auto r = eval(op, BDIType::INT32, {value(BDIType::FLOAT64, -2147483648.9)});
+        BDI_CHECK(r && r->as<int32_t>() == std::numeric_limits<int32_t>::min());
+        BDI_CHECK(!eval(op, BDIType::INT32, {value(BDIType::FLOAT64, 2147483648.0)}));
+        BDI_CHECK(!eval(op, BDIType::INT32, {value(BDIType::FLOAT64, -2147483649.0)}));
+        r = eval(op, BDIType::UINT8, {value(BDIType::FLOAT32, 255.9f)});
+        BDI_CHECK(r && r->as<uint8_t>() == 255);
+        BDI_CHECK(!eval(op, BDIType::UINT8, {value(BDIType::FLOAT32, 256.0f)}));
+        r = eval(op, BDIType::UINT32, {value(BDIType::FLOAT64, -0.75)});
+        BDI_CHECK(r && r->as<uint32_t>() == 0);
+        BDI_CHECK(!eval(op, BDIType::UINT32, {value(BDIType::FLOAT64, -1.0)}));
+        BDI_CHECK(!eval(op, BDIType::INT64, {value(BDIType::FLOAT64, 9223372036854775808.0)}));
+        BDI_CHECK(!eval(op, BDIType::INT64, {value(BDIType::FLOAT64, std::nan(""))}));
+        r = eval(op, BDIType::BOOL, {value(BDIType::FLOAT64, 1e300)});
+        BDI_CHECK(r && r->as<uint8_t>() == 1);
+    }
+    // Float results stored to an integer output and float operands of integer operations are checked too
+    BDI_CHECK(!eval(BDIOperationType::ARITH_ADD, BDIType::INT8, {value(BDIType::FLOAT32, 100.0f), value(BDIType::FLOAT32, 100.0f)}));
+    BDI_CHECK(!eval(BDIOperationType::ARITH_ADD, BDIType::UNKNOWN, {value(BDIType::INT32, int32_t{1}), value(BDIType::FLOAT64, 1e10)}));
+    auto r = eval(BDIOperationType::ARITH_ADD, BDIType::UNKNOWN, {value(BDIType::INT32, int32_t{1}), value(BDIType::FLOAT64, 41.5)});
+    BDI_CHECK(r && r->as<int32_t>() == 42);
+ }
+ void testFolderKeepsFailures() {
+    TestGraph t;
+    t.start();
+    const NodeID big = t.constant(BDIType::FLOAT64, 1e20);
+    const NodeID conv = t.op(BDIOperationType::CONV_TRUNC, {big}, BDIType::INT32, false);
+    const NodeID a = t.constant(BDIType::UINT16, uint16_t{65535});
+    const NodeID mul = t.op(BDIOperationType::ARITH_MUL, {a, a}, BDIType::UINT16, false);
+    const NodeID sum = t.op(BDIOperationType::ARITH_ADD, {conv, mul}, BDIType::INT32, false);
+    t.op(BDIOperationType::META_END, {sum}, BDIType::UNKNOWN, true);
+    bdi::optimizer::foldConstants(t.graph);
+    BDI_CHECK(t.graph.getNode(conv)->get().operation == BDIOperationType::CONV_TRUNC);
+    const auto& folded = t.graph.getNode(mul)->get();
+    BDI_CHECK(folded.operation == BDIOperationType::META_NOP && RuntimeValue::fromPayload(folded.payload).as<uint16_t>() == 1);
+ }
+ } // namespace
+ int main() {
+    testNarrowMultiply();
+    testFloatToInteger();
+    testFolderKeepsFailures();
+    return bdi::tests::finish("SemanticsTests");
+ }
@@ -0,0 +1,198 @@
+// File: bdi/runtime/distributed/ShmTransport.cpp
+ #include "ShmTransport.hpp"
+ #include <algorithm>
+ #include <bit>
+ #include <chrono>
+ #include <climits>
+ #include <cstring>
+ #include <new>
+ #include <thread>
+ #if defined(__unix__)
+ #include <sys/mman.h>
+ #endif
+ #if defined(__linux__)
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <time.h>
+ #include <unistd.h>
+ #endif
+ #if defined(__x86_64__) || defined(__i386__)
+ #include <immintrin.h>
+ #endif
+ namespace bdi::runtime::distributed {
+ namespace {
+ // The futex syscall works on the 32-bit word behind the atomic
+ static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+ static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring positions are shared between processes");
+ static_assert(sizeof(ShmRingHeader) == 192);
+ constexpr uint32_t SPIN_ROUNDS = 64;  // Pause, re-check
+ constexpr uint32_t YIELD_ROUNDS = 64; // Then yield, re-check, before sleeping
+ constexpr long WAIT_NS = 100'000'000; // A sleeper re-checks the abort flag at least this often
+ void cpuRelax() {
+ #if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+ #endif
+ }
+ // Shared (not process-private) futexes: the word lives in a MAP_SHARED mapping
+ void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+ #if defined(__linux__)
+    timespec timeout{0, WAIT_NS};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+ #else
+    if (word.load(std::memory_order_acquire) == expected) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+ #endif
+ }
+ void futexWakeAll(std::atomic<uint32_t>& word) {
+ #if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+ #else
+    (void)word;
+ #endif
+ }
+ // The waiter announces itself before re-checking the ring, the other side checks for a waiter after
+ // moving its position; with a full fence on both sides at least one of them sees the other.
+ void wakeIfWaiting(std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& seq) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) == 0) return;
+    seq.fetch_add(1, std::memory_order_release);
+    futexWakeAll(seq);
+ }
+ // Spin, yield, then sleep until 'attempt' succeeds or 'aborted' turns true
+ template <typename Attempt, typename Aborted>
+ bool waitUntil(Attempt&& attempt, Aborted&& aborted, std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& seq) {
+    for (uint32_t round = 0;; ++round) {
+        if (attempt()) return true;
+        if (aborted()) return false;
+        if (round < SPIN_ROUNDS) {
+            cpuRelax();
+            continue;
+        }
+        if (round < SPIN_ROUNDS + YIELD_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+        waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const uint32_t expected = seq.load(std::memory_order_acquire);
+        const bool done = attempt();
+        if (!done && !aborted()) futexWait(seq, expected);
+        waiting.store(0, std::memory_order_relaxed);
+        if (done) return true;
+    }
+ }
+ uint64_t recordBytes(size_t payload_bytes) { return 8 + ((payload_bytes + 7) & ~uint64_t{7}); }
+ size_t alignLine(size_t bytes) { return (bytes + 63) & ~size_t{63}; }
+ } // namespace
+ // --- ShmRing --
+ bool ShmRing::trySend(const TypedPayload& value) {
+    const size_t size = value.data.size();
+    if (!header_ || size > getMaxPayloadBytes()) return false;
+    const uint64_t capacity = mask_ + 1;
+    const uint64_t record = recordBytes(size);
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    const uint64_t offset = tail & mask_;
+    const uint64_t skip = offset + record > capacity ? capacity - offset : 0;
+    if (tail + skip + record - head_cache_ > capacity) {
+        head_cache_ = header_->head.load(std::memory_order_acquire);
+        if (tail + skip + record - head_cache_ > capacity) return false;
+    }
+    if (skip) std::memcpy(data_ + offset, &SKIP_RECORD, sizeof(uint32_t));
+    std::byte* at = data_ + ((tail + skip) & mask_);
+    const uint32_t fields[2] = {static_cast<uint32_t>(size), static_cast<uint32_t>(value.type)};
+    std::memcpy(at, fields, sizeof(fields));
+    if (size) std::memcpy(at + RECORD_HEADER_BYTES, value.data.data(), size);
+    header_->tail.store(tail + skip + record, std::memory_order_release);
+    wakeIfWaiting(header_->recv_waiting, header_->data_seq);
+    return true;
+ }
+ bool ShmRing::tryRecv(TypedPayload& out) {
+    if (!header_) return false;
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+        tail_cache_ = header_->tail.load(std::memory_order_acquire);
+        if (head == tail_cache_) return false;
+    }
+    uint32_t fields[2];
+    std::memcpy(fields, data_ + (head & mask_), sizeof(fields));
+    if (fields[0] == SKIP_RECORD) {
+        // Published together with the record behind it, which starts the data
+        head += (mask_ + 1) - (head & mask_);
+        std::memcpy(fields, data_, sizeof(fields));
+    }
+    const std::byte* at = data_ + (head & mask_) + RECORD_HEADER_BYTES;
+    out = TypedPayload(static_cast<BDIType>(fields[1]), bdi::core::payload::PayloadBuffer(at, fields[0]));
+    header_->head.store(head + recordBytes(fields[0]), std::memory_order_release);
+    wakeIfWaiting(header_->send_waiting, header_->space_seq);
+    return true;
+ }
+ bool ShmRing::send(const TypedPayload& value) {
+    if (!header_ || value.data.size() > getMaxPayloadBytes()) return false;
+    return waitUntil([&] { return trySend(value); }, [&] { return isAborted(); },
+                     header_->send_waiting, header_->space_seq);
+ }
+ bool ShmRing::recv(TypedPayload& out) {
+    if (!header_) return false;
+    return waitUntil([&] { return tryRecv(out); }, [&] { return isAborted(); },
+                     header_->recv_waiting, header_->data_seq);
+ }
+ // --- ShmSegment --
+ ShmSegment::ShmSegment(size_t ring_count, size_t ring_bytes, size_t worker_count, size_t output_count)
+    : ring_count_(ring_count), ring_bytes_(std::bit_ceil(std::max<size_t>(ring_bytes, 4096))),
+      worker_count_(worker_count), output_count_(output_count) {
+    workers_offset_ = LINE;
+    outputs_offset_ = workers_offset_ + worker_count_ * alignLine(sizeof(WorkerReport));
+    rings_offset_ = alignLine(outputs_offset_ + output_count_ * sizeof(OutputReport));
+    ring_stride_ = sizeof(ShmRingHeader) + ring_bytes_;
+    const size_t bytes = rings_offset_ + ring_count_ * ring_stride_;
+ #if defined(__unix__)
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return;
+    base_ = static_cast<std::byte*>(p);
+    bytes_ = bytes;
+    // Fresh anonymous pages are zero; construct the atomics in place all the same
+    new (base_) std::atomic<uint32_t>(0);
+    for (size_t i = 0; i < worker_count_; ++i) new (&getWorkerReport(i)) WorkerReport();
+    for (size_t i = 0; i < output_count_; ++i) new (&getOutputReport(i)) OutputReport();
+    for (size_t i = 0; i < ring_count_; ++i) {
+        ShmRingHeader* header = new (&ringHeader(i)) ShmRingHeader();
+        header->capacity = ring_bytes_;
+    }
+ #endif
+ }
+ ShmSegment::~ShmSegment() {
+ #if defined(__unix__)
+    if (base_) munmap(base_, bytes_);
+ #endif
+ }
+ ShmRing ShmSegment::getRing(size_t index) const {
+    if (!base_ || index >= ring_count_) return {};
+    ShmRingHeader& header = ringHeader(index);
+    return ShmRing(&header, reinterpret_cast<std::byte*>(&header) + sizeof(ShmRingHeader), &abortFlag());
+ }
+ WorkerReport& ShmSegment::getWorkerReport(size_t worker) const {
+    return *reinterpret_cast<WorkerReport*>(base_ + workers_offset_ + worker * alignLine(sizeof(WorkerReport)));
+ }
+ OutputReport& ShmSegment::getOutputReport(size_t output) const {
+    return *reinterpret_cast<OutputReport*>(base_ + outputs_offset_ + output * sizeof(OutputReport));
+ }
+ void ShmSegment::abort() {
+    if (!base_) return;
+    abortFlag().store(1, std::memory_order_release);
+    for (size_t i = 0; i < ring_count_; ++i) {
+        ShmRingHeader& header = ringHeader(i);
+        header.data_seq.fetch_add(1, std::memory_order_release);
+        header.space_seq.fetch_add(1, std::memory_order_release);
+        futexWakeAll(header.data_seq);
+        futexWakeAll(header.space_seq);
+    }
+ }
+ bool ShmSegment::isAborted() const {
+    return base_ && abortFlag().load(std::memory_order_acquire) != 0;
+ }
+ std::atomic<uint32_t>& ShmSegment::abortFlag() const {
+    return *reinterpret_cast<std::atomic<uint32_t>*>(base_);
+ }
+ ShmRingHeader& ShmSegment::ringHeader(size_t index) const {
+    return *reinterpret_cast<ShmRingHeader*>(base_ + rings_offset_ + index * ring_stride_);
+ }
+ } // namespace bdi::runtime::distributed
@@ -0,0 +1,104 @@
+// File: bdi/runtime/distributed/ShmTransport.hpp
+ #ifndef BDI_RUNTIME_DISTRIBUTED_SHMTRANSPORT_HPP
+ #define BDI_RUNTIME_DISTRIBUTED_SHMTRANSPORT_HPP
+ #include "../../core/payload/TypedPayload.hpp"
+ #include "../RuntimeValue.hpp"
+ #include <atomic>
+ #include <cstddef>
+ #include <cstdint>
+ namespace bdi::runtime::distributed {
+ using bdi::core::payload::TypedPayload;
+ // Control block of one ring, in shared memory in front of its data. Positions count bytes since creation.
+ struct ShmRingHeader {
+    alignas(64) std::atomic<uint64_t> tail{0}; // Sender
+    std::atomic<uint32_t> data_seq{0};         // Futex word the receiver sleeps on
+    std::atomic<uint32_t> recv_waiting{0};
+    alignas(64) std::atomic<uint64_t> head{0}; // Receiver
+    std::atomic<uint32_t> space_seq{0};        // Futex word the sender sleeps on
+    std::atomic<uint32_t> send_waiting{0};
+    alignas(64) uint64_t capacity = 0;         // Data bytes, a power of two
+ };
+ // Single-producer / single-consumer ring of TypedPayload values between two processes. Each process
+ // works through a view of its own, which caches the other side's position.
+ // Records are {uint32 size, uint32 type} followed by the bytes, padded to 8. A record never wraps: if it
+ // does not fit before the end of the data, a skip marker sends the receiver back to the start.
+ // send() / recv() spin briefly, then sleep on a futex in the header, waking up now and then to check the
+ // segment's abort flag.
+ class ShmRing {
+ public:
+    ShmRing() = default;
+    ShmRing(ShmRingHeader* header, std::byte* data, const std::atomic<uint32_t>* abort)
+        : header_(header), data_(data), abort_(abort), mask_(header->capacity - 1) {}
+    bool isValid() const { return header_ != nullptr; }
+    // Largest value a send accepts: a record of half the capacity fits whatever the position
+    size_t getMaxPayloadBytes() const { return header_ ? (mask_ + 1) / 2 - RECORD_HEADER_BYTES : 0; }
+    // False if the ring is full or the value is too large
+    bool trySend(const TypedPayload& value);
+    // False if the ring is empty
+    bool tryRecv(TypedPayload& out);
+    // Block until done. False if the value is too large or the segment was aborted.
+    bool send(const TypedPayload& value);
+    bool recv(TypedPayload& out);
+ private:
+    static constexpr uint64_t RECORD_HEADER_BYTES = 8;
+    static constexpr uint32_t SKIP_RECORD = UINT32_MAX;
+    bool isAborted() const { return abort_ && abort_->load(std::memory_order_acquire) != 0; }
+    ShmRingHeader* header_ = nullptr;
+    std::byte* data_ = nullptr;
+    const std::atomic<uint32_t>* abort_ = nullptr;
+    uint64_t mask_ = 0;
+    uint64_t head_cache_ = 0; // Sender's view
+    uint64_t tail_cache_ = 0; // Receiver's view
+ };
+ enum class WorkerState : uint32_t { RUNNING, SUCCEEDED, FAILED };
+ // Written by one worker, read by the coordinator once the worker has exited
+ struct WorkerReport {
+    std::atomic<WorkerState> state{WorkerState::RUNNING};
+    uint32_t has_return_value = 0;
+    RuntimeValue return_value;
+    uint64_t steps = 0;
+    uint64_t elapsed_ns = 0;
+ };
+ // One value asked of the run; the first worker to claim it writes it
+ struct OutputReport {
+    std::atomic<uint32_t> claimed{0};
+    std::atomic<uint32_t> ready{0};
+    RuntimeValue value;
+ };
+ // Shared memory for one distributed run: an abort flag, a report per worker, an output report per
+ // requested value and the boundary rings. One anonymous shared mapping, created by the coordinator
+ // before it forks the workers, which inherit it at the same address.
+ class ShmSegment {
+ public:
+    // 'ring_bytes' per ring, rounded up to a power of two of at least 4 KiB
+    ShmSegment(size_t ring_count, size_t ring_bytes, size_t worker_count, size_t output_count);
+    ~ShmSegment();
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+    bool isValid() const { return base_ != nullptr; }
+    size_t getBytes() const { return bytes_; }
+    size_t getRingCount() const { return ring_count_; }
+    // A new view of ring 'index'; the sending and the receiving process each need one
+    ShmRing getRing(size_t index) const;
+    WorkerReport& getWorkerReport(size_t worker) const;
+    OutputReport& getOutputReport(size_t output) const;
+    // Fail every blocked and future send() / recv(), in all processes
+    void abort();
+    bool isAborted() const;
+ private:
+    static constexpr size_t LINE = 64;
+    std::byte* base_ = nullptr;
+    size_t bytes_ = 0;
+    size_t ring_count_ = 0;
+    size_t ring_bytes_ = 0;
+    size_t worker_count_ = 0;
+    size_t output_count_ = 0;
+    size_t workers_offset_ = 0;
+    size_t outputs_offset_ = 0;
+    size_t rings_offset_ = 0;
+    size_t ring_stride_ = 0;
+    std::atomic<uint32_t>& abortFlag() const;
+    ShmRingHeader& ringHeader(size_t index) const;
+ };
+ } // namespace bdi::runtime::distributed
+ #endif // BDI_RUNTIME_DISTRIBUTED_SHMTRANSPORT_HPP
@@ -0,0 +1,116 @@
+// File: bdi/runtime/concurrency/TaskScheduler.cpp
+ #include "TaskScheduler.hpp"
+ #include "../BDIVirtualMachine.hpp"
+ namespace bdi::runtime::concurrency {
+ void ExecutionTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> task) noexcept {
+    promise_type& promise = task.promise();
+    TaskScheduler* scheduler = promise.scheduler;
+    const bool ok = promise.result;
+    promise.finished.store(true, std::memory_order_release);
+    if (scheduler) scheduler->finishTask(ok); // Last touch: the owner may destroy the frame from here on
+ }
+ TaskScheduler::TaskScheduler(WorkStealingPool& pool) : pool_(pool) {}
+ TaskScheduler::~TaskScheduler() = default;
+ // --- Channels --
+ ChannelID TaskScheduler::createChannel(size_t capacity, ChannelKind kind) {
+    channels_.push_back(std::make_unique<Channel>(kind, capacity));
+    return channels_.size();
+ }
+ bool TaskScheduler::trySend(ChannelID id, TypedPayload value) {
+    Channel* channel = getChannel(id);
+    if (!channel || !channel->trySend(value)) return false;
+    wakeReceiver(*channel);
+    return true;
+ }
+ std::optional<TypedPayload> TaskScheduler::tryRecv(ChannelID id) {
+    Channel* channel = getChannel(id);
+    TypedPayload value;
+    if (!channel || !channel->tryRecv(value)) return std::nullopt;
+    wakeSender(*channel);
+    return value;
+ }
+ // --- Tasks --
+ TaskScheduler::TaskID TaskScheduler::spawn(const CompiledGraph& graph, NodeID entry_node_id,
+                                            const std::function<void(BDIVirtualMachine&)>& configure) {
+    GraphTask entry;
+    entry.machine = std::make_unique<BDIVirtualMachine>();
+    if (configure) configure(*entry.machine);
+    entry.task = entry.machine->run(graph, entry_node_id, *this);
+    entry.task.handle().promise().scheduler = this;
+    const std::coroutine_handle<> handle = entry.task.handle();
+    tasks_.push_back(std::move(entry));
+    resume(handle);
+    return tasks_.size() - 1;
+ }
+ bool TaskScheduler::waitIdle() {
+    std::unique_lock lock(idle_mutex_);
+    idle_cv_.wait(lock, [this] { return active_.load(std::memory_order_acquire) == 0; });
+    return finished_.load(std::memory_order_acquire) == tasks_.size() && !failed_.load(std::memory_order_acquire);
+ }
+ std::optional<bool> TaskScheduler::getTaskResult(TaskID id) const {
+    if (id >= tasks_.size() || !tasks_[id].task.isFinished()) return std::nullopt;
+    return tasks_[id].task.getResult();
+ }
+ BDIVirtualMachine& TaskScheduler::getMachine(TaskID id) const {
+    return *tasks_[id].machine;
+ }
+ // --- Suspension and Resumption --
+ void TaskScheduler::resumeTask(void* address, uint32_t) {
+    std::coroutine_handle<>::from_address(address).resume();
+ }
+ void TaskScheduler::resume(std::coroutine_handle<> task) {
+    if (!task) return;
+    active_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit({&TaskScheduler::resumeTask, task.address(), 0});
+ }
+ bool TaskScheduler::park(std::coroutine_handle<> task, const WaitRequest& request) {
+    bool parked = false;
+    switch (request.kind) {
+        case WaitRequest::CHANNEL_RECV:
+            parked = request.channel->parkReceiver(task);
+            break;
+        case WaitRequest::CHANNEL_SEND:
+            parked = request.channel->parkSender(task);
+            break;
+        case WaitRequest::MUTEX: {
+            // Park only while the word still says "locked, with waiters"; the unlocker clears it before it
+            // takes this lock to wake someone, so the check and the queuing cannot miss that wakeup
+            std::lock_guard lock(mutex_waiters_lock_);
+            if (std::atomic_ref<uint32_t>(*request.lock_word).load() == 2) {
+                mutex_waiters_[request.lock_word].push_back(task);
+                parked = true;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    // From here on another thread may already be running the task again; touch only the scheduler
+    if (parked) leaveActive();
+    return parked;
+ }
+ void TaskScheduler::wakeMutexWaiter(uint32_t* lock_word) {
+    std::coroutine_handle<> task;
+    {
+        std::lock_guard lock(mutex_waiters_lock_);
+        auto it = mutex_waiters_.find(lock_word);
+        if (it == mutex_waiters_.end()) return;
+        task = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) mutex_waiters_.erase(it);
+    }
+    resume(task);
+ }
+ void TaskScheduler::finishTask(bool ok) {
+    if (!ok) failed_.store(true, std::memory_order_relaxed);
+    finished_.fetch_add(1, std::memory_order_release);
+    leaveActive();
+ }
+ void TaskScheduler::leaveActive() {
+    if (active_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Taking the lock orders this notify after waitIdle()'s predicate check
+        { std::lock_guard lock(idle_mutex_); }
+        idle_cv_.notify_all();
+    }
+ }
+ } // namespace bdi::runtime::concurrency
@@ -0,0 +1,157 @@
+// File: bdi/runtime/concurrency/TaskScheduler.hpp
+ #ifndef BDI_RUNTIME_CONCURRENCY_TASKSCHEDULER_HPP
+ #define BDI_RUNTIME_CONCURRENCY_TASKSCHEDULER_HPP
+ #include "Channel.hpp"
+ #include "../WorkStealingPool.hpp"
+ #include "../../core/graph/CompiledGraph.hpp"
+ #include <atomic>
+ #include <condition_variable>
+ #include <coroutine>
+ #include <cstddef>
+ #include <cstdint>
+ #include <deque>
+ #include <functional>
+ #include <memory>
+ #include <mutex>
+ #include <optional>
+ #include <unordered_map>
+ #include <utility>
+ #include <vector>
+ namespace bdi::runtime {
+ class BDIVirtualMachine;
+ }
+ namespace bdi::runtime::concurrency {
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeID;
+ class TaskScheduler;
+ // Coroutine running one VM execution context (BDIVirtualMachine::run). It starts suspended; the scheduler
+ // resumes it on a pool worker, and it suspends whenever a channel or lock makes it wait.
+ class ExecutionTask {
+ public:
+    struct promise_type {
+        TaskScheduler* scheduler = nullptr;
+        bool result = false;
+        std::atomic<bool> finished{false};
+        ExecutionTask get_return_object() { return ExecutionTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // Stays suspended at the end so the owner can read the result; tells the scheduler it is done
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> task) noexcept;
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(bool ok) { result = ok; }
+        void unhandled_exception() { result = false; }
+    };
+    ExecutionTask() = default;
+    ExecutionTask(ExecutionTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    ExecutionTask& operator=(ExecutionTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~ExecutionTask() {
+        if (handle_) handle_.destroy();
+    }
+    std::coroutine_handle<promise_type> handle() const { return handle_; }
+    bool isFinished() const { return handle_ && handle_.promise().finished.load(std::memory_order_acquire); }
+    // Meaningful once isFinished()
+    bool getResult() const { return handle_ && handle_.promise().result; }
+ private:
+    explicit ExecutionTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    std::coroutine_handle<promise_type> handle_;
+ };
+ // What a suspended task waits for
+ struct WaitRequest {
+    enum Kind : uint8_t {
+        NONE,
+        CHANNEL_RECV, // 'channel' has a value
+        CHANNEL_SEND, // 'channel' has room
+        MUTEX         // The lock word at 'lock_word' may have been released (SYNC_MUTEX_LOCK protocol)
+    };
+    Kind kind = NONE;
+    Channel* channel = nullptr;
+    uint32_t* lock_word = nullptr;
+ };
+ // Runs thousands of graph tasks as coroutines on a WorkStealingPool. A task that would block on a channel
+ // or lock parks its coroutine where the channel or lock can find it and returns the worker to the pool;
+ // whoever makes progress possible queues it again. No OS thread is ever parked for a task.
+ // Channels, spawn() and waitIdle() are for the host thread; tasks only use what BDIVirtualMachine::run needs.
+ class TaskScheduler {
+ public:
+    using TaskID = size_t;
+    explicit TaskScheduler(WorkStealingPool& pool);
+    // Tasks still parked are destroyed with it; call only while none is running (e.g. after waitIdle())
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    // --- Channels --
+    // Create channels before the tasks that use them are spawned. IDs start at 1.
+    ChannelID createChannel(size_t capacity, ChannelKind kind = ChannelKind::MPMC);
+    Channel* getChannel(ChannelID id) const { return id != 0 && id <= channels_.size() ? channels_[id - 1].get() : nullptr; }
+    size_t getChannelCount() const { return channels_.size(); }
+    // Non-blocking send / receive from the host; resumes a task parked on the other side
+    bool trySend(ChannelID id, TypedPayload value);
+    std::optional<TypedPayload> tryRecv(ChannelID id);
+    // --- Tasks --
+    // Run 'graph' from 'entry_node_id' on a VM of its own. 'graph' must outlive the task.
+    // 'configure' (optional) sets the VM up (payload overrides, step limit, tracer...) before it starts.
+    TaskID spawn(const CompiledGraph& graph, NodeID entry_node_id,
+                 const std::function<void(BDIVirtualMachine&)>& configure = {});
+    // Block until no task can make progress: every task has finished, or those left wait on channels or
+    // locks that only the host can release (e.g. with trySend). True if every task finished successfully.
+    bool waitIdle();
+    size_t getTaskCount() const { return tasks_.size(); }
+    size_t getFinishedTaskCount() const { return finished_.load(std::memory_order_acquire); }
+    // Result of a finished task; nullopt while it runs or waits
+    std::optional<bool> getTaskResult(TaskID id) const;
+    // The task's VM, for getOutputValue() and friends once the task has finished
+    BDIVirtualMachine& getMachine(TaskID id) const;
+    // --- Used by Running Tasks --
+    class WaitAwaiter {
+    public:
+        WaitAwaiter(TaskScheduler& scheduler, WaitRequest request) : scheduler_(scheduler), request_(request) {}
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> task) { return scheduler_.park(task, request_); }
+        void await_resume() const noexcept {}
+    private:
+        TaskScheduler& scheduler_;
+        WaitRequest request_;
+    };
+    // Suspend until 'request' may be satisfied; the task then retries the operation
+    WaitAwaiter wait(WaitRequest request) { return WaitAwaiter(*this, request); }
+    // After a successful channel operation or unlock: queue a task parked on the other side, if any
+    void wakeReceiver(Channel& channel) { resume(channel.takeReceiver()); }
+    void wakeSender(Channel& channel) { resume(channel.takeSender()); }
+    void wakeMutexWaiter(uint32_t* lock_word);
+    // Called by a task's final suspend with its result
+    void finishTask(bool ok);
+ private:
+    struct GraphTask {
+        std::unique_ptr<BDIVirtualMachine> machine;
+        ExecutionTask task;
+    };
+    WorkStealingPool& pool_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::vector<GraphTask> tasks_;
+    // Tasks queued or running; waitIdle() returns when it drops to zero
+    std::atomic<size_t> active_{0};
+    std::atomic<size_t> finished_{0};
+    std::atomic<bool> failed_{false};
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    // Tasks parked on contended lock words, by address
+    std::mutex mutex_waiters_lock_;
+    std::unordered_map<uint32_t*, std::deque<std::coroutine_handle<>>> mutex_waiters_;
+    static void resumeTask(void* address, uint32_t);
+    // Queue 'task' on the pool (no-op for a null handle)
+    void resume(std::coroutine_handle<> task);
+    // False if the wait is already over and the task should not suspend
+    bool park(std::coroutine_handle<> task, const WaitRequest& request);
+    void leaveActive();
+ };
+ } // namespace bdi::runtime::concurrency
+ #endif // BDI_RUNTIME_CONCURRENCY_TASKSCHEDULER_HPP
@@ -0,0 +1,67 @@
+// File: bdi/tests/TestSupport.hpp
+ #ifndef BDI_TESTS_TESTSUPPORT_HPP
+ #define BDI_TESTS_TESTSUPPORT_HPP
+ #include "../core/graph/BDIGraph.hpp"
+ #include "../runtime/RuntimeValue.hpp"
+ #include <cstdio>
+ #include <initializer_list>
+ // Checks for the test executables (one per *Tests.cpp, each a ctest case). A failed check is reported
+ // and counted; main() returns bdi::tests::finish(), non-zero if any check failed.
+ #define BDI_CHECK(condition) \
+    ::bdi::tests::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+ namespace bdi::tests {
+ using bdi::core::graph::BDIGraph;
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::RegionID;
+ using bdi::core::types::BDIType;
+ using bdi::runtime::RuntimeValue;
+ inline int& failureCount() {
+    static int failures = 0;
+    return failures;
+ }
+ inline bool check(bool ok, const char* condition, const char* file, int line) {
+    if (!ok) {
+        ++failureCount();
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+    }
+    return ok;
+ }
+ inline int finish(const char* suite) {
+    std::printf("%s: %s\n", suite, failureCount() ? "FAILED" : "passed");
+    return failureCount() ? 1 : 0;
+ }
+ // Appends nodes to a graph, chaining the control-path ones in creation order
+ struct TestGraph {
+    BDIGraph graph{"test"};
+    NodeID last_control = 0;
+    RegionID region = 0; // Given to the nodes created from now on
+    NodeID constant(BDIType type, RuntimeValue value) {
+        const NodeID id = graph.addNode(BDIOperationType::META_NOP);
+        auto& node = graph.getNode(id)->get();
+        value.type = type;
+        node.payload = value.toPayload();
+        node.data_outputs.push_back({type});
+        node.region_id = region;
+        return id;
+    }
+    template <typename T>
+    NodeID constant(BDIType type, T value) { return constant(type, RuntimeValue::make(type, value)); }
+    // Floating (no control edges) unless 'control'
+    NodeID op(BDIOperationType operation, std::initializer_list<NodeID> inputs, BDIType result, bool control) {
+        const NodeID id = graph.addNode(operation);
+        auto& node = graph.getNode(id)->get();
+        node.region_id = region;
+        if (result != BDIType::UNKNOWN) node.data_outputs.push_back({result});
+        uint32_t input = 0;
+        for (NodeID source : inputs) graph.connectData(source, 0, id, input++);
+        if (control) {
+            if (last_control) graph.connectControl(last_control, id);
+            last_control = id;
+        }
+        return id;
+    }
+    NodeID start() { return op(BDIOperationType::META_START, {}, BDIType::UNKNOWN, true); }
+ };
+ } // namespace bdi::tests
+ #endif // BDI_TESTS_TESTSUPPORT_HPP
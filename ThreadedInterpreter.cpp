@@ -0,0 +1,643 @@
+// File: bdi/runtime/ThreadedInterpreter.cpp
+ #include "ThreadedInterpreter.hpp"
+ #include "IoPrint.hpp"
+ #include "OperationSemantics.hpp"
+ #include "BDIVirtualMachine.hpp"
+ #include <algorithm>
+ #include <limits>
+ #include <map>
+ #include <string_view>
+ #include <unordered_map>
+ #include <unordered_set>
+ namespace bdi::runtime {
+ using bdi::core::graph::INVALID_NODE_INDEX;
+ using bdi::core::graph::INVALID_SLOT_INDEX;
+ using bdi::core::graph::SlotIndex;
+ namespace {
+ constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+ // Lowering state for one CompiledGraph
+ class Lowering {
+ public:
+    explicit Lowering(const CompiledGraph& graph, ThreadedProgram& program) : g_(graph), p_(program) {}
+    void run() {
+        const NodeIndex n = static_cast<NodeIndex>(g_.getNodeCount());
+        p_.graph = &g_;
+        p_.slot_count = static_cast<uint32_t>(g_.getSlotCount());
+        p_.entry_offsets.assign(n, 0);
+        p_.code.emplace_back(); // code[0]: HALT, the target of "no successor"
+        offsets_.assign(n, 0);
+        position_.assign(n, NO_POSITION);
+        invariant_.assign(n, Invariance::UNKNOWN);
+        consumers_.assign(n, 0);
+        routine_offsets_.assign(n, 0);
+        for (NodeIndex i = 0; i < n; ++i) {
+            if (g_.isFloating(i) && g_.operation(i) == BDIOperationType::META_NOP && g_.outputCount(i) &&
+                (g_.flags(i) & CompiledGraph::FLAG_HAS_PAYLOAD)) {
+                p_.constant_slots.emplace_back(g_.outputSlotBase(i), constant(payloadValue(i)));
+            }
+            // Distinct readers of each producer
+            auto slots = g_.inputSlots(i);
+            auto sources = g_.inputNodes(i);
+            for (size_t k = 0; k < slots.size(); ++k) {
+                if (slots[k] == INVALID_SLOT_INDEX) continue;
+                if (std::find(sources.begin(), sources.begin() + k, sources[k]) == sources.begin() + k) ++consumers_[sources[k]];
+            }
+        }
+        std::vector<std::pair<uint32_t, NodeIndex>> fixups; // Control instruction -> node to patch successors from
+        // Block heads first, so that each run of fall-through nodes is lowered from its start; the second
+        // pass takes the cycles that have no head
+        for (int pass = 0; pass < 2; ++pass) {
+            for (NodeIndex i = 0; i < n; ++i) {
+                if (g_.isFloating(i) || offsets_[i] || (pass == 0 && !startsBlock(i))) continue;
+                emitBlock(i, fixups);
+            }
+        }
+        while (!routines_.empty()) {
+            const NodeIndex node = routines_.back();
+            routines_.pop_back();
+            emitRoutine(node);
+        }
+        for (auto [at, node] : ensures_) p_.code[at].alt = routine_offsets_[node];
+        for (auto [at, i] : fixups) {
+            ThreadedInstruction& ins = p_.code[at];
+            auto succ = g_.controlSuccessors(i);
+            auto offset = [&](size_t k) -> uint32_t {
+                return k < succ.size() && succ[k] != INVALID_NODE_INDEX ? offsets_[succ[k]] : 0;
+            };
+            if (ins.handler == ThreadedOp::SPAWN) {
+                // control_outputs = [continuation, task_entry...]
+                ins.next = offset(0);
+                ins.src[0] = static_cast<uint32_t>(p_.spawn_targets.size());
+                ins.src[1] = succ.empty() ? 0 : static_cast<uint32_t>(succ.size() - 1);
+                for (size_t k = 1; k < succ.size(); ++k) p_.spawn_targets.push_back(offset(k));
+            } else if (ins.handler == ThreadedOp::BRANCH) {
+                ins.next = succ.size() < 2 ? 0 : offset(0);
+                ins.alt = succ.size() < 2 ? 0 : offset(1);
+            } else if (ins.handler != ThreadedOp::END && ins.handler != ThreadedOp::FAIL) {
+                ins.next = offset(0);
+            }
+        }
+        p_.register_count = p_.slot_count + static_cast<uint32_t>(p_.constants.size()) + 1;
+    }
+ private:
+    enum class Invariance : uint8_t { UNKNOWN, VISITING, INVARIANT, VARIANT };
+    const CompiledGraph& g_;
+    ThreadedProgram& p_;
+    std::vector<uint32_t> offsets_;  // Per NodeIndex: first instruction of a lowered control node
+    std::vector<uint32_t> position_; // Per NodeIndex: place in the block being lowered, NO_POSITION outside it
+    std::vector<NodeIndex> block_;
+    uint32_t at_ = 0;                // Position of the control node being lowered
+    bool in_routine_ = false;        // Lowering the code an ENSURE calls, not a block
+    // Floating producers evaluated in this block, and the last position their value is current at
+    std::unordered_map<NodeIndex, uint32_t> block_floating_;
+    std::unordered_set<NodeIndex> expanded_; // Floating producers whose inputs emitCone() has pushed
+    std::vector<NodeIndex> floating_stack_;
+    std::vector<Invariance> invariant_;
+    std::vector<NodeIndex> invariance_stack_;
+    std::vector<uint32_t> consumers_;
+    std::vector<uint32_t> routine_offsets_; // Per NodeIndex: code computing an invariant producer, 0 if not emitted
+    std::vector<NodeIndex> routines_;       // Invariant producers whose code is still to emit
+    std::vector<std::pair<uint32_t, NodeIndex>> ensures_;
+    std::map<std::pair<BDIType, uint64_t>, uint32_t> constant_registers_;
+    uint32_t sink() const { return std::numeric_limits<uint32_t>::max(); } // Patched to the sink register by lower()
+    uint32_t constant(const RuntimeValue& value) {
+        auto [it, added] = constant_registers_.try_emplace({value.type, value.bits}, 0);
+        if (added) {
+            p_.constants.push_back(value);
+            it->second = p_.slot_count + static_cast<uint32_t>(p_.constants.size() - 1);
+        }
+        return it->second;
+    }
+    uint32_t append(ThreadedInstruction ins) {
+        p_.code.push_back(ins);
+        return static_cast<uint32_t>(p_.code.size() - 1);
+    }
+    RuntimeValue payloadValue(NodeIndex node) const {
+        return RuntimeValue::fromBytes(g_.payloadType(node), g_.payloadBytes(node));
+    }
+    // Handled inline and continues with its only successor, so the next node can share its block
+    bool fallsThrough(NodeIndex node) const {
+        const BDIOperationType op = g_.operation(node);
+        switch (op) {
+            case BDIOperationType::META_START:
+            case BDIOperationType::META_COMMENT:
+            case BDIOperationType::META_NOP:
+            case BDIOperationType::META_ASSERT:
+            case BDIOperationType::CTRL_JUMP:
+            case BDIOperationType::IO_PRINT:
+                break;
+            default:
+                if (!isScalarOperation(op)) return false;
+        }
+        auto succ = g_.controlSuccessors(node);
+        return succ.size() == 1 && succ[0] != INVALID_NODE_INDEX;
+    }
+    bool startsBlock(NodeIndex node) const {
+        auto preds = g_.controlPredecessors(node);
+        return preds.size() != 1 || preds[0] == node || !fallsThrough(preds[0]);
+    }
+    void emitBlock(NodeIndex head, std::vector<std::pair<uint32_t, NodeIndex>>& fixups) {
+        block_.assign(1, head);
+        position_[head] = 0;
+        while (fallsThrough(block_.back())) {
+            const NodeIndex next = g_.controlSuccessors(block_.back())[0];
+            if (g_.isFloating(next) || offsets_[next] || position_[next] != NO_POSITION || startsBlock(next)) break;
+            position_[next] = static_cast<uint32_t>(block_.size());
+            block_.push_back(next);
+        }
+        block_floating_.clear();
+        in_routine_ = false;
+        for (at_ = 0; at_ < block_.size(); ++at_) {
+            const NodeIndex node = block_[at_];
+            const uint32_t node_start = static_cast<uint32_t>(p_.code.size());
+            offsets_[node] = node_start;
+            fixups.emplace_back(emitControlNode(node), node);
+            p_.code[node_start].step = 1;
+        }
+        p_.entry_offsets[head] = offsets_[head];
+        for (NodeIndex node : block_) position_[node] = NO_POSITION;
+    }
+    // Code computing invariant producer 'root' once per run, called by ENSURE
+    void emitRoutine(NodeIndex root) {
+        block_floating_.clear();
+        in_routine_ = true;
+        at_ = 0;
+        routine_offsets_[root] = static_cast<uint32_t>(p_.code.size());
+        if (!emitCone(root)) p_.requires_vm = true;
+        ThreadedInstruction ret;
+        ret.handler = ThreadedOp::RETURN;
+        append(ret);
+    }
+    // Floating 'root' computes the same value wherever a run evaluates it: scalar, and fed only by
+    // constants, payload immediates and other invariant producers
+    bool isInvariant(NodeIndex root) {
+        invariance_stack_.assign(1, root);
+        while (!invariance_stack_.empty()) {
+            const NodeIndex node = invariance_stack_.back();
+            Invariance& state = invariant_[node];
+            if (state == Invariance::INVARIANT || state == Invariance::VARIANT) {
+                invariance_stack_.pop_back();
+                continue;
+            }
+            const BDIOperationType op = g_.operation(node);
+            if (!g_.isFloating(node) || !isScalarOperation(op)) {
+                state = Invariance::VARIANT;
+                continue;
+            }
+            auto slots = g_.inputSlots(node);
+            auto sources = g_.inputNodes(node);
+            const size_t arity = std::min(getScalarOperationArity(op), slots.size());
+            if (state == Invariance::UNKNOWN) {
+                state = Invariance::VISITING;
+                bool pending = false;
+                for (size_t k = 0; k < arity; ++k) {
+                    if (slots[k] == INVALID_SLOT_INDEX || !g_.isFloating(sources[k]) ||
+                        g_.operation(sources[k]) == BDIOperationType::META_NOP) {
+                        continue;
+                    }
+                    if (invariant_[sources[k]] == Invariance::UNKNOWN) {
+                        invariance_stack_.push_back(sources[k]);
+                        pending = true;
+                    }
+                }
+                if (pending) continue;
+            }
+            state = Invariance::INVARIANT; // A producer still VISITING closes a cycle
+            for (size_t k = 0; k < arity; ++k) {
+                if (slots[k] == INVALID_SLOT_INDEX) continue;
+                const NodeIndex src = sources[k];
+                if (!g_.isFloating(src) ||
+                    (g_.operation(src) != BDIOperationType::META_NOP && invariant_[src] != Invariance::INVARIANT)) {
+                    state = Invariance::VARIANT;
+                }
+            }
+            invariance_stack_.pop_back();
+        }
+        return invariant_[root] == Invariance::INVARIANT;
+    }
+    // Inlined where it is read, rather than computed once per run: variant producers, and in the code of
+    // an invariant one, the invariant producers only it reads
+    bool inlined(NodeIndex node) { return !isInvariant(node) || (in_routine_ && consumers_[node] == 1); }
+    bool available(NodeIndex node) const {
+        auto it = block_floating_.find(node);
+        return it != block_floating_.end() && it->second >= at_;
+    }
+    void ensure(NodeIndex node) {
+        ThreadedInstruction ins;
+        ins.handler = ThreadedOp::ENSURE;
+        ins.node = node;
+        ins.dst = g_.outputSlotBase(node);
+        ins.next = static_cast<uint32_t>(p_.code.size() + 1);
+        ensures_.emplace_back(append(ins), node);
+        if (!routine_offsets_[node]) {
+            routine_offsets_[node] = NO_POSITION; // Requested; emitRoutine() sets the offset
+            routines_.push_back(node);
+        }
+        block_floating_[node] = NO_POSITION;
+    }
+    // Type a slot is guaranteed to hold once written, UNKNOWN if only known at run time
+    BDIType staticSlotType(SlotIndex slot) const {
+        NodeIndex owner = g_.slotOwner(slot);
+        BDIOperationType op = g_.operation(owner);
+        if (op == BDIOperationType::META_NOP) return g_.payloadType(owner);
+        if (op >= BDIOperationType::LOGIC_AND && op <= BDIOperationType::CMP_GE) return BDIType::BOOL;
+        if (isScalarOperation(op) && slot == g_.outputSlotBase(owner)) return g_.slotType(slot);
+        return BDIType::UNKNOWN;
+    }
+    BDIType staticRegisterType(uint32_t reg) const {
+        return reg < p_.slot_count ? staticSlotType(reg) : p_.constants[reg - p_.slot_count].type;
+    }
+    // Resolve operand k of 'node' to a register, emitting floating producers first.
+    // Returns false if a floating producer cannot be lowered.
+    bool operand(NodeIndex node, size_t k, uint32_t& reg) {
+        auto slots = g_.inputSlots(node);
+        auto sources = g_.inputNodes(node);
+        if (k >= slots.size() || slots[k] == INVALID_SLOT_INDEX) {
+            reg = constant(payloadValue(node)); // Inlined payload immediate
+            return true;
+        }
+        // Floating constants are read from their slots, seeded per run from constant_slots
+        const NodeIndex src = sources[k];
+        if (g_.isFloating(src) && g_.operation(src) != BDIOperationType::META_NOP && !emitFloating(src)) return false;
+        reg = slots[k];
+        return true;
+    }
+    bool emitFloating(NodeIndex root) {
+        if (available(root)) return true;
+        if (inlined(root)) return emitCone(root);
+        ensure(root);
+        return true;
+    }
+    // Emit 'root' and the inlined floating producers it reads that are not available yet, producers
+    // first. Depth-first on floating_stack_, not the native stack: chains can be millions of nodes deep.
+    bool emitCone(NodeIndex root) {
+        expanded_.clear();
+        floating_stack_.assign(1, root);
+        while (!floating_stack_.empty()) {
+            const NodeIndex node = floating_stack_.back();
+            if (available(node)) { // Reached twice before it was emitted
+                floating_stack_.pop_back();
+                continue;
+            }
+            const BDIOperationType op = g_.operation(node);
+            auto slots = g_.inputSlots(node);
+            auto sources = g_.inputNodes(node);
+            const size_t arity = std::min(getScalarOperationArity(op), slots.size());
+            if (expanded_.insert(node).second) {
+                if (!isScalarOperation(op)) return false;
+                bool pending = false;
+                for (size_t k = 0; k < arity; ++k) {
+                    const NodeIndex src = sources[k];
+                    if (slots[k] == INVALID_SLOT_INDEX || !g_.isFloating(src) ||
+                        g_.operation(src) == BDIOperationType::META_NOP || available(src)) {
+                        continue;
+                    }
+                    if (!inlined(src)) {
+                        ensure(src);
+                        continue;
+                    }
+                    if (expanded_.count(src)) return false; // Cycle among floating nodes
+                    floating_stack_.push_back(src);
+                    pending = true;
+                }
+                if (pending) continue;
+            }
+            floating_stack_.pop_back();
+            ThreadedInstruction ins;
+            if (!emitScalar(node, ins)) return false;
+            ins.next = static_cast<uint32_t>(p_.code.size() + 1);
+            append(ins);
+            // Current until a later node of the block rewrites a control-path input
+            uint32_t current_until = NO_POSITION;
+            for (size_t k = 0; k < arity; ++k) {
+                if (slots[k] == INVALID_SLOT_INDEX) continue;
+                const NodeIndex src = sources[k];
+                if (!g_.isFloating(src)) {
+                    if (position_[src] != NO_POSITION && position_[src] >= at_) current_until = std::min(current_until, position_[src]);
+                } else if (g_.operation(src) != BDIOperationType::META_NOP) {
+                    current_until = std::min(current_until, block_floating_.at(src));
+                }
+            }
+            block_floating_[node] = current_until;
+        }
+        return true;
+    }
+    // Fill 'ins' for a scalar node, emitting its floating producers
+    bool emitScalar(NodeIndex node, ThreadedInstruction& ins) {
+        BDIOperationType op = g_.operation(node);
+        ins.operation = op;
+        ins.node = node;
+        ins.arity = static_cast<uint8_t>(getScalarOperationArity(op));
+        for (size_t k = 0; k < ins.arity; ++k) {
+            if (!operand(node, k, ins.src[k])) return false;
+        }
+        const bool has_output = g_.outputCount(node) != 0;
+        ins.dst = has_output ? g_.outputSlotBase(node) : sink();
+        ins.result_type = has_output ? g_.slotType(g_.outputSlotBase(node)) : BDIType::UNKNOWN;
+        ins.handler = selectHandler(ins);
+        return true;
+    }
+    ThreadedOp selectHandler(const ThreadedInstruction& ins) const {
+        if (ins.arity != 2) return ThreadedOp::GENERIC;
+        const BDIType a = staticRegisterType(ins.src[0]);
+        const BDIType b = staticRegisterType(ins.src[1]);
+        if (a != b) return ThreadedOp::GENERIC;
+        // Arithmetic must also produce exactly the operand type
+        const bool same_result = ins.result_type == a || ins.result_type == BDIType::UNKNOWN;
+ #define BDI_THREADED_SELECT_BINOP(name, ctype, btype, oper) \
+        if (same_result && a == BDIType::btype && ins.operation == opFor(#oper, false)) return ThreadedOp::name;
+ #define BDI_THREADED_SELECT_CMPOP(name, ctype, btype, oper) \
+        if (a == BDIType::btype && ins.operation == opFor(#oper, true)) return ThreadedOp::name;
+        BDI_THREADED_INT_BINOPS(BDI_THREADED_SELECT_BINOP)
+        BDI_THREADED_FLOAT_BINOPS(BDI_THREADED_SELECT_BINOP)
+        BDI_THREADED_CMPOPS(BDI_THREADED_SELECT_CMPOP)
+ #undef BDI_THREADED_SELECT_BINOP
+ #undef BDI_THREADED_SELECT_CMPOP
+        return ThreadedOp::GENERIC;
+    }
+    static constexpr BDIOperationType opFor(std::string_view oper, bool comparison) {
+        if (comparison) {
+            if (oper == "==") return BDIOperationType::CMP_EQ;
+            if (oper == "!=") return BDIOperationType::CMP_NE;
+            if (oper == "<") return BDIOperationType::CMP_LT;
+            if (oper == "<=") return BDIOperationType::CMP_LE;
+            if (oper == ">") return BDIOperationType::CMP_GT;
+            return BDIOperationType::CMP_GE;
+        }
+        if (oper == "+") return BDIOperationType::ARITH_ADD;
+        if (oper == "-") return BDIOperationType::ARITH_SUB;
+        if (oper == "*") return BDIOperationType::ARITH_MUL;
+        if (oper == "&") return BDIOperationType::BIT_AND;
+        if (oper == "|") return BDIOperationType::BIT_OR;
+        return BDIOperationType::BIT_XOR;
+    }
+    // Emit the block body for a node; returns the offset of the instruction carrying its control transfer
+    uint32_t emitControlNode(NodeIndex node) {
+        BDIOperationType op = g_.operation(node);
+        ThreadedInstruction ins;
+        ins.operation = op;
+        ins.node = node;
+        ins.dst = sink();
+        auto fail = [&]() {
+            p_.requires_vm = true;
+            ThreadedInstruction f;
+            f.handler = ThreadedOp::FAIL;
+            f.node = node;
+            return append(f);
+        };
+        switch (op) {
+            case BDIOperationType::META_START:
+            case BDIOperationType::META_COMMENT:
+            case BDIOperationType::CTRL_JUMP:
+                ins.handler = ThreadedOp::NOP;
+                return append(ins);
+            case BDIOperationType::CONCURRENCY_SPAWN:
+                ins.handler = ThreadedOp::SPAWN;
+                return append(ins);
+            case BDIOperationType::CONCURRENCY_JOIN:
+                ins.handler = ThreadedOp::JOIN;
+                return append(ins);
+            case BDIOperationType::META_NOP:
+                if (g_.outputCount(node) && (g_.flags(node) & CompiledGraph::FLAG_HAS_PAYLOAD)) {
+                    ins.handler = ThreadedOp::COPY;
+                    ins.src[0] = constant(payloadValue(node));
+                    ins.dst = g_.outputSlotBase(node);
+                } else {
+                    ins.handler = ThreadedOp::NOP;
+                }
+                return append(ins);
+            case BDIOperationType::META_END:
+            case BDIOperationType::CTRL_RETURN:
+                ins.handler = ThreadedOp::END;
+                ins.arity = g_.inputSlots(node).empty() ? 0 : 1;
+                if (ins.arity && !operand(node, 0, ins.src[0])) return fail();
+                return append(ins);
+            case BDIOperationType::META_ASSERT:
+            case BDIOperationType::CTRL_BRANCH_COND:
+            case BDIOperationType::IO_PRINT:
+                ins.handler = op == BDIOperationType::META_ASSERT ? ThreadedOp::ASSERT
+                            : op == BDIOperationType::CTRL_BRANCH_COND ? ThreadedOp::BRANCH : ThreadedOp::PRINT;
+                ins.arity = 1;
+                if (!operand(node, 0, ins.src[0])) return fail();
+                return append(ins);
+            default:
+                if (!isScalarOperation(op) || !emitScalar(node, ins)) return fail();
+                return append(ins);
+        }
+    }
+ };
+ } // namespace
+ ThreadedInterpreter::ThreadedInterpreter() : fallback_(std::make_unique<BDIVirtualMachine>()) {}
+ ThreadedInterpreter::~ThreadedInterpreter() = default;
+ std::unique_ptr<ThreadedProgram> ThreadedInterpreter::lower(const CompiledGraph& graph) {
+    auto program = std::make_unique<ThreadedProgram>();
+    Lowering(graph, *program).run();
+    // Redirect writes of output-less nodes to the sink register
+    const uint32_t sink_reg = program->register_count - 1;
+    for (auto& ins : program->code) {
+        if (ins.dst == std::numeric_limits<uint32_t>::max()) ins.dst = sink_reg;
+    }
+    return program;
+ }
+ bool ThreadedInterpreter::execute(const ThreadedProgram& program, NodeID entry_node_id) {
+    program_ = &program;
+    return_value_.reset();
+    step_count_ = 0;
+    auto entry = program.graph->indexOf(entry_node_id);
+    ran_on_fallback_ = program.requires_vm || (entry && program.entry_offsets[*entry] == 0);
+    if (ran_on_fallback_) {
+        fallback_->setMaxSteps(max_steps_);
+        const bool ok = fallback_->execute(*program.graph, entry_node_id);
+        return_value_ = fallback_->getReturnValue();
+        step_count_ = fallback_->getStepCount();
+        return ok;
+    }
+    if (!entry) return false;
+    registers_.assign(program.register_count, RuntimeValue{});
+    std::copy(program.constants.begin(), program.constants.end(), registers_.begin() + program.slot_count);
+    for (auto [slot, reg] : program.constant_slots) registers_[slot] = registers_[reg];
+    return run(program.entry_offsets[*entry]);
+ }
+ std::optional<RuntimeValue> ThreadedInterpreter::getOutputValue(NodeID node_id, PortIndex port_idx) const {
+    if (!program_) return std::nullopt;
+    if (ran_on_fallback_) return fallback_->getOutputValue(node_id, port_idx);
+    const CompiledGraph& g = *program_->graph;
+    auto idx = g.indexOf(node_id);
+    if (!idx || port_idx >= g.outputCount(*idx)) return std::nullopt;
+    const RuntimeValue& value = registers_[g.outputSlotBase(*idx) + port_idx];
+    if (!value.isSet()) return std::nullopt;
+    return value;
+ }
+ bool ThreadedInterpreter::run(uint32_t entry_offset) {
+    const ThreadedInstruction* const code = program_->code.data();
+    const ThreadedInstruction* ip = code + entry_offset;
+    RuntimeValue* const regs = registers_.data();
+    const uint64_t limit = max_steps_ ? max_steps_ : std::numeric_limits<uint64_t>::max();
+    uint64_t steps = 0;
+    bool ok = false;
+    // Active CONCURRENCY_SPAWN instructions and the index of their next task
+    struct SpawnFrame { const ThreadedInstruction* spawn; uint32_t next_task; };
+    std::vector<SpawnFrame> spawn_stack;
+    std::vector<uint32_t> calls; // Return offsets of the active ENSURE calls
+    // Every handler starts by charging the step limit for block heads, like fetchDecodeExecuteCycle
+ #define BDI_CHARGE_STEP() \
+    if (ip->step) { if (steps >= limit) goto done; ++steps; }
+ #if BDI_THREADED_COMPUTED_GOTO
+    static void* const dispatch_table[] = {
+        &&L_HALT, &&L_FAIL, &&L_NOP, &&L_COPY, &&L_GENERIC, &&L_BRANCH, &&L_END, &&L_ASSERT, &&L_PRINT,
+        &&L_SPAWN, &&L_JOIN, &&L_ENSURE, &&L_RETURN,
+ #define BDI_THREADED_LABEL(name, ctype, btype, oper) &&L_##name,
+        BDI_THREADED_INT_BINOPS(BDI_THREADED_LABEL)
+        BDI_THREADED_FLOAT_BINOPS(BDI_THREADED_LABEL)
+        BDI_THREADED_CMPOPS(BDI_THREADED_LABEL)
+ #undef BDI_THREADED_LABEL
+    };
+    static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == static_cast<size_t>(ThreadedOp::COUNT));
+ #define BDI_DISPATCH() goto *dispatch_table[static_cast<size_t>(ip->handler)]
+ #define BDI_HANDLER(name) L_##name: BDI_CHARGE_STEP()
+ #define BDI_HANDLER_UNCHARGED(name) L_##name:
+    BDI_DISPATCH();
+ #else
+ #define BDI_DISPATCH() continue
+ #define BDI_HANDLER(name) case ThreadedOp::name: BDI_CHARGE_STEP()
+ #define BDI_HANDLER_UNCHARGED(name) case ThreadedOp::name:
+    for (;;) {
+    switch (ip->handler) {
+ #endif
+    BDI_HANDLER(HALT)
+        if (!spawn_stack.empty()) goto task_return; // "No successor" ends a spawned task
+        ok = true;
+        goto done;
+    BDI_HANDLER(FAIL)
+        goto done;
+    BDI_HANDLER(NOP)
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    BDI_HANDLER(COPY)
+        regs[ip->dst] = regs[ip->src[0]];
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    BDI_HANDLER(GENERIC) {
+        RuntimeValue operands[3];
+        for (uint8_t k = 0; k < ip->arity; ++k) {
+            operands[k] = regs[ip->src[k]];
+            if (!operands[k].isSet()) goto done;
+        }
+        RuntimeValue result;
+        if (!evaluateScalar(ip->operation, ip->result_type, operands, result)) goto done;
+        regs[ip->dst] = result;
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    }
+    BDI_HANDLER(BRANCH) {
+        const RuntimeValue& cond = regs[ip->src[0]];
+        if (!cond.isSet()) goto done;
+        ip = code + (isTruthy(cond) ? ip->next : ip->alt);
+        BDI_DISPATCH();
+    }
+    BDI_HANDLER(END)
+        if (ip->arity) {
+            if (!regs[ip->src[0]].isSet()) goto done;
+            return_value_ = regs[ip->src[0]];
+        }
+        if (!spawn_stack.empty()) goto task_return;
+        ok = true;
+        goto done;
+    BDI_HANDLER(ASSERT)
+        if (!regs[ip->src[0]].isSet() || !isTruthy(regs[ip->src[0]])) goto done;
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    BDI_HANDLER(PRINT) {
+        const RuntimeValue& v = regs[ip->src[0]];
+        if (!v.isSet()) goto done;
+        printValue(program_->graph->nodeIdAt(ip->node), v);
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    }
+    BDI_HANDLER(SPAWN)
+        if (ip->src[1] == 0) {
+            ip = code + ip->next;
+            BDI_DISPATCH();
+        }
+        spawn_stack.push_back(SpawnFrame{ip, 1});
+        ip = code + program_->spawn_targets[ip->src[0]];
+        BDI_DISPATCH();
+    // Reaching a JOIN ends the current task without executing it, like BDIVirtualMachine::runSpawnedTask
+    BDI_HANDLER_UNCHARGED(JOIN)
+        if (!spawn_stack.empty()) goto task_return;
+        BDI_CHARGE_STEP()
+        ip = code + ip->next;
+        BDI_DISPATCH();
+    BDI_HANDLER(ENSURE)
+        if (regs[ip->dst].isSet()) {
+            ip = code + ip->next;
+            BDI_DISPATCH();
+        }
+        calls.push_back(ip->next);
+        ip = code + ip->alt;
+        BDI_DISPATCH();
+    BDI_HANDLER(RETURN)
+        ip = code + calls.back();
+        calls.pop_back();
+        BDI_DISPATCH();
+    task_return: {
+        SpawnFrame& frame = spawn_stack.back();
+        if (frame.next_task < frame.spawn->src[1]) {
+            ip = code + program_->spawn_targets[frame.spawn->src[0] + frame.next_task++];
+        } else {
+            ip = code + frame.spawn->next;
+            spawn_stack.pop_back();
+        }
+        BDI_DISPATCH();
+    }
+    // Integer ops wrap: computed in the unsigned type, matching OperationSemantics
+ #define BDI_THREADED_INT_HANDLER(name, ctype, btype, oper) \
+    BDI_HANDLER(name) { \
+        const RuntimeValue& a = regs[ip->src[0]]; \
+        const RuntimeValue& b = regs[ip->src[1]]; \
+        if (a.type != BDIType::btype || b.type != BDIType::btype) goto done; \
+        using U = std::make_unsigned_t<ctype>; \
+        regs[ip->dst] = RuntimeValue::make<ctype>(BDIType::btype, static_cast<ctype>(U(a.as<U>() oper b.as<U>()))); \
+        ip = code + ip->next; \
+        BDI_DISPATCH(); \
+    }
+ #define BDI_THREADED_FLOAT_HANDLER(name, ctype, btype, oper) \
+    BDI_HANDLER(name) { \
+        const RuntimeValue& a = regs[ip->src[0]]; \
+        const RuntimeValue& b = regs[ip->src[1]]; \
+        if (a.type != BDIType::btype || b.type != BDIType::btype) goto done; \
+        const ctype x = a.as<ctype>(), y = b.as<ctype>(); \
+        regs[ip->dst] = RuntimeValue::make<ctype>(BDIType::btype, detail::orderedNan<ctype>(x oper y, x, y)); \
+        ip = code + ip->next; \
+        BDI_DISPATCH(); \
+    }
+ #define BDI_THREADED_CMP_HANDLER(name, ctype, btype, oper) \
+    BDI_HANDLER(name) { \
+        const RuntimeValue& a = regs[ip->src[0]]; \
+        const RuntimeValue& b = regs[ip->src[1]]; \
+        if (a.type != BDIType::btype || b.type != BDIType::btype) goto done; \
+        regs[ip->dst] = RuntimeValue::make<uint8_t>(BDIType::BOOL, (a.as<ctype>() oper b.as<ctype>()) ? 1 : 0); \
+        ip = code + ip->next; \
+        BDI_DISPATCH(); \
+    }
+    BDI_THREADED_INT_BINOPS(BDI_THREADED_INT_HANDLER)
+    BDI_THREADED_FLOAT_BINOPS(BDI_THREADED_FLOAT_HANDLER)
+    BDI_THREADED_CMPOPS(BDI_THREADED_CMP_HANDLER)
+ #undef BDI_THREADED_INT_HANDLER
+ #undef BDI_THREADED_FLOAT_HANDLER
+ #undef BDI_THREADED_CMP_HANDLER
+ #if !BDI_THREADED_COMPUTED_GOTO
+        default:
+            goto done;
+    }
+    }
+ #endif
+ #undef BDI_DISPATCH
+ #undef BDI_HANDLER
+ #undef BDI_HANDLER_UNCHARGED
+ #undef BDI_CHARGE_STEP
+ done:
+    step_count_ = steps;
+    return ok;
+ }
+ } // namespace bdi::runtime
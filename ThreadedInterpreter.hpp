@@ -0,0 +1,129 @@
+// File: bdi/runtime/ThreadedInterpreter.hpp
+ #ifndef BDI_RUNTIME_THREADEDINTERPRETER_HPP
+ #define BDI_RUNTIME_THREADEDINTERPRETER_HPP
+ #include "../core/graph/CompiledGraph.hpp"
+ #include "RuntimeValue.hpp"
+ #include <cstdint>
+ #include <memory>
+ #include <optional>
+ #include <utility>
+ #include <vector>
+ // Direct threading via computed goto where the compiler supports it, switch dispatch otherwise
+ #if !defined(BDI_THREADED_COMPUTED_GOTO)
+    #if defined(__GNUC__) || defined(__clang__)
+        #define BDI_THREADED_COMPUTED_GOTO 1
+    #else
+        #define BDI_THREADED_COMPUTED_GOTO 0
+    #endif
+ #endif
+ namespace bdi::runtime {
+ class BDIVirtualMachine;
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeID;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ // Specialized handlers: (handler, C++ type, BDIType, operator) for ops whose operand types are known at lowering time
+ #define BDI_THREADED_INT_BINOPS(X) \
+    X(ADD_I32, int32_t, INT32, +) X(SUB_I32, int32_t, INT32, -) X(MUL_I32, int32_t, INT32, *) \
+    X(AND_I32, int32_t, INT32, &) X(OR_I32, int32_t, INT32, |) X(XOR_I32, int32_t, INT32, ^) \
+    X(ADD_I64, int64_t, INT64, +) X(SUB_I64, int64_t, INT64, -) X(MUL_I64, int64_t, INT64, *) \
+    X(AND_I64, int64_t, INT64, &) X(OR_I64, int64_t, INT64, |) X(XOR_I64, int64_t, INT64, ^)
+ #define BDI_THREADED_FLOAT_BINOPS(X) \
+    X(ADD_F32, float, FLOAT32, +) X(SUB_F32, float, FLOAT32, -) X(MUL_F32, float, FLOAT32, *) \
+    X(ADD_F64, double, FLOAT64, +) X(SUB_F64, double, FLOAT64, -) X(MUL_F64, double, FLOAT64, *)
+ #define BDI_THREADED_CMPOPS(X) \
+    X(EQ_I32, int32_t, INT32, ==) X(NE_I32, int32_t, INT32, !=) X(LT_I32, int32_t, INT32, <) \
+    X(LE_I32, int32_t, INT32, <=) X(GT_I32, int32_t, INT32, >) X(GE_I32, int32_t, INT32, >=) \
+    X(EQ_I64, int64_t, INT64, ==) X(NE_I64, int64_t, INT64, !=) X(LT_I64, int64_t, INT64, <) \
+    X(LE_I64, int64_t, INT64, <=) X(GT_I64, int64_t, INT64, >) X(GE_I64, int64_t, INT64, >=) \
+    X(EQ_F64, double, FLOAT64, ==) X(NE_F64, double, FLOAT64, !=) X(LT_F64, double, FLOAT64, <) \
+    X(LE_F64, double, FLOAT64, <=) X(GT_F64, double, FLOAT64, >) X(GE_F64, double, FLOAT64, >=)
+ // Handler identifiers of the pre-decoded instruction stream
+ enum class ThreadedOp : uint16_t {
+    HALT,       // Stop, success
+    FAIL,       // Stop, failure (placeholder of a node lowering gave up on; see ThreadedProgram::requires_vm)
+    NOP,        // No effect, continue with 'next'
+    COPY,       // dst = src[0] (non-floating constant nodes)
+    GENERIC,    // evaluateScalar(op, result_type, src...)
+    BRANCH,     // truthy(src[0]) ? next : alt
+    END,        // Optional return value from src[0], then halt
+    ASSERT,     // Fail unless truthy(src[0])
+    PRINT,      // Debug print of src[0]
+    SPAWN,      // Run tasks spawn_targets[src[0], src[0] + src[1]) in order, then continue with 'next'
+    JOIN,       // Ends the current spawned task; no-op outside of one
+    ENSURE,     // Continue with 'next' if register dst is set, else call 'alt' (computes it) and return to 'next'
+    RETURN,     // Return from the code an ENSURE called
+ #define BDI_THREADED_ENUM(name, ctype, btype, oper) name,
+    BDI_THREADED_INT_BINOPS(BDI_THREADED_ENUM)
+    BDI_THREADED_FLOAT_BINOPS(BDI_THREADED_ENUM)
+    BDI_THREADED_CMPOPS(BDI_THREADED_ENUM)
+ #undef BDI_THREADED_ENUM
+    COUNT
+ };
+ // One pre-decoded instruction. Operands are register-file indices: value slots first, then the
+ // constant pool holding inlined payload immediates. Control successors are instruction offsets.
+ // Lowering:
+ //  - A block is a run of control-path nodes where each one after the first is only reached by falling
+ //    through from the one before. Floating producers are inlined into the block before their first
+ //    reader and reused by later readers in it, unless a node in between rewrote one of their inputs.
+ //  - A floating producer whose inputs are all constants (transitively) has one value per run. It is
+ //    emitted once, as code an ENSURE calls the first time a run needs the value.
+ struct ThreadedInstruction {
+    ThreadedOp handler = ThreadedOp::HALT;
+    BDIOperationType operation = BDIOperationType::META_NOP;
+    BDIType result_type = BDIType::UNKNOWN;
+    uint8_t arity = 0;
+    uint8_t step = 0; // 1 for control-path nodes (counts towards the step limit), 0 for floating producers
+    uint32_t dst = 0;
+    uint32_t src[3] = {0, 0, 0};
+    uint32_t next = 0;
+    uint32_t alt = 0;
+    NodeIndex node = 0;
+ };
+ // Lowered form of a CompiledGraph, reusable across runs and interpreter instances.
+ struct ThreadedProgram {
+    std::vector<ThreadedInstruction> code; // code[0] is HALT
+    std::vector<RuntimeValue> constants;   // Initial contents of registers [slot_count, slot_count + constants.size())
+    std::vector<uint32_t> entry_offsets;   // Per NodeIndex: first instruction of the block it starts (0 if none)
+    std::vector<std::pair<uint32_t, uint32_t>> constant_slots; // (slot, register) of floating constants, seeded per run
+    std::vector<uint32_t> spawn_targets;   // Task entry offsets referenced by SPAWN instructions
+    uint32_t slot_count = 0;
+    uint32_t register_count = 0;           // slots + constants + one write-only sink register
+    const CompiledGraph* graph = nullptr;
+    bool requires_vm = false;              // Some node has no handler; execute() runs BDIVirtualMachine
+ };
+ // Second execution engine: lowers the graph once into a compact instruction stream and runs it with
+ // direct-threaded dispatch. Results (success, output values, return value, step limit behaviour) are
+ // identical to BDIVirtualMachine running the same CompiledGraph.
+ // Handled: META_*, CTRL_JUMP / CTRL_BRANCH_COND / CTRL_RETURN, CONCURRENCY_SPAWN / CONCURRENCY_JOIN,
+ // IO_PRINT and the scalar operations of evaluateScalar. A program with any other node (kernels, MEM_*,
+ // LEARN_*, COMM_CHANNEL_*, SYNC_*, ...), and a run entered at a node that starts no block, run on a
+ // BDIVirtualMachine instead, configured through getFallbackMachine().
+ class ThreadedInterpreter {
+ public:
+    ThreadedInterpreter();
+    ~ThreadedInterpreter();
+    static std::unique_ptr<ThreadedProgram> lower(const CompiledGraph& graph);
+    bool execute(const ThreadedProgram& program, NodeID entry_node_id);
+    // The VM that runs what the instruction stream cannot (memory manager, channels, proof verifier, ...)
+    BDIVirtualMachine& getFallbackMachine() { return *fallback_; }
+    // The last execute() ran on getFallbackMachine()
+    bool ranOnFallback() const { return ran_on_fallback_; }
+    // --- State Inspection (same contract as BDIVirtualMachine) --
+    std::optional<RuntimeValue> getOutputValue(NodeID node_id, PortIndex port_idx) const;
+    std::optional<RuntimeValue> getReturnValue() const { return return_value_; }
+    void setMaxSteps(uint64_t max_steps) { max_steps_ = max_steps; }
+    uint64_t getStepCount() const { return step_count_; }
+ private:
+    std::unique_ptr<BDIVirtualMachine> fallback_;
+    bool ran_on_fallback_ = false;
+    const ThreadedProgram* program_ = nullptr;
+    std::vector<RuntimeValue> registers_;
+    std::optional<RuntimeValue> return_value_;
+    uint64_t step_count_ = 0;
+    uint64_t max_steps_ = 0;
+    bool run(uint32_t entry_offset);
+ };
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_THREADEDINTERPRETER_HPP
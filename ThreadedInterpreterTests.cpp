@@ -0,0 +1,189 @@
+// File: bdi/tests/ThreadedInterpreterTests.cpp
+ // ThreadedInterpreter against BDIVirtualMachine: generated workloads and step limits compared slot by
+ // slot, floating cones shared between blocks, and the VM fallback
+ #include "TestSupport.hpp"
+ #include "../benchmarks/GraphGenerators.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/ThreadedInterpreter.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ using namespace bdi::tests;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::core::graph::NodeIndex;
+ using bdi::core::graph::PortIndex;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::ThreadedInterpreter;
+ using bdi::runtime::ThreadedProgram;
+ namespace {
+ // Runs both engines from 'entry' with 'max_steps'; same success, step count, return value and value on
+ // every output port
+ bool matches(const CompiledGraph& graph, const ThreadedProgram& program, NodeID entry, uint64_t max_steps,
+              ThreadedInterpreter& threaded, bdi::runtime::memory::MemoryManager* memory = nullptr) {
+    BDIVirtualMachine vm;
+    vm.setJitThreshold(0);
+    vm.setMaxSteps(max_steps);
+    vm.setMemoryManager(memory);
+    threaded.setMaxSteps(max_steps);
+    if (vm.execute(graph, entry) != threaded.execute(program, entry)) return false;
+    if (vm.getStepCount() != threaded.getStepCount() || vm.getReturnValue() != threaded.getReturnValue()) return false;
+    for (NodeIndex i = 0; i < graph.getNodeCount(); ++i) {
+        const NodeID id = graph.nodeIdAt(i);
+        for (PortIndex port = 0; port < graph.outputCount(i); ++port) {
+            if (vm.getOutputValue(id, port) != threaded.getOutputValue(id, port)) return false;
+        }
+    }
+    return true;
+ }
+ void checkGenerated(bdi::benchmarks::GeneratedGraph generated, bool fallback) {
+    auto compiled = generated.graph->freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    auto program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(program->requires_vm == fallback);
+    ThreadedInterpreter threaded;
+    threaded.getFallbackMachine().setMemoryManager(generated.memory.get());
+    BDI_CHECK(matches(*compiled, *program, generated.entry, generated.max_steps, threaded, generated.memory.get()));
+    BDI_CHECK(threaded.ranOnFallback() == fallback);
+    BDI_CHECK(generated.max_steps != 0 || threaded.execute(*program, generated.entry)); // Only loops stop early
+    // A second run starts from the same state
+    BDI_CHECK(matches(*compiled, *program, generated.entry, generated.max_steps, threaded, generated.memory.get()));
+ }
+ void testGeneratedWorkloads() {
+    for (uint64_t seed = 1; seed <= 12; ++seed) {
+        bdi::meta::MetadataStore store;
+        bdi::benchmarks::RandomDagOptions options;
+        options.nodes = 3000;
+        options.seed = seed;
+        options.window = 8 + seed * 16;
+        options.floating_fraction = static_cast<double>(seed % 4) * 0.25;
+        options.type = seed % 3 == 0 ? BDIType::FLOAT64 : seed % 3 == 1 ? BDIType::INT64 : BDIType::INT16;
+        checkGenerated(bdi::benchmarks::generateRandomDag(store, options), false);
+    }
+    bdi::meta::MetadataStore store;
+    checkGenerated(bdi::benchmarks::generateChain(store, {}), false);
+    checkGenerated(bdi::benchmarks::generateWideDag(store, {}), false);
+    for (uint64_t seed = 1; seed <= 4; ++seed) {
+        bdi::benchmarks::LoopCfgOptions options;
+        options.seed = seed;
+        options.max_steps = 20000 + seed;
+        checkGenerated(bdi::benchmarks::generateLoopCfg(store, options), false);
+    }
+    bdi::benchmarks::VectorGraphOptions vectors;
+    vectors.nodes = 50;
+    vectors.elements = 64;
+    checkGenerated(bdi::benchmarks::generateVectorGraph(store, vectors), true); // Kernels: on the VM
+ }
+ // 'BLOCKS' branches in a loop, each reading the same deep floating cone and, through floating nodes, a
+ // value computed on the control path
+ constexpr size_t CONE = 5000;
+ constexpr size_t BLOCKS = 40;
+ struct SharedCone {
+    TestGraph t;
+    NodeID start = 0;
+    NodeID head = 0;
+    SharedCone() {
+        using Op = BDIOperationType;
+        start = t.start();
+        NodeID cone = t.constant(BDIType::INT64, int64_t{1});
+        for (size_t i = 0; i < CONE; ++i) cone = t.op(Op::ARITH_INC, {cone}, BDIType::INT64, false);
+        const NodeID one = t.constant(BDIType::INT64, int64_t{1});
+        head = t.op(Op::CTRL_JUMP, {}, BDIType::UNKNOWN, true);
+        const NodeID tick = t.op(Op::ARITH_ADD, {cone, one}, BDIType::INT64, true);
+        NodeID previous = 0;
+        for (size_t b = 0; b < BLOCKS; ++b) {
+            // Floating, and reading the control path: recomputed in every block
+            const NodeID shifted = t.op(Op::ARITH_ADD, {tick, cone}, BDIType::INT64, false);
+            // Taken (on to the next block) until the last one, which leaves the loop
+            const NodeID limit = t.constant(BDIType::INT64, b + 1 < BLOCKS ? static_cast<int64_t>(CONE * 3 + b) : int64_t{0});
+            const NodeID test = t.op(Op::CMP_LT, {shifted, limit}, BDIType::BOOL, false);
+            const NodeID branch = t.op(Op::CTRL_BRANCH_COND, {test}, BDIType::UNKNOWN, true);
+            if (previous) t.graph.connectControl(previous, branch); // Second successor of the previous branch
+            previous = branch;
+            t.op(Op::CTRL_JUMP, {}, BDIType::UNKNOWN, true);
+        }
+        t.graph.connectControl(t.last_control, head);
+        t.last_control = previous;
+        t.op(Op::META_END, {cone}, BDIType::UNKNOWN, true);
+    }
+ };
+ void testSharedCone() {
+    SharedCone g;
+    auto compiled = g.t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    auto program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(!program->requires_vm);
+    // The cone is emitted once, not once per block that reads it
+    BDI_CHECK(program->code.size() < CONE + 20 * BLOCKS);
+    ThreadedInterpreter threaded;
+    BDI_CHECK(matches(*compiled, *program, g.start, 0, threaded));
+    BDI_CHECK(!threaded.ranOnFallback());
+    BDI_CHECK(threaded.getReturnValue() && threaded.getReturnValue()->as<int64_t>() == static_cast<int64_t>(CONE + 1));
+    // Stopped at every step on the way, including in the middle of a block
+    for (uint64_t steps = 1; steps <= threaded.getStepCount() + 1; ++steps) {
+        BDI_CHECK(matches(*compiled, *program, g.start, steps, threaded));
+    }
+ }
+ // Repeated immediates share one register
+ void testConstantPool() {
+    TestGraph t;
+    const NodeID start = t.start();
+    NodeID value = t.constant(BDIType::INT32, int32_t{0});
+    for (int i = 0; i < 1000; ++i) {
+        value = t.op(BDIOperationType::ARITH_ADD, {value}, BDIType::INT32, true);
+        t.graph.getNode(value)->get().payload = RuntimeValue::make(BDIType::INT32, int32_t{7}).toPayload();
+    }
+    t.op(BDIOperationType::META_END, {value}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    auto program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(program->constants.size() <= 2);
+    ThreadedInterpreter threaded;
+    BDI_CHECK(matches(*compiled, *program, start, 0, threaded));
+    BDI_CHECK(threaded.getReturnValue() && threaded.getReturnValue()->as<int32_t>() == 7000);
+ }
+ // Nodes without a handler, and entries that start no block, run on the VM
+ void testFallback() {
+    using Op = BDIOperationType;
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT32, int32_t{20});
+    const NodeID floating = t.op(Op::ARITH_MUL, {a, a}, BDIType::INT32, false);
+    const NodeID sum = t.op(Op::ARITH_ADD, {floating, a}, BDIType::INT32, true);
+    const NodeID middle = t.op(Op::ARITH_SUB, {sum, a}, BDIType::INT32, true);
+    t.op(Op::META_END, {middle}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    auto program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(!program->requires_vm);
+    ThreadedInterpreter threaded;
+    BDI_CHECK(matches(*compiled, *program, start, 0, threaded) && !threaded.ranOnFallback());
+    BDI_CHECK(threaded.getReturnValue() && threaded.getReturnValue()->as<int32_t>() == 400);
+    for (NodeID entry : {floating, middle}) {
+        BDI_CHECK(matches(*compiled, *program, entry, 0, threaded) && threaded.ranOnFallback());
+    }
+    // MEM_ALLOC: fails on the VM without a MemoryManager, succeeds with the one set on the fallback
+    TestGraph m;
+    const NodeID m_start = m.start();
+    const NodeID bytes = m.constant(BDIType::UINT64, uint64_t{64});
+    const NodeID block = m.op(Op::MEM_ALLOC, {bytes}, BDIType::POINTER, true);
+    m.op(Op::META_END, {block}, BDIType::UNKNOWN, true);
+    compiled = m.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    program = ThreadedInterpreter::lower(*compiled);
+    BDI_CHECK(program->requires_vm);
+    BDI_CHECK(!threaded.execute(*program, m_start) && threaded.ranOnFallback());
+    bdi::runtime::memory::MemoryManager memory;
+    threaded.getFallbackMachine().setMemoryManager(&memory);
+    BDI_CHECK(threaded.execute(*program, m_start) && threaded.getReturnValue() && threaded.getReturnValue()->isSet());
+ }
+ } // namespace
+ int main() {
+    testGeneratedWorkloads();
+    testSharedCone();
+    testConstantPool();
+    testFallback();
+    return bdi::tests::finish("ThreadedInterpreterTests");
+ }
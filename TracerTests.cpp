@@ -0,0 +1,247 @@
+// File: bdi/tests/TracerTests.cpp
+ // ExecutionTracer on BDIVirtualMachine runs: the recorded events follow the control path node by node,
+ // the profile counts every step exactly, full rings drop rather than block, and a disabled tracer
+ // records nothing and leaves the run as it was
+ #include "TestSupport.hpp"
+ #include "../benchmarks/GraphGenerators.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include <algorithm>
+ #include <map>
+ #include <sstream>
+ #include <string>
+ #include <vector>
+ using namespace bdi::tests;
+ using bdi::core::graph::CompiledGraph;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::trace::ExecutionTracer;
+ using bdi::runtime::trace::NodeProfile;
+ namespace {
+ struct Event {
+    std::string category; // "node", "native" or "run"
+    NodeID node = 0;
+    uint64_t steps = 0;
+ };
+ // The events as exported by writeChromeTrace(), in ring order (one thread)
+ std::vector<Event> traceEvents(ExecutionTracer& tracer) {
+    std::ostringstream os;
+    tracer.writeChromeTrace(os);
+    std::vector<Event> events;
+    std::istringstream lines(os.str());
+    for (std::string line; std::getline(lines, line);) {
+        const size_t category = line.find("\"cat\":\"");
+        if (category == std::string::npos) continue;
+        Event event;
+        event.category = line.substr(category + 7, line.find('"', category + 7) - (category + 7));
+        event.node = std::stoull(line.substr(line.find("\"node\":") + 7));
+        event.steps = std::stoull(line.substr(line.find("\"steps\":") + 8));
+        events.push_back(event);
+    }
+    return events;
+ }
+ std::map<NodeID, NodeProfile> profileById(const ExecutionTracer& tracer) {
+    std::map<NodeID, NodeProfile> profile;
+    for (const NodeProfile& node : tracer.getNodeProfile()) profile[node.node_id] = node;
+    return profile;
+ }
+ uint64_t countedSteps(const ExecutionTracer& tracer) {
+    uint64_t steps = 0;
+    for (const NodeProfile& node : tracer.getNodeProfile()) steps += node.count + node.native_steps;
+    return steps;
+ }
+ // START, two control operations reading a constant, END returning a floating node
+ struct Straight {
+    TestGraph t;
+    NodeID start = 0, add = 0, mul = 0, end = 0, constant = 0, floating = 0;
+    Straight() {
+        using Op = BDIOperationType;
+        start = t.start();
+        constant = t.constant(BDIType::INT64, int64_t{3});
+        add = t.op(Op::ARITH_ADD, {constant, constant}, BDIType::INT64, true);
+        mul = t.op(Op::ARITH_MUL, {add, constant}, BDIType::INT64, true);
+        floating = t.op(Op::ARITH_SUB, {mul, constant}, BDIType::INT64, false);
+        end = t.op(Op::META_END, {floating}, BDIType::UNKNOWN, true);
+    }
+ };
+ void testEventOrder() {
+    Straight g;
+    auto compiled = g.t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    ExecutionTracer tracer;
+    tracer.setSamplePeriod(1);
+    BDIVirtualMachine vm;
+    vm.setJitThreshold(0);
+    vm.setTracer(&tracer);
+    BDI_CHECK(vm.execute(*compiled, g.start) && vm.getStepCount() == 4);
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int64_t>() == 15);
+    // One event per control node as it ran, then the run itself; floating nodes run inside their readers
+    std::vector<Event> events = traceEvents(tracer);
+    const NodeID expected[] = {g.start, g.add, g.mul, g.end};
+    BDI_CHECK(events.size() == 5);
+    if (events.size() != 5) return;
+    for (size_t i = 0; i < 4; ++i) BDI_CHECK(events[i].category == "node" && events[i].node == expected[i]);
+    BDI_CHECK(events[4].category == "run" && events[4].node == g.start);
+    auto profile = profileById(tracer);
+    BDI_CHECK(profile.size() == 4 && !profile.count(g.constant) && !profile.count(g.floating));
+    for (NodeID id : expected) BDI_CHECK(profile[id].count == 1 && profile[id].samples == 1);
+    BDI_CHECK(profile[g.add].operation == BDIOperationType::ARITH_ADD);
+    // A second run adds to the counters; the exported events keep the first run's
+    BDI_CHECK(vm.execute(*compiled, g.start));
+    events = traceEvents(tracer);
+    BDI_CHECK(events.size() == 10 && events[9].category == "run" && events[5].node == g.start);
+    profile = profileById(tracer);
+    for (NodeID id : expected) BDI_CHECK(profile[id].count == 2);
+    BDI_CHECK(tracer.getOperationProfile()[static_cast<size_t>(BDIOperationType::ARITH_MUL)].count == 2);
+    tracer.reset();
+    BDI_CHECK(tracer.getNodeProfile().empty() && traceEvents(tracer).empty());
+ }
+ // Loop CFGs stopped by the step limit: every recorded step is a control successor of the one before,
+ // and the profile adds up to the VM's step count
+ void testLoopPaths() {
+    for (uint64_t seed = 1; seed <= 3; ++seed) {
+        bdi::meta::MetadataStore store;
+        bdi::benchmarks::LoopCfgOptions options;
+        options.blocks = 12;
+        options.block_size = 4;
+        options.max_steps = 3000 + seed * 7;
+        options.seed = seed;
+        auto generated = bdi::benchmarks::generateLoopCfg(store, options);
+        auto compiled = generated.graph->freeze();
+        BDI_CHECK(compiled != nullptr);
+        if (!compiled) return;
+        ExecutionTracer tracer;
+        tracer.setSamplePeriod(1);
+        BDIVirtualMachine vm;
+        vm.setJitThreshold(0);
+        vm.setMaxSteps(generated.max_steps);
+        vm.setTracer(&tracer);
+        vm.execute(*compiled, generated.entry);
+        BDI_CHECK(vm.getStepCount() == generated.max_steps);
+        const std::vector<Event> events = traceEvents(tracer);
+        BDI_CHECK(events.size() == vm.getStepCount() + 1);
+        if (events.size() != vm.getStepCount() + 1) return;
+        BDI_CHECK(events.front().node == generated.entry && events.back().category == "run" && events.back().node == generated.entry);
+        std::map<NodeID, uint64_t> occurrences;
+        bool path = true;
+        for (size_t i = 0; i + 1 < events.size(); ++i) {
+            path = path && events[i].category == "node";
+            ++occurrences[events[i].node];
+            if (i == 0 || !path) continue;
+            const auto successors = compiled->controlSuccessors(*compiled->indexOf(events[i - 1].node));
+            const auto index = compiled->indexOf(events[i].node);
+            path = index && std::find(successors.begin(), successors.end(), *index) != successors.end();
+        }
+        BDI_CHECK(path);
+        BDI_CHECK(countedSteps(tracer) == vm.getStepCount());
+        for (const auto& [id, profile] : profileById(tracer)) BDI_CHECK(profile.count == occurrences[id]);
+        // Sampled: counts stay exact, one event per sample
+        ExecutionTracer sampled;
+        sampled.setSamplePeriod(64);
+        vm.setTracer(&sampled);
+        vm.execute(*compiled, generated.entry);
+        uint64_t samples = 0;
+        for (const NodeProfile& profile : sampled.getNodeProfile()) samples += profile.samples;
+        BDI_CHECK(countedSteps(sampled) == vm.getStepCount());
+        BDI_CHECK(samples > 0 && samples < vm.getStepCount() / 16);
+        BDI_CHECK(traceEvents(sampled).size() == samples + 1);
+    }
+ }
+ // Native regions: each entry is one event whose steps, with the interpreted counts, make up the run
+ void testNativeRegions() {
+    if (!bdi::runtime::jit::JitCompiler::isAvailable()) return;
+    bdi::meta::MetadataStore store;
+    bdi::benchmarks::LoopCfgOptions options;
+    options.blocks = 8;
+    options.max_steps = 20000;
+    auto generated = bdi::benchmarks::generateLoopCfg(store, options);
+    auto compiled = generated.graph->freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    ExecutionTracer tracer;
+    tracer.setSamplePeriod(1);
+    BDIVirtualMachine vm;
+    vm.setJitThreshold(2);
+    vm.setMaxSteps(generated.max_steps);
+    vm.setTracer(&tracer);
+    vm.execute(*compiled, generated.entry);
+    BDI_CHECK(vm.getNativeStepCount() > 0);
+    uint64_t native_steps = 0;
+    uint64_t native_entries = 0;
+    for (const NodeProfile& profile : tracer.getNodeProfile()) {
+        native_steps += profile.native_steps;
+        native_entries += profile.native_entries;
+    }
+    BDI_CHECK(native_steps == vm.getNativeStepCount() && countedSteps(tracer) == vm.getStepCount());
+    uint64_t event_steps = 0;
+    uint64_t event_entries = 0;
+    for (const Event& event : traceEvents(tracer)) {
+        if (event.category != "native") continue;
+        event_steps += event.steps;
+        ++event_entries;
+    }
+    BDI_CHECK(event_entries == native_entries && event_steps == native_steps);
+ }
+ // A ring smaller than the run keeps the oldest events and counts the rest as dropped
+ void testFullRing() {
+    Straight g;
+    auto compiled = g.t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    ExecutionTracer tracer(8);
+    tracer.setSamplePeriod(1);
+    BDIVirtualMachine vm;
+    vm.setJitThreshold(0);
+    vm.setTracer(&tracer);
+    BDI_CHECK(vm.execute(*compiled, g.start) && vm.execute(*compiled, g.start));
+    BDI_CHECK(tracer.getDroppedEventCount() == 2);
+    const std::vector<Event> events = traceEvents(tracer);
+    BDI_CHECK(events.size() == 8 && events[4].category == "run" && events[7].node == g.mul);
+    BDI_CHECK(countedSteps(tracer) == 8);
+ }
+ // A disabled (or detached) tracer is never touched: nothing recorded, and the run is the same as one
+ // without a tracer. Events can also be turned off while counting goes on.
+ void testDisabled() {
+    bdi::meta::MetadataStore store;
+    bdi::benchmarks::LoopCfgOptions options;
+    options.max_steps = 5000;
+    auto generated = bdi::benchmarks::generateLoopCfg(store, options);
+    auto compiled = generated.graph->freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BDIVirtualMachine plain;
+    plain.setMaxSteps(generated.max_steps);
+    const bool plain_ok = plain.execute(*compiled, generated.entry);
+    ExecutionTracer tracer;
+    tracer.setSamplePeriod(1);
+    tracer.setEnabled(false);
+    BDIVirtualMachine vm;
+    vm.setMaxSteps(generated.max_steps);
+    vm.setTracer(&tracer);
+    BDI_CHECK(vm.execute(*compiled, generated.entry) == plain_ok);
+    BDI_CHECK(vm.getStepCount() == plain.getStepCount() && vm.getReturnValue() == plain.getReturnValue());
+    BDI_CHECK(tracer.getNodeProfile().empty() && tracer.getDroppedEventCount() == 0);
+    std::ostringstream os;
+    BDI_CHECK(tracer.writeChromeTrace(os) && os.str().find("\"ph\"") == std::string::npos); // Not even a thread
+    vm.setTracer(nullptr);
+    tracer.setEnabled(true);
+    vm.execute(*compiled, generated.entry);
+    BDI_CHECK(tracer.getNodeProfile().empty());
+ #if BDI_TRACING
+    // Counters without events
+    vm.setTracer(&tracer);
+    tracer.setRecordEvents(false);
+    vm.execute(*compiled, generated.entry);
+    BDI_CHECK(countedSteps(tracer) == vm.getStepCount() && traceEvents(tracer).empty());
+ #endif
+ }
+ } // namespace
+ int main() {
+ #if BDI_TRACING
+    testEventOrder();
+    testLoopPaths();
+    testNativeRegions();
+    testFullRing();
+ #endif
+    testDisabled();
+    return bdi::tests::finish("TracerTests");
+ }
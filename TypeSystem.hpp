@@ -6,14 +6,14 @@
  class TypeSystem {
  public:
  // Basic type compatibility check (can types be used interchangeably?)
-    static bool areCompatible(BDIType type1, BDIType type2) {
+    static constexpr bool areCompatible(BDIType type1, BDIType type2) {
         // Basic implementation: types are compatible if they are identical
         // TODO: Expand with rules for implicit conversions (e.g., INT32 -> INT64)
         // TODO: Handle compatibility for pointers/references if needed
         return type1 == type2;
     }
     // Check if an implicit conversion is allowed
-    static bool canImplicitlyConvert(BDIType from_type, BDIType to_type) {
+    static constexpr bool canImplicitlyConvert(BDIType from_type, BDIType to_type) {
         if (from_type == to_type) return true;
         // Example: Widening integer conversions
         if ((from_type == BDIType::INT32 && to_type == BDIType::INT64) ||
@@ -42,6 +42,7 @@
  #include "../types/BinaryEncoding.hpp"
  #include <vector>
  #include <cstddef> // For std::byte
+ #include <cstring>
  #include <stdexcept>
  #include <concepts> // For C++20 concepts (optional, can use SFINAE/templates)
  #include <bit> // For std::bit_cast (C++20)
@@ -49,13 +50,91 @@
  using bdi::core::types::BDIType;
  using bdi::core::types::BinaryData;
  using bdi::core::types::getBdiTypeSize;
+ // Byte storage for a TypedPayload. Up to INLINE_CAPACITY bytes (every scalar BDIType, and 16-byte
+ // vectors) live inside the object, so immediates never touch the heap; larger blobs get one heap block.
+ class PayloadBuffer {
+ public:
+    static constexpr size_t INLINE_CAPACITY = 16;
+    PayloadBuffer() = default;
+    explicit PayloadBuffer(size_t size) { resize(size); }
+    PayloadBuffer(const std::byte* first, size_t size) { assign(first, first + size); }
+    PayloadBuffer(const BinaryData& bytes) { assign(bytes.data(), bytes.data() + bytes.size()); }
+    PayloadBuffer(const PayloadBuffer& other) { assign(other.begin(), other.end()); }
+    PayloadBuffer(PayloadBuffer&& other) noexcept { moveFrom(other); }
+    PayloadBuffer& operator=(const PayloadBuffer& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+    PayloadBuffer& operator=(PayloadBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    ~PayloadBuffer() { release(); }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool isInline() const { return size_ <= INLINE_CAPACITY; }
+    std::byte* data() { return isInline() ? inline_ : heap_; }
+    const std::byte* data() const { return isInline() ? inline_ : heap_; }
+    std::byte* begin() { return data(); }
+    std::byte* end() { return data() + size_; }
+    const std::byte* begin() const { return data(); }
+    const std::byte* end() const { return data() + size_; }
+    std::byte& operator[](size_t i) { return data()[i]; }
+    const std::byte& operator[](size_t i) const { return data()[i]; }
+    // New bytes are zeroed; existing bytes up to the new size are kept
+    void resize(size_t size) {
+        if (size == size_) return;
+        PayloadBuffer grown;
+        grown.allocate(size);
+        std::memcpy(grown.data(), data(), size < size_ ? size : size_);
+        if (size > size_) std::memset(grown.data() + size_, 0, size - size_);
+        *this = std::move(grown);
+    }
+    template <typename It>
+    void assign(It first, It last) {
+        const size_t size = static_cast<size_t>(last - first);
+        if (size != size_) {
+            release();
+            allocate(size);
+        }
+        if (size) std::memcpy(data(), &*first, size);
+    }
+    bool operator==(const PayloadBuffer& other) const {
+        return size_ == other.size_ && (size_ == 0 || std::memcmp(data(), other.data(), size_) == 0);
+    }
+    BinaryData toBinaryData() const { return BinaryData(begin(), end()); }
+ private:
+    union {
+        alignas(8) std::byte inline_[INLINE_CAPACITY] = {}; // Zeroed, so the union is never read uninitialized
+        std::byte* heap_;
+    };
+    size_t size_ = 0;
+    void allocate(size_t size) {
+        size_ = size;
+        if (!isInline()) heap_ = new std::byte[size];
+    }
+    void release() {
+        if (!isInline()) delete[] heap_;
+        size_ = 0;
+    }
+    void moveFrom(PayloadBuffer& other) {
+        size_ = other.size_;
+        if (other.isInline()) std::memcpy(inline_, other.inline_, size_);
+        else heap_ = other.heap_;
+        other.size_ = 0;
+    }
+ };
  // Represents a block of binary data associated with a specific BDI type.
  // Used for node payloads (immediate values, configuration).
  struct TypedPayload {
     BDIType type = BDIType::UNKNOWN;
-    BinaryData data;
+    PayloadBuffer data;
     TypedPayload() = default;
-    TypedPayload(BDIType t, BinaryData d) : type(t), data(std::move(d)) {}
+    TypedPayload(BDIType t, PayloadBuffer d) : type(t), data(std::move(d)) {}
+    TypedPayload(BDIType t, const BinaryData& d) : type(t), data(d) {}
     // Basic validation
     bool isValid() const {
         size_t expectedSize = getBdiTypeSize(type);
@@ -104,7 +183,7 @@
          if (payloadType == BDIType::UNKNOWN) {
              throw std::runtime_error("Cannot map C++ type to BDIType in createFrom");
          }
-         BinaryData data(sizeof(T));
+         PayloadBuffer data(sizeof(T));
          std::memcpy(data.data(), &value, sizeof(T));
          return TypedPayload(payloadType, std::move(data));
      }
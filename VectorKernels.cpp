@@ -0,0 +1,406 @@
+// File: bdi/runtime/kernels/VectorKernels.cpp
+ #include "VectorKernelsInternal.hpp"
+ #include "../OperationSemantics.hpp"
+ #include <algorithm>
+ #include <bit>
+ #include <cmath>
+ #include <cstring>
+ #include <numbers>
+ #include <type_traits>
+ #include <unordered_map>
+ #include <vector>
+ namespace bdi::runtime::kernels {
+ // --- CPU Detection --
+ const CpuFeatures& getCpuFeatures() {
+    static const CpuFeatures features = [] {
+        CpuFeatures f;
+ #if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        f.avx2 = __builtin_cpu_supports("avx2");
+        f.fma = __builtin_cpu_supports("fma");
+        f.avx512f = __builtin_cpu_supports("avx512f");
+        f.avx512dq = __builtin_cpu_supports("avx512dq");
+ #endif
+        return f;
+    }();
+    return features;
+ }
+ bool isKernelIsaSupported(KernelIsa isa) {
+    const CpuFeatures& f = getCpuFeatures();
+    switch (isa) {
+        case KernelIsa::SCALAR: return true;
+ #if defined(__x86_64__) || defined(__i386__)
+        case KernelIsa::AVX2: return f.avx2 && f.fma;
+        case KernelIsa::AVX512: return f.avx2 && f.fma && f.avx512f && f.avx512dq;
+ #endif
+        default: return false;
+    }
+ }
+ KernelIsa getBestKernelIsa() {
+    if (isKernelIsaSupported(KernelIsa::AVX512)) return KernelIsa::AVX512;
+    if (isKernelIsaSupported(KernelIsa::AVX2)) return KernelIsa::AVX2;
+    return KernelIsa::SCALAR;
+ }
+ const char* getKernelIsaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::SCALAR: return "scalar";
+        case KernelIsa::AVX2: return "avx2";
+        case KernelIsa::AVX512: return "avx512";
+    }
+    return "unknown";
+ }
+ std::optional<ElementKind> getElementKind(BDIType type) {
+    switch (type) {
+        case BDIType::INT8: case BDIType::UINT8: return ElementKind::I8;
+        case BDIType::INT16: case BDIType::UINT16: return ElementKind::I16;
+        case BDIType::INT32: case BDIType::UINT32: return ElementKind::I32;
+        case BDIType::INT64: case BDIType::UINT64: return ElementKind::I64;
+        case BDIType::FLOAT32: return ElementKind::F32;
+        case BDIType::FLOAT64: return ElementKind::F64;
+        default: return std::nullopt;
+    }
+ }
+ namespace detail {
+ namespace {
+ // --- Scalar Kernels --
+ template <typename T, bool Mul>
+ void scalarBinary(void* dst, const void* lhs, const void* rhs, size_t count) {
+    using A = Arith<T>;
+    // 8/16-bit lanes would promote to int, where a product can overflow
+    using W = std::conditional_t<std::is_integral_v<A>, std::common_type_t<A, unsigned>, A>;
+    auto* d = static_cast<A*>(dst);
+    const auto* a = static_cast<const A*>(lhs);
+    const auto* b = static_cast<const A*>(rhs);
+    for (size_t i = 0; i < count; ++i) d[i] = static_cast<A>(Mul ? W(a[i]) * W(b[i]) : W(a[i]) + W(b[i]));
+ }
+ // Element copies are type-agnostic: dispatch on the element size only
+ template <size_t Size>
+ struct Element {
+    std::byte bytes[Size];
+ };
+ template <size_t Size>
+ void scalarGather(void* dst, const void* src, size_t count, size_t stride) {
+    auto* d = static_cast<Element<Size>*>(dst);
+    const auto* s = static_cast<const Element<Size>*>(src);
+    if (stride == 1) {
+        std::memmove(d, s, count * Size);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) d[i] = s[i * stride];
+ }
+ template <size_t Size>
+ void scalarScatter(void* dst, const void* src, size_t count, size_t stride) {
+    auto* d = static_cast<Element<Size>*>(dst);
+    const auto* s = static_cast<const Element<Size>*>(src);
+    if (stride == 1) {
+        std::memmove(d, s, count * Size);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) d[i * stride] = s[i];
+ }
+ template <size_t Size>
+ void scalarShuffle(void* dst, const void* src, const uint32_t* indices, size_t count) {
+    auto* d = static_cast<Element<Size>*>(dst);
+    const auto* s = static_cast<const Element<Size>*>(src);
+    for (size_t i = 0; i < count; ++i) d[i] = s[indices[i]];
+ }
+ void scalarCopy(void* dst, const void* src, size_t bytes) {
+    std::memmove(dst, src, bytes);
+ }
+ void scalarFill(void* dst, uint64_t pattern, size_t bytes) {
+    auto* d = static_cast<unsigned char*>(dst);
+    size_t i = 0;
+    for (; i + sizeof(pattern) <= bytes; i += sizeof(pattern)) std::memcpy(d + i, &pattern, sizeof(pattern));
+    for (; i < bytes; ++i) d[i] = static_cast<unsigned char>(pattern >> (8 * (i % 8)));
+ }
+ template <typename T>
+ void scalarMatmul(void* c_out, const void* a_in, const void* b_in, size_t m, size_t n, size_t k) {
+    auto* c = static_cast<T*>(c_out);
+    const auto* a = static_cast<const T*>(a_in);
+    const auto* b = static_cast<const T*>(b_in);
+    std::fill(c, c + m * n, T{});
+    // i-k-j order inside each panel: the innermost loop streams one row of B and one row of C
+    for (size_t k0 = 0; k0 < k; k0 += MATMUL_KC) {
+        const size_t k1 = std::min(k, k0 + MATMUL_KC);
+        for (size_t j0 = 0; j0 < n; j0 += MATMUL_NC) {
+            const size_t j1 = std::min(n, j0 + MATMUL_NC);
+            for (size_t i = 0; i < m; ++i) {
+                T* c_row = c + i * n;
+                for (size_t p = k0; p < k1; ++p) {
+                    const T a_ip = a[i * k + p];
+                    const T* b_row = b + p * n;
+                    for (size_t j = j0; j < j1; ++j) c_row[j] += a_ip * b_row[j];
+                }
+            }
+        }
+    }
+ }
+ // Plain complex product; std::complex's operator* goes through the Annex G NaN/inf recovery path
+ template <typename T>
+ inline std::complex<T> cmul(std::complex<T> a, std::complex<T> b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+ }
+ template <typename T>
+ void scalarRadix4(std::complex<T>* data, size_t n, size_t m, const std::complex<T>* w1,
+                   const std::complex<T>* w2, const std::complex<T>* w3, bool inverse) {
+    // Quarters of each 4m block are the bit-reversed sub-transforms x0, x1, x2, x3; x1 pairs with
+    // x0 at twiddle w^2j (first radix-2 level), x2/x3 with w^j / w^3j (second level merged in)
+    for (size_t s = 0; s < n; s += 4 * m) {
+        std::complex<T>* x = data + s;
+        for (size_t j = 0; j < m; ++j) {
+            const std::complex<T> b = cmul(x[j + m], w2[j]);
+            const std::complex<T> c = cmul(x[j + 2 * m], w1[j]);
+            const std::complex<T> d = cmul(x[j + 3 * m], w3[j]);
+            const std::complex<T> p0 = x[j] + b, p1 = x[j] - b;
+            const std::complex<T> q0 = c + d, q1 = c - d;
+            // Multiply q1 by -i (forward) or +i (inverse)
+            const std::complex<T> q1r = inverse ? std::complex<T>(-q1.imag(), q1.real())
+                                                : std::complex<T>(q1.imag(), -q1.real());
+            x[j] = p0 + q0;
+            x[j + 2 * m] = p0 - q0;
+            x[j + m] = p1 + q1r;
+            x[j + 3 * m] = p1 - q1r;
+        }
+    }
+ }
+ template <typename T>
+ bool scalarFft(void* data, size_t count, bool inverse) {
+    return runFft(static_cast<std::complex<T>*>(data), count, inverse, FftStageKernel<T>{});
+ }
+ // Twiddles of every radix-4 stage of an n-point transform, stage after stage: w1[m], w2[m], w3[m]
+ template <typename T>
+ const std::vector<std::complex<T>>& getTwiddles(size_t n, bool inverse) {
+    thread_local std::unordered_map<uint64_t, std::vector<std::complex<T>>> cache;
+    const uint64_t key = (static_cast<uint64_t>(n) << 1) | (inverse ? 1 : 0);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    std::vector<std::complex<T>> twiddles;
+    const unsigned log_n = static_cast<unsigned>(std::countr_zero(n));
+    const double sign = inverse ? 1.0 : -1.0;
+    for (size_t m = (log_n % 2) ? 2 : 1; m < n; m *= 4) {
+        const size_t base = twiddles.size();
+        twiddles.resize(base + 3 * m);
+        for (size_t j = 0; j < m; ++j) {
+            // Computed in double so FLOAT32 transforms are not limited by twiddle error
+            for (size_t r = 1; r <= 3; ++r) {
+                const double angle = sign * 2.0 * std::numbers::pi * static_cast<double>(r * j) / static_cast<double>(4 * m);
+                twiddles[base + (r - 1) * m + j] = {static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle))};
+            }
+        }
+    }
+    return cache.emplace(key, std::move(twiddles)).first->second;
+ }
+ template <typename T>
+ bool runFftImpl(std::complex<T>* data, size_t n, bool inverse, const FftStageKernel<T>& simd) {
+    if (n == 0 || !std::has_single_bit(n)) return false;
+    if (n == 1) return true;
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    const unsigned log_n = static_cast<unsigned>(std::countr_zero(n));
+    size_t m = 1;
+    if (log_n % 2) {
+        // Odd power of two: one radix-2 stage (twiddle 1) first
+        for (size_t s = 0; s < n; s += 2) {
+            const std::complex<T> a = data[s], b = data[s + 1];
+            data[s] = a + b;
+            data[s + 1] = a - b;
+        }
+        m = 2;
+    }
+    const std::complex<T>* tw = getTwiddles<T>(n, inverse).data();
+    for (; m < n; m *= 4) {
+        if (simd.radix4 && m >= simd.min_m) simd.radix4(data, n, m, tw, tw + m, tw + 2 * m, inverse);
+        else scalarRadix4<T>(data, n, m, tw, tw + m, tw + 2 * m, inverse);
+        tw += 3 * m;
+    }
+    if (inverse) {
+        const T scale = T(1) / static_cast<T>(n);
+        for (size_t i = 0; i < n; ++i) data[i] *= scale;
+    }
+    return true;
+ }
+ VectorKernelTable makeScalarTable() {
+    VectorKernelTable t;
+    t.isa = KernelIsa::SCALAR;
+    t.vector_bytes = sizeof(uint64_t);
+    auto setBinary = [&t]<typename T>(ElementKind kind, T) {
+        const size_t k = static_cast<size_t>(kind);
+        t.add[k][0] = t.add[k][1] = &scalarBinary<T, false>;
+        t.mul[k][0] = t.mul[k][1] = &scalarBinary<T, true>;
+    };
+    setBinary(ElementKind::I8, int8_t{});
+    setBinary(ElementKind::I16, int16_t{});
+    setBinary(ElementKind::I32, int32_t{});
+    setBinary(ElementKind::I64, int64_t{});
+    setBinary(ElementKind::F32, float{});
+    setBinary(ElementKind::F64, double{});
+    t.gather[0] = &scalarGather<1>; t.gather[1] = &scalarGather<2>; t.gather[2] = &scalarGather<4>; t.gather[3] = &scalarGather<8>;
+    t.scatter[0] = &scalarScatter<1>; t.scatter[1] = &scalarScatter<2>; t.scatter[2] = &scalarScatter<4>; t.scatter[3] = &scalarScatter<8>;
+    t.shuffle[0] = &scalarShuffle<1>; t.shuffle[1] = &scalarShuffle<2>; t.shuffle[2] = &scalarShuffle<4>; t.shuffle[3] = &scalarShuffle<8>;
+    t.matmul[0] = &scalarMatmul<float>;
+    t.matmul[1] = &scalarMatmul<double>;
+    t.fft[0] = &scalarFft<float>;
+    t.fft[1] = &scalarFft<double>;
+    t.copy = &scalarCopy;
+    t.fill = &scalarFill;
+    return t;
+ }
+ } // namespace
+ bool runFft(std::complex<float>* data, size_t n, bool inverse, const FftStageKernel<float>& simd) {
+    return runFftImpl(data, n, inverse, simd);
+ }
+ bool runFft(std::complex<double>* data, size_t n, bool inverse, const FftStageKernel<double>& simd) {
+    return runFftImpl(data, n, inverse, simd);
+ }
+ const VectorKernelTable& scalarKernelTable() {
+    static const VectorKernelTable table = makeScalarTable();
+    return table;
+ }
+ } // namespace detail
+ // --- Table Selection --
+ const VectorKernelTable& getVectorKernels(KernelIsa isa) {
+ #if defined(__x86_64__) || defined(__i386__)
+    static const VectorKernelTable avx2 = [] {
+        VectorKernelTable t = detail::scalarKernelTable();
+        if (isKernelIsaSupported(KernelIsa::AVX2)) detail::initAvx2KernelTable(t);
+        return t;
+    }();
+    static const VectorKernelTable avx512 = [] {
+        VectorKernelTable t = avx2;
+        if (isKernelIsaSupported(KernelIsa::AVX512)) detail::initAvx512KernelTable(t);
+        return t;
+    }();
+    if (isa == KernelIsa::AVX512 && isKernelIsaSupported(KernelIsa::AVX512)) return avx512;
+    if (isa != KernelIsa::SCALAR && isKernelIsaSupported(KernelIsa::AVX2)) return avx2;
+ #else
+    (void)isa;
+ #endif
+    return detail::scalarKernelTable();
+ }
+ // --- Graph Operations --
+ namespace {
+ // Buffer address or non-negative integer operand
+ bool toUnsigned(const RuntimeValue& value, uint64_t& out) {
+    switch (value.type) {
+        case BDIType::POINTER:
+            out = value.bits;
+            return true;
+        case BDIType::UINT8: case BDIType::UINT16: case BDIType::UINT32: case BDIType::UINT64:
+            out = loadAs<uint64_t>(value);
+            return true;
+        case BDIType::INT8: case BDIType::INT16: case BDIType::INT32: case BDIType::INT64: {
+            const int64_t v = loadAs<int64_t>(value);
+            if (v < 0) return false;
+            out = static_cast<uint64_t>(v);
+            return true;
+        }
+        default:
+            return false;
+    }
+ }
+ // Number of bytes spanned by 'count' elements at 'stride', false on overflow
+ bool spanBytes(uint64_t count, uint64_t stride, size_t element_size, uint64_t& bytes) {
+    if (count == 0) { bytes = 0; return true; }
+    uint64_t last;
+    if (__builtin_mul_overflow(count - 1, stride, &last)) return false;
+    if (__builtin_add_overflow(last, uint64_t{1}, &last)) return false;
+    return !__builtin_mul_overflow(last, static_cast<uint64_t>(element_size), &bytes);
+ }
+ } // namespace
+ bool executeKernelOperation(BDIOperationType op, BDIType element_type, std::span<const RuntimeValue> operands,
+                             const KernelBufferCheck& buffers, const bdi::meta::HardwareHints& hints) {
+    // Every byte of the extent must be the engine's to hand out; empty buffers are never touched
+    auto isBuffer = [&](uint64_t address, uint64_t bytes) {
+        if (bytes == 0) return true;
+        return address != 0 && address + bytes > address && buffers.fn && buffers.fn(buffers.context, address, bytes);
+    };
+    const KernelOperandCount arity = getKernelOperandCount(op);
+    if (arity.max == 0 || operands.size() < arity.required || operands.size() > arity.max) return false;
+    auto kind = getElementKind(element_type);
+    if (!kind) return false;
+    uint64_t v[MAX_KERNEL_OPERANDS] = {};
+    for (size_t k = 0; k < operands.size(); ++k) {
+        if (!toUnsigned(operands[k], v[k])) return false;
+    }
+    const size_t element_size = bdi::core::types::getBdiTypeSize(element_type);
+    const size_t size_index = static_cast<size_t>(std::countr_zero(element_size));
+    const size_t k = static_cast<size_t>(*kind);
+    const VectorKernelTable& table = getVectorKernels(
+        hints.preferred_unit == bdi::meta::ExecutionUnit::CPU_SCALAR ? KernelIsa::SCALAR : getBestKernelIsa());
+    auto ptr = [&](size_t i) { return reinterpret_cast<void*>(static_cast<uintptr_t>(v[i])); };
+    uint64_t bytes = 0;
+    switch (op) {
+        case BDIOperationType::VEC_ADD:
+        case BDIOperationType::VEC_MUL: {
+            const uint64_t count = v[3];
+            if (!spanBytes(count, 1, element_size, bytes) || !isBuffer(v[0], bytes) || !isBuffer(v[1], bytes) ||
+                !isBuffer(v[2], bytes)) {
+                return false;
+            }
+            // A hint promises alignment ahead of time; otherwise use what the pointers actually have
+            const uint64_t alignment = hints.alignment != 0
+                                           ? hints.alignment
+                                           : uint64_t{1} << std::countr_zero(v[0] | v[1] | v[2] | (uint64_t{1} << 12));
+            const int aligned = alignment >= table.vector_bytes ? 1 : 0;
+            BinaryKernel kernel = op == BDIOperationType::VEC_ADD ? table.add[k][aligned] : table.mul[k][aligned];
+            kernel(ptr(0), ptr(1), ptr(2), count);
+            return true;
+        }
+        case BDIOperationType::VEC_LOAD_PACKED:
+        case BDIOperationType::VEC_STORE_PACKED: {
+            const uint64_t count = v[2];
+            const uint64_t stride = operands.size() > 3 ? v[3] : 1;
+            uint64_t packed = 0;
+            if (!spanBytes(count, stride, element_size, bytes) || !spanBytes(count, 1, element_size, packed)) return false;
+            const bool load = op == BDIOperationType::VEC_LOAD_PACKED;
+            if (!isBuffer(v[0], load ? packed : bytes) || !isBuffer(v[1], load ? bytes : packed)) return false;
+            (load ? table.gather : table.scatter)[size_index](ptr(0), ptr(1), count, stride);
+            return true;
+        }
+        case BDIOperationType::VEC_SHUFFLE: {
+            const uint64_t count = v[3], src_count = v[4];
+            uint64_t src_bytes = 0, index_bytes = 0;
+            if (!spanBytes(count, 1, element_size, bytes) || !spanBytes(src_count, 1, element_size, src_bytes) ||
+                !spanBytes(count, 1, sizeof(uint32_t), index_bytes) || !isBuffer(v[0], bytes) ||
+                !isBuffer(v[1], src_bytes) || !isBuffer(v[2], index_bytes)) {
+                return false;
+            }
+            const auto* indices = static_cast<const uint32_t*>(ptr(2));
+            if (count != 0 && *std::max_element(indices, indices + count) >= src_count) return false;
+            // Gather instructions take signed 32-bit indices
+            const ShuffleKernel kernel = src_count <= static_cast<uint64_t>(INT32_MAX)
+                                             ? table.shuffle[size_index]
+                                             : detail::scalarKernelTable().shuffle[size_index];
+            kernel(ptr(0), ptr(1), indices, count);
+            return true;
+        }
+        case BDIOperationType::LINALG_MATMUL: {
+            if (*kind != ElementKind::F32 && *kind != ElementKind::F64) return false;
+            const uint64_t m = v[3], n = v[4], kk = v[5];
+            uint64_t mn = 0, mk = 0, kn = 0, c_bytes = 0, a_bytes = 0, b_bytes = 0;
+            if (__builtin_mul_overflow(m, n, &mn) || __builtin_mul_overflow(m, kk, &mk) || __builtin_mul_overflow(kk, n, &kn) ||
+                !spanBytes(mn, 1, element_size, c_bytes) || !spanBytes(mk, 1, element_size, a_bytes) ||
+                !spanBytes(kn, 1, element_size, b_bytes) || !isBuffer(v[0], c_bytes) || !isBuffer(v[1], a_bytes) ||
+                !isBuffer(v[2], b_bytes)) {
+                return false;
+            }
+            table.matmul[*kind == ElementKind::F64 ? 1 : 0](ptr(0), ptr(1), ptr(2), m, n, kk);
+            return true;
+        }
+        case BDIOperationType::SIGNAL_FFT: {
+            if (*kind != ElementKind::F32 && *kind != ElementKind::F64) return false;
+            const uint64_t count = v[1];
+            if (!spanBytes(count, 1, 2 * element_size, bytes) || !isBuffer(v[0], bytes)) return false;
+            const bool inverse = operands.size() > 2 && v[2] != 0;
+            return table.fft[*kind == ElementKind::F64 ? 1 : 0](ptr(0), count, inverse);
+        }
+        default:
+            return false;
+    }
+ }
+ } // namespace bdi::runtime::kernels
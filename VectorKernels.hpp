@@ -0,0 +1,98 @@
+// File: bdi/runtime/kernels/VectorKernels.hpp
+ #ifndef BDI_RUNTIME_KERNELS_VECTORKERNELS_HPP
+ #define BDI_RUNTIME_KERNELS_VECTORKERNELS_HPP
+ #include "../../core/graph/OperationSignatures.hpp"
+ #include "../../core/types/BDITypes.hpp"
+ #include "../../meta/HardwareHints.hpp"
+ #include "../RuntimeValue.hpp"
+ #include <cstddef>
+ #include <cstdint>
+ #include <optional>
+ #include <span>
+ namespace bdi::runtime::kernels {
+ using bdi::core::graph::BDIOperationType;
+ using bdi::core::types::BDIType;
+ // Instruction sets with a kernel table. AVX2 implies FMA, AVX512 implies F + DQ.
+ enum class KernelIsa : uint8_t { SCALAR, AVX2, AVX512 };
+ struct CpuFeatures {
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+    bool avx512dq = false;
+ };
+ // Detected once per process
+ const CpuFeatures& getCpuFeatures();
+ KernelIsa getBestKernelIsa();
+ bool isKernelIsaSupported(KernelIsa isa);
+ const char* getKernelIsaName(KernelIsa isa);
+ // Element classes the kernels are specialized for (signedness does not matter for wrapping add/mul)
+ enum class ElementKind : uint8_t { I8, I16, I32, I64, F32, F64, COUNT };
+ std::optional<ElementKind> getElementKind(BDIType type);
+ // Kernel signatures. Buffers may overlap only if identical (dst == lhs etc.). Strides are in elements.
+ using BinaryKernel = void (*)(void* dst, const void* lhs, const void* rhs, size_t count);
+ using StridedCopyKernel = void (*)(void* dst, const void* src, size_t count, size_t stride);
+ using ShuffleKernel = void (*)(void* dst, const void* src, const uint32_t* indices, size_t count);
+ // Row-major C[m x n] = A[m x k] * B[k x n]
+ using MatmulKernel = void (*)(void* c, const void* a, const void* b, size_t m, size_t n, size_t k);
+ // In-place FFT of 'count' interleaved complex values (re, im); count must be a power of two.
+ // The inverse transform is scaled by 1/count, so inverse(forward(x)) == x.
+ using FftKernel = bool (*)(void* data, size_t count, bool inverse);
+ // Byte copy with memmove semantics (any overlap is allowed)
+ using CopyKernel = void (*)(void* dst, const void* src, size_t bytes);
+ // Fill 'bytes' bytes with the 8-byte 'pattern' repeated from dst on (little-endian: byte i = pattern byte i % 8)
+ using FillKernel = void (*)(void* dst, uint64_t pattern, size_t bytes);
+ struct VectorKernelTable {
+    KernelIsa isa = KernelIsa::SCALAR;
+    size_t vector_bytes = 0; // Register width; aligned variants need this much buffer alignment
+    static constexpr size_t KIND_COUNT = static_cast<size_t>(ElementKind::COUNT);
+    BinaryKernel add[KIND_COUNT][2] = {}; // [kind][aligned]
+    BinaryKernel mul[KIND_COUNT][2] = {};
+    StridedCopyKernel gather[4] = {};     // [log2(element size)]: packed dst[i] = src[i * stride]
+    StridedCopyKernel scatter[4] = {};    // dst[i * stride] = packed src[i]
+    ShuffleKernel shuffle[4] = {};        // dst[i] = src[indices[i]]
+    MatmulKernel matmul[2] = {};          // [F32, F64]
+    FftKernel fft[2] = {};
+    CopyKernel copy = nullptr;            // Large non-overlapping copies / fills use streaming stores
+    FillKernel fill = nullptr;
+ };
+ // Kernel table for 'isa' (falls back to the best supported ISA below it)
+ const VectorKernelTable& getVectorKernels(KernelIsa isa);
+ inline const VectorKernelTable& getVectorKernels() { return getVectorKernels(getBestKernelIsa()); }
+ // --- Graph Operations --
+ // Operand conventions of the kernel-backed opcodes. Buffer operands are POINTERs into MemoryManager blocks,
+ // counts and strides are integers. The element type is the type of the node's payload, which may be
+ // type-only (no bytes). Operands in brackets are optional.
+ //   VEC_ADD, VEC_MUL    [dst, lhs, rhs, count]
+ //   VEC_LOAD_PACKED     [dst, src, count, (stride = 1)]       packed dst[i] = src[i * stride]
+ //   VEC_STORE_PACKED    [dst, src, count, (stride = 1)]       dst[i * stride] = packed src[i]
+ //   VEC_SHUFFLE         [dst, src, indices, count, src_count] dst[i] = src[indices[i]], UINT32 indices
+ //   LINALG_MATMUL       [c, a, b, m, n, k]                    FLOAT32 / FLOAT64 only
+ //   SIGNAL_FFT          [data, count, (inverse = 0)]          FLOAT32 / FLOAT64 only
+ inline constexpr bool isKernelOperation(BDIOperationType op) {
+    return bdi::core::graph::getOperationSignature(op).has(bdi::core::graph::OP_KERNEL);
+ }
+ // Number of leading operands that must be wired, and the total accepted
+ struct KernelOperandCount {
+    size_t required = 0;
+    size_t max = 0;
+ };
+ inline constexpr KernelOperandCount getKernelOperandCount(BDIOperationType op) {
+    if (!isKernelOperation(op)) return {0, 0};
+    const auto& signature = bdi::core::graph::getOperationSignature(op);
+    return {signature.min_inputs, signature.max_inputs};
+ }
+ inline constexpr size_t MAX_KERNEL_OPERANDS = bdi::core::graph::MAX_SIGNATURE_OPERANDS;
+ // Decides whether a kernel may touch 'bytes' bytes from 'address' (the engine resolves it against its
+ // MemoryManager). Called once per non-empty buffer operand with the extent the operation will access.
+ struct KernelBufferCheck {
+    bool (*fn)(const void* context, uint64_t address, uint64_t bytes) = nullptr; // nullptr: no buffer is valid
+    const void* context = nullptr;
+ };
+ // Run one kernel-backed operation. 'hints' may narrow the ISA (preferred_unit) and promise buffer
+ // alignment; without an alignment hint the actual pointer alignment decides between aligned and
+ // unaligned kernels. Returns false on malformed operands or a buffer 'buffers' rejects (the run fails,
+ // nothing is written).
+ bool executeKernelOperation(BDIOperationType op, BDIType element_type, std::span<const RuntimeValue> operands,
+                             const KernelBufferCheck& buffers, const bdi::meta::HardwareHints& hints = {});
+ } // namespace bdi::runtime::kernels
+ #endif // BDI_RUNTIME_KERNELS_VECTORKERNELS_HPP
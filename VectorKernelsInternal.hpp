@@ -0,0 +1,44 @@
+// File: bdi/runtime/kernels/VectorKernelsInternal.hpp
+ #ifndef BDI_RUNTIME_KERNELS_VECTORKERNELSINTERNAL_HPP
+ #define BDI_RUNTIME_KERNELS_VECTORKERNELSINTERNAL_HPP
+ // Shared between the kernel translation units; not part of the public API.
+ #include "VectorKernels.hpp"
+ #include <complex>
+ #include <type_traits>
+ namespace bdi::runtime::kernels::detail {
+ // Integer arithmetic wraps like OperationSemantics (computed unsigned); floats are used as is
+ template <typename T, bool = std::is_integral_v<T>>
+ struct ArithType { using type = T; };
+ template <typename T>
+ struct ArithType<T, true> { using type = std::make_unsigned_t<T>; };
+ template <typename T>
+ using Arith = typename ArithType<T>::type;
+ // Cache blocking of LINALG_MATMUL: a KC x NC panel of B (128 KiB of float) stays in L2 while every
+ // row block of A streams over it
+ inline constexpr size_t MATMUL_KC = 128;
+ inline constexpr size_t MATMUL_NC = 256;
+ // Copies and fills of at least this many bytes bypass the cache with non-temporal stores: the data would
+ // evict more than a core's share of the last-level cache and is unlikely to be read back soon
+ inline constexpr size_t STREAMING_STORE_BYTES = size_t{4} << 20;
+ // One radix-4 decimation-in-time stage over 'n' points, combining sub-transforms of size m.
+ // w1/w2/w3 hold the stage twiddles w^j, w^2j, w^3j for j < m.
+ template <typename T>
+ using FftRadix4Stage = void (*)(std::complex<T>* data, size_t n, size_t m, const std::complex<T>* w1,
+                                 const std::complex<T>* w2, const std::complex<T>* w3, bool inverse);
+ // SIMD stage kernel plus the smallest m it handles (smaller stages run the scalar kernel)
+ template <typename T>
+ struct FftStageKernel {
+    FftRadix4Stage<T> radix4 = nullptr;
+    size_t min_m = 0;
+ };
+ // Bit reversal, one radix-2 stage when log2(n) is odd, then radix-4 stages; twiddles are cached per thread
+ bool runFft(std::complex<float>* data, size_t n, bool inverse, const FftStageKernel<float>& simd);
+ bool runFft(std::complex<double>* data, size_t n, bool inverse, const FftStageKernel<double>& simd);
+ const VectorKernelTable& scalarKernelTable();
+ #if defined(__x86_64__) || defined(__i386__)
+ // Defined in VectorKernelsX86.cpp; start from a copy of the next lower table and override entries
+ void initAvx2KernelTable(VectorKernelTable& table);
+ void initAvx512KernelTable(VectorKernelTable& table);
+ #endif
+ } // namespace bdi::runtime::kernels::detail
+ #endif // BDI_RUNTIME_KERNELS_VECTORKERNELSINTERNAL_HPP
@@ -0,0 +1,200 @@
+// File: bdi/runtime/kernels/VectorKernelsSimd.inl
+ // ISA-generic SIMD kernel bodies. Included once per instruction set by VectorKernelsX86.cpp, inside a
+ // target region and a namespace that defines the register traits used below:
+ //   float traits: T, R, W, MATMUL_ROWS, load<Aligned>, store<Aligned>, set1, add, sub, fmadd,
+ //                 cmul (interleaved complex multiply), mulNegI, mulPosI
+ //   int traits:   T, R, W, load<Aligned>, store<Aligned>, add, mul (only if HAS_MUL)
+ //   VBytes:       R, W (bytes), load, store (unaligned), stream (aligned, non-temporal), set1 (64-bit pattern)
+ // Compiling the same text under each target keeps AVX-512 instructions out of the AVX2 kernels.
+ template <typename V, bool Aligned, bool Mul>
+ void binaryKernel(void* dst, const void* lhs, const void* rhs, size_t count) {
+    using T = typename V::T;
+    auto* d = static_cast<T*>(dst);
+    const auto* a = static_cast<const T*>(lhs);
+    const auto* b = static_cast<const T*>(rhs);
+    size_t i = 0;
+    for (; i + 2 * V::W <= count; i += 2 * V::W) {
+        auto x0 = V::template load<Aligned>(a + i), x1 = V::template load<Aligned>(a + i + V::W);
+        auto y0 = V::template load<Aligned>(b + i), y1 = V::template load<Aligned>(b + i + V::W);
+        if constexpr (Mul) {
+            V::template store<Aligned>(d + i, V::mul(x0, y0));
+            V::template store<Aligned>(d + i + V::W, V::mul(x1, y1));
+        } else {
+            V::template store<Aligned>(d + i, V::add(x0, y0));
+            V::template store<Aligned>(d + i + V::W, V::add(x1, y1));
+        }
+    }
+    for (; i + V::W <= count; i += V::W) {
+        auto x = V::template load<Aligned>(a + i), y = V::template load<Aligned>(b + i);
+        if constexpr (Mul) V::template store<Aligned>(d + i, V::mul(x, y));
+        else V::template store<Aligned>(d + i, V::add(x, y));
+    }
+    // Tail (integers wrap, as in the scalar kernels)
+    using A = detail::Arith<T>;
+    for (; i < count; ++i) {
+        const A x = static_cast<A>(a[i]), y = static_cast<A>(b[i]);
+        d[i] = static_cast<T>(static_cast<A>(Mul ? x * y : x + y));
+    }
+ }
+ // Rows x (Cols * W) tile of C += A[rows, kc] * B[kc, cols]; accumulators stay in registers
+ template <typename V, size_t Rows, size_t Cols>
+ inline void matmulTile(typename V::T* c, size_t ldc, const typename V::T* a, size_t lda,
+                        const typename V::T* b, size_t ldb, size_t kc) {
+    typename V::R acc[Rows][Cols];
+    for (size_t r = 0; r < Rows; ++r) {
+        for (size_t q = 0; q < Cols; ++q) acc[r][q] = V::template load<false>(c + r * ldc + q * V::W);
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        typename V::R bv[Cols];
+        for (size_t q = 0; q < Cols; ++q) bv[q] = V::template load<false>(b + p * ldb + q * V::W);
+        for (size_t r = 0; r < Rows; ++r) {
+            const typename V::R av = V::set1(a[r * lda + p]);
+            for (size_t q = 0; q < Cols; ++q) acc[r][q] = V::fmadd(av, bv[q], acc[r][q]);
+        }
+    }
+    for (size_t r = 0; r < Rows; ++r) {
+        for (size_t q = 0; q < Cols; ++q) V::template store<false>(c + r * ldc + q * V::W, acc[r][q]);
+    }
+ }
+ // All column tiles of one row block inside the current (kc x [j0, j1)) panel
+ template <typename V, size_t Rows>
+ inline void matmulRowBlock(typename V::T* c, size_t n, const typename V::T* a, size_t k,
+                            const typename V::T* b, size_t j0, size_t j1, size_t kc) {
+    size_t j = j0;
+    for (; j + 2 * V::W <= j1; j += 2 * V::W) matmulTile<V, Rows, 2>(c + j, n, a, k, b + j, n, kc);
+    for (; j + V::W <= j1; j += V::W) matmulTile<V, Rows, 1>(c + j, n, a, k, b + j, n, kc);
+    for (; j < j1; ++j) {
+        for (size_t r = 0; r < Rows; ++r) {
+            typename V::T sum = c[r * n + j];
+            for (size_t p = 0; p < kc; ++p) sum += a[r * k + p] * b[p * n + j];
+            c[r * n + j] = sum;
+        }
+    }
+ }
+ template <typename V>
+ void matmulKernel(void* c_out, const void* a_in, const void* b_in, size_t m, size_t n, size_t k) {
+    using T = typename V::T;
+    auto* c = static_cast<T*>(c_out);
+    const auto* a = static_cast<const T*>(a_in);
+    const auto* b = static_cast<const T*>(b_in);
+    std::fill(c, c + m * n, T{});
+    for (size_t k0 = 0; k0 < k; k0 += detail::MATMUL_KC) {
+        const size_t kc = std::min(detail::MATMUL_KC, k - k0);
+        for (size_t j0 = 0; j0 < n; j0 += detail::MATMUL_NC) {
+            const size_t j1 = std::min(n, j0 + detail::MATMUL_NC);
+            const T* b_panel = b + k0 * n;
+            size_t i = 0;
+            for (; i + V::MATMUL_ROWS <= m; i += V::MATMUL_ROWS) {
+                matmulRowBlock<V, V::MATMUL_ROWS>(c + i * n, n, a + i * k + k0, k, b_panel, j0, j1, kc);
+            }
+            for (; i < m; ++i) matmulRowBlock<V, 1>(c + i * n, n, a + i * k + k0, k, b_panel, j0, j1, kc);
+        }
+    }
+ }
+ // Radix-4 stage vectorized across j (see detail::scalarRadix4 for the butterfly); m >= W / 2
+ template <typename V, bool Inverse>
+ void fftRadix4Body(std::complex<typename V::T>* data, size_t n, size_t m, const std::complex<typename V::T>* w1,
+                    const std::complex<typename V::T>* w2, const std::complex<typename V::T>* w3) {
+    using T = typename V::T;
+    constexpr size_t kComplexPerVector = V::W / 2;
+    const T* t1 = reinterpret_cast<const T*>(w1);
+    const T* t2 = reinterpret_cast<const T*>(w2);
+    const T* t3 = reinterpret_cast<const T*>(w3);
+    for (size_t s = 0; s < n; s += 4 * m) {
+        T* x0 = reinterpret_cast<T*>(data + s);
+        T* x1 = x0 + 2 * m;
+        T* x2 = x0 + 4 * m;
+        T* x3 = x0 + 6 * m;
+        for (size_t j = 0; j < 2 * m; j += 2 * kComplexPerVector) {
+            const auto a0 = V::template load<false>(x0 + j);
+            const auto b = V::cmul(V::template load<false>(x1 + j), V::template load<false>(t2 + j));
+            const auto c = V::cmul(V::template load<false>(x2 + j), V::template load<false>(t1 + j));
+            const auto d = V::cmul(V::template load<false>(x3 + j), V::template load<false>(t3 + j));
+            const auto p0 = V::add(a0, b), p1 = V::sub(a0, b);
+            const auto q0 = V::add(c, d);
+            const auto q1 = Inverse ? V::mulPosI(V::sub(c, d)) : V::mulNegI(V::sub(c, d));
+            V::template store<false>(x0 + j, V::add(p0, q0));
+            V::template store<false>(x2 + j, V::sub(p0, q0));
+            V::template store<false>(x1 + j, V::add(p1, q1));
+            V::template store<false>(x3 + j, V::sub(p1, q1));
+        }
+    }
+ }
+ template <typename V>
+ void fftRadix4(std::complex<typename V::T>* data, size_t n, size_t m, const std::complex<typename V::T>* w1,
+                const std::complex<typename V::T>* w2, const std::complex<typename V::T>* w3, bool inverse) {
+    if (inverse) fftRadix4Body<V, true>(data, n, m, w1, w2, w3);
+    else fftRadix4Body<V, false>(data, n, m, w1, w2, w3);
+ }
+ template <typename V>
+ bool fftKernel(void* data, size_t count, bool inverse) {
+    using T = typename V::T;
+    return detail::runFft(static_cast<std::complex<T>*>(data), count, inverse,
+                          detail::FftStageKernel<T>{&fftRadix4<V>, V::W / 2});
+ }
+ // Byte copy: four registers per iteration, the last partial register re-copies bytes already written.
+ // Large copies align the destination and store around the cache.
+ template <typename V>
+ void copyKernel(void* dst, const void* src, size_t bytes) {
+    auto* d = static_cast<unsigned char*>(dst);
+    const auto* s = static_cast<const unsigned char*>(src);
+    if (bytes < V::W || (d < s + bytes && s < d + bytes)) return scalarKernelTable().copy(dst, src, bytes);
+    size_t i = 0;
+    const bool streaming = bytes >= detail::STREAMING_STORE_BYTES;
+    if (streaming) {
+        V::store(d, V::load(s));
+        i = V::W - (reinterpret_cast<uintptr_t>(d) & (V::W - 1));
+        for (; i + 4 * V::W <= bytes; i += 4 * V::W) {
+            const auto x0 = V::load(s + i), x1 = V::load(s + i + V::W);
+            const auto x2 = V::load(s + i + 2 * V::W), x3 = V::load(s + i + 3 * V::W);
+            V::stream(d + i, x0);
+            V::stream(d + i + V::W, x1);
+            V::stream(d + i + 2 * V::W, x2);
+            V::stream(d + i + 3 * V::W, x3);
+        }
+        _mm_sfence(); // Order the streaming stores before the cached tail and anything after the copy
+    }
+    for (; i + 4 * V::W <= bytes; i += 4 * V::W) {
+        const auto x0 = V::load(s + i), x1 = V::load(s + i + V::W);
+        const auto x2 = V::load(s + i + 2 * V::W), x3 = V::load(s + i + 3 * V::W);
+        V::store(d + i, x0);
+        V::store(d + i + V::W, x1);
+        V::store(d + i + 2 * V::W, x2);
+        V::store(d + i + 3 * V::W, x3);
+    }
+    for (; i + V::W <= bytes; i += V::W) V::store(d + i, V::load(s + i));
+    if (i < bytes) V::store(d + bytes - V::W, V::load(s + bytes - V::W));
+ }
+ // Pattern fill; a store starting at byte offset 'at' needs the pattern rotated by at % 8 bytes
+ template <typename V>
+ void fillKernel(void* dst, uint64_t pattern, size_t bytes) {
+    auto* d = static_cast<unsigned char*>(dst);
+    if (bytes < V::W) return scalarKernelTable().fill(dst, pattern, bytes);
+    auto rotated = [pattern](size_t at) { return V::set1(std::rotr(pattern, static_cast<int>(8 * (at % 8)))); };
+    size_t i = 0;
+    auto value = V::set1(pattern);
+    if (bytes >= detail::STREAMING_STORE_BYTES) {
+        V::store(d, value);
+        i = V::W - (reinterpret_cast<uintptr_t>(d) & (V::W - 1));
+        value = rotated(i); // i % 8 is the same for every later (aligned) store
+        for (; i + 4 * V::W <= bytes; i += 4 * V::W) {
+            V::stream(d + i, value);
+            V::stream(d + i + V::W, value);
+            V::stream(d + i + 2 * V::W, value);
+            V::stream(d + i + 3 * V::W, value);
+        }
+        _mm_sfence();
+    }
+    for (; i + V::W <= bytes; i += V::W) V::store(d + i, value);
+    if (i < bytes) V::store(d + bytes - V::W, rotated(bytes - V::W));
+ }
+ template <typename V>
+ void setBinaryKernels(VectorKernelTable& table, ElementKind kind) {
+    const size_t k = static_cast<size_t>(kind);
+    table.add[k][0] = &binaryKernel<V, false, false>;
+    table.add[k][1] = &binaryKernel<V, true, false>;
+    if constexpr (V::HAS_MUL) {
+        table.mul[k][0] = &binaryKernel<V, false, true>;
+        table.mul[k][1] = &binaryKernel<V, true, true>;
+    }
+ }
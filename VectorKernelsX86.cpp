@@ -0,0 +1,346 @@
+// File: bdi/runtime/kernels/VectorKernelsX86.cpp
+ #include "VectorKernelsInternal.hpp"
+ #if defined(__x86_64__) || defined(__i386__)
+ #include <immintrin.h>
+ #include <algorithm>
+ #include <bit>
+ #include <climits>
+ #include <complex>
+ #include <type_traits>
+ // Every function in a target region is compiled for that ISA only; callers reach them exclusively
+ // through the tables, which getVectorKernels() hands out after checking CPU support.
+ #if defined(__clang__)
+ #define BDI_TARGET_REGION_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2,fma\"))), apply_to = function)")
+ #define BDI_TARGET_REGION_AVX512 _Pragma("clang attribute push(__attribute__((target(\"avx512f,avx512dq,avx2,fma\"))), apply_to = function)")
+ #define BDI_TARGET_REGION_END _Pragma("clang attribute pop")
+ #else
+ #define BDI_TARGET_REGION_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+ #define BDI_TARGET_REGION_AVX512 _Pragma("GCC push_options") _Pragma("GCC target(\"avx512f,avx512dq,avx2,fma\")")
+ #define BDI_TARGET_REGION_END _Pragma("GCC pop_options")
+ #endif
+ namespace bdi::runtime::kernels::detail {
+ // ============================================================================
+ // AVX2 + FMA
+ // ============================================================================
+ BDI_TARGET_REGION_AVX2
+ namespace avx2 {
+ struct VF32 {
+    using T = float;
+    using R = __m256;
+    static constexpr size_t W = 8;
+    static constexpr size_t MATMUL_ROWS = 6; // 6 x 16 tile: 12 accumulators + 2 B + 1 A of 16 ymm
+    static constexpr bool HAS_MUL = true;
+    template <bool A> static R load(const T* p) { if constexpr (A) return _mm256_load_ps(p); else return _mm256_loadu_ps(p); }
+    template <bool A> static void store(T* p, R v) { if constexpr (A) _mm256_store_ps(p, v); else _mm256_storeu_ps(p, v); }
+    static R set1(T v) { return _mm256_set1_ps(v); }
+    static R add(R a, R b) { return _mm256_add_ps(a, b); }
+    static R sub(R a, R b) { return _mm256_sub_ps(a, b); }
+    static R mul(R a, R b) { return _mm256_mul_ps(a, b); }
+    static R fmadd(R a, R b, R c) { return _mm256_fmadd_ps(a, b, c); }
+    // (ar, ai) * (wr, wi): even lanes ar*wr - ai*wi, odd lanes ai*wr + ar*wi
+    static R cmul(R a, R w) {
+        const R t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(w));
+        return _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(w), t);
+    }
+    // (re, im) * -i = (im, -re); * +i = (-im, re)
+    static R mulNegI(R a) { return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), _mm256_setr_ps(0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f)); }
+    static R mulPosI(R a) { return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), _mm256_setr_ps(-0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f)); }
+ };
+ struct VF64 {
+    using T = double;
+    using R = __m256d;
+    static constexpr size_t W = 4;
+    static constexpr size_t MATMUL_ROWS = 6;
+    static constexpr bool HAS_MUL = true;
+    template <bool A> static R load(const T* p) { if constexpr (A) return _mm256_load_pd(p); else return _mm256_loadu_pd(p); }
+    template <bool A> static void store(T* p, R v) { if constexpr (A) _mm256_store_pd(p, v); else _mm256_storeu_pd(p, v); }
+    static R set1(T v) { return _mm256_set1_pd(v); }
+    static R add(R a, R b) { return _mm256_add_pd(a, b); }
+    static R sub(R a, R b) { return _mm256_sub_pd(a, b); }
+    static R mul(R a, R b) { return _mm256_mul_pd(a, b); }
+    static R fmadd(R a, R b, R c) { return _mm256_fmadd_pd(a, b, c); }
+    static R cmul(R a, R w) {
+        const R t = _mm256_mul_pd(_mm256_permute_pd(a, 0x5), _mm256_permute_pd(w, 0xF));
+        return _mm256_fmaddsub_pd(a, _mm256_movedup_pd(w), t);
+    }
+    static R mulNegI(R a) { return _mm256_xor_pd(_mm256_permute_pd(a, 0x5), _mm256_setr_pd(0.0, -0.0, 0.0, -0.0)); }
+    static R mulPosI(R a) { return _mm256_xor_pd(_mm256_permute_pd(a, 0x5), _mm256_setr_pd(-0.0, 0.0, -0.0, 0.0)); }
+ };
+ // Integer lanes; 'Mul' selects the multiply instruction, if the ISA has one for this width
+ template <typename Elem, __m256i (*Add)(__m256i, __m256i), __m256i (*Mul)(__m256i, __m256i)>
+ struct VInt {
+    using T = Elem;
+    using R = __m256i;
+    static constexpr size_t W = 32 / sizeof(T);
+    static constexpr bool HAS_MUL = Mul != nullptr;
+    template <bool A> static R load(const T* p) {
+        if constexpr (A) return _mm256_load_si256(reinterpret_cast<const R*>(p));
+        else return _mm256_loadu_si256(reinterpret_cast<const R*>(p));
+    }
+    template <bool A> static void store(T* p, R v) {
+        if constexpr (A) _mm256_store_si256(reinterpret_cast<R*>(p), v);
+        else _mm256_storeu_si256(reinterpret_cast<R*>(p), v);
+    }
+    static R add(R a, R b) { return Add(a, b); }
+    static R mul(R a, R b) { return Mul(a, b); }
+ };
+ inline __m256i add8(__m256i a, __m256i b) { return _mm256_add_epi8(a, b); }
+ inline __m256i add16(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+ inline __m256i add32(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+ inline __m256i add64(__m256i a, __m256i b) { return _mm256_add_epi64(a, b); }
+ inline __m256i mul16(__m256i a, __m256i b) { return _mm256_mullo_epi16(a, b); }
+ inline __m256i mul32(__m256i a, __m256i b) { return _mm256_mullo_epi32(a, b); }
+ using VI8 = VInt<int8_t, &add8, nullptr>;
+ using VI16 = VInt<int16_t, &add16, &mul16>;
+ using VI32 = VInt<int32_t, &add32, &mul32>;
+ using VI64 = VInt<int64_t, &add64, nullptr>;
+ struct VBytes {
+    using R = __m256i;
+    static constexpr size_t W = 32;
+    static R load(const void* p) { return _mm256_loadu_si256(static_cast<const R*>(p)); }
+    static void store(void* p, R v) { _mm256_storeu_si256(static_cast<R*>(p), v); }
+    static void stream(void* p, R v) { _mm256_stream_si256(static_cast<R*>(p), v); }
+    static R set1(uint64_t v) { return _mm256_set1_epi64x(static_cast<long long>(v)); }
+ };
+ #include "VectorKernelsSimd.inl"
+ // Strided copies of 4- and 8-byte elements through the gather unit; other sizes stay scalar
+ constexpr size_t kMaxGatherStride = INT32_MAX / 8; // Lane offsets are signed 32-bit element indices
+ void gather4(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().gather[2](dst, src, count, stride);
+    auto* d = static_cast<int32_t*>(dst);
+    const auto* s = static_cast<const int32_t*>(src);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_i32gather_epi32(s + i * stride, lanes, 4));
+    }
+    for (; i < count; ++i) d[i] = s[i * stride];
+ }
+ void gather8(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().gather[3](dst, src, count, stride);
+    auto* d = static_cast<long long*>(dst);
+    const auto* s = static_cast<const long long*>(src);
+    const __m128i lanes = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_i32gather_epi64(s + i * stride, lanes, 8));
+    }
+    for (; i < count; ++i) d[i] = s[i * stride];
+ }
+ void shuffle4(void* dst, const void* src, const uint32_t* indices, size_t count) {
+    auto* d = static_cast<int32_t*>(dst);
+    const auto* s = static_cast<const int32_t*>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_i32gather_epi32(s, idx, 4));
+    }
+    for (; i < count; ++i) d[i] = s[indices[i]];
+ }
+ void shuffle8(void* dst, const void* src, const uint32_t* indices, size_t count) {
+    auto* d = static_cast<long long*>(dst);
+    const auto* s = static_cast<const long long*>(src);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_i32gather_epi64(s, idx, 8));
+    }
+    for (; i < count; ++i) d[i] = s[indices[i]];
+ }
+ } // namespace avx2
+ void initAvx2KernelTable(VectorKernelTable& t) {
+    using namespace avx2;
+    t.isa = KernelIsa::AVX2;
+    t.vector_bytes = 32;
+    setBinaryKernels<VI8>(t, ElementKind::I8);
+    setBinaryKernels<VI16>(t, ElementKind::I16);
+    setBinaryKernels<VI32>(t, ElementKind::I32);
+    setBinaryKernels<VI64>(t, ElementKind::I64);
+    setBinaryKernels<VF32>(t, ElementKind::F32);
+    setBinaryKernels<VF64>(t, ElementKind::F64);
+    t.gather[2] = &gather4;
+    t.gather[3] = &gather8;
+    t.shuffle[2] = &shuffle4;
+    t.shuffle[3] = &shuffle8;
+    t.matmul[0] = &matmulKernel<VF32>;
+    t.matmul[1] = &matmulKernel<VF64>;
+    t.fft[0] = &fftKernel<VF32>;
+    t.fft[1] = &fftKernel<VF64>;
+    t.copy = &copyKernel<VBytes>;
+    t.fill = &fillKernel<VBytes>;
+ }
+ BDI_TARGET_REGION_END
+ // ============================================================================
+ // AVX-512 F + DQ (8- and 16-bit integer lanes keep the AVX2 kernels: they would need BW)
+ // ============================================================================
+ BDI_TARGET_REGION_AVX512
+ namespace avx512 {
+ // GCC 12 expands the unmasked permute, dup and gather intrinsics through _mm512_undefined_*(), which
+ // -Wmaybe-uninitialized flags; the all-lanes masked forms over zero emit the same instructions
+ template <int C> inline __m512 permutePs(__m512 a) { return _mm512_maskz_permute_ps(0xFFFF, a, C); }
+ template <int C> inline __m512d permutePd(__m512d a) { return _mm512_maskz_permute_pd(0xFF, a, C); }
+ inline __m512 dupOddPs(__m512 a) { return _mm512_maskz_movehdup_ps(0xFFFF, a); }
+ inline __m512 dupEvenPs(__m512 a) { return _mm512_maskz_moveldup_ps(0xFFFF, a); }
+ inline __m512d dupEvenPd(__m512d a) { return _mm512_maskz_movedup_pd(0xFF, a); }
+ inline __m512i gather32(__m512i offsets, const void* base) {
+    return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, offsets, base, 4);
+ }
+ inline __m512i gather64(__m256i offsets, const void* base) {
+    return _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), 0xFF, offsets, base, 8);
+ }
+ struct VF32 {
+    using T = float;
+    using R = __m512;
+    static constexpr size_t W = 16;
+    static constexpr size_t MATMUL_ROWS = 8; // 8 x 32 tile: 16 accumulators of 32 zmm
+    static constexpr bool HAS_MUL = true;
+    template <bool A> static R load(const T* p) { if constexpr (A) return _mm512_load_ps(p); else return _mm512_loadu_ps(p); }
+    template <bool A> static void store(T* p, R v) { if constexpr (A) _mm512_store_ps(p, v); else _mm512_storeu_ps(p, v); }
+    static R set1(T v) { return _mm512_set1_ps(v); }
+    static R add(R a, R b) { return _mm512_add_ps(a, b); }
+    static R sub(R a, R b) { return _mm512_sub_ps(a, b); }
+    static R mul(R a, R b) { return _mm512_mul_ps(a, b); }
+    static R fmadd(R a, R b, R c) { return _mm512_fmadd_ps(a, b, c); }
+    static R cmul(R a, R w) {
+        const R t = _mm512_mul_ps(permutePs<0xB1>(a), dupOddPs(w));
+        return _mm512_fmaddsub_ps(a, dupEvenPs(w), t);
+    }
+    static R signMask(bool odd) {
+        return _mm512_castsi512_ps(_mm512_set1_epi64(odd ? int64_t(0x8000000000000000ull) : int64_t(0x80000000ull)));
+    }
+    static R mulNegI(R a) { return _mm512_xor_ps(permutePs<0xB1>(a), signMask(true)); }
+    static R mulPosI(R a) { return _mm512_xor_ps(permutePs<0xB1>(a), signMask(false)); }
+ };
+ struct VF64 {
+    using T = double;
+    using R = __m512d;
+    static constexpr size_t W = 8;
+    static constexpr size_t MATMUL_ROWS = 8;
+    static constexpr bool HAS_MUL = true;
+    template <bool A> static R load(const T* p) { if constexpr (A) return _mm512_load_pd(p); else return _mm512_loadu_pd(p); }
+    template <bool A> static void store(T* p, R v) { if constexpr (A) _mm512_store_pd(p, v); else _mm512_storeu_pd(p, v); }
+    static R set1(T v) { return _mm512_set1_pd(v); }
+    static R add(R a, R b) { return _mm512_add_pd(a, b); }
+    static R sub(R a, R b) { return _mm512_sub_pd(a, b); }
+    static R mul(R a, R b) { return _mm512_mul_pd(a, b); }
+    static R fmadd(R a, R b, R c) { return _mm512_fmadd_pd(a, b, c); }
+    static R cmul(R a, R w) {
+        const R t = _mm512_mul_pd(permutePd<0x55>(a), permutePd<0xFF>(w));
+        return _mm512_fmaddsub_pd(a, dupEvenPd(w), t);
+    }
+    static R signMask(bool odd) {
+        return _mm512_castsi512_pd(odd ? _mm512_set_epi64(INT64_MIN, 0, INT64_MIN, 0, INT64_MIN, 0, INT64_MIN, 0)
+                                       : _mm512_set_epi64(0, INT64_MIN, 0, INT64_MIN, 0, INT64_MIN, 0, INT64_MIN));
+    }
+    static R mulNegI(R a) { return _mm512_xor_pd(permutePd<0x55>(a), signMask(true)); }
+    static R mulPosI(R a) { return _mm512_xor_pd(permutePd<0x55>(a), signMask(false)); }
+ };
+ template <typename Elem, __m512i (*Add)(__m512i, __m512i), __m512i (*Mul)(__m512i, __m512i)>
+ struct VInt {
+    using T = Elem;
+    using R = __m512i;
+    static constexpr size_t W = 64 / sizeof(T);
+    static constexpr bool HAS_MUL = Mul != nullptr;
+    template <bool A> static R load(const T* p) { if constexpr (A) return _mm512_load_si512(p); else return _mm512_loadu_si512(p); }
+    template <bool A> static void store(T* p, R v) { if constexpr (A) _mm512_store_si512(p, v); else _mm512_storeu_si512(p, v); }
+    static R add(R a, R b) { return Add(a, b); }
+    static R mul(R a, R b) { return Mul(a, b); }
+ };
+ inline __m512i add32(__m512i a, __m512i b) { return _mm512_add_epi32(a, b); }
+ inline __m512i add64(__m512i a, __m512i b) { return _mm512_add_epi64(a, b); }
+ inline __m512i mul32(__m512i a, __m512i b) { return _mm512_mullo_epi32(a, b); }
+ inline __m512i mul64(__m512i a, __m512i b) { return _mm512_mullo_epi64(a, b); }
+ using VI32 = VInt<int32_t, &add32, &mul32>;
+ using VI64 = VInt<int64_t, &add64, &mul64>;
+ struct VBytes {
+    using R = __m512i;
+    static constexpr size_t W = 64;
+    static R load(const void* p) { return _mm512_loadu_si512(p); }
+    static void store(void* p, R v) { _mm512_storeu_si512(p, v); }
+    static void stream(void* p, R v) { _mm512_stream_si512(static_cast<R*>(p), v); }
+    static R set1(uint64_t v) { return _mm512_set1_epi64(static_cast<long long>(v)); }
+ };
+ #include "VectorKernelsSimd.inl"
+ constexpr size_t kMaxGatherStride = INT32_MAX / 16;
+ void gather4(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().gather[2](dst, src, count, stride);
+    auto* d = static_cast<int32_t*>(dst);
+    const auto* s = static_cast<const int32_t*>(src);
+    const __m512i lanes = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                             _mm512_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) _mm512_storeu_si512(d + i, gather32(lanes, s + i * stride));
+    for (; i < count; ++i) d[i] = s[i * stride];
+ }
+ void gather8(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().gather[3](dst, src, count, stride);
+    auto* d = static_cast<int64_t*>(dst);
+    const auto* s = static_cast<const int64_t*>(src);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) _mm512_storeu_si512(d + i, gather64(lanes, s + i * stride));
+    for (; i < count; ++i) d[i] = s[i * stride];
+ }
+ void scatter4(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().scatter[2](dst, src, count, stride);
+    auto* d = static_cast<int32_t*>(dst);
+    const auto* s = static_cast<const int32_t*>(src);
+    const __m512i lanes = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                             _mm512_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) _mm512_i32scatter_epi32(d + i * stride, lanes, _mm512_loadu_si512(s + i), 4);
+    for (; i < count; ++i) d[i * stride] = s[i];
+ }
+ void scatter8(void* dst, const void* src, size_t count, size_t stride) {
+    if (stride == 1 || stride > kMaxGatherStride) return scalarKernelTable().scatter[3](dst, src, count, stride);
+    auto* d = static_cast<int64_t*>(dst);
+    const auto* s = static_cast<const int64_t*>(src);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) _mm512_i32scatter_epi64(d + i * stride, lanes, _mm512_loadu_si512(s + i), 8);
+    for (; i < count; ++i) d[i * stride] = s[i];
+ }
+ void shuffle4(void* dst, const void* src, const uint32_t* indices, size_t count) {
+    auto* d = static_cast<int32_t*>(dst);
+    const auto* s = static_cast<const int32_t*>(src);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) _mm512_storeu_si512(d + i, gather32(_mm512_loadu_si512(indices + i), s));
+    for (; i < count; ++i) d[i] = s[indices[i]];
+ }
+ void shuffle8(void* dst, const void* src, const uint32_t* indices, size_t count) {
+    auto* d = static_cast<int64_t*>(dst);
+    const auto* s = static_cast<const int64_t*>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        _mm512_storeu_si512(d + i, gather64(idx, s));
+    }
+    for (; i < count; ++i) d[i] = s[indices[i]];
+ }
+ } // namespace avx512
+ void initAvx512KernelTable(VectorKernelTable& t) {
+    using namespace avx512;
+    t.isa = KernelIsa::AVX512;
+    t.vector_bytes = 64;
+    // I8 / I16 keep the AVX2 entries; their aligned variants only need 32-byte alignment, which
+    // 64-byte-aligned buffers satisfy
+    setBinaryKernels<VI32>(t, ElementKind::I32);
+    setBinaryKernels<VI64>(t, ElementKind::I64);
+    setBinaryKernels<VF32>(t, ElementKind::F32);
+    setBinaryKernels<VF64>(t, ElementKind::F64);
+    t.gather[2] = &gather4;
+    t.gather[3] = &gather8;
+    t.scatter[2] = &scatter4;
+    t.scatter[3] = &scatter8;
+    t.shuffle[2] = &shuffle4;
+    t.shuffle[3] = &shuffle8;
+    t.matmul[0] = &matmulKernel<VF32>;
+    t.matmul[1] = &matmulKernel<VF64>;
+    t.fft[0] = &fftKernel<VF32>;
+    t.fft[1] = &fftKernel<VF64>;
+    t.copy = &copyKernel<VBytes>;
+    t.fill = &fillKernel<VBytes>;
+ }
+ BDI_TARGET_REGION_END
+ } // namespace bdi::runtime::kernels::detail
+ #endif // x86
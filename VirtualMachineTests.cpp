@@ -0,0 +1,255 @@
+// File: bdi/tests/VirtualMachineTests.cpp
+ // BDIVirtualMachine node semantics that reach outside the graph: proofs, memory, locks; incremental runs
+ #include "TestSupport.hpp"
+ #include "../benchmarks/GraphGenerators.hpp"
+ #include "../meta/MetadataStore.hpp"
+ #include "../runtime/BDIVirtualMachine.hpp"
+ #include "../runtime/memory/MemoryManager.hpp"
+ using namespace bdi::tests;
+ using bdi::meta::MetadataStore;
+ using bdi::meta::ProofTag;
+ using bdi::runtime::BDIVirtualMachine;
+ using bdi::runtime::memory::MemoryManager;
+ namespace {
+ RuntimeValue pointer(const void* address) {
+    return RuntimeValue::make(BDIType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)));
+ }
+ void testVerifyProof() {
+    MetadataStore store;
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID verify = t.op(BDIOperationType::META_VERIFY_PROOF, {}, BDIType::UNKNOWN, true);
+    const NodeID value = t.constant(BDIType::INT32, int32_t{7});
+    t.op(BDIOperationType::META_END, {value}, BDIType::UNKNOWN, true);
+    ProofTag tag;
+    tag.hash[0] = 0x5A;
+    tag.proof_system = "lean4";
+    t.graph.getNode(verify)->get().metadata_handle = store.addMetadata(tag);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BDIVirtualMachine vm;
+    // No store, then no verifier: the node fails
+    BDI_CHECK(!vm.execute(*compiled, start));
+    vm.setMetadataStore(&store);
+    BDI_CHECK(!vm.execute(*compiled, start));
+    NodeID checked = 0;
+    vm.setProofVerifier([&](NodeID node_id, const ProofTag& proof) {
+        checked = node_id;
+        return proof.proof_system == "lean4" && proof.hash[0] == 0x5A;
+    });
+    BDI_CHECK(vm.execute(*compiled, start));
+    BDI_CHECK(checked == verify);
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int32_t>() == 7);
+    vm.setProofVerifier([](NodeID, const ProofTag&) { return false; });
+    BDI_CHECK(!vm.execute(*compiled, start));
+    // A handle of another kind is not a proof
+    t.graph.getNode(verify)->get().metadata_handle = store.addMetadata(bdi::meta::SemanticTag{"not a proof"});
+    compiled = t.graph.freeze();
+    vm.setProofVerifier([](NodeID, const ProofTag&) { return true; });
+    BDI_CHECK(compiled && !vm.execute(*compiled, start));
+ }
+ // Lock words and atomic counters must lie in MemoryManager blocks; unlocking a free mutex fails
+ void testSync() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID lock_address = t.constant(BDIType::POINTER, uint64_t{0});
+    const NodeID counter_address = t.constant(BDIType::POINTER, uint64_t{0});
+    const NodeID delta = t.constant(BDIType::INT32, int32_t{5});
+    t.op(BDIOperationType::SYNC_MUTEX_LOCK, {lock_address}, BDIType::UNKNOWN, true);
+    t.op(BDIOperationType::SYNC_MUTEX_UNLOCK, {lock_address}, BDIType::UNKNOWN, true);
+    const NodeID add = t.op(BDIOperationType::SYNC_ATOMIC_RMW, {counter_address, delta}, BDIType::INT32, true);
+    t.op(BDIOperationType::META_END, {add}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    MemoryManager memory;
+    auto* words = static_cast<uint32_t*>(memory.allocate(0, 2 * sizeof(uint32_t)));
+    BDI_CHECK(words != nullptr);
+    if (!words) return;
+    words[0] = 0;
+    words[1] = 10;
+    BDIVirtualMachine vm;
+    vm.setNodePayload(lock_address, pointer(&words[0]));
+    vm.setNodePayload(counter_address, pointer(&words[1]));
+    BDI_CHECK(!vm.execute(*compiled, start)); // No MemoryManager
+    vm.setMemoryManager(&memory);
+    BDI_CHECK(vm.execute(*compiled, start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int32_t>() == 10);
+    BDI_CHECK(words[0] == 0 && words[1] == 15);
+    // Host memory, and a word running past the end of the block
+    uint32_t host[2] = {0, 10};
+    vm.setNodePayload(lock_address, pointer(&host[0]));
+    BDI_CHECK(!vm.execute(*compiled, start));
+    vm.setNodePayload(lock_address, pointer(&words[0]));
+    vm.setNodePayload(counter_address, pointer(&host[1]));
+    BDI_CHECK(!vm.execute(*compiled, start));
+    BDI_CHECK(host[1] == 10);
+    vm.setNodePayload(counter_address, pointer(reinterpret_cast<std::byte*>(&words[1]) + 2));
+    BDI_CHECK(!vm.execute(*compiled, start));
+    // Unlock without the lock: fails and leaves the word free
+    TestGraph u;
+    const NodeID unlock_start = u.start();
+    u.op(BDIOperationType::SYNC_MUTEX_UNLOCK, {u.constant(BDIType::POINTER, pointer(&words[0]))}, BDIType::UNKNOWN, true);
+    u.op(BDIOperationType::META_END, {}, BDIType::UNKNOWN, true);
+    auto unlock_only = u.graph.freeze();
+    BDI_CHECK(unlock_only && !vm.execute(*unlock_only, unlock_start));
+    BDI_CHECK(words[0] == 0);
+ }
+ // MEM_* reach only the live blocks of the node's region, and only within the block
+ void testMemoryBounds() {
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID size = t.constant(BDIType::UINT64, uint64_t{16});
+    const NodeID offset = t.constant(BDIType::UINT64, uint64_t{4});
+    const NodeID block = t.op(BDIOperationType::MEM_ALLOC, {size}, BDIType::POINTER, true);
+    t.op(BDIOperationType::MEM_STORE, {block, t.constant(BDIType::INT32, int32_t{7}), offset}, BDIType::UNKNOWN, true);
+    const NodeID load = t.op(BDIOperationType::MEM_LOAD, {block, offset}, BDIType::INT32, true);
+    t.op(BDIOperationType::META_END, {load}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    MemoryManager memory;
+    BDIVirtualMachine vm;
+    BDI_CHECK(!vm.execute(*compiled, start)); // No MemoryManager
+    vm.setMemoryManager(&memory);
+    BDI_CHECK(vm.execute(*compiled, start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int32_t>() == 7);
+    vm.setNodePayload(offset, RuntimeValue::make(BDIType::UINT64, uint64_t{12}));
+    BDI_CHECK(vm.execute(*compiled, start));
+    vm.setNodePayload(offset, RuntimeValue::make(BDIType::UINT64, uint64_t{13})); // Last byte past the block
+    BDI_CHECK(!vm.execute(*compiled, start));
+    vm.setNodePayload(offset, RuntimeValue::make(BDIType::UINT64, UINT64_MAX - 1)); // Wraps around
+    BDI_CHECK(!vm.execute(*compiled, start));
+    // Loads through a pointer constant: host memory, another region's block and a freed block fail
+    TestGraph l;
+    const NodeID load_start = l.start();
+    const NodeID address = l.constant(BDIType::POINTER, uint64_t{0});
+    l.op(BDIOperationType::META_END, {l.op(BDIOperationType::MEM_LOAD, {address}, BDIType::INT64, true)}, BDIType::UNKNOWN, true);
+    auto loads = l.graph.freeze();
+    BDI_CHECK(loads != nullptr);
+    if (!loads) return;
+    int64_t host = 1;
+    auto* own = static_cast<int64_t*>(memory.allocate(0, sizeof(int64_t)));
+    auto* other = static_cast<int64_t*>(memory.allocate(1, sizeof(int64_t)));
+    BDI_CHECK(own && other);
+    if (!own || !other) return;
+    *own = 42;
+    *other = 43;
+    vm.setNodePayload(address, pointer(own));
+    BDI_CHECK(vm.execute(*loads, load_start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<int64_t>() == 42);
+    vm.setNodePayload(address, pointer(&host));
+    BDI_CHECK(!vm.execute(*loads, load_start));
+    vm.setNodePayload(address, pointer(other));
+    BDI_CHECK(!vm.execute(*loads, load_start));
+    BDI_CHECK(memory.free(own));
+    vm.setNodePayload(address, pointer(own));
+    BDI_CHECK(!vm.execute(*loads, load_start));
+    // MEM_SET and MEM_COPY: the whole range must fit in both blocks
+    TestGraph c;
+    const NodeID copy_start = c.start();
+    const NodeID dst = c.constant(BDIType::POINTER, uint64_t{0});
+    const NodeID src = c.constant(BDIType::POINTER, uint64_t{0});
+    const NodeID bytes = c.constant(BDIType::UINT64, uint64_t{16});
+    c.op(BDIOperationType::MEM_SET, {src, c.constant(BDIType::UINT8, uint8_t{0x11}), bytes}, BDIType::UNKNOWN, true);
+    c.op(BDIOperationType::MEM_COPY, {dst, src, bytes}, BDIType::UNKNOWN, true);
+    c.op(BDIOperationType::META_END, {c.op(BDIOperationType::MEM_LOAD, {dst}, BDIType::UINT32, true)}, BDIType::UNKNOWN, true);
+    auto copies = c.graph.freeze();
+    BDI_CHECK(copies != nullptr);
+    if (!copies) return;
+    void* small = memory.allocate(0, 16);
+    void* large = memory.allocate(0, 32);
+    vm.setNodePayload(dst, pointer(small));
+    vm.setNodePayload(src, pointer(large));
+    BDI_CHECK(vm.execute(*copies, copy_start));
+    BDI_CHECK(vm.getReturnValue() && vm.getReturnValue()->as<uint32_t>() == 0x11111111u);
+    vm.setNodePayload(bytes, RuntimeValue::make(BDIType::UINT64, uint64_t{17})); // Past the end of 'small'
+    BDI_CHECK(!vm.execute(*copies, copy_start));
+    vm.setNodePayload(dst, pointer(large));
+    vm.setNodePayload(src, pointer(small)); // Now MEM_SET runs past it
+    BDI_CHECK(!vm.execute(*copies, copy_start));
+ }
+ // Floating nodes outside the dirty cone keep their value from the previous run
+ void testIncrementalFloating() {
+    MetadataStore store;
+    bdi::benchmarks::RandomDagOptions options;
+    options.nodes = 2000;
+    options.floating_fraction = 0.5;
+    auto generated = bdi::benchmarks::generateRandomDag(store, options);
+    auto compiled = generated.graph->freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    NodeID last_constant = 0;
+    for (const auto& [id, node] : *generated.graph) {
+        if (node->operation == BDIOperationType::META_NOP && id > last_constant) last_constant = id;
+    }
+    BDIVirtualMachine vm;
+    vm.setIncremental(true);
+    BDI_CHECK(vm.execute(*compiled, generated.entry));
+    const uint64_t full = vm.getRecomputedNodeCount();
+    BDI_CHECK(vm.execute(*compiled, generated.entry));
+    BDI_CHECK(vm.getRecomputedNodeCount() == 0);
+    BDI_CHECK(vm.getReusedNodeCount() >= options.nodes / 2);
+    const RuntimeValue edited = RuntimeValue::make(options.type, int64_t{41});
+    vm.setNodePayload(last_constant, edited);
+    BDI_CHECK(vm.execute(*compiled, generated.entry));
+    BDI_CHECK(vm.getRecomputedNodeCount() < full);
+    BDIVirtualMachine reference;
+    reference.setNodePayload(last_constant, edited);
+    BDI_CHECK(reference.execute(*compiled, generated.entry));
+    BDI_CHECK(vm.getReturnValue() && reference.getReturnValue() &&
+              vm.getReturnValue()->as<int64_t>() == reference.getReturnValue()->as<int64_t>());
+ }
+ // invalidate() on a constant whose payload did not change recomputes the nodes reading it, exactly as an
+ // edit of the payload would, and keeps every other result
+ void testInvalidateConstant() {
+    using Op = BDIOperationType;
+    TestGraph t;
+    const NodeID start = t.start();
+    const NodeID a = t.constant(BDIType::INT64, int64_t{5});
+    const NodeID k = t.constant(BDIType::INT64, int64_t{10});
+    const NodeID other = t.constant(BDIType::INT64, int64_t{3});
+    const NodeID sum = t.op(Op::ARITH_ADD, {a, k}, BDIType::INT64, true);
+    const NodeID side = t.op(Op::ARITH_MUL, {other, other}, BDIType::INT64, false);
+    const NodeID total = t.op(Op::ARITH_ADD, {sum, side}, BDIType::INT64, true);
+    t.op(Op::META_END, {total}, BDIType::UNKNOWN, true);
+    auto compiled = t.graph.freeze();
+    BDI_CHECK(compiled != nullptr);
+    if (!compiled) return;
+    BDIVirtualMachine vm;
+    vm.setIncremental(true);
+    auto returned = [&] { return vm.getReturnValue() ? vm.getReturnValue()->as<int64_t>() : -1; };
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 24);
+    BDI_CHECK(vm.getRecomputedNodeCount() == 3); // sum, side, total
+    // Same payload, but 'sum' and 'total' run again; 'side' is kept
+    vm.invalidate(a);
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 24);
+    BDI_CHECK(vm.getRecomputedNodeCount() == 2 && vm.getReusedNodeCount() > 0);
+    BDI_CHECK(vm.getOutputValue(sum, 0) && vm.getOutputValue(sum, 0)->as<int64_t>() == 15);
+    // Only for the next run
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 24 && vm.getRecomputedNodeCount() == 0);
+    // A floating reader is evaluated again too
+    vm.invalidate(other);
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 24 && vm.getRecomputedNodeCount() == 2);
+    BDI_CHECK(vm.getOutputValue(side, 0) && vm.getOutputValue(side, 0)->as<int64_t>() == 9);
+    // The same cone as an actual edit of the constant
+    vm.invalidate(k);
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 24);
+    const uint64_t invalidated = vm.getRecomputedNodeCount();
+    vm.setNodePayload(k, RuntimeValue::make(BDIType::INT64, int64_t{11}));
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 25);
+    BDI_CHECK(invalidated == 2 && vm.getRecomputedNodeCount() == invalidated);
+    // IDs the graph does not have are ignored
+    vm.invalidate(9999);
+    BDI_CHECK(vm.execute(*compiled, start) && returned() == 25 && vm.getRecomputedNodeCount() == 0);
+ }
+ } // namespace
+ int main() {
+    testVerifyProof();
+    testSync();
+    testMemoryBounds();
+    testIncrementalFloating();
+    testInvalidateConstant();
+    return bdi::tests::finish("VirtualMachineTests");
+ }
@@ -0,0 +1,100 @@
+// File: bdi/runtime/WorkStealingPool.cpp
+ #include "WorkStealingPool.hpp"
+ namespace bdi::runtime {
+ namespace {
+ // Worker identity of the current thread (pool pointer guards against nested pools)
+ thread_local const WorkStealingPool* tls_pool = nullptr;
+ thread_local int tls_worker_index = -1;
+ } // namespace
+ WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    if (thread_count == 0) thread_count = 1;
+    queues_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) queues_.push_back(std::make_unique<WorkerQueue>());
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) workers_.emplace_back([this, i] { workerLoop(i); });
+ }
+ WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_.store(true);
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+ }
+ int WorkStealingPool::currentWorkerIndex() const {
+    return tls_pool == this ? tls_worker_index : -1;
+ }
+ void WorkStealingPool::submit(Task task) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    int self = currentWorkerIndex();
+    size_t target = self >= 0 ? static_cast<size_t>(self)
+                              : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(task);
+    }
+    // seq_cst pairs with the sleeper's increment of sleepers_ before it re-checks queued_
+    queued_.fetch_add(1);
+    if (sleepers_.load() != 0) {
+        {
+            // Taking the lock orders this notify after a sleeper's predicate check
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        work_cv_.notify_one();
+    }
+ }
+ void WorkStealingPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    idle_cv_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+ }
+ bool WorkStealingPool::tryPop(size_t index, Task& task) {
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+ }
+ bool WorkStealingPool::trySteal(size_t thief, Task& task) {
+    const size_t n = queues_.size();
+    for (size_t k = 1; k < n; ++k) {
+        WorkerQueue& victim = *queues_[(thief + k) % n];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+ }
+ void WorkStealingPool::workerLoop(size_t index) {
+    tls_pool = this;
+    tls_worker_index = static_cast<int>(index);
+    constexpr int kSpinRounds = 64;
+    int idle_rounds = 0;
+    while (true) {
+        Task task;
+        if (tryPop(index, task) || trySteal(index, task)) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            idle_rounds = 0;
+            task.fn(task.context, task.arg);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                idle_cv_.notify_all();
+            }
+            continue;
+        }
+        if (++idle_rounds < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        work_cv_.wait(lock, [this] { return stop_.load() || queued_.load() != 0; });
+        sleepers_.fetch_sub(1);
+        if (stop_.load() && queued_.load() == 0) return;
+        idle_rounds = 0;
+    }
+ }
+ } // namespace bdi::runtime
@@ -0,0 +1,58 @@
+// File: bdi/runtime/WorkStealingPool.hpp
+ #ifndef BDI_RUNTIME_WORKSTEALINGPOOL_HPP
+ #define BDI_RUNTIME_WORKSTEALINGPOOL_HPP
+ #include <atomic>
+ #include <condition_variable>
+ #include <cstddef>
+ #include <cstdint>
+ #include <deque>
+ #include <memory>
+ #include <mutex>
+ #include <thread>
+ #include <vector>
+ namespace bdi::runtime {
+ // Fixed-size thread pool with one deque per worker.
+ // A worker pushes and pops its own tasks LIFO at the back (cache-warm continuation of the dataflow it
+ // just released) and steals FIFO from the front of other workers' deques when it runs dry.
+ class WorkStealingPool {
+ public:
+    // Plain function + context instead of std::function: node tasks are two words and never allocate
+    struct Task {
+        void (*fn)(void* context, uint32_t arg) = nullptr;
+        void* context = nullptr;
+        uint32_t arg = 0;
+    };
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    // Queue a task. From a worker thread it goes to that worker's own deque, otherwise round-robin.
+    void submit(Task task);
+    // Block until every submitted task (including tasks submitted by tasks) has finished
+    void waitIdle();
+    size_t getThreadCount() const { return workers_.size(); }
+    // Index of the calling worker, or -1 when called from outside the pool
+    int currentWorkerIndex() const;
+    uint64_t getStealCount() const { return steals_.load(std::memory_order_relaxed); }
+ private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> pending_{0};   // Submitted but not yet finished
+    std::atomic<size_t> queued_{0};    // Sitting in some deque
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<uint64_t> steals_{0};
+    std::atomic<size_t> sleepers_{0};  // Workers blocked on work_cv_; submit() only notifies when non-zero
+    std::atomic<bool> stop_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable work_cv_;  // Workers wait here when every deque is empty
+    std::condition_variable idle_cv_;  // waitIdle() waits here for pending_ == 0
+    void workerLoop(size_t index);
+    bool tryPop(size_t index, Task& task);
+    bool trySteal(size_t thief, Task& task);
+ };
+ } // namespace bdi::runtime
+ #endif // BDI_RUNTIME_WORKSTEALINGPOOL_HPP